@@ -5,40 +5,75 @@
 #pragma once
 #endif  // defined(_MSC_VER) && (_MSC_VER >= 1200)
 
+#include <cstddef>
+
+#include <array>
+#include <vector>
+
 #include <boost/asio/buffer.hpp>
 
 namespace ssf {
 namespace io {
 
-template <class BufferType>
+/// Buffer sequence with inline storage for InlineCapacity buffers
+///   Buffers beyond InlineCapacity spill to the heap, so a sequence sized
+///   from the buffer_count of its components never allocates
+template <class BufferType, std::size_t InlineCapacity = 4>
 class fixed_buffer_sequence {
  public:
-  typedef std::vector<BufferType> buffer_type;
-  typedef typename buffer_type::value_type value_type;
-  typedef typename buffer_type::iterator iterator;
-  typedef typename buffer_type::const_iterator const_iterator;
+  typedef BufferType value_type;
+  typedef value_type* iterator;
+  typedef const value_type* const_iterator;
+  enum { inline_capacity = InlineCapacity > 0 ? InlineCapacity : 1 };
 
-  fixed_buffer_sequence() : buffers_() {}
+  fixed_buffer_sequence() : inline_buffers_(), heap_buffers_(), size_(0) {}
 
   template <class BufferSequence>
   fixed_buffer_sequence(const BufferSequence& buffers)
-      : buffers_() {
+      : inline_buffers_(), heap_buffers_(), size_(0) {
     for (const auto& buffer : buffers) {
-      buffers_.push_back(buffer);
+      push_back(buffer);
     }
   }
 
-  iterator begin() { return buffers_.begin(); }
-  iterator end() { return buffers_.end(); }
+  iterator begin() { return data(); }
+  iterator end() { return data() + size_; }
+
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + size_; }
+
+  std::size_t size() const { return size_; }
+
+  void push_back(const value_type& val) {
+    if (heap_buffers_.empty() && size_ < inline_capacity) {
+      inline_buffers_[size_++] = val;
+      return;
+    }
+
+    if (heap_buffers_.empty()) {
+      heap_buffers_.reserve(2 * inline_capacity);
+      heap_buffers_.assign(inline_buffers_.begin(),
+                           inline_buffers_.begin() + size_);
+    }
+    heap_buffers_.push_back(val);
+    ++size_;
+  }
 
-  const_iterator begin() const { return buffers_.begin(); }
-  const_iterator end() const { return buffers_.end(); }
+ private:
+  value_type* data() {
+    return heap_buffers_.empty() ? inline_buffers_.data()
+                                 : heap_buffers_.data();
+  }
 
-  void push_back(const value_type& val) { buffers_.push_back(val); }
-  void push_back(value_type&& val) { buffers_.push_back(std::move(val)); }
+  const value_type* data() const {
+    return heap_buffers_.empty() ? inline_buffers_.data()
+                                 : heap_buffers_.data();
+  }
 
  private:
-  buffer_type buffers_;
+  std::array<value_type, inline_capacity> inline_buffers_;
+  std::vector<value_type> heap_buffers_;
+  std::size_t size_;
 };
 
 typedef fixed_buffer_sequence<boost::asio::mutable_buffer>
@@ -0,0 +1,105 @@
+#ifndef SSF_IO_GET_SOME_OP_H_
+#define SSF_IO_GET_SOME_OP_H_
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif  // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+
+#include <vector>
+
+#include <boost/asio/detail/addressof.hpp>
+#include <boost/asio/detail/bind_handler.hpp>
+#include <boost/asio/detail/fenced_block.hpp>
+#include <boost/asio/detail/handler_alloc_helpers.hpp>
+#include <boost/asio/detail/handler_invoke_helpers.hpp>
+#include <boost/asio/error.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace ssf {
+namespace io {
+
+/// Pending get of at most max_count elements
+template <class T>
+class basic_pending_get_some_operation BOOST_ASIO_INHERIT_TRACKED_HANDLER {
+ public:
+  typedef std::vector<T> Elements;
+
+  void complete(const boost::system::error_code& ec, Elements elements) {
+    auto destroy = false;
+    func_(this, destroy, ec, std::move(elements));
+  }
+
+  void destroy() {
+    auto destroy = true;
+    func_(this, destroy, boost::system::error_code(), Elements());
+  }
+
+  std::size_t max_count() const { return max_count_; }
+
+ protected:
+  typedef void (*func_type)(basic_pending_get_some_operation*, bool,
+                            const boost::system::error_code&, Elements);
+
+  basic_pending_get_some_operation(func_type func, std::size_t max_count)
+      : next_(nullptr), func_(func), max_count_(max_count) {}
+
+  ~basic_pending_get_some_operation() {}
+
+  friend class boost::asio::detail::op_queue_access;
+  basic_pending_get_some_operation* next_;
+  func_type func_;
+  std::size_t max_count_;
+};
+
+template <class Handler, class T>
+class pending_get_some_operation : public basic_pending_get_some_operation<T> {
+ public:
+  BOOST_ASIO_DEFINE_HANDLER_PTR(pending_get_some_operation);
+
+  typedef typename basic_pending_get_some_operation<T>::Elements Elements;
+
+  pending_get_some_operation(Handler handler, std::size_t max_count)
+      : basic_pending_get_some_operation<T>(
+            &pending_get_some_operation::do_complete, max_count),
+        handler_(std::move(handler)) {}
+
+  static void do_complete(basic_pending_get_some_operation<T>* base,
+                          bool destroy,
+                          const boost::system::error_code& result_ec,
+                          Elements elements) {
+    boost::system::error_code ec(result_ec);
+
+    pending_get_some_operation* o(
+        static_cast<pending_get_some_operation*>(base));
+
+    ptr p = {boost::asio::detail::addressof(o->handler_), o, o};
+
+    BOOST_ASIO_HANDLER_COMPLETION((o));
+
+    boost::asio::detail::binder2<Handler, boost::system::error_code, Elements>
+        handler(o->handler_, ec, std::move(elements));
+    p.h = boost::asio::detail::addressof(handler.handler_);
+    p.reset();
+
+    if (!destroy) {
+      boost::asio::detail::fenced_block b(
+          boost::asio::detail::fenced_block::half);
+      BOOST_ASIO_HANDLER_INVOCATION_BEGIN((handler.arg1_, handler.arg2_));
+      boost_asio_handler_invoke_helpers::invoke(handler, handler.handler_);
+      BOOST_ASIO_HANDLER_INVOCATION_END;
+    }
+  }
+
+ private:
+  Handler handler_;
+};
+
+}  // io
+}  // ssf
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif  // SSF_IO_GET_SOME_OP_H_
@@ -30,7 +30,7 @@ class basic_pending_push_operation BOOST_ASIO_INHERIT_TRACKED_HANDLER {
     func_(this, destroy, boost::system::error_code());
   }
 
-  T element() { return element_; }
+  T& element() { return element_; }
 
  protected:
   typedef void (*func_type)(basic_pending_push_operation*, bool,
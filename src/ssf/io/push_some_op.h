@@ -0,0 +1,119 @@
+#ifndef SSF_IO_PUSH_SOME_OP_H_
+#define SSF_IO_PUSH_SOME_OP_H_
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif  // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+
+#include <vector>
+
+#include <boost/asio/detail/addressof.hpp>
+#include <boost/asio/detail/bind_handler.hpp>
+#include <boost/asio/detail/fenced_block.hpp>
+#include <boost/asio/detail/handler_alloc_helpers.hpp>
+#include <boost/asio/detail/handler_invoke_helpers.hpp>
+#include <boost/asio/error.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace ssf {
+namespace io {
+
+/// Pending push of a batch of elements
+///   Elements are pushed in order, next_element() being the first one not
+///   pushed yet. The handler gets the number of pushed elements
+template <class T>
+class basic_pending_push_some_operation BOOST_ASIO_INHERIT_TRACKED_HANDLER {
+ public:
+  typedef std::vector<T> Elements;
+
+  void complete(const boost::system::error_code& ec) {
+    auto destroy = false;
+    func_(this, destroy, ec, pushed_);
+  }
+
+  void destroy() {
+    auto destroy = true;
+    func_(this, destroy, boost::system::error_code(), pushed_);
+  }
+
+  bool done() const { return pushed_ == elements_.size(); }
+
+  T& next_element() { return elements_[pushed_]; }
+
+  void element_pushed() { ++pushed_; }
+
+ protected:
+  typedef void (*func_type)(basic_pending_push_some_operation*, bool,
+                            const boost::system::error_code&, std::size_t);
+
+  basic_pending_push_some_operation(func_type func, Elements elements,
+                                    std::size_t pushed)
+      : next_(nullptr),
+        func_(func),
+        elements_(std::move(elements)),
+        pushed_(pushed) {}
+
+  ~basic_pending_push_some_operation() {}
+
+  friend class boost::asio::detail::op_queue_access;
+  basic_pending_push_some_operation* next_;
+  func_type func_;
+  Elements elements_;
+  std::size_t pushed_;
+};
+
+template <class Handler, class T>
+class pending_push_some_operation
+    : public basic_pending_push_some_operation<T> {
+ public:
+  BOOST_ASIO_DEFINE_HANDLER_PTR(pending_push_some_operation);
+
+  typedef typename basic_pending_push_some_operation<T>::Elements Elements;
+
+  pending_push_some_operation(Handler handler, Elements elements,
+                              std::size_t pushed)
+      : basic_pending_push_some_operation<T>(
+            &pending_push_some_operation::do_complete, std::move(elements),
+            pushed),
+        handler_(std::move(handler)) {}
+
+  static void do_complete(basic_pending_push_some_operation<T>* base,
+                          bool destroy,
+                          const boost::system::error_code& result_ec,
+                          std::size_t pushed) {
+    boost::system::error_code ec(result_ec);
+
+    pending_push_some_operation* o(
+        static_cast<pending_push_some_operation*>(base));
+
+    ptr p = {boost::asio::detail::addressof(o->handler_), o, o};
+
+    BOOST_ASIO_HANDLER_COMPLETION((o));
+
+    boost::asio::detail::binder2<Handler, boost::system::error_code,
+                                 std::size_t> handler(o->handler_, ec, pushed);
+    p.h = boost::asio::detail::addressof(handler.handler_);
+    p.reset();
+
+    if (!destroy) {
+      boost::asio::detail::fenced_block b(
+          boost::asio::detail::fenced_block::half);
+      BOOST_ASIO_HANDLER_INVOCATION_BEGIN((handler.arg1_, handler.arg2_));
+      boost_asio_handler_invoke_helpers::invoke(handler, handler.handler_);
+      BOOST_ASIO_HANDLER_INVOCATION_END;
+    }
+  }
+
+ private:
+  Handler handler_;
+};
+
+}  // io
+}  // ssf
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif  // SSF_IO_PUSH_SOME_OP_H_
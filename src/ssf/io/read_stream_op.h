@@ -18,6 +18,7 @@
 #include <boost/asio/error.hpp>
 #include <boost/asio/streambuf.hpp>
 
+#include "ssf/io/buffers.h"
 #include "ssf/io/op.h"
 
 #include <boost/asio/detail/push_options.hpp>
@@ -31,6 +32,8 @@ class basic_pending_read_stream_operation
  protected:
   typedef size_t (*fill_buffer_func_type)(
       basic_pending_read_stream_operation*, boost::asio::streambuf&);
+  typedef io::fixed_mutable_buffer_sequence (*mutable_buffers_func_type)(
+      basic_pending_read_stream_operation*);
 
  protected:
   /// Constructor
@@ -39,17 +42,25 @@ class basic_pending_read_stream_operation
   */
   basic_pending_read_stream_operation(
       basic_pending_sized_io_operation::func_type func,
-      fill_buffer_func_type fill_buffer_func)
+      fill_buffer_func_type fill_buffer_func,
+      mutable_buffers_func_type mutable_buffers_func)
       : basic_pending_sized_io_operation(func),
-        fill_buffer_func_(fill_buffer_func) {}
+        fill_buffer_func_(fill_buffer_func),
+        mutable_buffers_func_(mutable_buffers_func) {}
 
  public:
    size_t fill_buffer(boost::asio::streambuf& stream) {
     return fill_buffer_func_(this, stream);
   }
 
+  /// The user buffers, to receive in them directly
+  io::fixed_mutable_buffer_sequence mutable_buffers() {
+    return mutable_buffers_func_(this);
+  }
+
  private:
   fill_buffer_func_type fill_buffer_func_;
+  mutable_buffers_func_type mutable_buffers_func_;
 };
 
 /// Class to store read operations
@@ -70,7 +81,8 @@ class pending_read_stream_operation
                                 Handler handler)
       : basic_pending_read_stream_operation(
             &pending_read_stream_operation::do_complete,
-            &pending_read_stream_operation::do_fill_buffer),
+            &pending_read_stream_operation::do_fill_buffer,
+            &pending_read_stream_operation::do_mutable_buffers),
         buffers_(buffers),
         handler_(std::move(handler)) {}
 
@@ -125,6 +137,13 @@ class pending_read_stream_operation
     return copied;
   }
 
+  static io::fixed_mutable_buffer_sequence do_mutable_buffers(
+      basic_pending_read_stream_operation* base) {
+    pending_read_stream_operation* o(
+        static_cast<pending_read_stream_operation*>(base));
+    return o->buffers_;
+  }
+
  private:
   MutableBufferSequence buffers_;
   Handler handler_;
@@ -0,0 +1,34 @@
+#ifndef SSF_LAYER_CONGESTION_BYTE_LIMIT_POLICY_H_
+#define SSF_LAYER_CONGESTION_BYTE_LIMIT_POLICY_H_
+
+#include <cstdint>
+
+#include "ssf/layer/congestion/drop_counter.h"
+
+namespace ssf {
+namespace layer {
+namespace congestion {
+
+/// Drop packets which would bring the queue over MaxBytes bytes
+///   The queue counts its bytes (Queue::bytes()), whatever its scheduling.
+///   A packet is always addable to an empty queue
+template <uint32_t MaxBytes>
+class ByteLimitPolicy : public DropCounter {
+ public:
+  template <class Queue, class Packet>
+  bool IsAddable(const Queue& queue, const Packet& packet) {
+    auto bytes = PacketSize(packet);
+    return Admit(queue.empty() || queue.bytes() + bytes <= MaxBytes, bytes);
+  }
+
+  template <class Queue>
+  bool IsAddable(const Queue& queue) {
+    return Admit(queue.empty() || queue.bytes() <= MaxBytes, 0);
+  }
+};
+
+}  // congestion
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CONGESTION_BYTE_LIMIT_POLICY_H_
@@ -0,0 +1,118 @@
+#ifndef SSF_LAYER_CONGESTION_CODEL_POLICY_H_
+#define SSF_LAYER_CONGESTION_CODEL_POLICY_H_
+
+#include <cmath>
+#include <cstdint>
+
+#include <chrono>
+
+#include "ssf/layer/congestion/drop_counter.h"
+#include "ssf/layer/congestion/queue_history.h"
+
+namespace ssf {
+namespace layer {
+namespace congestion {
+
+/// Controlled delay (CoDel) active queue management
+///   Once the oldest packet of the queue has waited more than TargetMs
+///   milliseconds for IntervalMs milliseconds, packets are dropped at an
+///   increasing rate (IntervalMs / sqrt(drops)) until the sojourn time gets
+///   back under TargetMs. Policies only decide at enqueue : arriving packets
+///   are dropped instead of the head of the queue. The queue never holds
+///   more than MaxSize packets
+///   The sojourn times are only exact on FIFO queues (FifoScheduler and the
+///   receive rings), see QueueHistory
+template <uint32_t TargetMs = 5, uint32_t IntervalMs = 100,
+          uint32_t MaxSize = 1000>
+class CoDelPolicy : public DropCounter {
+ private:
+  typedef QueueHistory::Clock Clock;
+
+ public:
+  CoDelPolicy()
+      : history_(),
+        dropping_(false),
+        count_(0),
+        first_above_time_(),
+        drop_next_() {}
+
+  template <class Queue, class Packet>
+  bool IsAddable(const Queue& queue, const Packet& packet) {
+    return AdmitPacket(Enqueue(queue.size()), packet);
+  }
+
+  template <class Queue>
+  bool IsAddable(const Queue& queue) {
+    return Admit(Enqueue(queue.size()), 0);
+  }
+
+ private:
+  bool Enqueue(std::size_t size) {
+    history_.Sync(size);
+
+    auto now = Clock::now();
+    auto addable = size < MaxSize && !ShouldDrop(now);
+    if (addable) {
+      history_.Add(now);
+    }
+
+    return addable;
+  }
+
+  bool ShouldDrop(Clock::time_point now) {
+    if (history_.Sojourn(now) < std::chrono::milliseconds(TargetMs)) {
+      first_above_time_ = Clock::time_point();
+      dropping_ = false;
+      return false;
+    }
+
+    if (first_above_time_ == Clock::time_point()) {
+      first_above_time_ = now + std::chrono::milliseconds(IntervalMs);
+      return false;
+    }
+
+    if (!dropping_) {
+      if (now < first_above_time_) {
+        return false;
+      }
+
+      // Resume near the previous drop rate if the last dropping state was
+      // recent
+      dropping_ = true;
+      count_ = (count_ > 2 &&
+                now - drop_next_ < std::chrono::milliseconds(16 * IntervalMs))
+                   ? count_ - 2
+                   : 1;
+      drop_next_ = ControlLaw(now);
+      return true;
+    }
+
+    if (now < drop_next_) {
+      return false;
+    }
+
+    ++count_;
+    drop_next_ = ControlLaw(drop_next_);
+    return true;
+  }
+
+  Clock::time_point ControlLaw(Clock::time_point t) const {
+    return t + std::chrono::duration_cast<Clock::duration>(
+                   std::chrono::microseconds(static_cast<int64_t>(
+                       1000.0 * IntervalMs /
+                       std::sqrt(static_cast<double>(count_)))));
+  }
+
+ private:
+  QueueHistory history_;
+  bool dropping_;
+  uint32_t count_;
+  Clock::time_point first_above_time_;
+  Clock::time_point drop_next_;
+};
+
+}  // congestion
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CONGESTION_CODEL_POLICY_H_
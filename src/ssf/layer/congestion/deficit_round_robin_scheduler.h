@@ -0,0 +1,167 @@
+#ifndef SSF_LAYER_CONGESTION_DEFICIT_ROUND_ROBIN_SCHEDULER_H_
+#define SSF_LAYER_CONGESTION_DEFICIT_ROUND_ROBIN_SCHEDULER_H_
+
+#include <cstdint>
+
+#include <deque>
+#include <map>
+#include <utility>
+
+#include <boost/asio/buffer.hpp>
+
+namespace ssf {
+namespace layer {
+namespace congestion {
+
+/// Scheduling class of a flow
+///   Flows of a lower priority value are always served first (strict
+///   priority), flows of the same priority share the link in proportion of
+///   their weight. A null weight is taken as 1, a flow never starves in its
+///   round
+struct FlowClass {
+  FlowClass(uint32_t p, uint32_t w) : priority(p), weight(w ? w : 1) {}
+
+  uint32_t priority;
+  uint32_t weight;
+};
+
+/// All flows in the same class with the same weight
+struct UniformFlowClassifier {
+  template <class FlowID>
+  static FlowClass Classify(const FlowID& flow_id) {
+    return FlowClass(0, 1);
+  }
+};
+
+/// Deficit round robin between flows
+///   Each turn, a flow may send Quantum * weight bytes (plus what it did not
+///   use in its previous turns). A bulk flow cannot delay the datagrams of
+///   the other flows by more than one round, however large its backlog.
+///   Quantum should be at least the mtu of the flows for a round to serve
+///   each active flow
+template <uint32_t Quantum, class Classifier = UniformFlowClassifier>
+class DeficitRoundRobinScheduler {
+  static_assert(Quantum > 0, "Quantum must be positive");
+
+ public:
+  /// Element::datagram is the scheduled datagram, FlowID its flow (ordered)
+  template <class Element, class FlowID>
+  class Queue {
+   private:
+    struct Flow {
+      Flow() : credit(0), deficit(0), elements() {}
+
+      /// Bytes granted each turn
+      uint64_t credit;
+      uint64_t deficit;
+      /// Elements with their size
+      std::deque<std::pair<std::size_t, Element>> elements;
+    };
+
+    typedef typename std::map<FlowID, Flow>::iterator FlowIt;
+
+    /// Flows with queued elements, in round order
+    typedef std::deque<FlowIt> Round;
+
+   public:
+    Queue() : size_(0), bytes_(0), flows_(), rounds_(), selected_(false) {}
+
+    bool empty() const { return !size_; }
+    std::size_t size() const { return size_; }
+
+    /// Bytes of the queued datagrams, whatever their flow
+    uint64_t bytes() const { return bytes_; }
+
+    void push(Element element) {
+      auto size = boost::asio::buffer_size(element.datagram.GetConstBuffers());
+      auto flow_id = element.datagram.header().id();
+
+      auto inserted = flows_.insert(std::make_pair(flow_id, Flow()));
+      auto flow_it = inserted.first;
+      if (inserted.second) {
+        auto flow_class = Classifier::Classify(flow_id);
+        flow_it->second.credit =
+            static_cast<uint64_t>(Quantum) * flow_class.weight;
+        flow_it->second.deficit = flow_it->second.credit;
+
+        auto round_inserted =
+            rounds_.insert(std::make_pair(flow_class.priority, Round()));
+        round_inserted.first->second.push_back(flow_it);
+        if (round_inserted.second) {
+          // The new round may take precedence over the selected flow
+          selected_ = false;
+        }
+      }
+
+      flow_it->second.elements.emplace_back(size, std::move(element));
+      ++size_;
+      bytes_ += size;
+    }
+
+    /// Next element to send, the queue must not be empty
+    Element& front() {
+      return Select()->second.elements.front().second;
+    }
+
+    /// Remove the front element
+    void pop() {
+      auto flow_it = Select();
+      auto& flow = flow_it->second;
+
+      flow.deficit -= flow.elements.front().first;
+      bytes_ -= flow.elements.front().first;
+      flow.elements.pop_front();
+      --size_;
+      selected_ = false;
+
+      if (flow.elements.empty()) {
+        // Idle flows lose their deficit
+        Round& round = rounds_.begin()->second;
+        round.pop_front();
+        if (round.empty()) {
+          rounds_.erase(rounds_.begin());
+        }
+        flows_.erase(flow_it);
+      }
+    }
+
+   private:
+    /// Flow of the front element : the first flow of the highest priority
+    ///   round with enough deficit for its head element. Flows without
+    ///   enough deficit get a new credit and go to the back of the round
+    FlowIt Select() {
+      Round& round = rounds_.begin()->second;
+      if (selected_) {
+        return round.front();
+      }
+
+      for (;;) {
+        auto flow_it = round.front();
+        auto& flow = flow_it->second;
+        if (flow.deficit >= flow.elements.front().first) {
+          selected_ = true;
+          return flow_it;
+        }
+
+        round.pop_front();
+        flow.deficit += flow.credit;
+        round.push_back(flow_it);
+      }
+    }
+
+   private:
+    std::size_t size_;
+    uint64_t bytes_;
+    std::map<FlowID, Flow> flows_;
+    /// Rounds by priority
+    std::map<uint32_t, Round> rounds_;
+    /// Whether the front flow of the first round was selected
+    bool selected_;
+  };
+};
+
+}  // congestion
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CONGESTION_DEFICIT_ROUND_ROBIN_SCHEDULER_H_
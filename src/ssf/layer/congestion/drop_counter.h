@@ -0,0 +1,69 @@
+#ifndef SSF_LAYER_CONGESTION_DROP_COUNTER_H_
+#define SSF_LAYER_CONGESTION_DROP_COUNTER_H_
+
+#include <cstdint>
+
+#include <atomic>
+
+#include <boost/asio/buffer.hpp>
+
+namespace ssf {
+namespace layer {
+namespace congestion {
+
+/// Size in bytes of a packet (datagram or payload)
+template <class Packet>
+std::size_t PacketSize(const Packet& packet) {
+  return boost::asio::buffer_size(packet.GetConstBuffers());
+}
+
+/// Packets and bytes dropped, read from one or more DropCounter
+struct DropStats {
+  DropStats() : packets(0), bytes(0) {}
+
+  template <class Counter>
+  void Add(const Counter& counter) {
+    packets += counter.dropped_packets();
+    bytes += counter.dropped_bytes();
+  }
+
+  uint64_t packets;
+  uint64_t bytes;
+};
+
+/// Packets and bytes dropped by a congestion policy
+///   Counters may be read from any thread
+class DropCounter {
+ public:
+  DropCounter() : dropped_packets_(0), dropped_bytes_(0) {}
+
+  uint64_t dropped_packets() const { return dropped_packets_; }
+  uint64_t dropped_bytes() const { return dropped_bytes_; }
+
+ protected:
+  /// Count the packet if not addable
+  bool Admit(bool addable, std::size_t bytes) {
+    if (!addable) {
+      ++dropped_packets_;
+      dropped_bytes_ += bytes;
+    }
+
+    return addable;
+  }
+
+  /// Count the packet if not addable, its size is only computed on drop
+  template <class Packet>
+  bool AdmitPacket(bool addable, const Packet& packet) {
+    return addable || Admit(false, PacketSize(packet));
+  }
+
+ private:
+  std::atomic<uint64_t> dropped_packets_;
+  std::atomic<uint64_t> dropped_bytes_;
+};
+
+}  // congestion
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CONGESTION_DROP_COUNTER_H_
@@ -1,21 +1,25 @@
 #ifndef SSF_LAYER_CONGESTION_DROP_TAIL_POLICY_H_
 #define SSF_LAYER_CONGESTION_DROP_TAIL_POLICY_H_
 
+#include <cstdint>
+
+#include "ssf/layer/congestion/drop_counter.h"
+
 namespace ssf {
 namespace layer {
 namespace congestion {
 
 template<uint32_t MaxSize>
-class DropTailPolicy {
+class DropTailPolicy : public DropCounter {
  public:
   template<class Queue, class Packet>
   bool IsAddable(const Queue& queue, const Packet& packet) {
-    return queue.size() < MaxSize;
+    return AdmitPacket(queue.size() < MaxSize, packet);
   }
 
   template <class Queue>
   bool IsAddable(const Queue& queue) {
-    return queue.size() < MaxSize;
+    return Admit(queue.size() < MaxSize, 0);
   }
 };
 
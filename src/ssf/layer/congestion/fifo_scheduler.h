@@ -0,0 +1,53 @@
+#ifndef SSF_LAYER_CONGESTION_FIFO_SCHEDULER_H_
+#define SSF_LAYER_CONGESTION_FIFO_SCHEDULER_H_
+
+#include <cstdint>
+
+#include <deque>
+#include <utility>
+
+#include <boost/asio/buffer.hpp>
+
+namespace ssf {
+namespace layer {
+namespace congestion {
+
+/// Datagrams are sent in their arrival order, whatever their flow
+struct FifoScheduler {
+  /// Element::datagram is the queued datagram
+  template <class Element, class FlowID>
+  class Queue {
+   public:
+    Queue() : elements_(), bytes_(0) {}
+
+    bool empty() const { return elements_.empty(); }
+    std::size_t size() const { return elements_.size(); }
+
+    /// Bytes of the queued datagrams
+    uint64_t bytes() const { return bytes_; }
+
+    void push(Element element) {
+      auto size = boost::asio::buffer_size(element.datagram.GetConstBuffers());
+      elements_.emplace_back(size, std::move(element));
+      bytes_ += size;
+    }
+
+    Element& front() { return elements_.front().second; }
+
+    void pop() {
+      bytes_ -= elements_.front().first;
+      elements_.pop_front();
+    }
+
+   private:
+    /// Elements with their size
+    std::deque<std::pair<std::size_t, Element>> elements_;
+    uint64_t bytes_;
+  };
+};
+
+}  // congestion
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CONGESTION_FIFO_SCHEDULER_H_
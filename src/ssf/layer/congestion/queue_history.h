@@ -0,0 +1,48 @@
+#ifndef SSF_LAYER_CONGESTION_QUEUE_HISTORY_H_
+#define SSF_LAYER_CONGESTION_QUEUE_HISTORY_H_
+
+#include <chrono>
+#include <deque>
+
+namespace ssf {
+namespace layer {
+namespace congestion {
+
+/// Arrival time of the packets admitted in a queue, oldest first
+///   Policies only see the size of the queue : the packets which left it
+///   since the last call are taken as the oldest ones. Only FIFO queues
+///   dequeue in that order, a scheduled queue (DeficitRoundRobinScheduler)
+///   may keep an old packet of a slow flow while the history drops it
+class QueueHistory {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+ public:
+  QueueHistory() : arrivals_() {}
+
+  /// Forget the packets which left the queue of size packets
+  void Sync(std::size_t size) {
+    while (arrivals_.size() > size) {
+      arrivals_.pop_front();
+    }
+  }
+
+  void Add(Clock::time_point arrival) { arrivals_.push_back(arrival); }
+
+  bool empty() const { return arrivals_.empty(); }
+
+  /// Time spent in the queue by its oldest packet
+  Clock::duration Sojourn(Clock::time_point now) const {
+    return arrivals_.empty() ? Clock::duration::zero()
+                             : now - arrivals_.front();
+  }
+
+ private:
+  std::deque<Clock::time_point> arrivals_;
+};
+
+}  // congestion
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CONGESTION_QUEUE_HISTORY_H_
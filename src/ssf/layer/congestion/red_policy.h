@@ -0,0 +1,91 @@
+#ifndef SSF_LAYER_CONGESTION_RED_POLICY_H_
+#define SSF_LAYER_CONGESTION_RED_POLICY_H_
+
+#include <cstdint>
+
+#include <random>
+
+#include "ssf/layer/congestion/drop_counter.h"
+
+namespace ssf {
+namespace layer {
+namespace congestion {
+
+/// Random early detection (gentle variant) on the queue size in packets
+///   The average queue size is an exponential moving average (weight 1/16)
+///   of the queue size at each arrival. Under MinSize, packets are kept.
+///   Between MinSize and MaxSize, the drop probability grows from 0 to
+///   MaxProbabilityPercent %, then to 100 % at twice MaxSize. The queue
+///   never holds more than twice MaxSize packets
+template <uint32_t MinSize, uint32_t MaxSize,
+          uint32_t MaxProbabilityPercent = 10>
+class REDPolicy : public DropCounter {
+  static_assert(MinSize < MaxSize, "MinSize must be lower than MaxSize");
+
+ public:
+  REDPolicy() : average_(0), count_(0), generator_(), distribution_(0, 1) {}
+
+  template <class Queue, class Packet>
+  bool IsAddable(const Queue& queue, const Packet& packet) {
+    return AdmitPacket(Enqueue(queue.size()), packet);
+  }
+
+  template <class Queue>
+  bool IsAddable(const Queue& queue) {
+    return Admit(Enqueue(queue.size()), 0);
+  }
+
+  /// Average queue size at the last call
+  double average_size() const { return average_; }
+
+ private:
+  enum { weight_shift = 4 };
+
+  bool Enqueue(std::size_t size) {
+    average_ += (static_cast<double>(size) - average_) / (1 << weight_shift);
+
+    if (size >= 2 * MaxSize || average_ >= 2 * MaxSize) {
+      count_ = 0;
+      return false;
+    }
+
+    if (average_ < MinSize) {
+      count_ = 0;
+      return true;
+    }
+
+    double max_probability = MaxProbabilityPercent / 100.0;
+    double probability =
+        (average_ < MaxSize)
+            ? max_probability * (average_ - MinSize) / (MaxSize - MinSize)
+            : max_probability +
+                  (1 - max_probability) * (average_ - MaxSize) / MaxSize;
+
+    // Spread the drops evenly between packets
+    ++count_;
+    if (count_ * probability < 1) {
+      probability /= 1 - count_ * probability;
+    } else {
+      probability = 1;
+    }
+
+    if (distribution_(generator_) < probability) {
+      count_ = 0;
+      return false;
+    }
+
+    return true;
+  }
+
+ private:
+  double average_;
+  uint32_t count_;
+  std::minstd_rand generator_;
+  std::uniform_real_distribution<double> distribution_;
+};
+
+}  // congestion
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CONGESTION_RED_POLICY_H_
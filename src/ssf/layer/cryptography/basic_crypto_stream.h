@@ -504,6 +504,11 @@ class basic_CryptoStreamAcceptor_service
   boost::system::error_code bind(implementation_type& impl,
                                  const endpoint_type& endpoint,
                                  boost::system::error_code& ec) {
+    if (CryptoProtocol::check_acceptor_context(endpoint.endpoint_context(),
+                                               ec)) {
+      return ec;
+    }
+
     impl.p_local_endpoint = std::make_shared<endpoint_type>(endpoint);
     return impl.p_next_layer_acceptor->bind(endpoint.next_layer_endpoint(), ec);
   }
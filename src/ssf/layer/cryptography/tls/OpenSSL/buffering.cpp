@@ -0,0 +1,184 @@
+#include "ssf/layer/cryptography/tls/OpenSSL/buffering.h"
+
+#include <algorithm>
+
+#include "ssf/layer/cryptography/tls/OpenSSL/ex_data.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/helpers.h"
+#include "ssf/utils/map_helpers.h"
+
+namespace ssf {
+namespace layer {
+namespace cryptography {
+namespace detail {
+
+bool SetCtxBuffering(boost::asio::ssl::context& ctx,
+                     const LayerParameters& parameters) {
+  static const char* const buffering_fields[] = {
+      "receive_buffer_size", "low_watermark",    "high_watermark",
+      "adaptive_buffering",  "direct_read",      "write_coalescing",
+      "write_record_size",   "write_flush_latency"};
+
+  auto custom = false;
+  for (auto field : buffering_fields) {
+    custom |= helpers::GetField<std::string>(field, parameters) != "";
+  }
+
+  if (!custom) {
+    return true;
+  }
+
+  TLSBufferingOptions options;
+
+  if (!GetUInt32Field(parameters, "receive_buffer_size",
+                      options.receive_buffer_size,
+                      &options.receive_buffer_size) ||
+      !GetUInt32Field(parameters, "low_watermark", options.low_watermark,
+                      &options.low_watermark) ||
+      !GetUInt32Field(parameters, "high_watermark", options.high_watermark,
+                      &options.high_watermark) ||
+      !GetUInt32Field(parameters, "write_record_size",
+                      options.write_record_size,
+                      &options.write_record_size) ||
+      !GetUInt32Field(parameters, "write_flush_latency",
+                      options.write_flush_latency,
+                      &options.write_flush_latency)) {
+    return false;
+  }
+
+  options.adaptive =
+      helpers::GetField<std::string>("adaptive_buffering", parameters) ==
+      "true";
+  options.direct_read =
+      helpers::GetField<std::string>("direct_read", parameters) != "false";
+  options.coalesce_writes =
+      helpers::GetField<std::string>("write_coalescing", parameters) ==
+      "true";
+
+  if (!options.receive_buffer_size || !options.high_watermark ||
+      options.low_watermark > options.high_watermark ||
+      !options.write_record_size ||
+      options.write_record_size > TLSBufferingOptions::max_record_size) {
+    return false;
+  }
+
+  return CtxExData<TLSBufferingOptions>::Set(ctx.native_handle(),
+                                             new TLSBufferingOptions(options));
+}
+
+TLSBufferingOptions GetCtxBuffering(SSL_CTX* p_ctx) {
+  auto p_options = CtxExData<TLSBufferingOptions>::Get(p_ctx);
+
+  if (!p_options) {
+    return TLSBufferingOptions();
+  }
+
+  return *p_options;
+}
+
+std::atomic<uint64_t> TLSBufferingBudget::limit_(0);
+std::atomic<uint64_t> TLSBufferingBudget::used_(0);
+
+void TLSBufferingBudget::SetLimit(uint64_t limit) { limit_ = limit; }
+
+uint64_t TLSBufferingBudget::Limit() { return limit_; }
+
+uint64_t TLSBufferingBudget::Used() { return used_; }
+
+bool TLSBufferingBudget::Reserve(std::size_t size, bool force) {
+  auto used = used_.fetch_add(size) + size;
+  auto limit = limit_.load();
+
+  if (force || !limit || used <= limit) {
+    return true;
+  }
+
+  used_.fetch_sub(size);
+  return false;
+}
+
+void TLSBufferingBudget::Release(std::size_t size) { used_.fetch_sub(size); }
+
+TLSReceiveWindow::TLSReceiveWindow(const TLSBufferingOptions& options)
+    : options_(options),
+      min_read_size_(options.receive_buffer_size),
+      read_size_(options.receive_buffer_size),
+      low_watermark_(options.low_watermark),
+      high_watermark_(options.high_watermark),
+      min_high_watermark_(options.high_watermark),
+      consumed_(0),
+      reads_(0),
+      full_reads_(0),
+      last_update_(clock_type::now()) {
+  if (options_.adaptive) {
+    // Start small, grow with the consumer up to the configured sizes
+    min_read_size_ = std::min<std::size_t>(
+        options_.receive_buffer_size, TLSBufferingOptions::max_record_size);
+    read_size_ = min_read_size_;
+    min_high_watermark_ = std::min<std::size_t>(
+        options_.high_watermark,
+        std::max<std::size_t>(options_.low_watermark,
+                              2 * options_.receive_buffer_size));
+    SetHighWatermark(min_high_watermark_);
+  }
+}
+
+void TLSReceiveWindow::ReadCompleted(std::size_t read_size,
+                                     std::size_t length) {
+  ++reads_;
+  if (length == read_size) {
+    ++full_reads_;
+  }
+}
+
+void TLSReceiveWindow::Consumed(std::size_t length) { consumed_ += length; }
+
+void TLSReceiveWindow::Update() {
+  if (!options_.adaptive) {
+    return;
+  }
+
+  auto now = clock_type::now();
+  auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        now - last_update_).count();
+  if (elapsed_ms < adaptation_interval_ms) {
+    return;
+  }
+
+  std::size_t max_read_size = options_.receive_buffer_size;
+
+  if (!consumed_) {
+    // Idle
+    read_size_ = std::max(read_size_ / 2, min_read_size_);
+    SetHighWatermark(high_watermark_ / 2);
+  } else {
+    if (full_reads_ * 2 >= reads_ && reads_) {
+      read_size_ = std::min(read_size_ * 2, max_read_size);
+    } else if (!full_reads_) {
+      read_size_ = std::max(read_size_ / 2, min_read_size_);
+    }
+
+    auto target = static_cast<std::size_t>(consumed_ * target_buffering_ms /
+                                           elapsed_ms);
+    SetHighWatermark(std::max(target, high_watermark_ / 2));
+  }
+
+  consumed_ = 0;
+  reads_ = 0;
+  full_reads_ = 0;
+  last_update_ = now;
+}
+
+void TLSReceiveWindow::SetHighWatermark(std::size_t high_watermark) {
+  high_watermark_ = std::min<std::size_t>(
+      std::max(high_watermark, min_high_watermark_), options_.high_watermark);
+
+  // Keep the configured low/high ratio
+  low_watermark_ = static_cast<std::size_t>(
+      static_cast<uint64_t>(high_watermark_) * options_.low_watermark /
+      options_.high_watermark);
+}
+
+}  // detail
+}  // cryptography
+}  // layer
+}  // ssf
@@ -0,0 +1,136 @@
+#ifndef SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_BUFFERING_H_
+#define SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_BUFFERING_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+
+#include <boost/asio/ssl.hpp>
+
+#include "ssf/layer/parameters.h"
+
+namespace ssf {
+namespace layer {
+namespace cryptography {
+namespace detail {
+
+/// Buffering of the TLS sockets
+///   Receive (buffered TLS sockets only) : reads of receive_buffer_size bytes
+///   are issued until high_watermark bytes are buffered, and resume below
+///   low_watermark. With direct_read, a pending user read of at least one
+///   record with nothing buffered receives the data directly.
+///   Send : with coalesce_writes, user writes are gathered in records of up
+///   to write_record_size bytes, flushed at the latest write_flush_latency
+///   microseconds after the first queued write (0 : at the end of the strand
+///   turn)
+struct TLSBufferingOptions {
+  enum {
+    default_receive_buffer_size = 50 * 1024,
+    default_low_watermark = 1 * 1024 * 1024,
+    default_high_watermark = 16 * 1024 * 1024,
+    max_record_size = 16 * 1024
+  };
+
+  TLSBufferingOptions()
+      : receive_buffer_size(default_receive_buffer_size),
+        low_watermark(default_low_watermark),
+        high_watermark(default_high_watermark),
+        adaptive(false),
+        direct_read(true),
+        coalesce_writes(false),
+        write_record_size(max_record_size),
+        write_flush_latency(0) {}
+
+  uint32_t receive_buffer_size;
+  uint32_t low_watermark;
+  uint32_t high_watermark;
+
+  /// Grow the read size (from one record) and the high watermark up to the
+  /// configured values with the consumer throughput, shrink them when idle
+  bool adaptive;
+
+  bool direct_read;
+
+  bool coalesce_writes;
+  uint32_t write_record_size;
+  uint32_t write_flush_latency;
+};
+
+/// Set the buffering options of the sockets using ctx
+///   "receive_buffer_size", "low_watermark", "high_watermark" (bytes),
+///   "adaptive_buffering" = "true", "direct_read" = "false",
+///   "write_coalescing" = "true", "write_record_size" (bytes),
+///   "write_flush_latency" (microseconds)
+bool SetCtxBuffering(boost::asio::ssl::context& ctx,
+                     const LayerParameters& parameters);
+
+TLSBufferingOptions GetCtxBuffering(SSL_CTX* p_ctx);
+
+/// Process wide budget of bytes buffered by the buffered TLS sockets
+///   A socket with nothing buffered may always read, so that every socket
+///   keeps progressing when the budget is exhausted
+class TLSBufferingBudget {
+ public:
+  /// Set the budget in bytes, 0 for no limit (default)
+  static void SetLimit(uint64_t limit);
+  static uint64_t Limit();
+  static uint64_t Used();
+
+  /// Reserve size bytes, always succeed if force is set
+  static bool Reserve(std::size_t size, bool force);
+  static void Release(std::size_t size);
+
+ private:
+  static std::atomic<uint64_t> limit_;
+  static std::atomic<uint64_t> used_;
+};
+
+/// Read size and watermarks of one socket, adapted to its consumer
+class TLSReceiveWindow {
+ private:
+  enum {
+    adaptation_interval_ms = 100,
+    /// Bytes buffered are targeted to this much of consumption
+    target_buffering_ms = 200
+  };
+
+  typedef std::chrono::steady_clock clock_type;
+
+ public:
+  explicit TLSReceiveWindow(const TLSBufferingOptions& options);
+
+  std::size_t read_size() const { return read_size_; }
+  std::size_t low_watermark() const { return low_watermark_; }
+  std::size_t high_watermark() const { return high_watermark_; }
+
+  void ReadCompleted(std::size_t read_size, std::size_t length);
+  void Consumed(std::size_t length);
+
+  /// Adapt the sizes once per interval, no-op if not adaptive
+  void Update();
+
+ private:
+  void SetHighWatermark(std::size_t high_watermark);
+
+ private:
+  TLSBufferingOptions options_;
+  std::size_t min_read_size_;
+  std::size_t read_size_;
+  std::size_t low_watermark_;
+  std::size_t high_watermark_;
+  std::size_t min_high_watermark_;
+
+  uint64_t consumed_;
+  uint32_t reads_;
+  uint32_t full_reads_;
+  clock_type::time_point last_update_;
+};
+
+}  // detail
+}  // cryptography
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_BUFFERING_H_
@@ -0,0 +1,70 @@
+#include "ssf/layer/cryptography/tls/OpenSSL/context_cache.h"
+
+#include <boost/functional/hash.hpp>
+#include <boost/log/trivial.hpp>
+
+namespace ssf {
+namespace layer {
+namespace cryptography {
+namespace detail {
+
+boost::recursive_mutex TLSContextCache::mutex_;
+TLSContextCache::ContextMap TLSContextCache::contexts_;
+
+ExtendedTLSContext TLSContextCache::GetContext(
+    boost::asio::io_service& io_service, const LayerParameters& parameters) {
+  auto hash = Hash(parameters);
+
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+
+  auto range = contexts_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second.parameters == parameters) {
+      return it->second.context;
+    }
+  }
+
+  auto context = make_tls_context(io_service, parameters);
+
+  // Failures are not cached, the next resolution retries
+  if (!!context) {
+    BOOST_LOG_TRIVIAL(debug) << " * TLS context cache : new context";
+    Entry entry = {parameters, context};
+    contexts_.insert(std::make_pair(hash, std::move(entry)));
+  }
+
+  return context;
+}
+
+bool TLSContextCache::Invalidate(const LayerParameters& parameters) {
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+
+  auto range = contexts_.equal_range(Hash(parameters));
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second.parameters == parameters) {
+      contexts_.erase(it);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void TLSContextCache::Clear() {
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+  contexts_.clear();
+}
+
+std::size_t TLSContextCache::Size() {
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+  return contexts_.size();
+}
+
+std::size_t TLSContextCache::Hash(const LayerParameters& parameters) {
+  return boost::hash_range(parameters.begin(), parameters.end());
+}
+
+}  // detail
+}  // cryptography
+}  // layer
+}  // ssf
@@ -0,0 +1,59 @@
+#ifndef SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_CONTEXT_CACHE_H_
+#define SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_CONTEXT_CACHE_H_
+
+#include <cstddef>
+
+#include <unordered_map>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+
+#include "ssf/layer/cryptography/tls/OpenSSL/helpers.h"
+#include "ssf/layer/parameters.h"
+
+namespace ssf {
+namespace layer {
+namespace cryptography {
+namespace detail {
+
+/// Process wide cache of TLS contexts keyed by their layer parameters
+///   Endpoints resolved with the same parameters share one context, so the
+///   CA, certificate, key and DH parameters are parsed once. Contexts stay
+///   cached until invalidated (e.g. on certificate rotation), sockets keep
+///   using the context they were created with
+class TLSContextCache {
+ public:
+  /// Get the context built from parameters, build it on first use
+  static ExtendedTLSContext GetContext(boost::asio::io_service& io_service,
+                                       const LayerParameters& parameters);
+
+  /// Drop the context built from parameters
+  ///   Return true if a context was cached
+  static bool Invalidate(const LayerParameters& parameters);
+
+  /// Drop all cached contexts
+  static void Clear();
+
+  static std::size_t Size();
+
+ private:
+  struct Entry {
+    LayerParameters parameters;
+    ExtendedTLSContext context;
+  };
+
+  typedef std::unordered_multimap<std::size_t, Entry> ContextMap;
+
+  static std::size_t Hash(const LayerParameters& parameters);
+
+ private:
+  static boost::recursive_mutex mutex_;
+  static ContextMap contexts_;
+};
+
+}  // detail
+}  // cryptography
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_CONTEXT_CACHE_H_
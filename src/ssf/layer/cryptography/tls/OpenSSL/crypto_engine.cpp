@@ -0,0 +1,249 @@
+#include "ssf/layer/cryptography/tls/OpenSSL/crypto_engine.h"
+
+#include <cstdint>
+
+#include <sstream>
+
+#include <boost/log/trivial.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <openssl/crypto.h>
+#include <openssl/opensslv.h>
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/evp.h>
+#include <openssl/provider.h>
+#elif !defined(OPENSSL_NO_ENGINE)
+#include <openssl/engine.h>
+#endif
+
+#include "ssf/utils/map_helpers.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define SSF_TLS_CPUID 1
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define SSF_TLS_CPUID 1
+#endif
+
+namespace ssf {
+namespace layer {
+namespace cryptography {
+namespace detail {
+
+namespace {
+
+/// Serializes the process wide engine selection
+boost::mutex engine_mutex;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+int AppendProvider(OSSL_PROVIDER* p_provider, void* p_names) {
+  auto& names = *static_cast<std::string*>(p_names);
+  if (!names.empty()) {
+    names += ",";
+  }
+  names += OSSL_PROVIDER_get0_name(p_provider);
+
+  return 1;
+}
+#endif
+
+std::string GetEngines() {
+  std::string engines;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  OSSL_PROVIDER_do_all(nullptr, &AppendProvider, &engines);
+#elif !defined(OPENSSL_NO_ENGINE)
+  auto p_engine = ENGINE_get_cipher_engine(NID_aes_128_gcm);
+  if (p_engine) {
+    engines = ENGINE_get_id(p_engine);
+    ENGINE_finish(p_engine);
+  }
+#endif
+
+  return engines.empty() ? "builtin" : engines;
+}
+
+bool LoadEngine(const std::string& name) {
+  boost::mutex::scoped_lock lock(engine_mutex);
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  if (!OSSL_PROVIDER_available(nullptr, name.c_str())) {
+    // Explicitly loading a provider disables the implicit default one
+    if (!OSSL_PROVIDER_available(nullptr, "default") &&
+        !OSSL_PROVIDER_load(nullptr, "default")) {
+      return false;
+    }
+
+    if (!OSSL_PROVIDER_load(nullptr, name.c_str())) {
+      return false;
+    }
+  }
+
+  // Loading only makes the provider available, the default properties make
+  // the fetches prefer it. Algorithms it lacks still come from the others
+  auto properties = "?provider=" + name;
+
+  return EVP_set_default_properties(nullptr, properties.c_str()) == 1;
+#elif !defined(OPENSSL_NO_ENGINE)
+  ENGINE_load_builtin_engines();
+
+  auto p_engine = ENGINE_by_id(name.c_str());
+  if (!p_engine) {
+    return false;
+  }
+
+  // The functional reference is kept by the default tables
+  auto success = ENGINE_init(p_engine) &&
+                 ENGINE_set_default(p_engine, ENGINE_METHOD_CIPHERS |
+                                                  ENGINE_METHOD_DIGESTS);
+  ENGINE_free(p_engine);
+
+  return !!success;
+#else
+  return false;
+#endif
+}
+
+#if defined(SSF_TLS_CPUID)
+/// Registers eax, ebx, ecx, edx of cpuid leaf, false if not supported
+bool Cpuid(uint32_t leaf, uint32_t registers[4]) {
+#if defined(_MSC_VER)
+  int values[4];
+  __cpuid(values, 0);
+  if (static_cast<uint32_t>(values[0]) < leaf) {
+    return false;
+  }
+
+  __cpuidex(values, static_cast<int>(leaf), 0);
+  for (int i = 0; i < 4; ++i) {
+    registers[i] = static_cast<uint32_t>(values[i]);
+  }
+#else
+  if (__get_cpuid_max(0, nullptr) < leaf) {
+    return false;
+  }
+
+  __cpuid_count(leaf, 0, registers[0], registers[1], registers[2],
+                registers[3]);
+#endif
+
+  return true;
+}
+
+/// The OS saves the SSE and AVX registers (XCR0 bits 1 and 2), cpuid leaf 1
+/// ecx must report OSXSAVE for xgetbv to be available
+bool IsAVXStateEnabled(const uint32_t leaf1_registers[4]) {
+  if (!(leaf1_registers[2] & (1U << 27))) {
+    return false;
+  }
+
+#if defined(_MSC_VER)
+  auto xcr0 = static_cast<uint64_t>(_xgetbv(0));
+#else
+  uint32_t eax;
+  uint32_t edx;
+  __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  auto xcr0 = (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+
+  return (xcr0 & 0x6) == 0x6;
+}
+#endif
+
+}  // namespace
+
+CryptoCapabilities GetCryptoCapabilities() {
+  CryptoCapabilities capabilities;
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+  capabilities.library = OpenSSL_version(OPENSSL_VERSION);
+#else
+  capabilities.library = SSLeay_version(SSLEAY_VERSION);
+#endif
+  capabilities.engines = GetEngines();
+
+  capabilities.pclmul = false;
+  capabilities.aes_ni = false;
+  capabilities.avx = false;
+  capabilities.avx2 = false;
+  capabilities.vaes = false;
+  capabilities.vpclmul = false;
+
+#if defined(SSF_TLS_CPUID)
+  uint32_t registers[4];
+  auto avx_state = false;
+  if (Cpuid(1, registers)) {
+    avx_state = IsAVXStateEnabled(registers);
+    capabilities.pclmul = (registers[2] & (1U << 1)) != 0;
+    capabilities.aes_ni = (registers[2] & (1U << 25)) != 0;
+    capabilities.avx = avx_state && (registers[2] & (1U << 28)) != 0;
+  }
+  // VEX encoded instructions fault unless the OS saves the AVX state
+  if (avx_state && Cpuid(7, registers)) {
+    capabilities.avx2 = (registers[1] & (1U << 5)) != 0;
+    capabilities.vaes = (registers[2] & (1U << 9)) != 0;
+    capabilities.vpclmul = (registers[2] & (1U << 10)) != 0;
+  }
+#endif
+
+  return capabilities;
+}
+
+std::string ToString(const CryptoCapabilities& capabilities) {
+  std::ostringstream oss;
+
+  oss << capabilities.library << " (" << capabilities.engines << ")"
+      << (capabilities.aes_ni ? " aes-ni" : "")
+      << (capabilities.pclmul ? " pclmul" : "")
+      << (capabilities.avx ? " avx" : "")
+      << (capabilities.avx2 ? " avx2" : "")
+      << (capabilities.vaes ? " vaes" : "")
+      << (capabilities.vpclmul ? " vpclmul" : "");
+
+  return oss.str();
+}
+
+bool HasHardwareAESGCM() {
+  auto capabilities = GetCryptoCapabilities();
+
+  return capabilities.aes_ni && capabilities.pclmul;
+}
+
+bool SelectCryptoEngine(const LayerParameters& parameters) {
+  auto engine = helpers::GetField<std::string>("crypto_engine", parameters);
+
+  if (engine != "" && !LoadEngine(engine)) {
+    BOOST_LOG_TRIVIAL(error) << "crypto engine " << engine
+                             << " not available";
+    return false;
+  }
+
+  BOOST_LOG_TRIVIAL(debug) << " * TLS crypto : "
+                           << ToString(GetCryptoCapabilities());
+
+  return true;
+}
+
+bool GetPreferAESGCM(const LayerParameters& parameters, bool* p_prefer_aes) {
+  auto acceleration =
+      helpers::GetField<std::string>("crypto_acceleration", parameters);
+
+  if (acceleration == "" || acceleration == "auto") {
+    *p_prefer_aes = HasHardwareAESGCM();
+  } else if (acceleration == "on") {
+    *p_prefer_aes = true;
+  } else if (acceleration == "off") {
+    *p_prefer_aes = false;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+}  // detail
+}  // cryptography
+}  // layer
+}  // ssf
@@ -0,0 +1,57 @@
+#ifndef SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_CRYPTO_ENGINE_H_
+#define SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_CRYPTO_ENGINE_H_
+
+#include <string>
+
+#include "ssf/layer/parameters.h"
+
+namespace ssf {
+namespace layer {
+namespace cryptography {
+namespace detail {
+
+/// Crypto implementations available to OpenSSL in this process
+///   The CPU features come from CPUID, OpenSSL picks its code paths from
+///   them at startup. All false on non x86 CPUs
+struct CryptoCapabilities {
+  std::string library;
+  /// Loaded providers (OpenSSL >= 3.0) or default cipher engine
+  std::string engines;
+  bool aes_ni;
+  bool pclmul;
+  bool avx;
+  bool avx2;
+  bool vaes;
+  bool vpclmul;
+};
+
+CryptoCapabilities GetCryptoCapabilities();
+
+std::string ToString(const CryptoCapabilities& capabilities);
+
+/// AES-GCM runs on AES-NI and carry-less multiplication instructions
+bool HasHardwareAESGCM();
+
+/// Select the crypto implementation of the contexts created afterwards
+///   "crypto_engine" = "" (default) : OpenSSL builtin implementations, the
+///   fastest code path for the CPU is picked at startup
+///   "crypto_engine" = name : load the provider name and prefer it through
+///   the default properties (OpenSSL >= 3.0), or use the engine name by
+///   default for ciphers and digests (OpenSSL < 3.0).
+///   A context fetches its algorithms when created, the selection must come
+///   first. It is process wide and kept until exit
+bool SelectCryptoEngine(const LayerParameters& parameters);
+
+/// Whether the TLS cipher lists put AES-GCM before ChaCha20-Poly1305
+///   "crypto_acceleration" = "auto" (default) : AES-GCM first with hardware
+///   AES-GCM, ChaCha20 first otherwise
+///   "crypto_acceleration" = "on" ("off") : AES-GCM (ChaCha20) first
+///   Return false if the value is unknown
+bool GetPreferAESGCM(const LayerParameters& parameters, bool* p_prefer_aes);
+
+}  // detail
+}  // cryptography
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_CRYPTO_ENGINE_H_
@@ -0,0 +1,111 @@
+#ifndef SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_EX_DATA_H_
+#define SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_EX_DATA_H_
+
+#include <boost/asio/ssl.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+
+namespace ssf {
+namespace layer {
+namespace cryptography {
+namespace detail {
+
+/// Object of type T attached to a SSL_CTX
+///   The SSL_CTX owns the object, which is deleted with it
+template <class T>
+class CtxExData {
+ public:
+  static T* Get(SSL_CTX* p_ctx) {
+    return static_cast<T*>(SSL_CTX_get_ex_data(p_ctx, Index()));
+  }
+
+  /// Attach p_data to p_ctx, p_data is deleted on failure
+  static bool Set(SSL_CTX* p_ctx, T* p_data) {
+    if (!SSL_CTX_set_ex_data(p_ctx, Index(), p_data)) {
+      delete p_data;
+      return false;
+    }
+
+    return true;
+  }
+
+ private:
+  static int Index() {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+
+    if (index_ < 0) {
+      index_ = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, &Free);
+    }
+
+    return index_;
+  }
+
+  static void Free(void* parent, void* ptr, CRYPTO_EX_DATA* ad, int idx,
+                   long argl, void* argp) {
+    delete static_cast<T*>(ptr);
+  }
+
+ private:
+  static boost::recursive_mutex mutex_;
+  static int index_;
+};
+
+template <class T>
+boost::recursive_mutex CtxExData<T>::mutex_;
+
+template <class T>
+int CtxExData<T>::index_ = -1;
+
+/// Object of type T attached to a SSL
+///   The SSL owns the object, which is deleted with it or when replaced
+template <class T>
+class SslExData {
+ public:
+  static T* Get(SSL* ssl) {
+    return static_cast<T*>(SSL_get_ex_data(ssl, Index()));
+  }
+
+  /// Attach p_data to ssl, p_data is deleted on failure
+  static bool Set(SSL* ssl, T* p_data) {
+    auto p_previous = Get(ssl);
+    if (!SSL_set_ex_data(ssl, Index(), p_data)) {
+      delete p_data;
+      return false;
+    }
+
+    delete p_previous;
+    return true;
+  }
+
+ private:
+  static int Index() {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+
+    if (index_ < 0) {
+      index_ = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, &Free);
+    }
+
+    return index_;
+  }
+
+  static void Free(void* parent, void* ptr, CRYPTO_EX_DATA* ad, int idx,
+                   long argl, void* argp) {
+    delete static_cast<T*>(ptr);
+  }
+
+ private:
+  static boost::recursive_mutex mutex_;
+  static int index_;
+};
+
+template <class T>
+boost::recursive_mutex SslExData<T>::mutex_;
+
+template <class T>
+int SslExData<T>::index_ = -1;
+
+}  // detail
+}  // cryptography
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_EX_DATA_H_
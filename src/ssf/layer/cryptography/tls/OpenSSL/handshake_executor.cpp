@@ -0,0 +1,155 @@
+#include "ssf/layer/cryptography/tls/OpenSSL/handshake_executor.h"
+
+namespace ssf {
+namespace layer {
+namespace cryptography {
+namespace detail {
+
+boost::recursive_mutex TLSHandshakeExecutor::mutex_;
+std::unique_ptr<boost::asio::io_service> TLSHandshakeExecutor::p_io_service_;
+std::unique_ptr<boost::asio::io_service::work> TLSHandshakeExecutor::p_work_;
+std::unique_ptr<boost::thread_group> TLSHandshakeExecutor::p_threads_;
+boost::condition_variable_any TLSHandshakeExecutor::drained_;
+std::queue<std::pair<TLSHandshakeExecutor::Handshake,
+                     TLSHandshakeExecutor::Abort>>
+    TLSHandshakeExecutor::queue_;
+uint32_t TLSHandshakeExecutor::max_in_flight_(0);
+uint32_t TLSHandshakeExecutor::max_queued_(0);
+uint32_t TLSHandshakeExecutor::in_flight_(0);
+bool TLSHandshakeExecutor::stopping_(false);
+
+void TLSHandshakeExecutor::Start(uint32_t threads, uint32_t max_in_flight,
+                                 uint32_t max_queued) {
+  Stop();
+
+  if (!threads) {
+    return;
+  }
+
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+
+  // The io_service outlives the pool : stream operations still pending may
+  // dispatch handlers to it
+  if (!p_io_service_) {
+    p_io_service_.reset(new boost::asio::io_service());
+  }
+  p_io_service_->reset();
+  p_work_.reset(new boost::asio::io_service::work(*p_io_service_));
+  p_threads_.reset(new boost::thread_group());
+
+  auto p_io_service = p_io_service_.get();
+  for (uint32_t i = 0; i < threads; ++i) {
+    p_threads_->create_thread([p_io_service]() { p_io_service->run(); });
+  }
+
+  max_in_flight_ =
+      max_in_flight ? max_in_flight : threads * default_in_flight_per_thread;
+  max_queued_ = max_queued;
+}
+
+void TLSHandshakeExecutor::Stop() {
+  std::queue<std::pair<Handshake, Abort>> aborted;
+
+  {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+
+    if (!p_work_ || stopping_) {
+      return;
+    }
+
+    stopping_ = true;
+    aborted.swap(queue_);
+  }
+
+  while (!aborted.empty()) {
+    aborted.front().second(boost::asio::error::make_error_code(
+        boost::asio::error::operation_aborted));
+    aborted.pop();
+  }
+
+  std::unique_ptr<boost::thread_group> p_threads;
+
+  {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+
+    // The pool keeps running the handshakes in flight until they release
+    // their slot
+    while (in_flight_) {
+      drained_.wait(lock);
+    }
+
+    p_work_.reset();
+    p_threads = std::move(p_threads_);
+    stopping_ = false;
+  }
+
+  // Joined out of the lock, a pool thread may be releasing its slot
+  p_threads->join_all();
+}
+
+bool TLSHandshakeExecutor::Enabled() {
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+  return p_work_ != nullptr && !stopping_;
+}
+
+bool TLSHandshakeExecutor::Submit(Handshake handshake, Abort abort) {
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+
+  if (!p_work_ || stopping_) {
+    return false;
+  }
+
+  if (in_flight_ < max_in_flight_) {
+    ++in_flight_;
+    auto p_io_service = p_io_service_.get();
+    p_io_service->post(
+        [p_io_service, handshake]() { handshake(*p_io_service); });
+    return true;
+  }
+
+  if (queue_.size() >= max_queued_) {
+    return false;
+  }
+
+  queue_.push(std::make_pair(std::move(handshake), std::move(abort)));
+
+  return true;
+}
+
+void TLSHandshakeExecutor::Release() {
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+
+  if (!in_flight_) {
+    return;
+  }
+
+  if (queue_.empty()) {
+    if (!--in_flight_) {
+      drained_.notify_all();
+    }
+    return;
+  }
+
+  // The slot goes to the oldest queued handshake
+  auto handshake = std::move(queue_.front().first);
+  queue_.pop();
+
+  auto p_io_service = p_io_service_.get();
+  p_io_service->post(
+      [p_io_service, handshake]() { handshake(*p_io_service); });
+}
+
+uint32_t TLSHandshakeExecutor::InFlight() {
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+  return in_flight_;
+}
+
+uint32_t TLSHandshakeExecutor::Queued() {
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+  return static_cast<uint32_t>(queue_.size());
+}
+
+}  // detail
+}  // cryptography
+}  // layer
+}  // ssf
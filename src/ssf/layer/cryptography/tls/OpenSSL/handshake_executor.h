@@ -0,0 +1,133 @@
+#ifndef SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_HANDSHAKE_EXECUTOR_H_
+#define SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_HANDSHAKE_EXECUTOR_H_
+
+#include <cstdint>
+
+#include <functional>
+#include <memory>
+#include <queue>
+#include <utility>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/bind.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "ssf/error/error.h"
+
+namespace ssf {
+namespace layer {
+namespace cryptography {
+namespace detail {
+
+/// Process wide pool of threads running the TLS handshakes
+///   A handshake started on the pool has all its steps (key exchange,
+///   certificate checks, private key operations) run by the pool threads
+///   instead of the io_service threads forwarding data.
+///   At most max_in_flight handshakes run at once, at most max_queued wait
+///   for a slot, the others are refused
+///   Stopping aborts the queued handshakes and waits for the ones in flight
+class TLSHandshakeExecutor {
+ public:
+  /// Handshakes mostly wait for their peer
+  enum { default_in_flight_per_thread = 16 };
+
+  /// Start the handshake, its handlers run on the given pool io_service
+  typedef std::function<void(boost::asio::io_service&)> Handshake;
+
+  /// Complete a queued handshake which will not run
+  typedef std::function<void(const boost::system::error_code&)> Abort;
+
+ public:
+  /// Run the handshakes on threads pool threads, 0 to stop the pool
+  /// (handshakes then run on the io_service of their socket, default)
+  ///   max_in_flight 0 : default_in_flight_per_thread per thread
+  ///   max_queued 0 : no queue, handshakes beyond max_in_flight are refused
+  ///   The running pool is stopped first, see Stop
+  static void Start(uint32_t threads, uint32_t max_in_flight,
+                    uint32_t max_queued);
+
+  /// Abort the queued handshakes with operation_aborted, then wait for the
+  /// handshakes in flight to finish before joining the pool threads
+  ///   The wait has no time limit, a handshake in flight ends with its peer
+  ///   or when its socket is closed. Not to be called from a pool thread
+  static void Stop();
+
+  static bool Enabled();
+
+  /// Run handshake on the pool or queue it, false if the queue is full or
+  /// the pool stopping. abort completes it if stopped while queued
+  static bool Submit(Handshake handshake, Abort abort);
+
+  /// Free the slot of a finished handshake
+  static void Release();
+
+  static uint32_t InFlight();
+  static uint32_t Queued();
+
+ private:
+  static boost::recursive_mutex mutex_;
+  static std::unique_ptr<boost::asio::io_service> p_io_service_;
+  static std::unique_ptr<boost::asio::io_service::work> p_work_;
+  static std::unique_ptr<boost::thread_group> p_threads_;
+  static boost::condition_variable_any drained_;
+  static std::queue<std::pair<Handshake, Abort>> queue_;
+  static uint32_t max_in_flight_;
+  static uint32_t max_queued_;
+  static uint32_t in_flight_;
+  static bool stopping_;
+};
+
+/// Handshake p_stream on the handshake executor if enabled, handler is
+/// called on strand
+template <typename TLSStream, typename Handler>
+void AsyncHandshake(std::shared_ptr<TLSStream> p_stream,
+                    boost::asio::ssl::stream_base::handshake_type type,
+                    std::shared_ptr<boost::asio::io_service::strand> p_strand,
+                    Handler handler) {
+  typedef boost::asio::io_service::strand strand_type;
+
+  if (!TLSHandshakeExecutor::Enabled()) {
+    p_stream->async_handshake(type, p_strand->wrap(handler));
+    return;
+  }
+
+  auto handshake = [p_stream, type, p_strand,
+                    handler](boost::asio::io_service& io_service) {
+    // The stream handlers are invoked through the handshake strand
+    auto p_handshake_strand = std::make_shared<strand_type>(io_service);
+    auto handshake_done = [p_strand, handler, p_handshake_strand](
+        const boost::system::error_code& ec) {
+      TLSHandshakeExecutor::Release();
+      p_strand->post(boost::bind<void>(handler, ec));
+    };
+
+    p_handshake_strand->dispatch([p_stream, type, p_handshake_strand,
+                                  handshake_done]() {
+      p_stream->async_handshake(type,
+                                p_handshake_strand->wrap(handshake_done));
+    });
+  };
+
+  auto abort = [p_strand, handler](const boost::system::error_code& ec) {
+    p_strand->post(boost::bind<void>(handler, ec));
+  };
+
+  if (!TLSHandshakeExecutor::Submit(std::move(handshake), std::move(abort))) {
+    p_strand->post(boost::bind<void>(
+        handler, boost::system::error_code(ssf::error::device_or_resource_busy,
+                                           ssf::error::get_ssf_category())));
+  }
+}
+
+}  // detail
+}  // cryptography
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_HANDSHAKE_EXECUTOR_H_
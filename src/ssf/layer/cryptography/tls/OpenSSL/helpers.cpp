@@ -1,10 +1,17 @@
 #include "ssf/layer/cryptography/tls/OpenSSL/helpers.h"
 
+#include <exception>
+#include <limits>
+
 #include <boost/archive/text_iarchive.hpp>
 
 #include <boost/serialization/vector.hpp>
 
 #include "ssf/error/error.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/buffering.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/crypto_engine.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/kernel_tls.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/session.h"
 #include "ssf/utils/cleaner.h"
 #include "ssf/utils/map_helpers.h"
 
@@ -13,21 +20,100 @@ namespace layer {
 namespace cryptography {
 namespace detail {
 
+namespace {
+
+/// Named cipher/curve profiles selected by "cipher_profile"
+///   compat : finite field DHE, TLS 1.2 only (historical default)
+///   fast-ecdhe : ECDHE (X25519 first) with AES-GCM or ChaCha20, TLS 1.2 only
+///   tls13 : TLS 1.3 where OpenSSL supports it, fast-ecdhe over TLS 1.2
+///   The software lists put ChaCha20 first, for CPUs without hardware AES-GCM
+struct CipherProfile {
+  const char* name;
+  const char* cipher_list;
+  const char* software_cipher_list;
+  const char* curves_list;
+  bool tls13;
+  bool finite_field_dhe;
+};
+
+const char* const ecdhe_cipher_list =
+    "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:"
+    "ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305:"
+    "ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384";
+
+const char* const ecdhe_software_cipher_list =
+    "ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305:"
+    "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:"
+    "ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384";
+
+#ifdef SSL_OP_NO_TLSv1_3
+const char* const tls13_ciphersuites =
+    "TLS_AES_128_GCM_SHA256:TLS_CHACHA20_POLY1305_SHA256:"
+    "TLS_AES_256_GCM_SHA384";
+
+const char* const tls13_software_ciphersuites =
+    "TLS_CHACHA20_POLY1305_SHA256:TLS_AES_128_GCM_SHA256:"
+    "TLS_AES_256_GCM_SHA384";
+#endif
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+const char* const ecdhe_curves_list = "X25519:P-256:P-384";
+#else
+const char* const ecdhe_curves_list = "P-256:P-384";
+#endif
+
+const CipherProfile cipher_profiles[] = {
+    {"compat", "DHE-RSA-AES256-GCM-SHA384", "DHE-RSA-AES256-GCM-SHA384",
+     nullptr, false, true},
+    {"fast-ecdhe", ecdhe_cipher_list, ecdhe_software_cipher_list,
+     ecdhe_curves_list, false, false},
+    {"tls13", ecdhe_cipher_list, ecdhe_software_cipher_list,
+     ecdhe_curves_list, true, false}};
+
+const CipherProfile* GetCipherProfile(const std::string& name) {
+  if (name == "") {
+    return &cipher_profiles[0];
+  }
+
+  for (const auto& profile : cipher_profiles) {
+    if (name == profile.name) {
+      return &profile;
+    }
+  }
+
+  return nullptr;
+}
+
+bool SetCtxCurves(SSL_CTX* p_ctx, const char* curves_list) {
+  if (!SSL_CTX_set1_curves_list(p_ctx, curves_list)) {
+    return false;
+  }
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+  // Automatic curve selection is the default from OpenSSL 1.1.0
+  SSL_CTX_set_ecdh_auto(p_ctx, 1);
+#endif
+
+  return true;
+}
+
+}  // namespace
+
 ExtendedTLSContext::ExtendedTLSContext(
-    std::shared_ptr<boost::asio::ssl::context> p_ctx)
-    : p_ctx_(std::move(p_ctx)) {}
+    std::shared_ptr<boost::asio::ssl::context> p_ctx, bool dhparam_missing)
+    : p_ctx_(std::move(p_ctx)), dhparam_missing_(dhparam_missing) {}
 
 boost::asio::ssl::context& ExtendedTLSContext::operator*() { return *p_ctx_; }
 std::shared_ptr<boost::asio::ssl::context> ExtendedTLSContext::operator->() {
   return p_ctx_;
 }
 
-bool ExtendedTLSContext::operator==(const ExtendedTLSContext&) const {
-  return true;
+bool ExtendedTLSContext::operator==(const ExtendedTLSContext& other) const {
+  return p_ctx_ == other.p_ctx_;
 }
 
-bool ExtendedTLSContext::operator!=(const ExtendedTLSContext&) const {
-  return false;
+bool ExtendedTLSContext::operator!=(const ExtendedTLSContext& other) const {
+  return !(*this == other);
 }
 
 bool ExtendedTLSContext::operator<(const ExtendedTLSContext& other) const {
@@ -38,8 +124,15 @@ bool ExtendedTLSContext::operator!() const { return !p_ctx_; }
 
 ExtendedTLSContext make_tls_context(boost::asio::io_service& io_service,
                                     const LayerParameters& parameters) {
+  // The context fetches its algorithms from the selected implementation
+  if (!SelectCryptoEngine(parameters)) {
+    return ExtendedTLSContext(nullptr);
+  }
+
+  // Versions below TLS 1.2 are disabled by options, the cipher profile
+  // decides whether TLS 1.3 is negotiable
   auto p_ctx = std::make_shared<boost::asio::ssl::context>(
-      boost::asio::ssl::context::tlsv12);
+      boost::asio::ssl::context::sslv23);
 
   auto& ctx = *p_ctx;
 
@@ -73,12 +166,9 @@ ExtendedTLSContext make_tls_context(boost::asio::io_service& io_service,
                   boost::asio::ssl::context::no_tlsv1 |
                   boost::asio::ssl::context::single_dh_use);
 
-  SSL_CTX_set_options(ctx.native_handle(),
-                      SSL_OP_NO_TLSv1_1 | SSL_OP_NO_TICKET);
-
-  // [not used] Set compression methods
-  SSL_COMP_add_compression_method(0, COMP_rle());
-  SSL_COMP_add_compression_method(1, COMP_zlib());
+  SSL_CTX_set_options(ctx.native_handle(), SSL_OP_NO_TLSv1_1 |
+                                               SSL_OP_NO_TICKET |
+                                               SSL_OP_NO_COMPRESSION);
 
   bool success = true;
 
@@ -86,26 +176,88 @@ ExtendedTLSContext make_tls_context(boost::asio::io_service& io_service,
   success &= SetCtxCa(ctx, parameters);
   success &= SetCtxCrt(ctx, parameters, ec);
   success &= SetCtxKey(ctx, parameters, ec);
-  success |= SetCtxDhparam(ctx, parameters, ec);
+  // DH parameters are optional (clients, ECDHE only profiles), a configured
+  // source must load. Acceptors of DHE profiles check they are set
+  auto dhparam_set = SetCtxDhparam(ctx, parameters, ec);
+  if (helpers::GetField<std::string>("dhparam_src", parameters) != "") {
+    success &= dhparam_set;
+  }
+  success &= SetCtxSessionResumption(ctx, parameters);
+  success &= SetCtxBuffering(ctx, parameters);
+  success &= SetCtxKernelTLS(ctx, parameters);
 
   if (!success) {
     return ExtendedTLSContext(nullptr);
   }
 
-  return ExtendedTLSContext(p_ctx);
+  return ExtendedTLSContext(p_ctx,
+                            !dhparam_set && NeedsDhparam(parameters));
+}
+
+bool NeedsDhparam(const LayerParameters& parameters) {
+  // "set_cipher_suit" replaces the profile ciphers, the user chose them
+  if (helpers::GetField<std::string>("set_cipher_suit", parameters) != "") {
+    return false;
+  }
+
+  auto p_profile = GetCipherProfile(
+      helpers::GetField<std::string>("cipher_profile", parameters));
+
+  return p_profile && p_profile->finite_field_dhe;
+}
+
+bool CheckAcceptorContext(const ExtendedTLSContext& context,
+                          boost::system::error_code& ec) {
+  if (context.dhparam_missing_) {
+    ec.assign(ssf::error::no_dh_param_error, ssf::error::get_ssf_category());
+    return false;
+  }
+
+  ec.assign(ssf::error::success, ssf::error::get_ssf_category());
+  return true;
 }
 
 bool SetCtxCipher(boost::asio::ssl::context& ctx,
                   const LayerParameters& parameters) {
+  auto p_profile = GetCipherProfile(
+      helpers::GetField<std::string>("cipher_profile", parameters));
+  if (!p_profile) {
+    return false;
+  }
+
+  bool prefer_aes = true;
+  if (!GetPreferAESGCM(parameters, &prefer_aes)) {
+    return false;
+  }
+
+  auto p_ctx = ctx.native_handle();
+
+  // "set_cipher_suit" overrides the TLS 1.2 cipher list of the profile
   auto cipher_suit =
       helpers::GetField<std::string>("set_cipher_suit", parameters);
   if (cipher_suit == "") {
-    return !!SSL_CTX_set_cipher_list(ctx.native_handle(),
-                                     "DHE-RSA-AES256-GCM-SHA384");
-  } else {
-    return !!SSL_CTX_set_cipher_list(ctx.native_handle(),
-                                     cipher_suit.c_str());
+    cipher_suit = prefer_aes ? p_profile->cipher_list
+                             : p_profile->software_cipher_list;
+  }
+
+  if (!SSL_CTX_set_cipher_list(p_ctx, cipher_suit.c_str())) {
+    return false;
+  }
+
+  if (p_profile->curves_list && !SetCtxCurves(p_ctx, p_profile->curves_list)) {
+    return false;
+  }
+
+#ifdef SSL_OP_NO_TLSv1_3
+  if (p_profile->tls13) {
+    return !!SSL_CTX_set_ciphersuites(
+        p_ctx, prefer_aes ? tls13_ciphersuites : tls13_software_ciphersuites);
   }
+
+  SSL_CTX_set_options(p_ctx, SSL_OP_NO_TLSv1_3);
+#endif
+
+  return true;
 }
 
 bool SetCtxCa(boost::asio::ssl::context& ctx,
@@ -259,10 +411,56 @@ bool SetCtxDhparam(boost::asio::ssl::context& ctx,
         helpers::GetField<std::string>("dhparam_file", parameters), ec);
 
     return !ec;
-  } else {
+  }
+
+  if (helpers::GetField<std::string>("dhparam_src", parameters) != "buffer") {
+    ec.assign(ssf::error::no_dh_param_error, ssf::error::get_ssf_category());
+    return false;
+  }
+
+  auto dhparam_vector = get_value_in_vector(parameters, "dhparam_buffer");
+
+  if (!dhparam_vector.size()) {
+    ec.assign(ssf::error::no_dh_param_error, ssf::error::get_ssf_category());
+    return false;
+  }
+
+  auto p_dhparam_vector = dhparam_vector.data();
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  // DH parameters as a key of the DH type, the context owns it once set
+  EVP_PKEY* p_dh = d2i_KeyParams(EVP_PKEY_DH, nullptr,
+                                 (const unsigned char**)&p_dhparam_vector,
+                                 static_cast<long>(dhparam_vector.size()));
+  ScopeCleaner cleaner([&p_dh]() {
+    EVP_PKEY_free(p_dh);
+    p_dh = nullptr;
+  });
+
+  if (!p_dh || !SSL_CTX_set0_tmp_dh_pkey(ctx.native_handle(), p_dh)) {
+    ec.assign(ssf::error::no_dh_param_error, ssf::error::get_ssf_category());
+    return false;
+  }
+  p_dh = nullptr;
+#else
+  DH* dh = NULL;
+  ScopeCleaner cleaner([&dh]() {
+    DH_free(dh);
+    dh = NULL;
+  });
+
+  auto imported =
+      !!d2i_DHparams(&dh, (const unsigned char**)&p_dhparam_vector,
+                     static_cast<long>(dhparam_vector.size()));
+
+  if (!imported || !SSL_CTX_set_tmp_dh(ctx.native_handle(), dh)) {
     ec.assign(ssf::error::no_dh_param_error, ssf::error::get_ssf_category());
     return false;
   }
+#endif
+
+  ec.assign(ssf::error::success, ssf::error::get_ssf_category());
+  return true;
 }
 
 bool verify_certificate(bool preverified,
@@ -274,7 +472,12 @@ bool verify_certificate(bool preverified,
   X509_NAME_oneline(X509_get_subject_name(cert), subject_name, 256);
   //std::cout << "Verifying " << subject_name << "\n";
 
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+  // X509_STORE_CTX is opaque from OpenSSL 1.1.0
+  X509* issuer = X509_STORE_CTX_get0_current_issuer(cts);
+#else
   X509* issuer = cts->current_issuer;
+#endif
   if (issuer) {
     X509_NAME_oneline(X509_get_subject_name(issuer), subject_name, 256);
     //std::cout << "Issuer " << subject_name << "\n";
@@ -305,6 +508,32 @@ std::vector<uint8_t> get_value_in_vector(const LayerParameters& parameters,
   }
 }
 
+bool GetUInt32Field(const LayerParameters& parameters, const std::string& key,
+                    uint32_t default_value, uint32_t* p_value) {
+  auto value_str = helpers::GetField<std::string>(key, parameters);
+
+  if (value_str == "") {
+    *p_value = default_value;
+    return true;
+  }
+
+  // Decimal digits only, std::stoul accepts signs, spaces and trailing text
+  if (value_str.find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+
+  try {
+    auto value = std::stoull(value_str);
+    if (value > std::numeric_limits<uint32_t>::max()) {
+      return false;
+    }
+    *p_value = static_cast<uint32_t>(value);
+    return true;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
 }  // detail
 }  // cryptography
 }  // layer
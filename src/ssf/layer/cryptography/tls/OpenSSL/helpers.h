@@ -18,9 +18,10 @@ namespace cryptography {
 namespace detail {
 
 struct ExtendedTLSContext {
-  ExtendedTLSContext() : p_ctx_(nullptr) {}
+  ExtendedTLSContext() : p_ctx_(nullptr), dhparam_missing_(false) {}
 
-  explicit ExtendedTLSContext(std::shared_ptr<boost::asio::ssl::context> p_ctx);
+  explicit ExtendedTLSContext(std::shared_ptr<boost::asio::ssl::context> p_ctx,
+                              bool dhparam_missing = false);
 
   boost::asio::ssl::context& operator*();
   std::shared_ptr<boost::asio::ssl::context> operator->();
@@ -31,6 +32,8 @@ struct ExtendedTLSContext {
   bool operator!() const;
 
   std::shared_ptr<boost::asio::ssl::context> p_ctx_;
+  /// The cipher profile needs DH parameters to accept and none were loaded
+  bool dhparam_missing_;
 };
 
 ExtendedTLSContext make_tls_context(boost::asio::io_service& io_service,
@@ -48,12 +51,25 @@ bool SetCtxKey(boost::asio::ssl::context& ctx,
 bool SetCtxDhparam(boost::asio::ssl::context& ctx,
                    const LayerParameters& parameters,
                    boost::system::error_code& ec);
+
+/// Whether accepting with the cipher profile of parameters needs DH
+/// parameters (finite field DHE)
+bool NeedsDhparam(const LayerParameters& parameters);
+
+/// Fail with no_dh_param_error if context cannot accept handshakes
+bool CheckAcceptorContext(const ExtendedTLSContext& context,
+                          boost::system::error_code& ec);
 bool verify_certificate(bool preverified,
                         boost::asio::ssl::verify_context& ctx);
 std::vector<uint8_t> get_deserialized_vector(const std::string& serialized);
 std::vector<uint8_t> get_value_in_vector(const LayerParameters& parameters,
                                          const std::string& key);
 
+/// Parse the unsigned field key of parameters, default_value if not set
+///   Return false if the field is not a decimal number of 32 bits
+bool GetUInt32Field(const LayerParameters& parameters, const std::string& key,
+                    uint32_t default_value, uint32_t* p_value);
+
 }  // detail
 }  // cryptography
 }  // layer
@@ -3,7 +3,10 @@
 
 #include <cstdint>
 
+#include <algorithm>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <boost/asio/async_result.hpp>
 #include <boost/asio/detail/config.hpp>
@@ -17,9 +20,15 @@
 #include <boost/bind.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/system/error_code.hpp>
-#include <boost/thread/recursive_mutex.hpp>
 
+#include "ssf/layer/cryptography/tls/OpenSSL/buffering.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/context_cache.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/crypto_engine.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/handshake_executor.h"
 #include "ssf/layer/cryptography/tls/OpenSSL/helpers.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/kernel_tls.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/session.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/write_gatherer.h"
 
 #include "ssf/error/error.h"
 #include "ssf/io/read_stream_op.h"
@@ -35,16 +44,17 @@ namespace cryptography {
 namespace detail {
 
 /// The class in charge of receiving data from a TLS stream into a buffer
+///   All the state is only accessed on the strand. Pending read operations
+///   are completed directly from the receive handler, or in one strand post
+///   per batch when requested with data already buffered.
+///   Read size and watermarks come from the TLS context buffering options,
+///   buffered bytes are accounted in the process wide TLSBufferingBudget.
+///   With nothing buffered, a pending user read of at least one record
+///   receives the data directly, without going through the queue. Only the
+///   socket can abort it : cancelling the bufferer cancels the socket
 template <typename NextLayerStreamSocket>
 class TLSStreamBufferer : public std::enable_shared_from_this<
                               TLSStreamBufferer<NextLayerStreamSocket>> {
- private:
-  enum {
-    lower_queue_size_bound = 1 * 1024 * 1024,
-    higher_queue_size_bound = 16 * 1024 * 1024,
-    receive_buffer_size = 50 * 1024
-  };
-
  private:
   typedef boost::asio::ssl::stream<NextLayerStreamSocket> tls_stream_type;
   typedef std::shared_ptr<tls_stream_type> p_tls_stream_type;
@@ -58,11 +68,27 @@ class TLSStreamBufferer : public std::enable_shared_from_this<
   typedef boost::asio::detail::op_queue<io::basic_pending_read_stream_operation>
       op_queue_type;
 
+ private:
+  /// Read operation whose completion is deferred
+  struct Completion {
+    io::basic_pending_read_stream_operation* p_op;
+    boost::system::error_code ec;
+    std::size_t length;
+  };
+  typedef std::vector<Completion> Completions;
+
  public:
   TLSStreamBufferer(const TLSStreamBufferer&) = delete;
   TLSStreamBufferer& operator=(const TLSStreamBufferer&) = delete;
 
-  ~TLSStreamBufferer() {}
+  ~TLSStreamBufferer() {
+    TLSBufferingBudget::Release(p_data_queue_->size() + read_reserved_);
+
+    // Direct read handler dropped without being called
+    if (p_direct_op_) {
+      p_direct_op_->destroy();
+    }
+  }
 
   static p_puller_type create(p_tls_stream_type p_socket,
                               p_strand_type p_strand, p_context_type p_ctx) {
@@ -71,15 +97,8 @@ class TLSStreamBufferer : public std::enable_shared_from_this<
 
   /// Start receiving data
   void start_pulling() {
-    {
-      boost::recursive_mutex::scoped_lock lock(pulling_mutex_);
-      if (!pulling_) {
-        pulling_ = true;
-        BOOST_LOG_TRIVIAL(debug) << "pulling";
-        io_service_.post(boost::bind(&TLSStreamBufferer::async_pull_packets,
-                                     this->shared_from_this()));
-      }
-    }
+    strand_.dispatch(boost::bind(&TLSStreamBufferer::do_start_pulling,
+                                 this->shared_from_this()));
   }
 
   /// User interface for receiving some data
@@ -104,15 +123,11 @@ class TLSStreamBufferer : public std::enable_shared_from_this<
 
       p.p = new (p.v) op(buffers, init.handler);
 
-      {
-        boost::recursive_mutex::scoped_lock lock(op_queue_mutex_);
-        op_queue_.push(p.p);
-      }
-
+      io::basic_pending_read_stream_operation* p_op = p.p;
       p.v = p.p = 0;
 
-      io_service_.post(boost::bind(&TLSStreamBufferer::handle_data_n_ops,
-                                   this->shared_from_this()));
+      strand_.dispatch(boost::bind(&TLSStreamBufferer::enqueue_op,
+                                   this->shared_from_this(), p_op));
     } else {
       io_service_.post(
           boost::bind<void>(init.handler, boost::system::error_code(), 0));
@@ -122,20 +137,8 @@ class TLSStreamBufferer : public std::enable_shared_from_this<
   }
 
   boost::system::error_code cancel(boost::system::error_code& ec) {
-    boost::recursive_mutex::scoped_lock lock1(data_queue_mutex_);
-    boost::recursive_mutex::scoped_lock lock2(op_queue_mutex_);
-    data_queue_.consume(data_queue_.size());
-    while (!op_queue_.empty()) {
-      auto op = op_queue_.front();
-      op_queue_.pop();
-      auto self = this->shared_from_this();
-      auto do_complete = [op, this, self]() {
-        op->complete(boost::asio::error::make_error_code(
-                         boost::asio::error::basic_errors::operation_aborted),
-                     0);
-      };
-      io_service_.post(do_complete);
-    }
+    strand_.dispatch(
+        boost::bind(&TLSStreamBufferer::do_cancel, this->shared_from_this()));
 
     return ec;
   }
@@ -150,96 +153,216 @@ class TLSStreamBufferer : public std::enable_shared_from_this<
         p_ctx_(p_ctx),
         io_service_(strand_.get_io_service()),
         status_(boost::system::error_code()),
-        pulling_(false) {}
-
-  /// Check if data is available for user requests
-  void handle_data_n_ops() {
-    if (!status_) {
-      {
-        boost::recursive_mutex::scoped_lock lock(pulling_mutex_);
-        if ((data_queue_.size() < lower_queue_size_bound) && !pulling_) {
-          start_pulling();
-        }
-      }
+        p_data_queue_(new boost::asio::streambuf()),
+        queue_capacity_(0),
+        read_reserved_(0),
+        window_(!p_ctx ? TLSBufferingOptions()
+                       : GetCtxBuffering((*p_ctx).native_handle())),
+        direct_read_(!p_ctx ||
+                     GetCtxBuffering((*p_ctx).native_handle()).direct_read),
+        p_direct_op_(nullptr),
+        pulling_(false),
+        completions_(),
+        completing_(),
+        completion_scheduled_(false) {}
+
+  void do_start_pulling() {
+    if (!pulling_) {
+      pulling_ = true;
+      BOOST_LOG_TRIVIAL(debug) << "pulling";
+      async_pull_packets();
+    }
+  }
 
-      boost::recursive_mutex::scoped_lock lock1(data_queue_mutex_);
-      boost::recursive_mutex::scoped_lock lock2(op_queue_mutex_);
-      if (!op_queue_.empty() && data_queue_.size()) {
-        auto op = op_queue_.front();
-        op_queue_.pop();
+  /// Queue a user read, data already buffered completes it in a strand post
+  void enqueue_op(io::basic_pending_read_stream_operation* p_op) {
+    op_queue_.push(p_op);
+    handle_data_n_ops(true);
+  }
 
-        size_t copied = op->fill_buffer(data_queue_);
+  void do_cancel() {
+    TLSBufferingBudget::Release(p_data_queue_->size());
+    p_data_queue_->consume(p_data_queue_->size());
+    while (!op_queue_.empty()) {
+      auto op = op_queue_.front();
+      op_queue_.pop();
+      complete(op,
+               boost::asio::error::make_error_code(
+                   boost::asio::error::basic_errors::operation_aborted),
+               0, true);
+    }
 
-        auto do_complete =
-            [=]() { op->complete(boost::system::error_code(), copied); };
-        io_service_.post(do_complete);
+    // The direct read fills the user buffers until the socket read returns,
+    // it completes with operation_aborted in direct_read_completed
+    if (p_direct_op_) {
+      boost::system::error_code ec;
+      socket_.lowest_layer().cancel(ec);
+    }
+  }
 
-        io_service_.dispatch(boost::bind(&TLSStreamBufferer::handle_data_n_ops,
-                                         this->shared_from_this()));
-      }
-    } else {
-      boost::recursive_mutex::scoped_lock lock1(data_queue_mutex_);
-      boost::recursive_mutex::scoped_lock lock2(op_queue_mutex_);
-      if (!op_queue_.empty()) {
-        auto op = op_queue_.front();
-        op_queue_.pop();
-        auto self = this->shared_from_this();
-        auto do_complete =
-            [op, this, self]() { op->complete(this->status_, 0); };
-        io_service_.post(do_complete);
-
-        io_service_.dispatch(boost::bind(&TLSStreamBufferer::handle_data_n_ops,
-                                         this->shared_from_this()));
+  /// Serve pending user operations with the buffered data
+  ///   Buffered data is delivered before the receive error
+  void handle_data_n_ops(bool defer) {
+    while (!op_queue_.empty() && (p_data_queue_->size() || status_)) {
+      auto op = op_queue_.front();
+      op_queue_.pop();
+
+      if (p_data_queue_->size()) {
+        auto copied = op->fill_buffer(*p_data_queue_);
+        TLSBufferingBudget::Release(copied);
+        window_.Consumed(copied);
+        complete(op, boost::system::error_code(), copied, defer);
+      } else {
+        complete(op, status_, 0, defer);
       }
     }
+
+    if (!status_ && (p_data_queue_->size() < window_.low_watermark())) {
+      do_start_pulling();
+    }
+  }
+
+  /// Complete op inline unless deferred or earlier completions are pending
+  void complete(io::basic_pending_read_stream_operation* op,
+                const boost::system::error_code& ec, std::size_t length,
+                bool defer) {
+    if (!defer && !completion_scheduled_) {
+      op->complete(ec, length);
+      return;
+    }
+
+    Completion completion = {op, ec, length};
+    completions_.push_back(completion);
+
+    if (!completion_scheduled_) {
+      completion_scheduled_ = true;
+      strand_.post(boost::bind(&TLSStreamBufferer::flush_completions,
+                               this->shared_from_this()));
+    }
+  }
+
+  void flush_completions() {
+    completing_.swap(completions_);
+    completion_scheduled_ = false;
+
+    for (auto& completion : completing_) {
+      completion.p_op->complete(completion.ec, completion.length);
+    }
+
+    completing_.clear();
   }
 
   /// Receive some data
   void async_pull_packets() {
-    auto self = this->shared_from_this();
-
-    auto handler = [this, self](const boost::system::error_code& ec,
-                                size_t length) {
-      if (!ec) {
-        {
-          boost::recursive_mutex::scoped_lock lock1(this->data_queue_mutex_);
-          this->data_queue_.commit(length);
-        }
-
-        if (!this->status_) {
-          this->io_service_.dispatch(
-              boost::bind(&TLSStreamBufferer::async_pull_packets,
-                          this->shared_from_this()));
-        }
-      } else {
-        if (ec.value() == boost::asio::error::operation_aborted) {
-          boost::system::error_code cancel_ec;
-          cancel(cancel_ec);
-        } else {
-          this->status_ = ec;
-          BOOST_LOG_TRIVIAL(info) << "TLS connection terminated";
-        }
-      }
+    if (status_) {
+      pulling_ = false;
+      return;
+    }
 
-      this->io_service_.dispatch(boost::bind(
-          &TLSStreamBufferer::handle_data_n_ops, this->shared_from_this()));
-    };
+    window_.Update();
 
-    {
-      boost::recursive_mutex::scoped_lock lock(data_queue_mutex_);
-      boost::asio::streambuf::mutable_buffers_type bufs =
-          data_queue_.prepare(receive_buffer_size);
+    auto buffered = p_data_queue_->size();
 
-      if (data_queue_.size() < higher_queue_size_bound) {
-        auto lambda = [this, bufs, handler, self]() {
-          this->socket_.async_read_some(bufs, this->strand_.wrap(handler));
-        };
-        strand_.dispatch(lambda);
-      } else {
-        pulling_ = false;
-        BOOST_LOG_TRIVIAL(debug) << "not pulling";
-      }
+    if (buffered >= window_.high_watermark()) {
+      pulling_ = false;
+      BOOST_LOG_TRIVIAL(debug) << "not pulling";
+      return;
+    }
+
+    if (!buffered && start_direct_read()) {
+      return;
+    }
+
+    auto read_size = window_.read_size();
+
+    if (!TLSBufferingBudget::Reserve(read_size, !buffered)) {
+      pulling_ = false;
+      BOOST_LOG_TRIVIAL(debug) << "not pulling (buffering budget)";
+      return;
+    }
+
+    // Release the memory of an emptied queue grown over the watermark
+    if (!buffered && queue_capacity_ > window_.high_watermark()) {
+      p_data_queue_.reset(new boost::asio::streambuf());
+      queue_capacity_ = 0;
+    }
+
+    read_reserved_ = read_size;
+    queue_capacity_ = std::max(queue_capacity_, buffered + read_size);
+
+    socket_.async_read_some(
+        p_data_queue_->prepare(read_size),
+        strand_.wrap(boost::bind(&TLSStreamBufferer::packets_pulled,
+                                 this->shared_from_this(), _1, _2)));
+  }
+
+  void packets_pulled(const boost::system::error_code& ec, size_t length) {
+    TLSBufferingBudget::Release(read_reserved_ - length);
+    window_.ReadCompleted(read_reserved_, length);
+    read_reserved_ = 0;
+
+    if (!ec) {
+      p_data_queue_->commit(length);
+      // Serve the pending reads first, their handlers may queue a read
+      // large enough to receive the next data directly
+      handle_data_n_ops(false);
+      async_pull_packets();
+      return;
+    }
+
+    pull_failed(ec);
+  }
+
+  /// Receive in the first pending user read if it can hold a record
+  bool start_direct_read() {
+    if (!direct_read_ || op_queue_.empty()) {
+      return false;
+    }
+
+    auto buffers = op_queue_.front()->mutable_buffers();
+    if (boost::asio::buffer_size(buffers) <
+        TLSBufferingOptions::max_record_size) {
+      return false;
+    }
+
+    p_direct_op_ = op_queue_.front();
+    op_queue_.pop();
+
+    socket_.async_read_some(
+        buffers,
+        strand_.wrap(boost::bind(&TLSStreamBufferer::direct_read_completed,
+                                 this->shared_from_this(), _1, _2)));
+
+    return true;
+  }
+
+  void direct_read_completed(const boost::system::error_code& ec,
+                             size_t length) {
+    auto p_op = p_direct_op_;
+    p_direct_op_ = nullptr;
+
+    window_.Consumed(length);
+    complete(p_op, ec, length, false);
+
+    if (!ec) {
+      async_pull_packets();
+      return;
+    }
+
+    pull_failed(ec);
+  }
+
+  void pull_failed(const boost::system::error_code& ec) {
+    pulling_ = false;
+
+    if (ec.value() == boost::asio::error::operation_aborted) {
+      do_cancel();
+    } else {
+      status_ = ec;
+      BOOST_LOG_TRIVIAL(info) << "TLS connection terminated";
     }
+
+    handle_data_n_ops(false);
   }
 
   /// The TLS stream to receive from
@@ -259,15 +382,27 @@ class TLSStreamBufferer : public std::enable_shared_from_this<
   boost::system::error_code status_;
 
   /// Handle the data received
-  boost::recursive_mutex data_queue_mutex_;
-  boost::asio::streambuf data_queue_;
+  std::unique_ptr<boost::asio::streambuf> p_data_queue_;
+  std::size_t queue_capacity_;
+
+  /// Bytes reserved in the buffering budget for the read in flight
+  std::size_t read_reserved_;
+
+  TLSReceiveWindow window_;
 
   /// Handle pending user operations
-  boost::recursive_mutex op_queue_mutex_;
   op_queue_type op_queue_;
 
-  boost::recursive_mutex pulling_mutex_;
+  /// User read receiving directly, out of op_queue_
+  bool direct_read_;
+  io::basic_pending_read_stream_operation* p_direct_op_;
+
   bool pulling_;
+
+  /// Deferred completions, run in one strand handler
+  Completions completions_;
+  Completions completing_;
+  bool completion_scheduled_;
 };
 
 }  // detail
@@ -283,6 +418,8 @@ class basic_buffered_tls_socket {
   typedef std::shared_ptr<boost::asio::streambuf> p_streambuf;
   typedef detail::TLSStreamBufferer<NextLayerStreamSocket> puller_type;
   typedef std::shared_ptr<puller_type> p_puller_type;
+  typedef detail::TLSWriteGatherer<NextLayerStreamSocket> writer_type;
+  typedef std::shared_ptr<writer_type> p_writer_type;
   typedef boost::asio::io_service::strand strand_type;
   typedef std::shared_ptr<strand_type> p_strand_type;
 
@@ -297,7 +434,8 @@ class basic_buffered_tls_socket {
         p_socket_(nullptr),
         socket_(),
         p_strand_(nullptr),
-        p_puller_(nullptr) {}
+        p_puller_(nullptr),
+        p_writer_(nullptr) {}
 
   basic_buffered_tls_socket(p_tls_stream_type p_socket, p_context_type p_ctx)
       : p_ctx_(p_ctx),
@@ -305,7 +443,8 @@ class basic_buffered_tls_socket {
         socket_(*p_socket_),
         p_strand_(std::make_shared<strand_type>(
             socket_.get().lowest_layer().get_io_service())),
-        p_puller_(puller_type::create(p_socket_, p_strand_, p_ctx_)) {}
+        p_puller_(puller_type::create(p_socket_, p_strand_, p_ctx_)),
+        p_writer_(writer_type::create(p_socket_, p_strand_, p_ctx_)) {}
 
   basic_buffered_tls_socket(boost::asio::io_service& io_service,
                             p_context_type p_ctx)
@@ -313,14 +452,16 @@ class basic_buffered_tls_socket {
         p_socket_(new tls_stream_type(io_service, *p_ctx)),
         socket_(*p_socket_),
         p_strand_(std::make_shared<strand_type>(io_service)),
-        p_puller_(puller_type::create(p_socket_, p_strand_, p_ctx_)) {}
+        p_puller_(puller_type::create(p_socket_, p_strand_, p_ctx_)),
+        p_writer_(writer_type::create(p_socket_, p_strand_, p_ctx_)) {}
 
   basic_buffered_tls_socket(basic_buffered_tls_socket&& other)
       : p_ctx_(std::move(other.p_ctx_)),
         p_socket_(std::move(other.p_socket_)),
         socket_(*p_socket_),
         p_strand_(std::move(other.p_strand_)),
-        p_puller_(std::move(other.p_puller_)) {
+        p_puller_(std::move(other.p_puller_)),
+        p_writer_(std::move(other.p_writer_)) {
     other.socket_ = *(other.p_socket_);
   }
 
@@ -337,10 +478,19 @@ class basic_buffered_tls_socket {
   lowest_layer_type& lowest_layer() { return socket_.get().lowest_layer(); }
   next_layer_type& next_layer() { return socket_.get().next_layer(); }
 
+  /// SSL object of the TLS stream
+  SSL* native_handle() { return socket_.get().native_handle(); }
+
   boost::system::error_code handshake(handshake_type type,
                                       boost::system::error_code& ec) {
+    auto peer = session_peer(type);
+    detail::ResumeClientSession(socket_.get().native_handle(), peer);
+
     socket_.get().handshake(type, ec);
 
+    detail::ForgetFailedClientSession(socket_.get().native_handle(), peer,
+                                      ec);
+
     if (!ec) {
       p_puller_->start_pulling();
     }
@@ -352,17 +502,21 @@ class basic_buffered_tls_socket {
   /// completion
   template <typename Handler>
   void async_handshake(handshake_type type, Handler handler) {
+    auto peer = session_peer(type);
     auto do_user_handler =
-        [this, handler](const boost::system::error_code& ec) mutable {
+        [this, handler, peer](const boost::system::error_code& ec) mutable {
+          detail::ForgetFailedClientSession(
+              this->socket_.get().native_handle(), peer, ec);
           if (!ec) {
             this->p_puller_->start_pulling();
           }
           handler(ec);
         };
 
-    auto lambda = [this, type, do_user_handler]() {
-      this->socket_.get().async_handshake(type,
-                                          p_strand_->wrap(do_user_handler));
+    auto lambda = [this, type, peer, do_user_handler]() {
+      detail::ResumeClientSession(this->socket_.get().native_handle(), peer);
+      detail::AsyncHandshake(this->p_socket_, type, this->p_strand_,
+                             do_user_handler);
     };
     p_strand_->dispatch(lambda);
   }
@@ -406,6 +560,11 @@ class basic_buffered_tls_socket {
         WriteHandler, void(boost::system::error_code, std::size_t)>
         init(std::forward<WriteHandler>(handler));
 
+    if (p_writer_) {
+      p_writer_->async_write_some(buffers, init.handler);
+      return init.result.get();
+    }
+
     auto lambda = [this, buffers, init]() {
       this->socket_.get().async_write_some(buffers,
                                            this->p_strand_->wrap(init.handler));
@@ -420,10 +579,16 @@ class basic_buffered_tls_socket {
 
   void close() {
     boost::system::error_code ec;
-    socket_.get().lowest_layer().close(ec);
+    close(ec);
   }
 
+  /// Abort the pending reads, a direct read included, then close the socket
   boost::system::error_code close(boost::system::error_code& ec) {
+    if (p_puller_) {
+      p_puller_->cancel(ec);
+    }
+
+    detail::KeepSessionOnClose(socket_.get().native_handle());
     return socket_.get().lowest_layer().close(ec);
   }
 
@@ -436,6 +601,16 @@ class basic_buffered_tls_socket {
   tls_stream_type& socket() { return socket_; }
   strand_type& strand() { return *p_strand_; }
 
+ private:
+  /// Peer whose session is resumed, client handshakes only
+  std::string session_peer(handshake_type type) {
+    if (type != tls_stream_type::client) {
+      return std::string();
+    }
+
+    return detail::GetPeerKey(socket_.get());
+  }
+
  private:
   /// The TLS ctx in a shared_ptr to be able to move it
   p_context_type p_ctx_;
@@ -451,6 +626,9 @@ class basic_buffered_tls_socket {
 
   /// The TLSStreamBufferer in a shared_ptr to be able to move it
   p_puller_type p_puller_;
+
+  /// Gather writes in records, nullptr if disabled
+  p_writer_type p_writer_;
 };
 
 template <typename NextLayerStreamSocket>
@@ -460,6 +638,10 @@ class basic_tls_socket {
   typedef std::shared_ptr<tls_stream_type> p_tls_stream_type;
   typedef detail::ExtendedTLSContext p_context_type;
   typedef std::shared_ptr<boost::asio::streambuf> p_streambuf;
+  typedef detail::TLSKernelStream<NextLayerStreamSocket> kernel_stream_type;
+  typedef std::shared_ptr<kernel_stream_type> p_kernel_stream_type;
+  typedef detail::TLSWriteGatherer<NextLayerStreamSocket> writer_type;
+  typedef std::shared_ptr<writer_type> p_writer_type;
   typedef boost::asio::io_service::strand strand_type;
   typedef std::shared_ptr<strand_type> p_strand_type;
 
@@ -470,26 +652,37 @@ class basic_tls_socket {
 
  public:
   basic_tls_socket()
-      : p_ctx_(nullptr), p_socket_(nullptr), socket_(), p_strand_(nullptr) {}
+      : p_ctx_(nullptr),
+        p_socket_(nullptr),
+        socket_(),
+        p_strand_(nullptr),
+        p_kernel_(nullptr),
+        p_writer_(nullptr) {}
 
   basic_tls_socket(p_tls_stream_type p_socket, p_context_type p_ctx)
       : p_ctx_(p_ctx),
         p_socket_(p_socket),
         socket_(*p_socket_),
         p_strand_(std::make_shared<strand_type>(
-            socket_.get().lowest_layer().get_io_service())) {}
+            socket_.get().lowest_layer().get_io_service())),
+        p_kernel_(kernel_stream_type::create(p_socket_, p_strand_, p_ctx_)),
+        p_writer_(make_writer()) {}
 
   basic_tls_socket(boost::asio::io_service& io_service, p_context_type p_ctx)
       : p_ctx_(p_ctx),
         p_socket_(new tls_stream_type(io_service, *p_ctx)),
         socket_(*p_socket_),
-        p_strand_(std::make_shared<strand_type>(io_service)) {}
+        p_strand_(std::make_shared<strand_type>(io_service)),
+        p_kernel_(kernel_stream_type::create(p_socket_, p_strand_, p_ctx_)),
+        p_writer_(make_writer()) {}
 
   basic_tls_socket(basic_tls_socket&& other)
       : p_ctx_(std::move(other.p_ctx_)),
         p_socket_(std::move(other.p_socket_)),
         socket_(*p_socket_),
-        p_strand_(std::move(other.p_strand_)) {
+        p_strand_(std::move(other.p_strand_)),
+        p_kernel_(std::move(other.p_kernel_)),
+        p_writer_(std::move(other.p_writer_)) {
     other.socket_ = *(other.p_socket_);
   }
 
@@ -505,18 +698,46 @@ class basic_tls_socket {
   lowest_layer_type& lowest_layer() { return socket_.get().lowest_layer(); }
   next_layer_type& next_layer() { return socket_.get().next_layer(); }
 
+  /// SSL object of the TLS stream
+  SSL* native_handle() { return socket_.get().native_handle(); }
+
   boost::system::error_code handshake(handshake_type type,
                                       boost::system::error_code ec) {
-    socket_.get().handshake(type, ec);
+    auto peer = session_peer(type);
+    detail::ResumeClientSession(socket_.get().native_handle(), peer);
+
+    if (p_kernel_) {
+      p_kernel_->handshake(type, ec);
+    } else {
+      socket_.get().handshake(type, ec);
+    }
+
+    detail::ForgetFailedClientSession(socket_.get().native_handle(), peer,
+                                      ec);
+
     return ec;
   }
 
-  /// Forward the call to the TLS stream and start pulling packets on
-  /// completion
+  /// Forward the call to the TLS stream (or to the kernel TLS stream)
   template <typename Handler>
   void async_handshake(handshake_type type, Handler handler) {
-    auto lambda = [this, type, handler]() {
-      this->socket_.get().async_handshake(type, p_strand_->wrap(handler));
+    auto peer = session_peer(type);
+    auto do_user_handler =
+        [this, handler, peer](const boost::system::error_code& ec) mutable {
+          detail::ForgetFailedClientSession(
+              this->socket_.get().native_handle(), peer, ec);
+          handler(ec);
+        };
+
+    auto lambda = [this, type, peer, do_user_handler]() {
+      detail::ResumeClientSession(this->socket_.get().native_handle(), peer);
+      if (this->p_kernel_) {
+        this->p_kernel_->async_handshake(type,
+                                         p_strand_->wrap(do_user_handler));
+        return;
+      }
+      detail::AsyncHandshake(this->p_socket_, type, this->p_strand_,
+                             do_user_handler);
     };
 
     p_strand_->dispatch(lambda);
@@ -525,14 +746,23 @@ class basic_tls_socket {
   template <typename MutableBufferSequence>
   std::size_t read_some(const MutableBufferSequence& buffers,
                         boost::system::error_code& ec) {
+    if (p_kernel_) {
+      return p_kernel_->read_some(buffers, ec);
+    }
+
     return socket_.get().read_some(buffers, ec);
   }
 
-  /// Forward the call to the TLSStreamBufferer object
+  /// Forward the call to the TLS stream (wrapped in an strand)
   template <typename MutableBufferSequence, typename ReadHandler>
   void async_read_some(const MutableBufferSequence& buffers,
                        ReadHandler&& handler) {
     auto lambda = [this, buffers, handler]() {
+      if (this->p_kernel_) {
+        this->p_kernel_->async_read_some(buffers,
+                                         this->p_strand_->wrap(handler));
+        return;
+      }
       this->socket_.get().async_read_some(buffers,
                                           this->p_strand_->wrap(handler));
     };
@@ -542,13 +772,29 @@ class basic_tls_socket {
   template <typename ConstBufferSequence>
   std::size_t write_some(const ConstBufferSequence& buffers,
                          boost::system::error_code& ec) {
+    if (p_kernel_) {
+      return p_kernel_->write_some(buffers, ec);
+    }
+
     return socket_.get().write_some(buffers, ec);
   }
 
   /// Forward the call directly to the TLS stream (wrapped in an strand)
   template <typename ConstBufferSequence, typename Handler>
   void async_write_some(const ConstBufferSequence& buffers, Handler&& handler) {
+    if (p_writer_) {
+      p_writer_->async_write_some(
+          buffers,
+          typename std::decay<Handler>::type(std::forward<Handler>(handler)));
+      return;
+    }
+
     auto lambda = [this, buffers, handler]() {
+      if (this->p_kernel_) {
+        this->p_kernel_->async_write_some(buffers,
+                                          this->p_strand_->wrap(handler));
+        return;
+      }
       this->socket_.get().async_write_some(buffers,
                                            this->p_strand_->wrap(handler));
     };
@@ -560,10 +806,11 @@ class basic_tls_socket {
 
   void close() {
     boost::system::error_code ec;
-    socket_.get().lowest_layer().close(ec);
+    close(ec);
   }
 
   boost::system::error_code close(boost::system::error_code& ec) {
+    detail::KeepSessionOnClose(socket_.get().native_handle());
     return socket_.get().lowest_layer().close(ec);
   }
 
@@ -576,6 +823,25 @@ class basic_tls_socket {
   tls_stream_type& socket() { return socket_; }
   strand_type& strand() { return *p_strand_; }
 
+ private:
+  /// The kernel does the record layer work of the write gatherer
+  p_writer_type make_writer() {
+    if (p_kernel_) {
+      return nullptr;
+    }
+
+    return writer_type::create(p_socket_, p_strand_, p_ctx_);
+  }
+
+  /// Peer whose session is resumed, client handshakes only
+  std::string session_peer(handshake_type type) {
+    if (type != tls_stream_type::client) {
+      return std::string();
+    }
+
+    return detail::GetPeerKey(socket_.get());
+  }
+
  private:
   /// The TLS ctx in a shared_ptr to be able to move it
   p_context_type p_ctx_;
@@ -588,6 +854,12 @@ class basic_tls_socket {
 
   /// The strand in a shared_ptr to be able to move it
   p_strand_type p_strand_;
+
+  /// Records through the socket fd (kernel TLS), nullptr if disabled
+  p_kernel_stream_type p_kernel_;
+
+  /// Gather writes in records, nullptr if disabled
+  p_writer_type p_writer_;
 };
 
 template <class NextLayer, template <class> class TLSStreamSocket>
@@ -621,7 +893,8 @@ class basic_tls {
       boost::asio::io_service& io_service,
       typename query::const_iterator parameters_it, uint32_t lower_id,
       boost::system::error_code& ec) {
-    auto context = detail::make_tls_context(io_service, *parameters_it);
+    auto context =
+        detail::TLSContextCache::GetContext(io_service, *parameters_it);
     if (!context) {
       ec.assign(ssf::error::invalid_argument, ssf::error::get_ssf_category());
     }
@@ -629,6 +902,48 @@ class basic_tls {
     return context;
   }
 
+  /// Check that acceptors can handshake with context (DH parameters of
+  /// finite field DHE profiles)
+  static boost::system::error_code check_acceptor_context(
+      const endpoint_context_type& context, boost::system::error_code& ec) {
+    detail::CheckAcceptorContext(context, ec);
+    return ec;
+  }
+
+  /// Force the next endpoints resolved with parameters to reload their
+  /// certificates. Existing sockets keep their context
+  static bool invalidate_endpoint_context(const LayerParameters& parameters) {
+    return detail::TLSContextCache::Invalidate(parameters);
+  }
+
+  static void invalidate_endpoint_contexts() {
+    detail::TLSContextCache::Clear();
+  }
+
+  /// Limit the bytes buffered by all the buffered TLS sockets, 0 for no limit
+  static void set_buffering_budget(uint64_t budget) {
+    detail::TLSBufferingBudget::SetLimit(budget);
+  }
+
+  /// Run the asynchronous handshakes on a pool of dedicated threads (threads
+  /// of them), at most max_in_flight at once (0 : default) and max_queued
+  /// waiting (0 : none). Further handshakes fail with
+  /// device_or_resource_busy. 0 threads : handshakes run on the socket
+  /// io_service (default)
+  ///   A running pool is stopped first : its queued handshakes are aborted
+  ///   and the call blocks, without time limit, until its handshakes in
+  ///   flight finish (closing their sockets ends them). Not to be called
+  ///   from the io_service threads their socket I/O needs
+  static void set_handshake_executor(uint32_t threads, uint32_t max_in_flight,
+                                     uint32_t max_queued) {
+    detail::TLSHandshakeExecutor::Start(threads, max_in_flight, max_queued);
+  }
+
+  /// Crypto library, engines and CPU acceleration in use
+  static detail::CryptoCapabilities crypto_capabilities() {
+    return detail::GetCryptoCapabilities();
+  }
+
   static void add_params_from_property_tree(
       query* p_query, const boost::property_tree::ptree& property_tree,
       bool connect, boost::system::error_code& ec) {
@@ -679,6 +994,43 @@ class basic_tls {
       params["key_src"] = "buffer";
     }
 
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "cipher_profile",
+                                     &params);
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "crypto_engine",
+                                     &params);
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "crypto_acceleration",
+                                     &params);
+
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "receive_buffer_size",
+                                     &params);
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "low_watermark",
+                                     &params);
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "high_watermark",
+                                     &params);
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "adaptive_buffering",
+                                     &params);
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "write_coalescing",
+                                     &params);
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "write_record_size",
+                                     &params);
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "write_flush_latency",
+                                     &params);
+
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "kernel_tls", &params);
+
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "session_cache",
+                                     &params);
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "session_cache_size",
+                                     &params);
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "session_timeout",
+                                     &params);
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "session_tickets",
+                                     &params);
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "ticket_key_lifetime",
+                                     &params);
+    ssf::layer::ptree_entry_to_query(*layer_parameters, "session_resumption",
+                                     &params);
+
     ssf::layer::ptree_entry_to_query(*layer_parameters, "dhparam_file",
                                           &params);
     ssf::layer::ptree_entry_to_query(*layer_parameters, "dhparam_buffer",
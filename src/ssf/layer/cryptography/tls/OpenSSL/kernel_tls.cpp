@@ -0,0 +1,120 @@
+#include "ssf/layer/cryptography/tls/OpenSSL/kernel_tls.h"
+
+#include <string>
+
+#include <openssl/bio.h>
+
+#include "ssf/layer/cryptography/tls/OpenSSL/ex_data.h"
+#include "ssf/utils/map_helpers.h"
+
+namespace ssf {
+namespace layer {
+namespace cryptography {
+namespace detail {
+
+namespace {
+
+/// Marks the contexts whose TCP sockets use kernel TLS
+struct KernelTLSOption {};
+
+}  // namespace
+
+bool SetCtxKernelTLS(boost::asio::ssl::context& ctx,
+                     const LayerParameters& parameters) {
+  auto kernel_tls = helpers::GetField<std::string>("kernel_tls", parameters);
+
+  if (kernel_tls != "true") {
+    return true;
+  }
+
+#if defined(SSF_TLS_KERNEL_OFFLOAD)
+  SSL_CTX_set_options(ctx.native_handle(), SSL_OP_ENABLE_KTLS);
+
+  return CtxExData<KernelTLSOption>::Set(ctx.native_handle(),
+                                         new KernelTLSOption());
+#else
+  BOOST_LOG_TRIVIAL(warning)
+      << "kernel TLS not available, records stay in user space";
+
+  return true;
+#endif
+}
+
+bool IsCtxKernelTLS(SSL_CTX* p_ctx) {
+  return CtxExData<KernelTLSOption>::Get(p_ctx) != nullptr;
+}
+
+bool AttachKernelTLS(SSL* ssl, int fd,
+                     boost::asio::ssl::stream_base::handshake_type type,
+                     boost::system::error_code& ec) {
+  // The stream BIOs are freed with the SSL object ones
+  if (!SSL_set_fd(ssl, fd)) {
+    ec.assign(ssf::error::bad_file_descriptor, ssf::error::get_ssf_category());
+    return false;
+  }
+
+  if (type == boost::asio::ssl::stream_base::client) {
+    SSL_set_connect_state(ssl);
+  } else {
+    SSL_set_accept_state(ssl);
+  }
+
+  ec.assign(ssf::error::success, ssf::error::get_ssf_category());
+
+  return true;
+}
+
+bool KernelTLSSend(SSL* ssl) {
+#if defined(SSF_TLS_KERNEL_OFFLOAD)
+  return BIO_get_ktls_send(SSL_get_wbio(ssl)) != 0;
+#else
+  return false;
+#endif
+}
+
+bool KernelTLSReceive(SSL* ssl) {
+#if defined(SSF_TLS_KERNEL_OFFLOAD)
+  return BIO_get_ktls_recv(SSL_get_rbio(ssl)) != 0;
+#else
+  return false;
+#endif
+}
+
+KernelTLSWait GetKernelTLSResult(SSL* ssl, int result,
+                                 boost::system::error_code& ec) {
+  if (result > 0) {
+    ec.assign(ssf::error::success, ssf::error::get_ssf_category());
+    return kernel_tls_done;
+  }
+
+  auto sys_error = errno;
+  auto error = SSL_get_error(ssl, result);
+
+  switch (error) {
+    case SSL_ERROR_WANT_READ:
+      return kernel_tls_wait_read;
+    case SSL_ERROR_WANT_WRITE:
+      return kernel_tls_wait_write;
+    case SSL_ERROR_ZERO_RETURN:
+      ec = boost::asio::error::eof;
+      break;
+    case SSL_ERROR_SYSCALL:
+      if (result < 0 && sys_error) {
+        ec.assign(sys_error, boost::system::system_category());
+      } else {
+        ec = boost::asio::error::eof;
+      }
+      break;
+    default:
+      ec.assign(static_cast<int>(ERR_get_error()),
+                boost::asio::error::get_ssl_category());
+      break;
+  }
+
+  return kernel_tls_done;
+}
+
+}  // detail
+}  // cryptography
+}  // layer
+}  // ssf
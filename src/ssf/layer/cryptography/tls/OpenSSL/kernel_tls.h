@@ -0,0 +1,430 @@
+#ifndef SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_KERNEL_TLS_H_
+#define SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_KERNEL_TLS_H_
+
+#include <cerrno>
+#include <cstddef>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/detail/buffer_sequence_adapter.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/bind.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <openssl/err.h>
+#include <openssl/opensslv.h>
+#include <openssl/ssl.h>
+
+#include "ssf/error/error.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/helpers.h"
+#include "ssf/layer/parameters.h"
+
+#if defined(__linux__) && OPENSSL_VERSION_NUMBER >= 0x30000000L && \
+    !defined(OPENSSL_NO_KTLS)
+#define SSF_TLS_KERNEL_OFFLOAD 1
+#endif
+
+namespace ssf {
+namespace layer {
+namespace cryptography {
+namespace detail {
+
+/// Enable the kernel TLS offload of the TCP sockets using ctx (opt-in)
+///   "kernel_tls" = "true" : the handshake runs on the socket itself and
+///   OpenSSL installs the negotiated keys in the kernel (SOL_TLS). Records
+///   are then sent and received by plain socket I/O. Ciphers or kernels
+///   without kTLS support keep the records in user space.
+///   Ignored, with a warning, when OpenSSL is built without kTLS
+bool SetCtxKernelTLS(boost::asio::ssl::context& ctx,
+                     const LayerParameters& parameters);
+
+bool IsCtxKernelTLS(SSL_CTX* p_ctx);
+
+/// Use the socket fd for the records of ssl instead of the stream BIOs
+///   The fd must be non blocking : SSL calls then return on a socket not
+///   ready instead of blocking the thread running the handshake or the I/O
+bool AttachKernelTLS(SSL* ssl, int fd,
+                     boost::asio::ssl::stream_base::handshake_type type,
+                     boost::system::error_code& ec);
+
+/// Records sent (received) by the kernel
+bool KernelTLSSend(SSL* ssl);
+bool KernelTLSReceive(SSL* ssl);
+
+enum KernelTLSWait {
+  kernel_tls_done,
+  kernel_tls_wait_read,
+  kernel_tls_wait_write
+};
+
+/// Translate the result of an SSL operation on a non blocking socket
+KernelTLSWait GetKernelTLSResult(SSL* ssl, int result,
+                                 boost::system::error_code& ec);
+
+/// Kernel TLS can only drive TCP sockets
+template <typename NextLayerStreamSocket>
+struct IsKernelTLSCapable
+    : std::integral_constant<bool,
+#if defined(SSF_TLS_KERNEL_OFFLOAD)
+                             std::is_same<NextLayerStreamSocket,
+                                          boost::asio::ip::tcp::socket>::value
+#else
+                             false
+#endif
+                             > {
+};
+
+/// TLS stream whose records go through the socket fd, and through the
+/// kernel once OpenSSL enabled the offload
+///   Unavailable for next layers without fd : create returns nullptr
+template <typename NextLayerStreamSocket,
+          bool Capable = IsKernelTLSCapable<NextLayerStreamSocket>::value>
+class TLSKernelStream {
+ private:
+  typedef boost::asio::ssl::stream<NextLayerStreamSocket> tls_stream_type;
+  typedef std::shared_ptr<tls_stream_type> p_tls_stream_type;
+  typedef detail::ExtendedTLSContext p_context_type;
+  typedef boost::asio::io_service::strand strand_type;
+  typedef std::shared_ptr<strand_type> p_strand_type;
+  typedef typename tls_stream_type::handshake_type handshake_type;
+
+ public:
+  typedef std::shared_ptr<TLSKernelStream> p_kernel_stream_type;
+
+ public:
+  static p_kernel_stream_type create(p_tls_stream_type p_socket,
+                                     p_strand_type p_strand,
+                                     p_context_type p_ctx) {
+    return nullptr;
+  }
+
+  boost::system::error_code handshake(handshake_type type,
+                                      boost::system::error_code& ec) {
+    ec.assign(ssf::error::function_not_supported,
+              ssf::error::get_ssf_category());
+    return ec;
+  }
+
+  template <typename Handler>
+  void async_handshake(handshake_type type, Handler handler) {}
+
+  template <typename MutableBufferSequence>
+  std::size_t read_some(const MutableBufferSequence& buffers,
+                        boost::system::error_code& ec) {
+    ec.assign(ssf::error::function_not_supported,
+              ssf::error::get_ssf_category());
+    return 0;
+  }
+
+  template <typename MutableBufferSequence, typename Handler>
+  void async_read_some(const MutableBufferSequence& buffers, Handler handler) {}
+
+  template <typename ConstBufferSequence>
+  std::size_t write_some(const ConstBufferSequence& buffers,
+                         boost::system::error_code& ec) {
+    ec.assign(ssf::error::function_not_supported,
+              ssf::error::get_ssf_category());
+    return 0;
+  }
+
+  template <typename ConstBufferSequence, typename Handler>
+  void async_write_some(const ConstBufferSequence& buffers, Handler handler) {}
+};
+
+template <typename NextLayerStreamSocket>
+class TLSKernelStream<NextLayerStreamSocket, true>
+    : public std::enable_shared_from_this<
+          TLSKernelStream<NextLayerStreamSocket, true>> {
+ private:
+  typedef boost::asio::ssl::stream<NextLayerStreamSocket> tls_stream_type;
+  typedef std::shared_ptr<tls_stream_type> p_tls_stream_type;
+  typedef detail::ExtendedTLSContext p_context_type;
+  typedef boost::asio::io_service::strand strand_type;
+  typedef std::shared_ptr<strand_type> p_strand_type;
+  typedef typename tls_stream_type::handshake_type handshake_type;
+
+  typedef std::function<int()> Operation;
+  typedef std::function<void(const boost::system::error_code&, std::size_t)>
+      Handler;
+
+ public:
+  typedef std::shared_ptr<TLSKernelStream> p_kernel_stream_type;
+
+ public:
+  TLSKernelStream(const TLSKernelStream&) = delete;
+  TLSKernelStream& operator=(const TLSKernelStream&) = delete;
+
+  static p_kernel_stream_type create(p_tls_stream_type p_socket,
+                                     p_strand_type p_strand,
+                                     p_context_type p_ctx) {
+    if (!p_ctx || !IsCtxKernelTLS((*p_ctx).native_handle())) {
+      return nullptr;
+    }
+
+    return p_kernel_stream_type(new TLSKernelStream(p_socket, p_strand));
+  }
+
+  boost::system::error_code handshake(handshake_type type,
+                                      boost::system::error_code& ec) {
+    if (!attach(type, ec)) {
+      return ec;
+    }
+
+    auto p_ssl = ssl();
+    perform([p_ssl]() { return SSL_do_handshake(p_ssl); }, ec);
+
+    if (!ec) {
+      log_offload();
+    }
+
+    return ec;
+  }
+
+  /// Handshake on the socket fd, to be called on the strand
+  template <typename HandshakeHandler>
+  void async_handshake(handshake_type type, HandshakeHandler handler) {
+    boost::system::error_code ec;
+    if (!attach(type, ec)) {
+      strand_.post(boost::bind<void>(handler, ec));
+      return;
+    }
+
+    auto p_ssl = ssl();
+    auto self = this->shared_from_this();
+    async_perform([p_ssl]() { return SSL_do_handshake(p_ssl); },
+                  [self, handler](const boost::system::error_code& ec,
+                                  std::size_t) mutable {
+                    if (!ec) {
+                      self->log_offload();
+                    }
+                    handler(ec);
+                  },
+                  true);
+  }
+
+  template <typename MutableBufferSequence>
+  std::size_t read_some(const MutableBufferSequence& buffers,
+                        boost::system::error_code& ec) {
+    auto buffer = first_buffer<boost::asio::mutable_buffer>(buffers);
+    if (!boost::asio::buffer_size(buffer)) {
+      ec.assign(ssf::error::success, ssf::error::get_ssf_category());
+      return 0;
+    }
+
+    return perform(read_operation(buffer), ec);
+  }
+
+  /// Read in the buffers directly from the socket once the kernel decrypts
+  /// the records, to be called on the strand
+  template <typename MutableBufferSequence, typename ReadHandler>
+  void async_read_some(const MutableBufferSequence& buffers,
+                       ReadHandler handler) {
+    auto buffer = first_buffer<boost::asio::mutable_buffer>(buffers);
+    if (!boost::asio::buffer_size(buffer)) {
+      strand_.post(
+          boost::bind<void>(handler, boost::system::error_code(), 0));
+      return;
+    }
+
+    if (!KernelTLSReceive(ssl()) || SSL_has_pending(ssl())) {
+      async_perform(read_operation(buffer), handler, true);
+      return;
+    }
+
+    auto self = this->shared_from_this();
+    auto do_user_handler = [self, buffer, handler](
+        const boost::system::error_code& ec, std::size_t length) mutable {
+      // A non application record (alert, key update) is left for OpenSSL
+      if (ec == boost::system::error_code(EIO,
+                                          boost::system::system_category())) {
+        self->async_perform(self->read_operation(buffer), handler, false);
+        return;
+      }
+      handler(ec, length);
+    };
+
+    socket().async_read_some(buffers, strand_.wrap(do_user_handler));
+  }
+
+  template <typename ConstBufferSequence>
+  std::size_t write_some(const ConstBufferSequence& buffers,
+                         boost::system::error_code& ec) {
+    if (KernelTLSSend(ssl())) {
+      return socket().write_some(buffers, ec);
+    }
+
+    auto buffer = first_buffer<boost::asio::const_buffer>(buffers);
+    if (!boost::asio::buffer_size(buffer)) {
+      ec.assign(ssf::error::success, ssf::error::get_ssf_category());
+      return 0;
+    }
+
+    return perform(write_operation(buffer), ec);
+  }
+
+  /// Write the buffers directly to the socket once the kernel encrypts the
+  /// records, to be called on the strand
+  template <typename ConstBufferSequence, typename WriteHandler>
+  void async_write_some(const ConstBufferSequence& buffers,
+                        WriteHandler handler) {
+    if (KernelTLSSend(ssl())) {
+      socket().async_write_some(buffers, strand_.wrap(handler));
+      return;
+    }
+
+    auto buffer = first_buffer<boost::asio::const_buffer>(buffers);
+    if (!boost::asio::buffer_size(buffer)) {
+      strand_.post(
+          boost::bind<void>(handler, boost::system::error_code(), 0));
+      return;
+    }
+
+    async_perform(write_operation(buffer), handler, true);
+  }
+
+ private:
+  TLSKernelStream(p_tls_stream_type p_socket, p_strand_type p_strand)
+      : socket_(*p_socket),
+        p_socket_(p_socket),
+        strand_(*p_strand),
+        p_strand_(p_strand) {}
+
+  SSL* ssl() { return socket_.native_handle(); }
+
+  /// Hand the socket fd to OpenSSL in non blocking mode
+  ///   Only the native mode is set : the synchronous socket operations used
+  ///   to wait for the fd keep blocking
+  bool attach(handshake_type type, boost::system::error_code& ec) {
+    socket().native_non_blocking(true, ec);
+    if (ec) {
+      return false;
+    }
+
+    return AttachKernelTLS(ssl(), socket().native_handle(), type, ec);
+  }
+
+  NextLayerStreamSocket& socket() { return socket_.next_layer(); }
+
+  template <typename Buffer, typename BufferSequence>
+  static Buffer first_buffer(const BufferSequence& buffers) {
+    return boost::asio::detail::buffer_sequence_adapter<
+        Buffer, BufferSequence>::first(buffers);
+  }
+
+  static int operation_size(std::size_t size) {
+    return static_cast<int>(
+        std::min<std::size_t>(size, std::numeric_limits<int>::max()));
+  }
+
+  Operation read_operation(boost::asio::mutable_buffer buffer) {
+    auto p_ssl = ssl();
+    auto p_data = boost::asio::buffer_cast<void*>(buffer);
+    auto size = operation_size(boost::asio::buffer_size(buffer));
+
+    return [p_ssl, p_data, size]() { return SSL_read(p_ssl, p_data, size); };
+  }
+
+  Operation write_operation(boost::asio::const_buffer buffer) {
+    auto p_ssl = ssl();
+    auto p_data = boost::asio::buffer_cast<const void*>(buffer);
+    auto size = operation_size(boost::asio::buffer_size(buffer));
+
+    return [p_ssl, p_data, size]() { return SSL_write(p_ssl, p_data, size); };
+  }
+
+  /// Run operation until done, waiting for the socket in between
+  std::size_t perform(const Operation& operation,
+                      boost::system::error_code& ec) {
+    for (;;) {
+      ERR_clear_error();
+      auto result = operation();
+
+      switch (GetKernelTLSResult(ssl(), result, ec)) {
+        case kernel_tls_wait_read:
+          socket().read_some(boost::asio::null_buffers(), ec);
+          break;
+        case kernel_tls_wait_write:
+          socket().write_some(boost::asio::null_buffers(), ec);
+          break;
+        default:
+          return ec ? 0 : static_cast<std::size_t>(result);
+      }
+
+      if (ec) {
+        return 0;
+      }
+    }
+  }
+
+  /// Run operation until done, waiting asynchronously for the socket
+  ///   A first call done at once completes in a strand post
+  void async_perform(Operation operation, Handler handler, bool first) {
+    boost::system::error_code ec;
+
+    ERR_clear_error();
+    auto result = operation();
+    auto wait = GetKernelTLSResult(ssl(), result, ec);
+
+    if (wait != kernel_tls_done) {
+      auto self = this->shared_from_this();
+      auto retry = [self, operation, handler](
+          const boost::system::error_code& ec, std::size_t) {
+        if (ec) {
+          handler(ec, 0);
+          return;
+        }
+        self->async_perform(operation, handler, false);
+      };
+
+      if (wait == kernel_tls_wait_read) {
+        socket().async_read_some(boost::asio::null_buffers(),
+                                 strand_.wrap(retry));
+      } else {
+        socket().async_write_some(boost::asio::null_buffers(),
+                                  strand_.wrap(retry));
+      }
+      return;
+    }
+
+    std::size_t length = ec ? 0 : static_cast<std::size_t>(result);
+    if (first) {
+      strand_.post(boost::bind<void>(handler, ec, length));
+      return;
+    }
+
+    handler(ec, length);
+  }
+
+  void log_offload() {
+    BOOST_LOG_TRIVIAL(debug) << "kernel TLS: send "
+                             << (KernelTLSSend(ssl()) ? "on" : "off")
+                             << ", receive "
+                             << (KernelTLSReceive(ssl()) ? "on" : "off");
+  }
+
+ private:
+  /// The TLS stream owning the SSL object
+  tls_stream_type& socket_;
+  p_tls_stream_type p_socket_;
+
+  /// The strand serializing the TLS stream operations
+  strand_type& strand_;
+  p_strand_type p_strand_;
+};
+
+}  // detail
+}  // cryptography
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_KERNEL_TLS_H_
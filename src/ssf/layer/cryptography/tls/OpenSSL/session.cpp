@@ -0,0 +1,342 @@
+#include "ssf/layer/cryptography/tls/OpenSSL/session.h"
+
+#include <cstring>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#endif
+
+#include "ssf/layer/cryptography/tls/OpenSSL/ex_data.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/helpers.h"
+#include "ssf/utils/map_helpers.h"
+
+namespace ssf {
+namespace layer {
+namespace cryptography {
+namespace detail {
+
+namespace {
+
+enum {
+  default_session_cache_size = 1024,
+  default_session_timeout = 300,
+  session_id_context_size = 3
+};
+
+const unsigned char session_id_context[session_id_context_size] = {'S', 'S',
+                                                                   'F'};
+
+}  // namespace
+
+TLSTicketKeys::TLSTicketKeys(uint32_t lifetime_seconds)
+    : mutex_(),
+      lifetime_(lifetime_seconds),
+      current_(),
+      previous_(),
+      has_previous_(false) {
+  MakeKey(&current_);
+}
+
+int TLSTicketKeys::TicketKeyCallback(SSL* ssl, unsigned char* key_name,
+                                     unsigned char* iv,
+                                     EVP_CIPHER_CTX* cipher_ctx,
+                                     MacContext* mac_ctx, int enc) {
+  auto p_keys = CtxExData<TLSTicketKeys>::Get(SSL_get_SSL_CTX(ssl));
+  if (!p_keys) {
+    return -1;
+  }
+
+  if (enc) {
+    return p_keys->Encrypt(key_name, iv, cipher_ctx, mac_ctx);
+  }
+
+#ifdef TLS1_3_VERSION
+  auto tls13 = SSL_version(ssl) >= TLS1_3_VERSION;
+#else
+  auto tls13 = false;
+#endif
+
+  return p_keys->Decrypt(key_name, iv, cipher_ctx, mac_ctx, tls13);
+}
+
+bool TLSTicketKeys::MakeKey(Key* p_key) {
+  p_key->creation = std::chrono::steady_clock::now();
+
+  return RAND_bytes(p_key->name, name_size) == 1 &&
+         RAND_bytes(p_key->aes_key, key_size) == 1 &&
+         RAND_bytes(p_key->hmac_key, key_size) == 1;
+}
+
+bool TLSTicketKeys::InitMac(MacContext* mac_ctx,
+                            const unsigned char* hmac_key) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  OSSL_PARAM params[] = {
+      OSSL_PARAM_construct_octet_string(
+          OSSL_MAC_PARAM_KEY, const_cast<unsigned char*>(hmac_key), key_size),
+      OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST,
+                                       const_cast<char*>("SHA256"), 0),
+      OSSL_PARAM_construct_end()};
+
+  return EVP_MAC_CTX_set_params(mac_ctx, params) == 1;
+#else
+  return HMAC_Init_ex(mac_ctx, hmac_key, key_size, EVP_sha256(), nullptr) ==
+         1;
+#endif
+}
+
+int TLSTicketKeys::Encrypt(unsigned char* key_name, unsigned char* iv,
+                           EVP_CIPHER_CTX* cipher_ctx, MacContext* mac_ctx) {
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+
+  if (std::chrono::steady_clock::now() - current_.creation >= lifetime_) {
+    Key key;
+    if (!MakeKey(&key)) {
+      return -1;
+    }
+    previous_ = current_;
+    has_previous_ = true;
+    current_ = key;
+  }
+
+  if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1) {
+    return -1;
+  }
+
+  std::memcpy(key_name, current_.name, name_size);
+  if (EVP_EncryptInit_ex(cipher_ctx, EVP_aes_256_cbc(), nullptr,
+                         current_.aes_key, iv) != 1 ||
+      !InitMac(mac_ctx, current_.hmac_key)) {
+    return -1;
+  }
+
+  return 1;
+}
+
+int TLSTicketKeys::Decrypt(const unsigned char* key_name, unsigned char* iv,
+                           EVP_CIPHER_CTX* cipher_ctx, MacContext* mac_ctx,
+                           bool tls13) {
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+
+  const Key* p_key = nullptr;
+  auto renew = false;
+
+  if (!std::memcmp(key_name, current_.name, name_size)) {
+    p_key = &current_;
+  } else if (has_previous_ &&
+             !std::memcmp(key_name, previous_.name, name_size)) {
+    p_key = &previous_;
+    renew = true;
+  }
+
+  // Unknown key : full handshake
+  if (!p_key) {
+    return 0;
+  }
+
+  if (!InitMac(mac_ctx, p_key->hmac_key) ||
+      EVP_DecryptInit_ex(cipher_ctx, EVP_aes_256_cbc(), nullptr,
+                         p_key->aes_key, iv) != 1) {
+    return -1;
+  }
+
+  return (renew || tls13) ? 2 : 1;
+}
+
+TLSClientSessions::TLSClientSessions(std::size_t max_size)
+    : mutex_(), max_size_(max_size), sessions_(), index_() {}
+
+void TLSClientSessions::Resume(SSL* ssl, const std::string& peer) {
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+
+  auto index_it = index_.find(peer);
+  if (index_it != std::end(index_)) {
+    sessions_.splice(std::begin(sessions_), sessions_, index_it->second);
+    SSL_set_session(ssl, index_it->second->second.get());
+  }
+}
+
+int TLSClientSessions::NewSessionCallback(SSL* ssl, SSL_SESSION* p_session) {
+  auto p_sessions = CtxExData<TLSClientSessions>::Get(SSL_get_SSL_CTX(ssl));
+  auto p_peer = SslExData<std::string>::Get(ssl);
+  if (!p_sessions || !p_peer) {
+    return 0;
+  }
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+  // TLS 1.3 servers may issue tickets which cannot be resumed
+  if (!SSL_SESSION_is_resumable(p_session)) {
+    return 0;
+  }
+#endif
+
+  p_sessions->Save(*p_peer, p_session);
+
+  return 1;
+}
+
+void TLSClientSessions::Save(const std::string& peer,
+                             SSL_SESSION* p_session) {
+  SessionPtr p_saved_session(p_session, &SSL_SESSION_free);
+
+  if (!max_size_) {
+    return;
+  }
+
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+
+  auto index_it = index_.find(peer);
+  if (index_it != std::end(index_)) {
+    sessions_.splice(std::begin(sessions_), sessions_, index_it->second);
+    index_it->second->second = std::move(p_saved_session);
+    return;
+  }
+
+  if (sessions_.size() >= max_size_) {
+    index_.erase(sessions_.back().first);
+    sessions_.pop_back();
+  }
+
+  sessions_.emplace_front(peer, std::move(p_saved_session));
+  index_[peer] = std::begin(sessions_);
+}
+
+void TLSClientSessions::Forget(const std::string& peer) {
+  boost::recursive_mutex::scoped_lock lock(mutex_);
+
+  auto index_it = index_.find(peer);
+  if (index_it != std::end(index_)) {
+    sessions_.erase(index_it->second);
+    index_.erase(index_it);
+  }
+}
+
+bool SetCtxSessionResumption(boost::asio::ssl::context& ctx,
+                             const LayerParameters& parameters) {
+  auto p_ctx = ctx.native_handle();
+
+  uint32_t cache_size = 0;
+  uint32_t timeout = 0;
+  if (!GetUInt32Field(parameters, "session_cache_size",
+                      default_session_cache_size, &cache_size) ||
+      !GetUInt32Field(parameters, "session_timeout", default_session_timeout,
+                      &timeout)) {
+    return false;
+  }
+
+  auto session_cache =
+      helpers::GetField<std::string>("session_cache", parameters) == "true";
+  auto session_tickets =
+      helpers::GetField<std::string>("session_tickets", parameters) == "true";
+  auto client_resumption =
+      helpers::GetField<std::string>("session_resumption", parameters) ==
+      "true";
+
+  if (!session_cache && !session_tickets && !client_resumption) {
+    SSL_CTX_set_session_cache_mode(p_ctx, SSL_SESS_CACHE_OFF);
+    return true;
+  }
+
+  // Resumed sessions of authenticated peers need a session id context
+  if (!SSL_CTX_set_session_id_context(p_ctx, session_id_context,
+                                      session_id_context_size)) {
+    return false;
+  }
+
+  SSL_CTX_set_timeout(p_ctx, timeout);
+
+  long cache_mode = SSL_SESS_CACHE_OFF;
+  if (session_cache) {
+    cache_mode |= SSL_SESS_CACHE_SERVER;
+    SSL_CTX_sess_set_cache_size(p_ctx, cache_size);
+  }
+
+  // Client sessions are only stored by the new session callback, the
+  // internal store is kept for the server cache
+  if (client_resumption) {
+    cache_mode |= SSL_SESS_CACHE_CLIENT;
+    if (!session_cache) {
+      cache_mode |= SSL_SESS_CACHE_NO_INTERNAL_STORE;
+    }
+  }
+
+  SSL_CTX_set_session_cache_mode(p_ctx, cache_mode);
+
+  if (session_tickets || client_resumption) {
+    SSL_CTX_clear_options(p_ctx, SSL_OP_NO_TICKET);
+  }
+
+  if (session_tickets &&
+      helpers::GetField<std::string>("ticket_key_lifetime", parameters) !=
+          "") {
+    uint32_t ticket_key_lifetime = 0;
+    if (!GetUInt32Field(parameters, "ticket_key_lifetime", 0,
+                        &ticket_key_lifetime) ||
+        !ticket_key_lifetime) {
+      return false;
+    }
+
+    if (!CtxExData<TLSTicketKeys>::Set(
+            p_ctx, new TLSTicketKeys(ticket_key_lifetime))) {
+      return false;
+    }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(p_ctx,
+                                         &TLSTicketKeys::TicketKeyCallback);
+#else
+    SSL_CTX_set_tlsext_ticket_key_cb(p_ctx, &TLSTicketKeys::TicketKeyCallback);
+#endif
+  }
+
+  if (client_resumption) {
+    if (!CtxExData<TLSClientSessions>::Set(
+            p_ctx, new TLSClientSessions(cache_size))) {
+      return false;
+    }
+
+    SSL_CTX_sess_set_new_cb(p_ctx, &TLSClientSessions::NewSessionCallback);
+  }
+
+  return true;
+}
+
+void ResumeClientSession(SSL* ssl, const std::string& peer) {
+  if (peer == "") {
+    return;
+  }
+
+  auto p_sessions = CtxExData<TLSClientSessions>::Get(SSL_get_SSL_CTX(ssl));
+  if (!p_sessions || !SslExData<std::string>::Set(ssl, new std::string(peer))) {
+    return;
+  }
+
+  p_sessions->Resume(ssl, peer);
+}
+
+void ForgetFailedClientSession(SSL* ssl, const std::string& peer,
+                               const boost::system::error_code& ec) {
+  if (!ec || peer == "") {
+    return;
+  }
+
+  // The stored session may be the cause of the failure
+  auto p_sessions = CtxExData<TLSClientSessions>::Get(SSL_get_SSL_CTX(ssl));
+  if (p_sessions) {
+    p_sessions->Forget(peer);
+  }
+}
+
+void KeepSessionOnClose(SSL* ssl) {
+  if (SSL_is_init_finished(ssl)) {
+    SSL_set_shutdown(ssl, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+  }
+}
+
+}  // detail
+}  // cryptography
+}  // layer
+}  // ssf
@@ -0,0 +1,151 @@
+#ifndef SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_SESSION_H_
+#define SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_SESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <list>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <boost/asio/ssl.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+
+#include "ssf/layer/parameters.h"
+
+namespace ssf {
+namespace layer {
+namespace cryptography {
+namespace detail {
+
+/// Ticket encryption keys of a server context
+///   The current key is replaced every lifetime. Tickets encrypted with the
+///   previous key are still accepted (and renewed) during the next lifetime
+class TLSTicketKeys {
+ public:
+  enum { name_size = 16, key_size = 32 };
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  typedef EVP_MAC_CTX MacContext;
+#else
+  typedef HMAC_CTX MacContext;
+#endif
+
+ public:
+  explicit TLSTicketKeys(uint32_t lifetime_seconds);
+
+  /// SSL_CTX_set_tlsext_ticket_key_evp_cb callback (OpenSSL 3) or
+  /// SSL_CTX_set_tlsext_ticket_key_cb callback
+  static int TicketKeyCallback(SSL* ssl, unsigned char* key_name,
+                               unsigned char* iv, EVP_CIPHER_CTX* cipher_ctx,
+                               MacContext* mac_ctx, int enc);
+
+ private:
+  struct Key {
+    unsigned char name[name_size];
+    unsigned char aes_key[key_size];
+    unsigned char hmac_key[key_size];
+    std::chrono::steady_clock::time_point creation;
+  };
+
+  static bool MakeKey(Key* p_key);
+
+  /// Key mac_ctx with the HMAC-SHA256 key of a ticket key
+  static bool InitMac(MacContext* mac_ctx, const unsigned char* hmac_key);
+
+  int Encrypt(unsigned char* key_name, unsigned char* iv,
+              EVP_CIPHER_CTX* cipher_ctx, MacContext* mac_ctx);
+  /// TLS 1.3 tickets are always renewed, clients use them once
+  int Decrypt(const unsigned char* key_name, unsigned char* iv,
+              EVP_CIPHER_CTX* cipher_ctx, MacContext* mac_ctx, bool tls13);
+
+ private:
+  boost::recursive_mutex mutex_;
+  std::chrono::seconds lifetime_;
+  Key current_;
+  Key previous_;
+  bool has_previous_;
+};
+
+/// Sessions of a client context keyed by peer
+///   Sessions are saved as the server issues them (after the handshake with
+///   TLS 1.3), only resumable ones are kept. At most max_size sessions are
+///   kept, the least recently saved or resumed one is evicted first
+class TLSClientSessions {
+ public:
+  explicit TLSClientSessions(std::size_t max_size);
+
+  /// SSL_CTX_sess_set_new_cb callback
+  static int NewSessionCallback(SSL* ssl, SSL_SESSION* p_session);
+
+  /// Offer the session stored for peer in the next handshake of ssl
+  void Resume(SSL* ssl, const std::string& peer);
+
+  /// Store p_session for peer, taking ownership of its reference
+  void Save(const std::string& peer, SSL_SESSION* p_session);
+
+  void Forget(const std::string& peer);
+
+ private:
+  typedef std::shared_ptr<SSL_SESSION> SessionPtr;
+  /// Sessions from the most to the least recently used
+  typedef std::list<std::pair<std::string, SessionPtr>> SessionList;
+
+ private:
+  boost::recursive_mutex mutex_;
+  std::size_t max_size_;
+  SessionList sessions_;
+  std::map<std::string, SessionList::iterator> index_;
+};
+
+/// Configure session resumption on ctx (opt-in, disabled by default)
+///   Server side :
+///     "session_cache" = "true" : server session cache of
+///     "session_cache_size" entries living "session_timeout" seconds
+///     "session_tickets" = "true" : accept session tickets, with keys rotated
+///     every "ticket_key_lifetime" seconds if set
+///   Client side :
+///     "session_resumption" = "true" : store sessions by peer and offer them
+///     on reconnection, without the OpenSSL internal client cache
+bool SetCtxSessionResumption(boost::asio::ssl::context& ctx,
+                             const LayerParameters& parameters);
+
+/// Offer the session stored for peer if ssl's context stores client sessions
+///   The sessions then issued to ssl are stored for peer
+void ResumeClientSession(SSL* ssl, const std::string& peer);
+
+/// Forget the session stored for peer when the client handshake failed
+void ForgetFailedClientSession(SSL* ssl, const std::string& peer,
+                               const boost::system::error_code& ec);
+
+/// Keep the session of ssl resumable when its transport is closed
+///   The TLS layer closes without close_notify, which would otherwise make
+///   OpenSSL evict the session when ssl is freed
+void KeepSessionOnClose(SSL* ssl);
+
+/// Key identifying the peer of a TLS stream
+template <class TLSStream>
+std::string GetPeerKey(TLSStream& stream) {
+  boost::system::error_code ec;
+  auto peer_endpoint = stream.lowest_layer().remote_endpoint(ec);
+
+  if (ec) {
+    return "";
+  }
+
+  std::ostringstream peer;
+  peer << peer_endpoint;
+
+  return peer.str();
+}
+
+}  // detail
+}  // cryptography
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_SESSION_H_
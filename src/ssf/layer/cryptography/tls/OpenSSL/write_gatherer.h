@@ -0,0 +1,268 @@
+#ifndef SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_WRITE_GATHERER_H_
+#define SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_WRITE_GATHERER_H_
+
+#include <cstdint>
+
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/detail/op_queue.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/bind.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "ssf/io/write_op.h"
+
+#include "ssf/layer/cryptography/tls/OpenSSL/buffering.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/helpers.h"
+
+namespace ssf {
+namespace layer {
+namespace cryptography {
+namespace detail {
+
+/// Gather the user writes of a TLS stream in records
+///   Whole writes queued on the strand are copied in one record of up to
+///   write_record_size bytes, written when full, when the previous record is
+///   written, or write_flush_latency after the first queued write. A write
+///   never spans two records so the bytes of concurrent writes do not
+///   interleave, each write completing with all its bytes once its record is
+///   written. A write alone in its record, for instance because the next one
+///   does not fit, is written as is
+template <typename NextLayerStreamSocket>
+class TLSWriteGatherer : public std::enable_shared_from_this<
+                             TLSWriteGatherer<NextLayerStreamSocket>> {
+ private:
+  typedef boost::asio::ssl::stream<NextLayerStreamSocket> tls_stream_type;
+  typedef std::shared_ptr<tls_stream_type> p_tls_stream_type;
+  typedef detail::ExtendedTLSContext p_context_type;
+  typedef boost::asio::io_service::strand strand_type;
+  typedef std::shared_ptr<strand_type> p_strand_type;
+
+  typedef boost::asio::detail::op_queue<io::basic_pending_write_operation>
+      op_queue_type;
+  typedef std::vector<std::pair<io::basic_pending_write_operation*,
+                                std::size_t>> RecordOps;
+
+ public:
+  typedef TLSWriteGatherer<NextLayerStreamSocket> gatherer_type;
+  typedef std::shared_ptr<gatherer_type> p_gatherer_type;
+
+ public:
+  TLSWriteGatherer(const TLSWriteGatherer&) = delete;
+  TLSWriteGatherer& operator=(const TLSWriteGatherer&) = delete;
+
+  ~TLSWriteGatherer() {}
+
+  /// Create the gatherer of a socket, nullptr unless p_ctx enables it
+  static p_gatherer_type create(p_tls_stream_type p_socket,
+                                p_strand_type p_strand, p_context_type p_ctx) {
+    if (!p_ctx) {
+      return nullptr;
+    }
+
+    auto options = GetCtxBuffering((*p_ctx).native_handle());
+    if (!options.coalesce_writes) {
+      return nullptr;
+    }
+
+    return p_gatherer_type(new gatherer_type(p_socket, p_strand, options));
+  }
+
+  /// Queue a write, handler must be ready for the pending write operation
+  template <typename ConstBufferSequence, typename Handler>
+  void async_write_some(const ConstBufferSequence& buffers, Handler handler) {
+    typedef io::pending_write_operation<ConstBufferSequence, Handler> op;
+    typename op::ptr p = {
+        boost::asio::detail::addressof(handler),
+        boost_asio_handler_alloc_helpers::allocate(sizeof(op), handler), 0};
+
+    p.p = new (p.v) op(buffers, handler);
+
+    io::basic_pending_write_operation* p_op = p.p;
+    p.v = p.p = 0;
+
+    strand_.dispatch(boost::bind(&TLSWriteGatherer::enqueue_op,
+                                 this->shared_from_this(), p_op));
+  }
+
+ private:
+  TLSWriteGatherer(p_tls_stream_type p_socket, p_strand_type p_strand,
+                   const TLSBufferingOptions& options)
+      : socket_(*p_socket),
+        p_socket_(p_socket),
+        strand_(*p_strand),
+        p_strand_(p_strand),
+        record_size_(options.write_record_size),
+        flush_latency_(options.write_flush_latency),
+        timer_(strand_.get_io_service()),
+        pending_(),
+        pending_size_(0),
+        record_(record_size_),
+        record_length_(0),
+        record_ops_(),
+        completing_ops_(),
+        writing_(false),
+        flush_scheduled_(false) {}
+
+  void enqueue_op(io::basic_pending_write_operation* p_op) {
+    pending_size_ += boost::asio::buffer_size(p_op->const_buffers());
+    pending_.push(p_op);
+
+    if (writing_) {
+      return;
+    }
+
+    if (pending_size_ >= record_size_) {
+      flush();
+      return;
+    }
+
+    if (!flush_scheduled_) {
+      schedule_flush();
+    }
+  }
+
+  void schedule_flush() {
+    flush_scheduled_ = true;
+
+    if (!flush_latency_.count()) {
+      strand_.post(
+          boost::bind(&TLSWriteGatherer::flush, this->shared_from_this()));
+      return;
+    }
+
+    timer_.expires_from_now(flush_latency_);
+    timer_.async_wait(
+        strand_.wrap(boost::bind(&TLSWriteGatherer::flush_timer_expired,
+                                 this->shared_from_this(), _1)));
+  }
+
+  void flush_timer_expired(const boost::system::error_code& ec) {
+    if (ec == boost::asio::error::operation_aborted || !flush_scheduled_) {
+      return;
+    }
+
+    flush();
+  }
+
+  /// Write the queued writes as one record
+  void flush() {
+    if (flush_scheduled_ && flush_latency_.count()) {
+      boost::system::error_code ec;
+      timer_.cancel(ec);
+    }
+    flush_scheduled_ = false;
+
+    if (writing_ || pending_.empty()) {
+      return;
+    }
+
+    writing_ = true;
+
+    // Take whole writes until the record is full or the next one overflows it
+    record_length_ = 0;
+    while (!pending_.empty() && record_length_ < record_size_) {
+      auto p_op = pending_.front();
+      auto size = boost::asio::buffer_size(p_op->const_buffers());
+      if (!record_ops_.empty() && record_length_ + size > record_size_) {
+        break;
+      }
+
+      pending_.pop();
+      pending_size_ -= size;
+      record_length_ += size;
+      record_ops_.push_back(std::make_pair(p_op, size));
+    }
+
+    if (record_ops_.size() == 1) {
+      auto p_op = record_ops_.front().first;
+      record_ops_.clear();
+      boost::asio::async_write(
+          socket_, p_op->const_buffers(),
+          strand_.wrap(boost::bind(&TLSWriteGatherer::op_written,
+                                   this->shared_from_this(), p_op, _1, _2)));
+      return;
+    }
+
+    std::size_t offset = 0;
+    for (auto& record_op : record_ops_) {
+      offset += boost::asio::buffer_copy(
+          boost::asio::buffer(&record_[offset], record_length_ - offset),
+          record_op.first->const_buffers());
+    }
+
+    boost::asio::async_write(
+        socket_, boost::asio::buffer(record_.data(), record_length_),
+        strand_.wrap(boost::bind(&TLSWriteGatherer::record_written,
+                                 this->shared_from_this(), _1, _2)));
+  }
+
+  void op_written(io::basic_pending_write_operation* p_op,
+                  const boost::system::error_code& ec, std::size_t length) {
+    writing_ = false;
+    p_op->complete(ec, length);
+
+    continue_writing();
+  }
+
+  void record_written(const boost::system::error_code& ec, std::size_t) {
+    writing_ = false;
+
+    // Handlers may queue writes which may flush a new record
+    completing_ops_.swap(record_ops_);
+    for (auto& record_op : completing_ops_) {
+      record_op.first->complete(ec, ec ? 0 : record_op.second);
+    }
+    completing_ops_.clear();
+
+    continue_writing();
+  }
+
+  /// Writes queued during the write already waited for it
+  void continue_writing() {
+    if (!writing_ && !pending_.empty()) {
+      flush();
+    }
+  }
+
+ private:
+  /// The TLS stream to write to
+  tls_stream_type& socket_;
+  p_tls_stream_type p_socket_;
+
+  /// The strand serializing the TLS stream operations
+  strand_type& strand_;
+  p_strand_type p_strand_;
+
+  std::size_t record_size_;
+  std::chrono::microseconds flush_latency_;
+  boost::asio::steady_timer timer_;
+
+  /// Writes waiting for the next record
+  op_queue_type pending_;
+  std::size_t pending_size_;
+
+  /// Record being written and its writes
+  std::vector<uint8_t> record_;
+  std::size_t record_length_;
+  RecordOps record_ops_;
+  RecordOps completing_ops_;
+
+  bool writing_;
+  bool flush_scheduled_;
+};
+
+}  // detail
+}  // cryptography
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_CRYPTOGRAPHY_TLS_OPENSSL_WRITE_GATHERER_H_
@@ -0,0 +1,120 @@
+#ifndef SSF_LAYER_DATAGRAM_BASIC_BUFFER_POOL_H_
+#define SSF_LAYER_DATAGRAM_BASIC_BUFFER_POOL_H_
+
+#include <cstdint>
+
+#include <atomic>
+
+#include <boost/thread/mutex.hpp>
+
+namespace ssf {
+namespace layer {
+
+/// Process wide pool of fixed size, reference counted memory blocks
+///   One pool exists per block size. Released blocks are kept in a free list
+///   (up to max_cached_bytes) and handed back out on the next Acquire
+template <uint32_t BlockSize>
+class basic_BufferPool {
+ public:
+  enum { block_size = BlockSize };
+  enum { max_cached_bytes = 8 * 1024 * 1024 };
+  enum {
+    max_cached_blocks =
+        (max_cached_bytes / (BlockSize + 1)) > 0
+            ? (max_cached_bytes / (BlockSize + 1))
+            : 1
+  };
+
+  struct Block {
+    std::atomic<uint32_t> ref_count;
+    Block* p_next;
+    uint8_t data[BlockSize > 0 ? BlockSize : 1];
+  };
+
+ public:
+  /// Get a block with a reference count of 1
+  static Block* Acquire() {
+    Block* p_block = nullptr;
+    {
+      boost::mutex::scoped_lock lock(free_list_mutex_);
+      if (p_free_list_) {
+        p_block = p_free_list_;
+        p_free_list_ = p_block->p_next;
+        --free_count_;
+      }
+    }
+
+    if (!p_block) {
+      p_block = new Block;
+    }
+
+    p_block->p_next = nullptr;
+    p_block->ref_count.store(1, std::memory_order_relaxed);
+    used_count_.fetch_add(1, std::memory_order_relaxed);
+
+    return p_block;
+  }
+
+  static void AddRef(Block* p_block) {
+    p_block->ref_count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Drop a reference, the block returns to the pool when it was the last one
+  static void Release(Block* p_block) {
+    if (p_block->ref_count.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      return;
+    }
+
+    used_count_.fetch_sub(1, std::memory_order_relaxed);
+    {
+      boost::mutex::scoped_lock lock(free_list_mutex_);
+      if (free_count_ < max_cached_blocks) {
+        p_block->p_next = p_free_list_;
+        p_free_list_ = p_block;
+        ++free_count_;
+        return;
+      }
+    }
+
+    delete p_block;
+  }
+
+  static bool IsUnique(const Block* p_block) {
+    return p_block->ref_count.load(std::memory_order_acquire) == 1;
+  }
+
+  /// Number of blocks currently waiting in the free list
+  static std::size_t CachedBlocks() {
+    boost::mutex::scoped_lock lock(free_list_mutex_);
+    return free_count_;
+  }
+
+  /// Number of blocks currently referenced by at least one payload
+  static std::size_t UsedBlocks() {
+    return used_count_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static boost::mutex free_list_mutex_;
+  static Block* p_free_list_;
+  static std::size_t free_count_;
+  static std::atomic<std::size_t> used_count_;
+};
+
+template <uint32_t BlockSize>
+boost::mutex basic_BufferPool<BlockSize>::free_list_mutex_;
+
+template <uint32_t BlockSize>
+typename basic_BufferPool<BlockSize>::Block*
+    basic_BufferPool<BlockSize>::p_free_list_ = nullptr;
+
+template <uint32_t BlockSize>
+std::size_t basic_BufferPool<BlockSize>::free_count_ = 0;
+
+template <uint32_t BlockSize>
+std::atomic<std::size_t> basic_BufferPool<BlockSize>::used_count_(0);
+
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_DATAGRAM_BASIC_BUFFER_POOL_H_
@@ -18,17 +18,26 @@ class basic_Datagram {
   typedef TFooter Footer;
 
  public:
-  typedef io::fixed_const_buffer_sequence ConstBuffers;
-  typedef io::fixed_mutable_buffer_sequence MutableBuffers;
   enum { size = Header::size + Payload::size + Footer::size };
+  enum {
+    buffer_count =
+        Header::buffer_count + Payload::buffer_count + Footer::buffer_count
+  };
+  typedef io::fixed_buffer_sequence<boost::asio::const_buffer, buffer_count>
+      ConstBuffers;
+  typedef io::fixed_buffer_sequence<boost::asio::mutable_buffer,
+                                    buffer_count> MutableBuffers;
 
  public:
   basic_Datagram() : header_(), payload_(), footer_() {}
 
+  /// The header fields are final, encode its wire buffer
   basic_Datagram(Header header, Payload payload, Footer footer)
       : header_(std::move(header)),
         payload_(std::move(payload)),
-        footer_(std::move(footer)) {}
+        footer_(std::move(footer)) {
+    header_.Encode();
+  }
 
   basic_Datagram(const basic_Datagram& datagram)
       : header_(datagram.header_),
@@ -64,7 +73,8 @@ class basic_Datagram {
     return buffers;
   }
 
-  void GetConstBuffers(ConstBuffers* p_buffers) const {
+  template <class ConstBufferSequence>
+  void GetConstBuffers(ConstBufferSequence* p_buffers) const {
     header_.GetConstBuffers(p_buffers);
     payload_.GetConstBuffers(p_buffers);
     footer_.GetConstBuffers(p_buffers);
@@ -78,7 +88,8 @@ class basic_Datagram {
     return buffers;
   }
 
-  void GetMutableBuffers(MutableBuffers* p_buffers) {
+  template <class MutableBufferSequence>
+  void GetMutableBuffers(MutableBufferSequence* p_buffers) {
     header_.GetMutableBuffers(p_buffers);
     payload_.GetMutableBuffers(p_buffers);
     footer_.GetMutableBuffers(p_buffers);
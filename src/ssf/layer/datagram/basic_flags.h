@@ -3,7 +3,7 @@
 
 #include <cstdint>
 
-#include <boost/asio/buffer.hpp>
+#include "ssf/layer/datagram/byte_order.h"
 
 namespace ssf {
 namespace layer {
@@ -11,37 +11,21 @@ namespace layer {
 template <typename BasicType>
 class basic_Flags {
  public:
-  typedef io::fixed_const_buffer_sequence ConstBuffers;
-  typedef io::fixed_mutable_buffer_sequence MutableBuffers;
   enum { size = sizeof(BasicType) };
 
  public:
-  basic_Flags() {}
+  basic_Flags() : raw_flags_(0) {}
   basic_Flags(BasicType raw_flags) : raw_flags_(raw_flags) {}
 
   ~basic_Flags() {}
 
-  ConstBuffers GetConstBuffers() const {
-    ConstBuffers buffers;
-    buffers.push_back(boost::asio::buffer(&raw_flags_, sizeof(raw_flags_)));
-    return buffers;
-  }
-
-  void GetConstBuffers(ConstBuffers* p_buffers) const {
-    p_buffers->push_back(boost::asio::buffer(&raw_flags_, sizeof(raw_flags_)));
-  }
-
-  MutableBuffers GetMutableBuffers() {
-    MutableBuffers buffers;
-    buffers.push_back(boost::asio::buffer(&raw_flags_, sizeof(raw_flags_)));
-    return buffers;
-  }
+  void Encode(uint8_t* p_wire) const { EncodeBigEndian(raw_flags_, p_wire); }
 
-  void GetMutableBuffers(MutableBuffers* p_buffers) {
-    p_buffers->push_back(boost::asio::buffer(&raw_flags_, sizeof(raw_flags_)));
+  void Decode(const uint8_t* p_wire) {
+    raw_flags_ = DecodeBigEndian<BasicType>(p_wire);
   }
 
-  BasicType raw_flags() const { return raw_flags_ }
+  BasicType raw_flags() const { return raw_flags_; }
   void set_raw_flags(BasicType raw_flags) { raw_flags_ = raw_flags; }
 
  private:
@@ -3,10 +3,15 @@
 
 #include <cstdint>
 
+#include <array>
 #include <type_traits>
 
 #include <boost/asio/buffer.hpp>
 
+#include "ssf/io/buffers.h"
+
+#include "ssf/layer/datagram/byte_order.h"
+
 namespace ssf {
 namespace layer {
 
@@ -25,6 +30,28 @@ struct ResolvePayloadLengthBaseSize<uint0_t> {
   enum { value = 0 };
 };
 
+template <class T>
+struct PayloadLengthWireFormat {
+  static void Encode(const T& payload_length, uint8_t* p_wire) {
+    EncodeBigEndian(payload_length, p_wire);
+  }
+
+  static void Decode(T* p_payload_length, const uint8_t* p_wire) {
+    *p_payload_length = DecodeBigEndian<T>(p_wire);
+  }
+};
+
+template <>
+struct PayloadLengthWireFormat<uint0_t> {
+  static void Encode(const uint0_t& payload_length, uint8_t* p_wire) {}
+  static void Decode(uint0_t* p_payload_length, const uint8_t* p_wire) {}
+};
+
+/// Datagram header sent as one contiguous block in network byte order
+///   Components are laid out in order (version, id, flags, payload length)
+///   and each of them writes its own wire format through Encode/Decode.
+///   The wire buffer is only written by non const members : call Encode()
+///   after setting the fields through the accessors
 template <typename TVersion, class TID, class TFlags, class TPayloadLength>
 class basic_Header {
  public:
@@ -40,58 +67,87 @@ class basic_Header {
   };
 
  public:
-  typedef io::fixed_const_buffer_sequence ConstBuffers;
-  typedef io::fixed_mutable_buffer_sequence MutableBuffers;
   enum {
     size = Version::size + ID::size + Flags::size + payload_length_base_size
   };
+  enum { buffer_count = size > 0 ? 1 : 0 };
+  typedef io::fixed_buffer_sequence<boost::asio::const_buffer, buffer_count>
+      ConstBuffers;
+  typedef io::fixed_buffer_sequence<boost::asio::mutable_buffer,
+                                    buffer_count> MutableBuffers;
+  typedef std::array<uint8_t, size> WireFormat;
 
  public:
-  basic_Header() : version_(), id_(), flags_(), payload_length_(0) {}
+  basic_Header()
+      : version_(), id_(), flags_(), payload_length_(0), wire_() {
+    Encode();
+  }
 
   basic_Header(Version version, ID id, Flags flags,
                PayloadLength payload_length)
       : version_(std::move(version)),
         id_(std::move(id)),
         flags_(std::move(flags)),
-        payload_length_(std::move(payload_length)) {}
+        payload_length_(std::move(payload_length)),
+        wire_() {
+    Encode();
+  }
 
   ~basic_Header() {}
 
+  void Encode(WireFormat* p_wire) const { Encode(p_wire->data()); }
+
+  /// Encode the fields in the size bytes starting at p_data
+  void Encode(uint8_t* p_data) const {
+    version_.Encode(p_data);
+    id_.Encode(p_data + Version::size);
+    flags_.Encode(p_data + Version::size + ID::size);
+    PayloadLengthWireFormat<PayloadLength>::Encode(
+        payload_length_, p_data + Version::size + ID::size + Flags::size);
+  }
+
+  /// Update the wire buffer from the fields
+  void Encode() { Encode(&wire_); }
+
+  void Decode(const WireFormat& wire) {
+    wire_ = wire;
+    auto p_data = wire.data();
+    version_.Decode(p_data);
+    id_.Decode(p_data + Version::size);
+    flags_.Decode(p_data + Version::size + ID::size);
+    PayloadLengthWireFormat<PayloadLength>::Decode(
+        &payload_length_, p_data + Version::size + ID::size + Flags::size);
+  }
+
+  /// Update the fields from the wire buffer filled through GetMutableBuffers
+  void Decode() { Decode(wire_); }
+
+  /// Return the wire buffer, as of the last Encode or Decode
   ConstBuffers GetConstBuffers() const {
     ConstBuffers buffers;
-    version_.GetConstBuffers(&buffers);
-    id_.GetConstBuffers(&buffers);
-    flags_.GetConstBuffers(&buffers);
-    buffers.push_back(
-        boost::asio::buffer(&payload_length_, payload_length_base_size));
+    GetConstBuffers(&buffers);
     return buffers;
   }
 
-  void GetConstBuffers(ConstBuffers* p_buffers) const {
-    version_.GetConstBuffers(p_buffers);
-    id_.GetConstBuffers(p_buffers);
-    flags_.GetConstBuffers(p_buffers);
-    p_buffers->push_back(
-        boost::asio::buffer(&payload_length_, payload_length_base_size));
+  template <class ConstBufferSequence>
+  void GetConstBuffers(ConstBufferSequence* p_buffers) const {
+    if (size > 0) {
+      p_buffers->push_back(boost::asio::buffer(wire_));
+    }
   }
 
+  /// Return the wire buffer, call Decode once it has been filled
   MutableBuffers GetMutableBuffers() {
     MutableBuffers buffers;
-    version_.GetMutableBuffers(&buffers);
-    id_.GetMutableBuffers(&buffers);
-    flags_.GetMutableBuffers(&buffers);
-    buffers.push_back(
-        boost::asio::buffer(&payload_length_, payload_length_base_size));
+    GetMutableBuffers(&buffers);
     return buffers;
   }
 
-  void GetMutableBuffers(MutableBuffers* p_buffers) {
-    version_.GetMutableBuffers(p_buffers);
-    id_.GetMutableBuffers(p_buffers);
-    flags_.GetMutableBuffers(p_buffers);
-    p_buffers->push_back(
-        boost::asio::buffer(&payload_length_, payload_length_base_size));
+  template <class MutableBufferSequence>
+  void GetMutableBuffers(MutableBufferSequence* p_buffers) {
+    if (size > 0) {
+      p_buffers->push_back(boost::asio::buffer(wire_));
+    }
   }
 
   Version& version() { return version_; }
@@ -111,6 +167,7 @@ class basic_Header {
   ID id_;
   Flags flags_;
   PayloadLength payload_length_;
+  WireFormat wire_;
 };
 
 }  // layer
@@ -2,12 +2,15 @@
 #define SSF_LAYER_DATAGRAM_BASIC_PAYLOAD_H_
 
 #include <cstdint>
+#include <cstring>
 
+#include <utility>
 #include <vector>
 
 #include <boost/asio/buffer.hpp>
 
 #include "ssf/io/buffers.h"
+#include "ssf/layer/datagram/basic_buffer_pool.h"
 
 namespace ssf {
 namespace layer {
@@ -17,6 +20,8 @@ class MutablePayload {
   typedef io::fixed_mutable_buffer_sequence MutableBuffers;
   typedef io::fixed_const_buffer_sequence ConstBuffers;
   enum { size = 0 };
+  /// Usual number of buffers, user sequences may hold more
+  enum { buffer_count = 1 };
 
  public:
   template <class MutableBufferSequence>
@@ -27,7 +32,8 @@ class MutablePayload {
 
   MutableBuffers GetMutableBuffers() const { return data_; }
 
-  void GetMutableBuffers(MutableBuffers* p_buffers) const {
+  template <class MutableBufferSequence>
+  void GetMutableBuffers(MutableBufferSequence* p_buffers) const {
     for (const auto& buffer : data_) {
       p_buffers->push_back(buffer);
     }
@@ -35,7 +41,8 @@ class MutablePayload {
 
   ConstBuffers GetConstBuffers() const { return data_; }
 
-  void GetConstBuffers(ConstBuffers* p_buffers) const {
+  template <class ConstBufferSequence>
+  void GetConstBuffers(ConstBufferSequence* p_buffers) const {
     for (const auto& buffer : data_) {
       p_buffers->push_back(buffer);
     }
@@ -57,6 +64,8 @@ class ConstPayload {
  public:
   typedef io::fixed_const_buffer_sequence ConstBuffers;
   enum { size = 0 };
+  /// Usual number of buffers, user sequences may hold more
+  enum { buffer_count = 1 };
 
  public:
   template <class ConstBufferSequence>
@@ -67,7 +76,8 @@ class ConstPayload {
 
   ConstBuffers GetConstBuffers() const { return data_; }
 
-  void GetConstBuffers(ConstBuffers* p_buffers) const {
+  template <class ConstBufferSequence>
+  void GetConstBuffers(ConstBufferSequence* p_buffers) const {
     for (const auto& buffer : data_) {
       p_buffers->push_back(buffer);
     }
@@ -85,45 +95,133 @@ class ConstPayload {
   ConstBuffers data_;
 };
 
-template <uint32_t MaxSize>
+/// Receive payload backed by a pooled, reference counted block of MaxSize
+///   Copies share the block, it is duplicated on the first mutable access
+///   of a shared payload (copy on write)
+///   Headroom bytes are reserved in front of the data so that a header can be
+///   encoded there and sent with the payload as one buffer (Frame)
+template <uint32_t MaxSize, uint32_t Headroom = 0>
 class BufferPayload {
  public:
-  typedef io::fixed_const_buffer_sequence ConstBuffers;
-  typedef io::fixed_mutable_buffer_sequence MutableBuffers;
   enum { size = 0 };
+  enum { max_size = MaxSize };
+  enum { headroom = Headroom };
+  enum { buffer_count = 1 };
+  typedef io::fixed_buffer_sequence<boost::asio::const_buffer, buffer_count>
+      ConstBuffers;
+  typedef io::fixed_buffer_sequence<boost::asio::mutable_buffer,
+                                    buffer_count> MutableBuffers;
+  typedef basic_BufferPool<Headroom + MaxSize> Pool;
 
  public:
-  BufferPayload() : data_(MaxSize) {}
-  ~BufferPayload() {}
+  BufferPayload() : p_block_(Pool::Acquire()), size_(MaxSize) {}
+
+  BufferPayload(const BufferPayload& other)
+      : p_block_(other.p_block_), size_(other.size_) {
+    if (p_block_) {
+      Pool::AddRef(p_block_);
+    }
+  }
+
+  BufferPayload(BufferPayload&& other)
+      : p_block_(other.p_block_), size_(other.size_) {
+    other.p_block_ = nullptr;
+    other.size_ = 0;
+  }
+
+  ~BufferPayload() {
+    if (p_block_) {
+      Pool::Release(p_block_);
+    }
+  }
+
+  BufferPayload& operator=(const BufferPayload& other) {
+    BufferPayload copy(other);
+    Swap(copy);
+    return *this;
+  }
+
+  BufferPayload& operator=(BufferPayload&& other) {
+    BufferPayload moved(std::move(other));
+    Swap(moved);
+    return *this;
+  }
 
   ConstBuffers GetConstBuffers() const {
-    return ConstBuffers({boost::asio::buffer(data_)});
+    return ConstBuffers({boost::asio::buffer(data(), size_)});
   }
 
-  void GetConstBuffers(ConstBuffers* p_buffers) const {
-    p_buffers->push_back(boost::asio::buffer(data_));
+  template <class ConstBufferSequence>
+  void GetConstBuffers(ConstBufferSequence* p_buffers) const {
+    p_buffers->push_back(boost::asio::buffer(data(), size_));
   }
 
   MutableBuffers GetMutableBuffers() {
-    return MutableBuffers({boost::asio::buffer(data_)});
+    MakeUnique();
+    return MutableBuffers({boost::asio::buffer(mutable_data(), size_)});
   }
 
-  void GetMutableBuffers(MutableBuffers* p_buffers) {
-    p_buffers->push_back(boost::asio::buffer(data_));
+  template <class MutableBufferSequence>
+  void GetMutableBuffers(MutableBufferSequence* p_buffers) {
+    MakeUnique();
+    p_buffers->push_back(boost::asio::buffer(mutable_data(), size_));
+  }
+
+  /// Encode header in the headroom and return header and payload
+  ///   as one contiguous buffer, valid as long as the block is referenced
+  template <class Header>
+  boost::asio::const_buffer Frame(const Header& header) {
+    static_assert(Header::size <= Headroom, "Header does not fit in headroom");
+
+    MakeUnique();
+    auto p_frame = mutable_data() - Header::size;
+    header.Encode(p_frame);
+
+    return boost::asio::const_buffer(p_frame, Header::size + size_);
   }
 
-  std::size_t GetSize() const { return data_.size(); }
+  std::size_t GetSize() const { return size_; }
 
   void SetSize(std::size_t new_size) {
     if (new_size <= MaxSize) {
-      data_.resize(new_size);
+      size_ = new_size;
     }
   }
 
-  void ResetSize() { data_.resize(MaxSize); }
+  void ResetSize() { size_ = MaxSize; }
+
+ private:
+  const uint8_t* data() const {
+    return p_block_ ? p_block_->data + Headroom : nullptr;
+  }
+
+  uint8_t* mutable_data() { return p_block_->data + Headroom; }
+
+  // Give this payload its own block (moved from or shared payloads)
+  void MakeUnique() {
+    if (!p_block_) {
+      p_block_ = Pool::Acquire();
+      return;
+    }
+
+    if (Pool::IsUnique(p_block_)) {
+      return;
+    }
+
+    auto p_block = Pool::Acquire();
+    std::memcpy(p_block->data + Headroom, p_block_->data + Headroom, size_);
+    Pool::Release(p_block_);
+    p_block_ = p_block;
+  }
+
+  void Swap(BufferPayload& other) {
+    std::swap(p_block_, other.p_block_);
+    std::swap(size_, other.size_);
+  }
 
  private:
-  std::vector<uint8_t> data_;
+  typename Pool::Block* p_block_;
+  std::size_t size_;
 };
 
 }  // layer
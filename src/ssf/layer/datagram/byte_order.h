@@ -0,0 +1,35 @@
+#ifndef SSF_LAYER_DATAGRAM_BYTE_ORDER_H_
+#define SSF_LAYER_DATAGRAM_BYTE_ORDER_H_
+
+#include <cstdint>
+
+#include <type_traits>
+
+namespace ssf {
+namespace layer {
+
+/// Write value in network byte order (big endian) at p_wire
+template <class T>
+void EncodeBigEndian(T value, uint8_t* p_wire) {
+  static_assert(std::is_integral<T>::value, "Integral type expected");
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    p_wire[i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >>
+                                     (8 * (sizeof(T) - 1 - i)));
+  }
+}
+
+/// Read a value in network byte order (big endian) from p_wire
+template <class T>
+T DecodeBigEndian(const uint8_t* p_wire) {
+  static_assert(std::is_integral<T>::value, "Integral type expected");
+  uint64_t value = 0;
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    value = (value << 8) | p_wire[i];
+  }
+  return static_cast<T>(value);
+}
+
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_DATAGRAM_BYTE_ORDER_H_
@@ -7,24 +7,34 @@
 
 #include <boost/asio/buffer.hpp>
 
+#include "ssf/io/buffers.h"
+
 namespace ssf {
 namespace layer {
 
   class EmptyComponent {
   public:
-   typedef io::fixed_const_buffer_sequence ConstBuffers;
-   typedef io::fixed_mutable_buffer_sequence MutableBuffers;
     enum { size = 0 };
+    enum { buffer_count = 0 };
+    typedef io::fixed_buffer_sequence<boost::asio::const_buffer, buffer_count>
+        ConstBuffers;
+    typedef io::fixed_buffer_sequence<boost::asio::mutable_buffer,
+                                      buffer_count> MutableBuffers;
 
   public:
     EmptyComponent() {}
     ~EmptyComponent() {}
 
+    void Encode(uint8_t* p_wire) const {}
+    void Decode(const uint8_t* p_wire) {}
+
     ConstBuffers GetConstBuffers() const { return ConstBuffers(); }
-    void GetConstBuffers(ConstBuffers* p_buffers) const {}
+    template <class ConstBufferSequence>
+    void GetConstBuffers(ConstBufferSequence* p_buffers) const {}
 
     MutableBuffers GetMutableBuffers() { return MutableBuffers(); }
-    void GetMutableBuffers(MutableBuffers* p_buffers) {}
+    template <class MutableBufferSequence>
+    void GetMutableBuffers(MutableBufferSequence* p_buffers) {}
   };
 
 }  // layer
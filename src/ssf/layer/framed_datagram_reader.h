@@ -0,0 +1,225 @@
+#ifndef SSF_LAYER_FRAMED_DATAGRAM_READER_H_
+#define SSF_LAYER_FRAMED_DATAGRAM_READER_H_
+
+#include <cstdint>
+#include <cstring>
+
+#include <type_traits>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include "ssf/error/error.h"
+
+#include "ssf/layer/protocol_attributes.h"
+
+namespace ssf {
+namespace layer {
+
+/// Read datagrams from a socket in batches
+///   On stream sockets, large chunks are read into a receive buffer and every
+///   complete datagram it holds is decoded in one pass (one read for many
+///   datagrams instead of three reads per datagram). The bytes of an
+///   incomplete datagram are moved to the front of the buffer before the
+///   next read.
+///   On datagram sockets, each batch holds one datagram.
+///
+///   Handler signature: void(const boost::system::error_code&, Datagrams&)
+///   The handler may move datagrams out of the batch. The batch is cleared
+///   at the next read. Datagrams decoded before an invalid frame are
+///   delivered without error, the next read reports the error.
+template <class Socket, class Datagram>
+class basic_FramedDatagramReader {
+ public:
+  typedef std::vector<Datagram> Datagrams;
+  typedef typename Socket::endpoint_type Endpoint;
+
+ private:
+  typedef typename Datagram::Header Header;
+  typedef typename Datagram::Payload Payload;
+  typedef typename Datagram::Footer Footer;
+
+ public:
+  enum {
+    max_datagram_size = Header::size + Payload::max_size + Footer::size
+  };
+  enum { read_chunk_size = 64 * 1024 };
+  enum { receive_buffer_size = max_datagram_size + read_chunk_size };
+  enum { max_batch_size = 64 };
+
+ public:
+  explicit basic_FramedDatagramReader(Socket& socket)
+      : socket_(socket), buffer_(), begin_(0), end_(0), datagrams_() {}
+
+  template <class Handler>
+  void AsyncReadDatagrams(Handler handler) {
+    AsyncReadDatagrams(nullptr, std::move(handler));
+  }
+
+  /// Same, the endpoint the datagrams of the batch come from is written in
+  /// *p_source (the remote endpoint on stream sockets)
+  template <class Handler>
+  void AsyncReadDatagrams(Endpoint* p_source, Handler handler) {
+    AsyncReadDatagrams(p_source, std::move(handler),
+                       std::integral_constant<bool, IsStream<Socket>::value>());
+  }
+
+  /// Number of bytes received but not decoded yet
+  std::size_t pending_bytes() const { return end_ - begin_; }
+
+ private:
+  /// Stream socket: decode from the receive buffer
+  template <class Handler>
+  void AsyncReadDatagrams(Endpoint* p_source, Handler handler,
+                          std::true_type) {
+    datagrams_.clear();
+
+    if (buffer_.empty()) {
+      buffer_.resize(receive_buffer_size);
+    }
+
+    if (p_source) {
+      boost::system::error_code endpoint_ec;
+      *p_source = socket_.remote_endpoint(endpoint_ec);
+    }
+
+    // Serve the datagrams left by the previous read first
+    boost::system::error_code ec;
+    DecodeDatagrams(ec);
+    if (ec || !datagrams_.empty()) {
+      auto& datagrams = datagrams_;
+      socket_.get_io_service().post([handler, ec, &datagrams]() mutable {
+        handler(ec, datagrams);
+      });
+      return;
+    }
+
+    AsyncReadSome(std::move(handler));
+  }
+
+  /// Datagram socket: one datagram per batch
+  template <class Handler>
+  void AsyncReadDatagrams(Endpoint* p_source, Handler handler,
+                          std::false_type) {
+    datagrams_.clear();
+    datagrams_.emplace_back();
+
+    auto& datagrams = datagrams_;
+    auto received = [handler, &datagrams](const boost::system::error_code& ec,
+                                          std::size_t length) mutable {
+      if (ec) {
+        datagrams.clear();
+      }
+      handler(ec, datagrams);
+    };
+
+    if (p_source) {
+      AsyncReceiveDatagram(socket_, &datagrams_.back(), *p_source,
+                           std::move(received));
+    } else {
+      AsyncReceiveDatagram(socket_, &datagrams_.back(), std::move(received));
+    }
+  }
+
+  template <class Handler>
+  void AsyncReadSome(Handler handler) {
+    Compact();
+
+    socket_.async_read_some(
+        boost::asio::buffer(&buffer_[end_], buffer_.size() - end_),
+        [this, handler](const boost::system::error_code& read_ec,
+                        std::size_t length) mutable {
+          if (read_ec) {
+            handler(read_ec, datagrams_);
+            return;
+          }
+
+          end_ += length;
+
+          boost::system::error_code ec;
+          DecodeDatagrams(ec);
+
+          if (!ec && datagrams_.empty()) {
+            // Not even one complete datagram, keep reading
+            AsyncReadSome(std::move(handler));
+            return;
+          }
+
+          handler(ec, datagrams_);
+        });
+  }
+
+  /// Decode the complete datagrams held in the receive buffer
+  void DecodeDatagrams(boost::system::error_code& ec) {
+    while (datagrams_.size() < max_batch_size) {
+      auto available = end_ - begin_;
+      if (available < Header::size) {
+        return;
+      }
+
+      Header header;
+      boost::asio::buffer_copy(
+          header.GetMutableBuffers(),
+          boost::asio::buffer(&buffer_[begin_], Header::size));
+      header.Decode();
+
+      auto payload_size = static_cast<std::size_t>(header.payload_length());
+      if (payload_size > Payload::max_size) {
+        if (datagrams_.empty()) {
+          ec.assign(ssf::error::message_size, ssf::error::get_ssf_category());
+        }
+        return;
+      }
+
+      auto datagram_size = Header::size + payload_size + Footer::size;
+      if (available < datagram_size) {
+        return;
+      }
+
+      datagrams_.emplace_back();
+      auto& datagram = datagrams_.back();
+      datagram.header() = header;
+      datagram.payload().SetSize(payload_size);
+
+      auto p_data = &buffer_[begin_ + Header::size];
+      boost::asio::buffer_copy(datagram.payload().GetMutableBuffers(),
+                               boost::asio::buffer(p_data, payload_size));
+      boost::asio::buffer_copy(
+          datagram.footer().GetMutableBuffers(),
+          boost::asio::buffer(p_data + payload_size, Footer::size));
+
+      begin_ += datagram_size;
+    }
+  }
+
+  /// Move the incomplete datagram to the front if the free space is too small
+  void Compact() {
+    if (begin_ == end_) {
+      begin_ = 0;
+      end_ = 0;
+      return;
+    }
+
+    if (buffer_.size() - end_ >= read_chunk_size) {
+      return;
+    }
+
+    std::memmove(&buffer_[0], &buffer_[begin_], end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+  }
+
+ private:
+  Socket& socket_;
+  std::vector<uint8_t> buffer_;
+  std::size_t begin_;
+  std::size_t end_;
+  Datagrams datagrams_;
+};
+
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_FRAMED_DATAGRAM_READER_H_
@@ -4,6 +4,7 @@
 #include <cstdint>
 
 #include <memory>
+#include <queue>
 #include <vector>
 
 #include <boost/asio/detail/op_queue.hpp>
@@ -19,6 +20,7 @@
 #include "ssf/io/read_op.h"
 #include "ssf/io/write_op.h"
 
+#include "ssf/layer/framed_datagram_reader.h"
 #include "ssf/layer/protocol_attributes.h"
 
 namespace ssf {
@@ -37,6 +39,9 @@ class specific_interface_socket
   using endpoint_type = typename protocol_type::endpoint;
 
   using receive_datagram_type = typename protocol_type::ReceiveDatagram;
+  using framed_reader_type =
+      basic_FramedDatagramReader<internal_socket_type, receive_datagram_type>;
+  using receive_datagrams_type = typename framed_reader_type::Datagrams;
   using receive_op_queue_type = boost::asio::detail::op_queue<
       io::basic_pending_read_operation<protocol_type>>;
 
@@ -160,7 +165,8 @@ class specific_interface_socket
         closed_(false),
         receive_mutex_(),
         receive_pending_(false),
-        internal_receive_datagram_(),
+        framed_reader_(*p_internal_socket_),
+        received_datagrams_(),
         receive_op_queue_(),
         send_mutex_(),
         send_pending_(false),
@@ -170,7 +176,7 @@ class specific_interface_socket
         send_op_queue_() {}
 
   void handle_received(const boost::system::error_code& ec,
-                       std::size_t length) {
+                       receive_datagrams_type& datagrams) {
     if (ec) {
       //  Close socket if any error happened on reading
       boost::system::error_code close_ec;
@@ -180,23 +186,8 @@ class specific_interface_socket
 
     {
       boost::recursive_mutex::scoped_lock lock(receive_mutex_);
-
-      if (!receive_op_queue_.empty()) {
-        auto op = std::move(receive_op_queue_.front());
-        receive_op_queue_.pop();
-
-        boost::system::error_code fill_ec;
-        auto copied = op->fill_buffer(internal_receive_datagram_, fill_ec);
-
-        if (fill_ec) {
-          auto do_complete =
-              [op, fill_ec, copied]() { op->complete(fill_ec, copied); };
-          p_internal_socket_->get_io_service().post(std::move(do_complete));
-        } else {
-          // check copied == length - receive_datagram_type::size ??
-          auto do_complete = [op, ec, copied]() { op->complete(ec, copied); };
-          p_internal_socket_->get_io_service().post(std::move(do_complete));
-        }
+      for (auto& datagram : datagrams) {
+        received_datagrams_.push(std::move(datagram));
       }
     }
 
@@ -209,6 +200,23 @@ class specific_interface_socket
     }
   }
 
+  /// Complete pending receive operations with the received datagrams
+  void complete_receive_ops() {
+    while (!receive_op_queue_.empty() && !received_datagrams_.empty()) {
+      auto op = std::move(receive_op_queue_.front());
+      receive_op_queue_.pop();
+
+      boost::system::error_code fill_ec;
+      auto copied = op->fill_buffer(received_datagrams_.front(), fill_ec);
+      received_datagrams_.pop();
+
+      auto do_complete = [op, fill_ec, copied]() {
+        op->complete(fill_ec, copied);
+      };
+      p_internal_socket_->get_io_service().post(std::move(do_complete));
+    }
+  }
+
   void handle_sent(const boost::system::error_code& ec, std::size_t length) {
     if (ec) {
       //  Close socket if any error happened on sending
@@ -251,6 +259,8 @@ class specific_interface_socket
     {
       boost::recursive_mutex::scoped_lock lock(receive_mutex_);
 
+      complete_receive_ops();
+
       if (receive_op_queue_.empty()) {
         receive_pending_ = false;
         return;
@@ -260,10 +270,10 @@ class specific_interface_socket
     }
 
     auto self = this->shared_from_this();
-    AsyncReceiveDatagram(
-        *p_internal_socket_, &internal_receive_datagram_,
-        [self, this](const boost::system::error_code& ec, std::size_t length) {
-          this->handle_received(ec, length);
+    framed_reader_.AsyncReadDatagrams(
+        [self, this](const boost::system::error_code& ec,
+                     receive_datagrams_type& datagrams) {
+          this->handle_received(ec, datagrams);
         });
   }
 
@@ -325,7 +335,8 @@ class specific_interface_socket
 
   boost::recursive_mutex receive_mutex_;
   bool receive_pending_;
-  receive_datagram_type internal_receive_datagram_;
+  framed_reader_type framed_reader_;
+  std::queue<receive_datagram_type> received_datagrams_;
   receive_op_queue_type receive_op_queue_;
 
   boost::recursive_mutex send_mutex_;
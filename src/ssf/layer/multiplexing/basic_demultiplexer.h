@@ -4,15 +4,32 @@
 #include <atomic>
 #include <map>
 #include <memory>
+#include <vector>
 
+#include <boost/bind.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 
 #include "ssf/error/error.h"
+#include "ssf/io/read_op.h"
+
+#include "ssf/layer/framed_datagram_reader.h"
+
+#include "ssf/layer/congestion/drop_counter.h"
+
+#include "ssf/layer/multiplexing/dispatch_table.h"
 
 namespace ssf {
 namespace layer {
 namespace multiplexing {
 
+/// Dispatch the datagrams received on a next layer socket to the socket
+/// contexts bound on their (local, remote) ids
+///   Datagrams are read in batches by a framed reader (one read for many
+///   datagrams on stream next layers) and dispatched through an immutable
+///   snapshot of the bindings
+///   loaded atomically: one hash table on the full id and one small table
+///   for the contexts bound on any remote id. Bind and Unbind rebuild and
+///   publish the snapshot under the mutex
 template <class Protocol, class CongestionPolicy>
 class basic_Demultiplexer : public std::enable_shared_from_this<
           basic_Demultiplexer<Protocol, CongestionPolicy> >
@@ -24,11 +41,12 @@ class basic_Demultiplexer : public std::enable_shared_from_this<
   typedef std::shared_ptr<SocketContext> SocketContextPtr;
   typedef typename Protocol::endpoint_context_type EndpointContext;
   typedef typename Protocol::next_layer_protocol::endpoint NextEndpoint;
-  typedef std::shared_ptr<NextEndpoint> NextEndpointPtr;
   typedef typename Protocol::ReceiveDatagram ReceiveDatagram;
-  typedef std::shared_ptr<ReceiveDatagram> ReceiveDatagramPtr;
+  typedef basic_FramedDatagramReader<NextSocket, ReceiveDatagram> FramedReader;
+  typedef typename FramedReader::Datagrams ReceiveDatagrams;
   typedef std::shared_ptr<CongestionPolicy> CongestionPolicyPtr;
   typedef std::pair<SocketContextPtr, CongestionPolicyPtr> ContextPtrCongestionPair;
+  typedef io::basic_pending_read_operation<Protocol> ReadOp;
 
  public:
   static std::shared_ptr<basic_Demultiplexer> Create(NextSocketPtr p_socket) {
@@ -38,7 +56,7 @@ class basic_Demultiplexer : public std::enable_shared_from_this<
 
   void Start() {
     reading_ = true;
-    AsyncReadHeader();
+    AsyncReadDatagrams();
   }
 
   void Stop() { reading_ = false; }
@@ -53,6 +71,10 @@ class basic_Demultiplexer : public std::enable_shared_from_this<
         ContextPtrCongestionPair(p_socket_context,
                                  std::make_shared<CongestionPolicy>()));
 
+    if (socket_context_inserted.second) {
+      Publish(BuildSnapshot());
+    }
+
     return socket_context_inserted.second;
   }
 
@@ -67,143 +89,149 @@ class basic_Demultiplexer : public std::enable_shared_from_this<
       multiplexed_maps_.erase(p_socket_context->local_id);
     }
 
+    Publish(BuildSnapshot());
+
     return true;
   }
 
   bool IsBound(SocketContextPtr p_socket_context) {
-    boost::recursive_mutex::scoped_lock lock(mutex_);
-
-    auto local_multiplexed_map_it =
-          multiplexed_maps_.find(p_socket_context->local_id);
+    auto p_snapshot = LoadSnapshot();
+    auto p_pair = p_snapshot->Find(p_socket_context->local_id,
+                                   p_socket_context->remote_id);
 
-    if (local_multiplexed_map_it == std::end(multiplexed_maps_)) {
-      return false;
-    }
-
-    auto& local_multiplexed_map = local_multiplexed_map_it->second;
-    auto p_context_it =
-        local_multiplexed_map.find(p_socket_context->remote_id);
-
-    return (p_context_it != std::end(local_multiplexed_map)) &&
-           (p_socket_context == p_context_it->second.first);
+    return p_pair && (p_socket_context == p_pair->first);
   }
 
   void Read(SocketContextPtr p_socket_context) {
     HandleQueues(p_socket_context);
   }
 
+  /// Datagrams dropped by the congestion policy of the receive ring of
+  /// p_socket_context while bound
+  congestion::DropStats GetDropStats(SocketContextPtr p_socket_context) const {
+    congestion::DropStats stats;
+    auto p_snapshot = LoadSnapshot();
+    auto p_pair = p_snapshot->Find(p_socket_context->local_id,
+                                   p_socket_context->remote_id);
+
+    if (p_pair && (p_socket_context == p_pair->first)) {
+      stats.Add(*p_pair->second);
+    }
+
+    return stats;
+  }
+
  private:
   basic_Demultiplexer(NextSocketPtr p_socket)
       : p_socket_(p_socket),
+        reader_(*p_socket_),
+        next_endpoint_(),
         multiplexed_maps_(),
         mutex_(),
+        p_snapshot_(std::make_shared<Snapshot>()),
         reading_(false) {}
 
-  /// Async read receive_datagram_type
-  void AsyncReadHeader(NextEndpointPtr p_next_endpoint = nullptr,
-                       ReceiveDatagramPtr p_datagram = nullptr) {
+  /// Async read a batch of datagrams
+  void AsyncReadDatagrams() {
     if (!reading_) {
       return;
     }
 
-    if (!p_next_endpoint) {
-      p_next_endpoint = std::make_shared<NextEndpoint>();
-    }
-
-    if (!p_datagram) {
-      p_datagram = std::make_shared<ReceiveDatagram>();
-    }
-
-    p_datagram->payload().ResetSize();
-
-    AsyncReceiveDatagram(*p_socket_, p_datagram.get(), *p_next_endpoint,
-                         boost::bind(&basic_Demultiplexer::DispatchDatagram,
-                                     this->shared_from_this(), p_next_endpoint,
-                                     p_datagram, _1, _2));
+    reader_.AsyncReadDatagrams(
+        &next_endpoint_,
+        boost::bind(&basic_Demultiplexer::DispatchDatagrams,
+                    this->shared_from_this(), _1, _2));
   }
 
-  /// Dispatch the datagram through its corresponding queue
-  void DispatchDatagram(NextEndpointPtr p_next_endpoint,
-                        ReceiveDatagramPtr p_datagram,
-                        const boost::system::error_code& ec,
-                        std::size_t length) {
-    if (ec) {
-      boost::system::error_code close_ec;
-      p_socket_->close(close_ec);
-      return;
-    }
+  /// Dispatch the datagrams of the batch through their corresponding queue
+  void DispatchDatagrams(const boost::system::error_code& ec,
+                         ReceiveDatagrams& datagrams) {
+    auto p_snapshot = LoadSnapshot();
+
+    for (auto& datagram : datagrams) {
+      auto& header = datagram.header();
+      // Second half header represents the local id, first half the remote id
+      auto p_pair = p_snapshot->Find(header.id().GetSecondHalfId(),
+                                     header.id().GetFirstHalfId());
+
+      // Deliver the datagram to a waiting read or enqueue it in the socket
+      // context ring. If no context, drop it
+      if (!p_pair || Deliver(p_pair->first, &datagram, next_endpoint_)) {
+        continue;
+      }
 
-    {
-      boost::recursive_mutex::scoped_lock lock(mutex_);
+      auto& p_context = p_pair->first;
+      auto& p_congestion_policy = p_pair->second;
 
-      auto& header = p_datagram->header();
-      // Second half header represents the local id
-      auto local_id = header.id().GetSecondHalfId();
+      {
+        boost::recursive_mutex::scoped_lock lock(p_context->mutex);
 
-      auto local_multiplexed_it = multiplexed_maps_.find(local_id);
+        auto& receive_ring = p_context->receive_ring;
 
-      if (local_multiplexed_it == std::end(multiplexed_maps_)) {
-        return;
+        // Drop packet if not addable
+        if (p_congestion_policy->IsAddable(receive_ring,
+                                           datagram.payload())) {
+          auto next_endpoint = next_endpoint_;
+          auto bytes = datagram.payload().GetSize();
+          receive_ring.push(datagram, next_endpoint, bytes);
+        }
       }
 
-      // The local id is multiplexed
-      auto& local_multiplexed_map = local_multiplexed_it->second;
+      HandleQueues(p_context);
+    }
 
-      SocketContextPtr p_context = nullptr;
-      CongestionPolicyPtr p_congestion_policy = nullptr;
+    if (ec) {
+      boost::system::error_code close_ec;
+      p_socket_->close(close_ec);
+      return;
+    }
 
-      // First half represents the remote id
-      auto remote_id = header.id().GetFirstHalfId();
+    // Continue reading datagrams
+    AsyncReadDatagrams();
+  }
 
-      auto p_context_it = local_multiplexed_map.find(remote_id);
+  /// Fill the first waiting read of p_context with the datagram, nothing
+  /// being queued before it
+  ///   The read is completed from the receive handler, without going
+  ///   through the io_service queue. Return false if the datagram must be
+  ///   queued
+  bool Deliver(const SocketContextPtr& p_context, ReceiveDatagram* p_datagram,
+               const NextEndpoint& next_endpoint) {
+    ReadOp* p_read_op = nullptr;
+    boost::system::error_code ec;
+    std::size_t copied = 0;
 
-      if (p_context_it != std::end(local_multiplexed_map)) {
-        // There is a socket which is bound on this particular id
-        p_context = p_context_it->second.first;
-        p_congestion_policy = p_context_it->second.second;
-      } else {
-        // There is a socket which is bound on any remote id
-        auto p_bound_context_it =
-          local_multiplexed_map.find(EndpointContext());
+    {
+      boost::recursive_mutex::scoped_lock lock(p_context->mutex);
+      auto& read_op_queue = p_context->read_op_queue;
 
-        if (p_bound_context_it != std::end(local_multiplexed_map)) {
-          p_context = p_bound_context_it->second.first;
-          p_congestion_policy = p_bound_context_it->second.second;
-        }
+      if (read_op_queue.empty() || !p_context->receive_ring.empty()) {
+        return false;
       }
 
-      // Enqueue the datagram in the socket context queue. If none, drop it
-      if (p_context) {
-
-        {
-          boost::recursive_mutex::scoped_lock lock(p_context->mutex);
+      p_read_op = read_op_queue.front();
+      read_op_queue.pop();
 
-          auto& datagram_queue = p_context->datagram_queue;
-          auto& payload = p_datagram->payload();
-
-          // Drop packet if not addable
-          if (p_congestion_policy->IsAddable(datagram_queue, payload)) {
-            datagram_queue.push(std::move(*p_datagram));
-            auto& next_endpoint_queue = p_context->next_endpoint_queue;
-            next_endpoint_queue.push(std::move(*p_next_endpoint));
-          }
-        }
+      copied = p_read_op->fill_buffer(*p_datagram, ec);
 
-        HandleQueues(p_context);
+      if (!ec) {
+        p_read_op->set_p_endpoint(typename Protocol::endpoint(
+            Protocol::id_type::MakeHalfRemoteID(p_datagram->header().id()),
+            next_endpoint));
       }
     }
 
-    // Continue reading datagram
-    AsyncReadHeader(std::move(p_next_endpoint),
-                    std::move(p_datagram));
+    // A datagram larger than the read buffer stays for the next read
+    p_read_op->complete(ec, copied);
+
+    return !ec;
   }
 
   void HandleQueues(SocketContextPtr p_context,
       const boost::system::error_code& ec = boost::system::error_code()) {
     boost::recursive_mutex::scoped_lock lock(p_context->mutex);
     auto& read_op_queue = p_context->read_op_queue;
-    auto& datagram_queue = p_context->datagram_queue;
-    auto& next_endpoint_queue = p_context->next_endpoint_queue;
+    auto& receive_ring = p_context->receive_ring;
 
     if (ec) {
       while (!read_op_queue.empty()) {
@@ -217,37 +245,30 @@ class basic_Demultiplexer : public std::enable_shared_from_this<
       return;
     }
 
-    if (datagram_queue.empty() || read_op_queue.empty()) {
+    if (receive_ring.empty() || read_op_queue.empty()) {
       return;
     }
 
-    auto read_op = std::move(read_op_queue.front());
+    auto read_op = read_op_queue.front();
     read_op_queue.pop();
 
-    auto copied = read_op->fill_buffer(datagram_queue.front());
+    auto& slot = receive_ring.front();
+    boost::system::error_code fill_ec;
+    auto copied = read_op->fill_buffer(*slot.datagram, fill_ec);
 
-    if (copied == std::numeric_limits<size_t>::max()) {
-      auto do_complete = [read_op]() {
-        read_op->complete(
-            boost::system::error_code(ssf::error::message_size,
-                                      ssf::error::get_ssf_category()),
-            0);
+    if (fill_ec) {
+      auto do_complete = [read_op, fill_ec]() {
+        read_op->complete(fill_ec, 0);
       };
 
       p_socket_->get_io_service().post(std::move(do_complete));
       return;
     }
 
-    auto datagram = std::move(datagram_queue.front());
-    datagram_queue.pop();
-    auto& id = datagram.header().id();
-    auto half_id = Protocol::id_type::MakeHalfRemoteID(id);
-
-    auto src_next_endpoint = std::move(next_endpoint_queue.front());
-    next_endpoint_queue.pop();
-
-    read_op->set_p_endpoint(
-        Protocol::endpoint(std::move(half_id), std::move(src_next_endpoint)));
+    read_op->set_p_endpoint(typename Protocol::endpoint(
+        Protocol::id_type::MakeHalfRemoteID(slot.datagram->header().id()),
+        std::move(slot.next_endpoint)));
+    receive_ring.pop();
 
     auto do_complete = [read_op, ec, copied]() {
       read_op->complete(ec, copied);
@@ -263,11 +284,68 @@ class basic_Demultiplexer : public std::enable_shared_from_this<
      LocalMultiplexedMaps;
   typedef std::map<LocalEndpointContext, LocalMultiplexedMaps>
      MultiplexedMaps;
+  typedef DispatchTable<ContextPtrCongestionPair> Table;
+
+  /// Contexts bound on a remote id, keyed on (local, remote), and contexts
+  /// bound on any remote id, keyed on local
+  struct Snapshot {
+    Snapshot() : contexts(), wildcards() {}
+    Snapshot(Table contexts_table, Table wildcards_table)
+        : contexts(std::move(contexts_table)),
+          wildcards(std::move(wildcards_table)) {}
+
+    const ContextPtrCongestionPair* Find(
+        const LocalEndpointContext& local_id,
+        const RemoteEndpointContext& remote_id) const {
+      auto p_pair = contexts.Find(PackDispatchKey(local_id, remote_id));
+      if (p_pair) {
+        return p_pair;
+      }
+
+      return wildcards.Find(PackHalfID(local_id));
+    }
+
+    Table contexts;
+    Table wildcards;
+  };
+  typedef std::shared_ptr<const Snapshot> SnapshotPtr;
+
+ private:
+  SnapshotPtr BuildSnapshot() const {
+    std::vector<typename Table::Item> contexts;
+    std::vector<typename Table::Item> wildcards;
+
+    for (const auto& local_multiplexed_map : multiplexed_maps_) {
+      const auto& local_id = local_multiplexed_map.first;
+      for (const auto& context : local_multiplexed_map.second) {
+        if (context.first == EndpointContext()) {
+          wildcards.emplace_back(PackHalfID(local_id), context.second);
+        } else {
+          contexts.emplace_back(PackDispatchKey(local_id, context.first),
+                                context.second);
+        }
+      }
+    }
+
+    return std::make_shared<Snapshot>(Table(std::move(contexts)),
+                                      Table(std::move(wildcards)));
+  }
+
+  SnapshotPtr LoadSnapshot() const { return std::atomic_load(&p_snapshot_); }
+
+  void Publish(SnapshotPtr p_snapshot) {
+    std::atomic_store(&p_snapshot_, std::move(p_snapshot));
+  }
 
  private:
   NextSocketPtr p_socket_;
+  FramedReader reader_;
+  /// Next layer endpoint of the datagrams being read
+  NextEndpoint next_endpoint_;
+  /// Bindings, modified under mutex_
   MultiplexedMaps multiplexed_maps_;
   boost::recursive_mutex mutex_;
+  SnapshotPtr p_snapshot_;
   std::atomic<bool> reading_;
 };
 
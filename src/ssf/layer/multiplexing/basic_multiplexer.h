@@ -3,11 +3,12 @@
 
 #include <cstdint>
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 #include <atomic>
 #include <vector>
-#include <queue>
+#include <type_traits>
 
 #include <boost/thread/recursive_mutex.hpp>
 #include <boost/bind.hpp>
@@ -19,21 +20,44 @@
 #include "ssf/layer/io_handler.h"
 #include "ssf/layer/protocol_attributes.h"
 
+#include "ssf/layer/congestion/drop_counter.h"
+
 namespace ssf {
 namespace layer {
 namespace multiplexing {
 
+/// Send datagrams of multiplexed sockets through one next layer socket
+///   Queued datagrams are served in the order of the SchedulerPolicy, flows
+///   being identified by the datagram header id
 template <class SocketPtr, class Datagram, class Endpoint,
-          class CongestionPolicy>
+          class CongestionPolicy, class SchedulerPolicy>
 class basic_Multiplexer
     : public std::enable_shared_from_this<
-          basic_Multiplexer<SocketPtr, Datagram, Endpoint, CongestionPolicy>> {
+          basic_Multiplexer<SocketPtr, Datagram, Endpoint, CongestionPolicy,
+                            SchedulerPolicy>> {
  private:
   typedef ssf::layer::BaseIOHandler BaseIOHandler;
   typedef ssf::layer::BaseIOHandlerPtr BaseIOHandlerPtr;
-  typedef std::pair<std::pair<Endpoint, Datagram>, BaseIOHandlerPtr>
-      QueueElement;
-  typedef std::queue<QueueElement> Queue;
+
+  struct QueueElement {
+    QueueElement(Endpoint d, Datagram dgr, BaseIOHandlerPtr p_h)
+        : destination(std::move(d)),
+          datagram(std::move(dgr)),
+          p_handler(std::move(p_h)) {}
+
+    Endpoint destination;
+    Datagram datagram;
+    BaseIOHandlerPtr p_handler;
+  };
+
+  typedef typename SchedulerPolicy::template Queue<
+      QueueElement, typename Datagram::Header::ID> Queue;
+  typedef typename SocketPtr::element_type Socket;
+  typedef std::integral_constant<bool, IsStream<Socket>::value> IsStreamSocket;
+
+ public:
+  /// Limits of a gathered write on a stream next layer
+  enum { max_batch_datagrams = 64, max_batch_bytes = 64 * 1024 };
 
  public:
   static std::shared_ptr<basic_Multiplexer> Create(SocketPtr p_socket) {
@@ -59,8 +83,8 @@ class basic_Multiplexer
       return false;
     }
 
-    pending_datagrams_.emplace(std::make_pair(
-        std::make_pair(destination, std::move(datagram)),
+    pending_datagrams_.push(QueueElement(
+        destination, std::move(datagram),
         std::make_shared<IOHandler<Handler>>(std::move(handler))));
 
     if (!popping_) {
@@ -72,6 +96,13 @@ class basic_Multiplexer
 
   void Stop() { ready_ = false; }
 
+  /// Datagrams dropped by the congestion policy of the send queue
+  congestion::DropStats GetDropStats() const {
+    congestion::DropStats stats;
+    stats.Add(congestion_policy_);
+    return stats;
+  }
+
  private:
   basic_Multiplexer(SocketPtr p_socket)
       : ready_(true),
@@ -79,9 +110,14 @@ class basic_Multiplexer
         p_socket_(std::move(p_socket)),
         mutex_(),
         pending_datagrams_(),
+        batch_(),
+        batch_buffers_(),
         congestion_policy_() {}
 
-  /// Get the first element of the datagram queue and async send it
+  /// Async send the datagrams at the front of the queue
+  ///   On a stream next layer, up to max_batch_datagrams datagrams (or
+  ///   max_batch_bytes bytes, the first datagram is always sent) are gathered
+  ///   in one write. A datagram next layer sends one datagram at a time
   void StartPopping() {
     boost::recursive_mutex::scoped_lock lock(mutex_);
 
@@ -91,23 +127,63 @@ class basic_Multiplexer
     }
 
     popping_ = true;
-    auto& datagram = pending_datagrams_.front();
 
-    AsyncSendDatagram(
-        *p_socket_, datagram.first.second, datagram.first.first,
-        boost::bind(&basic_Multiplexer::DatagramSent, this->shared_from_this(), _1, _2));
+    std::size_t max_datagrams = IsStreamSocket::value ? max_batch_datagrams : 1;
+    std::size_t batch_bytes = 0;
+
+    while (!pending_datagrams_.empty() && batch_.size() < max_datagrams) {
+      auto& element = pending_datagrams_.front();
+      auto size = boost::asio::buffer_size(element.datagram.GetConstBuffers());
+      if (!batch_.empty() && batch_bytes + size > max_batch_bytes) {
+        break;
+      }
+
+      batch_.push_back(std::move(element));
+      pending_datagrams_.pop();
+      batch_bytes += size;
+    }
+
+    SendBatch(IsStreamSocket());
+  }
+
+  void SendBatch(std::false_type) {
+    auto& element = batch_.front();
+
+    AsyncSendDatagram(*p_socket_, element.datagram, element.destination,
+                      boost::bind(&basic_Multiplexer::DatagramsSent,
+                                  this->shared_from_this(), _1, _2));
   }
 
-  /// Pop an element from the datagram queue
-  void DatagramSent(const boost::system::error_code& ec, std::size_t length) {
+  void SendBatch(std::true_type) {
+    for (const auto& element : batch_) {
+      element.datagram.GetConstBuffers(&batch_buffers_);
+    }
+
+    boost::asio::async_write(*p_socket_, batch_buffers_,
+                             boost::bind(&basic_Multiplexer::DatagramsSent,
+                                         this->shared_from_this(), _1, _2));
+  }
+
+  /// Notify the handlers of the sent datagrams
+  ///   On error, the datagrams not entirely written get the error
+  void DatagramsSent(const boost::system::error_code& ec, std::size_t length) {
     {
       boost::recursive_mutex::scoped_lock lock(mutex_);
-      auto datagram = std::move(pending_datagrams_.front());
-      pending_datagrams_.pop();
-      auto p_handler = std::move(datagram.second);
-      p_socket_->get_io_service().post([p_handler, ec, length]() {
-        (*p_handler)(ec, length);
-      });
+      for (auto& element : batch_) {
+        auto size =
+            boost::asio::buffer_size(element.datagram.GetConstBuffers());
+        auto sent = std::min(size, length);
+        length -= sent;
+
+        auto datagram_ec =
+            (sent == size) ? boost::system::error_code() : ec;
+        auto p_handler = std::move(element.p_handler);
+        p_socket_->get_io_service().post([p_handler, datagram_ec, sent]() {
+          (*p_handler)(datagram_ec, sent);
+        });
+      }
+      batch_.clear();
+      batch_buffers_.clear();
     }
 
     if (!ec) {
@@ -124,13 +200,17 @@ class basic_Multiplexer
   SocketPtr p_socket_;
   boost::recursive_mutex mutex_;
   Queue pending_datagrams_;
+  /// Datagrams being sent
+  std::vector<QueueElement> batch_;
+  std::vector<boost::asio::const_buffer> batch_buffers_;
   CongestionPolicy congestion_policy_;
 };
 
 template <class SocketPtr, class Datagram, class Endpoint,
-          class CongestionPolicy>
-using basic_MultiplexerPtr = std::shared_ptr<
-    basic_Multiplexer<SocketPtr, Datagram, Endpoint, CongestionPolicy>>;
+          class CongestionPolicy, class SchedulerPolicy>
+using basic_MultiplexerPtr =
+    std::shared_ptr<basic_Multiplexer<SocketPtr, Datagram, Endpoint,
+                                      CongestionPolicy, SchedulerPolicy>>;
 
 }  // multiplexing
 }  // layer
@@ -21,12 +21,15 @@
 #include "ssf/layer/protocol_attributes.h"
 #include "ssf/layer/parameters.h"
 
+#include "ssf/layer/congestion/fifo_scheduler.h"
+
 #include "ssf/layer/datagram/basic_datagram.h"
 #include "ssf/layer/datagram/basic_header.h"
 #include "ssf/layer/datagram/basic_payload.h"
 #include "ssf/layer/datagram/empty_component.h"
 
 #include "ssf/layer/multiplexing/basic_multiplexer_socket_service.h"
+#include "ssf/layer/multiplexing/receive_ring.h"
 
 #include "ssf/utils/map_helpers.h"
 
@@ -34,7 +37,8 @@ namespace ssf {
 namespace layer {
 namespace multiplexing {
 
-template <class NextLayer, class MultiplexID, class CongestionPolicy>
+template <class NextLayer, class MultiplexID, class CongestionPolicy,
+          class SchedulerPolicy = congestion::FifoScheduler>
 class basic_MultiplexedProtocol {
  private:
   typedef typename NextLayer::socket next_socket_type;
@@ -65,6 +69,7 @@ class basic_MultiplexedProtocol {
   using next_endpoint_type = typename next_layer_protocol::endpoint;
 
   typedef CongestionPolicy congestion_policy_type;
+  typedef SchedulerPolicy scheduler_policy_type;
 
   typedef basic_VirtualLink_endpoint<basic_MultiplexedProtocol> endpoint;
   typedef basic_VirtualLink_resolver<basic_MultiplexedProtocol> resolver;
@@ -78,9 +83,8 @@ class basic_MultiplexedProtocol {
     endpoint_context_type local_id;
     endpoint_context_type remote_id;
 
-    std::queue<ReceiveDatagram> datagram_queue;
-
-    std::queue<typename next_layer_protocol::endpoint> next_endpoint_queue;
+    /// Datagrams waiting for a read, with their source next layer endpoint
+    ReceiveRing<ReceiveDatagram, next_endpoint_type> receive_ring;
 
     boost::asio::detail::op_queue<io::basic_pending_read_operation<
         basic_MultiplexedProtocol>> read_op_queue;
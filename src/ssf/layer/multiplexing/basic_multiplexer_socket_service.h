@@ -63,6 +63,7 @@ class basic_MultiplexedSocket_service
   typedef typename protocol_type::socket_context socket_context_type;
   typedef std::shared_ptr<socket_context_type> p_socket_context_type;
   typedef typename protocol_type::congestion_policy_type congestion_policy_type;
+  typedef typename protocol_type::scheduler_policy_type scheduler_policy_type;
 
  public:
   explicit basic_MultiplexedSocket_service(boost::asio::io_service& io_service)
@@ -127,6 +128,10 @@ class basic_MultiplexedSocket_service
 
   boost::system::error_code close(implementation_type& impl,
                                   boost::system::error_code& ec) {
+    if (impl.p_socket_context) {
+      AbortReads(impl.p_socket_context);
+    }
+
     {
       boost::recursive_mutex::scoped_lock lock(mutex_);
       
@@ -167,6 +172,21 @@ class basic_MultiplexedSocket_service
 
   native_handle_type native_handle(implementation_type& impl) { return impl; }
 
+  /// Complete the waiting reads with operation_aborted
+  boost::system::error_code cancel(implementation_type& impl,
+                                   boost::system::error_code& ec) {
+    if (!impl.p_socket_context) {
+      ec.assign(ssf::error::bad_file_descriptor,
+                ssf::error::get_ssf_category());
+      return ec;
+    }
+
+    AbortReads(impl.p_socket_context);
+    ec.assign(ssf::error::success, ssf::error::get_ssf_category());
+
+    return ec;
+  }
+
   bool at_mark(const implementation_type& impl,
                boost::system::error_code& ec) const {
     if (!impl.p_next_layer_socket) {
@@ -187,11 +207,13 @@ class basic_MultiplexedSocket_service
 
     boost::recursive_mutex::scoped_lock lock(impl.p_socket_context->mutex);
     ec.assign(ssf::error::success, ssf::error::get_ssf_category());
-    if (impl.p_socket_context->datagram_queue.empty()) {
+    if (impl.p_socket_context->receive_ring.empty()) {
       return 0;
     }
 
-    return impl.p_socket_context->datagram_queue.front().payload().GetSize();
+    return impl.p_socket_context->receive_ring.front()
+        .datagram->payload()
+        .GetSize();
   }
 
   boost::system::error_code bind(implementation_type& impl,
@@ -453,6 +475,40 @@ class basic_MultiplexedSocket_service
     {
       boost::recursive_mutex::scoped_lock lock(impl.p_socket_context->mutex);
       auto& op_queue = impl.p_socket_context->read_op_queue;
+      auto& receive_ring = impl.p_socket_context->receive_ring;
+
+      // A datagram is already there, complete without queuing the read. The
+      // posted handler carries the continuation hint of the user handler
+      if (op_queue.empty() && !receive_ring.empty()) {
+        auto& slot = receive_ring.front();
+        auto& payload = slot.datagram->payload();
+
+        if (boost::asio::buffer_size(buffers) < payload.GetSize()) {
+          this->get_io_service().post(
+              boost::asio::detail::binder2<decltype(init.handler),
+                                           boost::system::error_code,
+                                           std::size_t>(
+                  init.handler,
+                  boost::system::error_code(ssf::error::message_size,
+                                            ssf::error::get_ssf_category()),
+                  0));
+          return init.result.get();
+        }
+
+        auto copied =
+            boost::asio::buffer_copy(buffers, payload.GetConstBuffers());
+        sender_endpoint = endpoint_type(
+            id_type::MakeHalfRemoteID(slot.datagram->header().id()),
+            std::move(slot.next_endpoint));
+        receive_ring.pop();
+
+        this->get_io_service().post(
+            boost::asio::detail::binder2<decltype(init.handler),
+                                         boost::system::error_code,
+                                         std::size_t>(
+                init.handler, boost::system::error_code(), copied));
+        return init.result.get();
+      }
 
       typedef io::pending_read_operation<
           MutableBufferSequence, decltype(init.handler), protocol_type> op;
@@ -503,6 +559,23 @@ class basic_MultiplexedSocket_service
   void shutdown_service() {}
 
  private:
+  void AbortReads(const p_socket_context_type& p_socket_context) {
+    boost::recursive_mutex::scoped_lock lock(p_socket_context->mutex);
+    auto& op_queue = p_socket_context->read_op_queue;
+
+    while (!op_queue.empty()) {
+      auto p_op = op_queue.front();
+      op_queue.pop();
+
+      auto do_complete = [p_op]() {
+        p_op->complete(boost::asio::error::make_error_code(
+                           boost::asio::error::operation_aborted),
+                       0);
+      };
+      this->get_io_service().post(std::move(do_complete));
+    }
+  }
+
   bool ChangeBinding(implementation_type& impl, endpoint_type remote_endpoint) {
     boost::recursive_mutex::scoped_lock lock(mutex_);
 
@@ -547,7 +620,7 @@ class basic_MultiplexedSocket_service
   static std::set<endpoint_type> local_endpoints_;
   static multiplexing::MultiplexerManager<
       p_next_socket_type, send_datagram_type, next_endpoint_type,
-      congestion_policy_type> multiplexer_manager_;
+      congestion_policy_type, scheduler_policy_type> multiplexer_manager_;
 
   static multiplexing::DemultiplexerManager<
       protocol_type, congestion_policy_type> demultiplexer_manager_;
@@ -573,7 +646,8 @@ multiplexing::MultiplexerManager<
     typename basic_MultiplexedSocket_service<Protocol>::p_next_socket_type,
     typename basic_MultiplexedSocket_service<Protocol>::send_datagram_type,
     typename basic_MultiplexedSocket_service<Protocol>::next_endpoint_type,
-    typename basic_MultiplexedSocket_service<Protocol>::congestion_policy_type>
+    typename basic_MultiplexedSocket_service<Protocol>::congestion_policy_type,
+    typename basic_MultiplexedSocket_service<Protocol>::scheduler_policy_type>
     basic_MultiplexedSocket_service<Protocol>::multiplexer_manager_;
 
 template <class Protocol>
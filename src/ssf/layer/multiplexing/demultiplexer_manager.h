@@ -5,6 +5,8 @@
 
 #include <boost/thread/recursive_mutex.hpp>
 
+#include "ssf/layer/congestion/drop_counter.h"
+
 #include "ssf/layer/multiplexing/basic_demultiplexer.h"
 
 namespace ssf {
@@ -88,6 +90,20 @@ class DemultiplexerManager {
     return demultiplexer_it->second->IsBound(p_socket_context);
   }
 
+  /// Datagrams received on p_socket and dropped for p_socket_context
+  congestion::DropStats GetDropStats(NextSocketPtr p_socket,
+                                     SocketContextPtr p_socket_context) {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    // Get the demultiplexer linked to the given socket
+    auto demultiplexer_it = demultiplexers_.find(p_socket);
+
+    if (demultiplexer_it == std::end(demultiplexers_)) {
+      return congestion::DropStats();
+    }
+
+    return demultiplexer_it->second->GetDropStats(p_socket_context);
+  }
+
   void Read(NextSocketPtr p_socket, SocketContextPtr p_socket_context) {
     boost::recursive_mutex::scoped_lock lock(mutex_);
     // Get the demultiplexer linked to the given socket
@@ -0,0 +1,121 @@
+#ifndef SSF_LAYER_MULTIPLEXING_DISPATCH_TABLE_H_
+#define SSF_LAYER_MULTIPLEXING_DISPATCH_TABLE_H_
+
+#include <cstdint>
+
+#include <utility>
+#include <vector>
+
+namespace ssf {
+namespace layer {
+namespace multiplexing {
+
+/// Pack a half id (at most 32 bits on the wire) in its network order value
+template <class HalfID>
+uint32_t PackHalfID(const HalfID& id) {
+  static_assert(HalfID::size <= sizeof(uint32_t),
+                "Half id does not fit in a dispatch key");
+
+  uint8_t wire[sizeof(uint32_t)] = {0, 0, 0, 0};
+  id.Encode(wire);
+
+  return (static_cast<uint32_t>(wire[0]) << 24) |
+         (static_cast<uint32_t>(wire[1]) << 16) |
+         (static_cast<uint32_t>(wire[2]) << 8) | static_cast<uint32_t>(wire[3]);
+}
+
+/// Dispatch key of the (local, remote) pair
+template <class HalfID>
+uint64_t PackDispatchKey(const HalfID& local_id, const HalfID& remote_id) {
+  return (static_cast<uint64_t>(PackHalfID(local_id)) << 32) |
+         PackHalfID(remote_id);
+}
+
+/// Immutable open addressing table from 64 bits keys to values
+///   Slots hold the key and the value inline : a hit reads the cache line of
+///   its slot, the table is at most half full and linear probing rarely
+///   leaves it. Empty slots hold a default constructed value.
+///   The table is rebuilt, in O(n), on each change of its keys : it suits
+///   read mostly maps such as the demultiplexer contexts
+template <class Value>
+class DispatchTable {
+ public:
+  typedef std::pair<uint64_t, Value> Item;
+
+ public:
+  DispatchTable() : shift_(64), size_(0), slots_(1) {}
+
+  /// Keys are unique
+  explicit DispatchTable(std::vector<Item> items)
+      : shift_(64), size_(items.size()), slots_() {
+    std::size_t capacity = min_capacity;
+    while (capacity < 2 * items.size()) {
+      capacity *= 2;
+      --shift_;
+    }
+    shift_ -= min_capacity_log2;
+
+    slots_.resize(capacity);
+
+    for (auto& item : items) {
+      auto mask = slots_.size() - 1;
+      auto position = Hash(item.first);
+      while (slots_[position].used) {
+        position = (position + 1) & mask;
+      }
+
+      auto& slot = slots_[position];
+      slot.key = item.first;
+      slot.used = true;
+      slot.value = std::move(item.second);
+    }
+  }
+
+  /// Value of key, nullptr if not found
+  const Value* Find(uint64_t key) const {
+    auto mask = slots_.size() - 1;
+
+    for (auto position = Hash(key);; position = (position + 1) & mask) {
+      const auto& slot = slots_[position];
+      if (!slot.used) {
+        return nullptr;
+      }
+      if (slot.key == key) {
+        return &slot.value;
+      }
+    }
+  }
+
+  std::size_t size() const { return size_; }
+
+ private:
+  enum { min_capacity_log2 = 4, min_capacity = 1 << min_capacity_log2 };
+
+  struct Slot {
+    Slot() : key(0), used(false), value() {}
+
+    uint64_t key;
+    bool used;
+    Value value;
+  };
+
+  /// Fibonacci hashing, the high bits of the product select the slot
+  std::size_t Hash(uint64_t key) const {
+    if (shift_ >= 64) {
+      return 0;
+    }
+
+    return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ULL) >> shift_);
+  }
+
+ private:
+  uint32_t shift_;
+  std::size_t size_;
+  std::vector<Slot> slots_;
+};
+
+}  // multiplexing
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_MULTIPLEXING_DISPATCH_TABLE_H_
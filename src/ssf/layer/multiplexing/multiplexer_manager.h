@@ -5,6 +5,8 @@
 
 #include <boost/thread/recursive_mutex.hpp>
 
+#include "ssf/layer/congestion/drop_counter.h"
+
 #include "ssf/layer/multiplexing/basic_multiplexer.h"
 
 namespace ssf {
@@ -12,11 +14,13 @@ namespace layer {
 namespace multiplexing {
 
 template <class SocketPtr, class Datagram, class Endpoint,
-          class CongestionPolicy>
+          class CongestionPolicy, class SchedulerPolicy>
 class MultiplexerManager {
  private:
-  typedef basic_Multiplexer<SocketPtr, Datagram, Endpoint, CongestionPolicy> Multiplexer;
-  typedef basic_MultiplexerPtr<SocketPtr, Datagram, Endpoint, CongestionPolicy> MultiplexerPtr;
+  typedef basic_Multiplexer<SocketPtr, Datagram, Endpoint, CongestionPolicy,
+                            SchedulerPolicy> Multiplexer;
+  typedef basic_MultiplexerPtr<SocketPtr, Datagram, Endpoint, CongestionPolicy,
+                               SchedulerPolicy> MultiplexerPtr;
 
  public:
   MultiplexerManager() : mutex_(), multiplexers_() {}
@@ -46,6 +50,19 @@ class MultiplexerManager {
                                       std::move(handler));
   }
 
+  /// Datagrams dropped before being sent on p_socket
+  congestion::DropStats GetDropStats(SocketPtr p_socket) {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+
+    auto multiplexer_it = multiplexers_.find(p_socket);
+
+    if (multiplexer_it == std::end(multiplexers_)) {
+      return congestion::DropStats();
+    }
+
+    return multiplexer_it->second->GetDropStats();
+  }
+
   void Stop(SocketPtr p_socket) {
     boost::recursive_mutex::scoped_lock lock(mutex_);
 
@@ -3,12 +3,15 @@
 
 #include <cstdint>
 
+#include <limits>
+#include <set>
 #include <vector>
 
-#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_service.hpp>
 
 #include "ssf/utils/map_helpers.h"
 
+#include "ssf/layer/datagram/byte_order.h"
 #include "ssf/layer/parameters.h"
 
 namespace ssf {
@@ -20,8 +23,6 @@ class PortID {
   typedef uint16_t ID;
 
  public:
-  typedef io::fixed_const_buffer_sequence ConstBuffers;
-  typedef io::fixed_mutable_buffer_sequence MutableBuffers;
   enum { size = sizeof(ID) };
 
  public:
@@ -34,21 +35,9 @@ class PortID {
   bool operator<(const PortID& rhs) const { return id_ < rhs.id_; }
   bool operator!() const { return !id_; }
 
-  ConstBuffers GetConstBuffers() const {
-    return ConstBuffers({boost::asio::buffer(&id_, sizeof(id_))});
-  }
-
-  void GetConstBuffers(ConstBuffers* p_buffers) const {
-    p_buffers->push_back(boost::asio::buffer(&id_, sizeof(id_)));
-  }
-
-  MutableBuffers GetMutableBuffers() {
-    return MutableBuffers({boost::asio::buffer(&id_, sizeof(id_))});
-  }
+  void Encode(uint8_t* p_wire) const { EncodeBigEndian(id_, p_wire); }
 
-  void GetMutableBuffers(MutableBuffers* p_buffers) {
-    p_buffers->push_back(boost::asio::buffer(&id_, sizeof(id_)));
-  }
+  void Decode(const uint8_t* p_wire) { id_ = DecodeBigEndian<ID>(p_wire); }
 
   ID& id() { return id_; }
   const ID& id() const { return id_; }
@@ -62,8 +51,6 @@ class PortPairID {
   typedef PortID ID;
 
  public:
-  typedef io::fixed_const_buffer_sequence ConstBuffers;
-  typedef io::fixed_mutable_buffer_sequence MutableBuffers;
   enum { size = 2 * ID::size };
 
  public:
@@ -82,28 +69,14 @@ class PortPairID {
            ((left_id_ == rhs.left_id_) && (right_id_ < rhs.right_id_));
   }
 
-  ConstBuffers GetConstBuffers() const {
-    ConstBuffers result;
-    left_id_.GetConstBuffers(&result);
-    right_id_.GetConstBuffers(&result);
-    return result;
-  }
-
-  void GetConstBuffers(ConstBuffers* p_buffers) const {
-    left_id_.GetConstBuffers(p_buffers);
-    right_id_.GetConstBuffers(p_buffers);
-  }
-
-  MutableBuffers GetMutableBuffers() {
-    MutableBuffers result;
-    left_id_.GetMutableBuffers(&result);
-    right_id_.GetMutableBuffers(&result);
-    return result;
+  void Encode(uint8_t* p_wire) const {
+    left_id_.Encode(p_wire);
+    right_id_.Encode(p_wire + ID::size);
   }
 
-  void GetMutableBuffers(MutableBuffers* p_buffers) {
-    left_id_.GetMutableBuffers(p_buffers);
-    right_id_.GetMutableBuffers(p_buffers);
+  void Decode(const uint8_t* p_wire) {
+    left_id_.Decode(p_wire);
+    right_id_.Decode(p_wire + ID::size);
   }
 
   ID& left_id() { return left_id_; }
@@ -8,10 +8,10 @@
 #include <vector>
 
 #include <boost/asio/io_service.hpp>
-#include <boost/asio/buffer.hpp>
 
 #include "common/utils/map_helpers.h"
 
+#include "ssf/layer/datagram/byte_order.h"
 #include "ssf/layer/parameters.h"
 
 namespace ssf {
@@ -24,8 +24,6 @@ class ProtocolAndPortID {
   typedef uint16_t PortID;
 
  public:
-  typedef io::fixed_const_buffer_sequence ConstBuffers;
-  typedef io::fixed_mutable_buffer_sequence MutableBuffers;
   enum { size = sizeof(ProtocolID) + sizeof(PortID) };
 
  public:
@@ -49,30 +47,14 @@ class ProtocolAndPortID {
 
   bool operator!() const { return !(!!protocol_id_ && !!port_id_); }
 
-  ConstBuffers GetConstBuffers() const {
-    ConstBuffers result;
-    result.push_back(boost::asio::buffer(&protocol_id_, sizeof(protocol_id_)));
-    result.push_back(boost::asio::buffer(&port_id_, sizeof(port_id_)));
-    return result;
+  void Encode(uint8_t* p_wire) const {
+    EncodeBigEndian(protocol_id_, p_wire);
+    EncodeBigEndian(port_id_, p_wire + sizeof(ProtocolID));
   }
 
-  void GetConstBuffers(ConstBuffers* p_buffers) const {
-    p_buffers->push_back(
-        boost::asio::buffer(&protocol_id_, sizeof(protocol_id_)));
-    p_buffers->push_back(boost::asio::buffer(&port_id_, sizeof(port_id_)));
-  }
-
-  MutableBuffers GetMutableBuffers() {
-    MutableBuffers result;
-    result.push_back(boost::asio::buffer(&protocol_id_, sizeof(protocol_id_)));
-    result.push_back(boost::asio::buffer(&port_id_, sizeof(port_id_)));
-    return result;
-  }
-
-  void GetMutableBuffers(MutableBuffers* p_buffers) {
-    p_buffers->push_back(
-        boost::asio::buffer(&protocol_id_, sizeof(protocol_id_)));
-    p_buffers->push_back(boost::asio::buffer(&port_id_, sizeof(port_id_)));
+  void Decode(const uint8_t* p_wire) {
+    protocol_id_ = DecodeBigEndian<ProtocolID>(p_wire);
+    port_id_ = DecodeBigEndian<PortID>(p_wire + sizeof(ProtocolID));
   }
 
   ProtocolID& protocol_id() { return protocol_id_; }
@@ -91,8 +73,6 @@ class ProtocolAndPortPairID {
   typedef ProtocolAndPortID ID;
 
  public:
-  typedef io::fixed_const_buffer_sequence ConstBuffers;
-  typedef io::fixed_mutable_buffer_sequence MutableBuffers;
   enum { size = 2 * ID::size };
 
  public:
@@ -113,28 +93,14 @@ class ProtocolAndPortPairID {
            ((left_id_ == rhs.left_id_) && (right_id_ < rhs.right_id_));
   }
 
-  ConstBuffers GetConstBuffers() const {
-    ConstBuffers result;
-    left_id_.GetConstBuffers(&result);
-    right_id_.GetConstBuffers(&result);
-    return result;
-  }
-
-  void GetConstBuffers(ConstBuffers* p_buffers) const {
-    left_id_.GetConstBuffers(p_buffers);
-    right_id_.GetConstBuffers(p_buffers);
-  }
-
-  MutableBuffers GetMutableBuffers() {
-    MutableBuffers result;
-    left_id_.GetMutableBuffers(&result);
-    right_id_.GetMutableBuffers(&result);
-    return result;
+  void Encode(uint8_t* p_wire) const {
+    left_id_.Encode(p_wire);
+    right_id_.Encode(p_wire + ID::size);
   }
 
-  void GetMutableBuffers(MutableBuffers* p_buffers) {
-    left_id_.GetMutableBuffers(p_buffers);
-    right_id_.GetMutableBuffers(p_buffers);
+  void Decode(const uint8_t* p_wire) {
+    left_id_.Decode(p_wire);
+    right_id_.Decode(p_wire + ID::size);
   }
 
   ID& left_id() { return left_id_; }
@@ -3,12 +3,14 @@
 
 #include <cstdint>
 
+#include <set>
 #include <vector>
 
-#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_service.hpp>
 
 #include "ssf/utils/map_helpers.h"
 
+#include "ssf/layer/datagram/byte_order.h"
 #include "ssf/layer/parameters.h"
 
 namespace ssf {
@@ -20,8 +22,6 @@ class ProtocolID {
   typedef uint8_t ID;
 
  public:
-  typedef io::fixed_const_buffer_sequence ConstBuffers;
-  typedef io::fixed_mutable_buffer_sequence MutableBuffers;
   enum { size = sizeof(ID) };
 
  public:
@@ -35,21 +35,9 @@ class ProtocolID {
   bool operator<(const ProtocolID& rhs) const { return id_ < rhs.id_; }
   bool operator!() const { return !id_; }
 
-  ConstBuffers GetConstBuffers() const {
-    return ConstBuffers({boost::asio::buffer(&id_, sizeof(id_))});
-  }
-
-  void GetConstBuffers(ConstBuffers* p_buffers) const {
-    p_buffers->push_back(boost::asio::buffer(&id_, sizeof(id_)));
-  }
+  void Encode(uint8_t* p_wire) const { EncodeBigEndian(id_, p_wire); }
 
-  MutableBuffers GetMutableBuffers() {
-    return MutableBuffers({boost::asio::buffer(&id_, sizeof(id_))});
-  }
-
-  void GetMutableBuffers(MutableBuffers* p_buffers) {
-    p_buffers->push_back(boost::asio::buffer(&id_, sizeof(id_)));
-  }
+  void Decode(const uint8_t* p_wire) { id_ = DecodeBigEndian<ID>(p_wire); }
 
   ID& id() { return id_; }
   const ID& id() const { return id_; }
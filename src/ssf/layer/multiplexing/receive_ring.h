@@ -0,0 +1,115 @@
+#ifndef SSF_LAYER_MULTIPLEXING_RECEIVE_RING_H_
+#define SSF_LAYER_MULTIPLEXING_RECEIVE_RING_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+namespace ssf {
+namespace layer {
+namespace multiplexing {
+
+/// Datagrams received for a socket context with their source next layer
+/// endpoint and payload size, in a ring of reusable slots
+///   Slots are allocated up front and only grow (doubling) when the ring is
+///   full, the congestion policy bounds the ring size. An empty slot holds no
+///   datagram (hence no payload buffer). Pushing into a slot keeping a spare
+///   datagram swaps it with the received one so that the receiver gets the
+///   spare buffer back for its next receive. At most max_spares free slots
+///   keep their datagram, a ring grown by a burst releases the others when
+///   it drains
+template <class Datagram, class Endpoint>
+class ReceiveRing {
+ public:
+  enum { default_capacity = 16, max_spares = default_capacity };
+
+  struct Slot {
+    Slot() : datagram(), next_endpoint(), bytes(0), spare(false) {}
+
+    /// Set while the slot is queued or keeps a spare datagram
+    boost::optional<Datagram> datagram;
+    Endpoint next_endpoint;
+    std::size_t bytes;
+    bool spare;
+  };
+
+ public:
+  ReceiveRing()
+      : slots_(default_capacity), head_(0), size_(0), bytes_(0), spares_(0) {}
+
+  bool empty() const { return !size_; }
+  std::size_t size() const { return size_; }
+
+  /// Payload bytes of the queued datagrams
+  uint64_t bytes() const { return bytes_; }
+
+  Slot& front() { return slots_[head_]; }
+  const Slot& front() const { return slots_[head_]; }
+
+  void push(Datagram& datagram, Endpoint& next_endpoint, std::size_t bytes) {
+    if (size_ == slots_.size()) {
+      Grow();
+    }
+
+    auto& slot = slots_[(head_ + size_) & (slots_.size() - 1)];
+    if (slot.spare) {
+      slot.spare = false;
+      --spares_;
+      std::swap(*slot.datagram, datagram);
+    } else {
+      slot.datagram = std::move(datagram);
+    }
+
+    std::swap(slot.next_endpoint, next_endpoint);
+    slot.bytes = bytes;
+    ++size_;
+    bytes_ += bytes;
+  }
+
+  /// Release the front slot, its datagram buffer is kept for reuse unless
+  /// max_spares slots already keep one
+  void pop() {
+    auto& slot = slots_[head_];
+    if (spares_ < max_spares) {
+      slot.spare = true;
+      ++spares_;
+    } else {
+      slot.datagram = boost::none;
+      slot.next_endpoint = Endpoint();
+    }
+
+    bytes_ -= slot.bytes;
+    head_ = (head_ + 1) & (slots_.size() - 1);
+    --size_;
+  }
+
+ private:
+  /// The ring is full when growing, no slot keeps a spare datagram and the
+  /// new slots are empty
+  void Grow() {
+    std::vector<Slot> slots(2 * slots_.size());
+    for (std::size_t i = 0; i < size_; ++i) {
+      std::swap(slots[i], slots_[(head_ + i) & (slots_.size() - 1)]);
+    }
+
+    slots_.swap(slots);
+    head_ = 0;
+  }
+
+ private:
+  std::vector<Slot> slots_;
+  std::size_t head_;
+  std::size_t size_;
+  uint64_t bytes_;
+  std::size_t spares_;
+};
+
+}  // multiplexing
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_MULTIPLEXING_RECEIVE_RING_H_
@@ -41,8 +41,8 @@ class basic_NetworkProtocol {
       Header;
   typedef EmptyComponent Footer;
 
-  typedef BufferPayload<NextLayer::mtu - Header::size - Footer::size>
-      ReceivePayload;
+  typedef BufferPayload<NextLayer::mtu - Header::size - Footer::size,
+                        Header::size> ReceivePayload;
   typedef basic_Datagram<Header, ReceivePayload, Footer> ReceiveDatagram;
 
   typedef ConstPayload SendPayload;
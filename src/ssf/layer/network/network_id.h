@@ -4,12 +4,11 @@
 #include <cstdint>
 
 #include <boost/thread/recursive_mutex.hpp>
-#include <boost/asio/buffer.hpp>
 #include <boost/asio/io_service.hpp>
 
-#include "ssf/io/buffers.h"
 #include "ssf/utils/map_helpers.h"
 
+#include "ssf/layer/datagram/byte_order.h"
 #include "ssf/layer/parameters.h"
 
 namespace ssf {
@@ -20,8 +19,6 @@ class NetworkID {
  public:
   typedef uint16_t HalfID;
 
-  typedef io::fixed_const_buffer_sequence ConstBuffers;
-  typedef io::fixed_mutable_buffer_sequence MutableBuffers;
   enum { size = 2 * sizeof(HalfID) };
 
  public:
@@ -30,28 +27,16 @@ class NetworkID {
   NetworkID(HalfID local, HalfID remote)
       : local_id_(local), remote_id_(remote) {}
 
-  ConstBuffers GetConstBuffers() const {
-    ConstBuffers buffers;
-    buffers.push_back(boost::asio::buffer(&local_id_, sizeof(HalfID)));
-    buffers.push_back(boost::asio::buffer(&remote_id_, sizeof(HalfID)));
-    return buffers;
+  /// Write the wire format (size bytes, network byte order) at p_wire
+  void Encode(uint8_t* p_wire) const {
+    EncodeBigEndian(local_id_, p_wire);
+    EncodeBigEndian(remote_id_, p_wire + sizeof(HalfID));
   }
 
-  void GetConstBuffers(ConstBuffers* p_buffers) const {
-    p_buffers->push_back(boost::asio::buffer(&local_id_, sizeof(HalfID)));
-    p_buffers->push_back(boost::asio::buffer(&remote_id_, sizeof(HalfID)));
-  }
-
-  MutableBuffers GetMutableBuffers() {
-    MutableBuffers buffers;
-    buffers.push_back(boost::asio::buffer(&local_id_, sizeof(HalfID)));
-    buffers.push_back(boost::asio::buffer(&remote_id_, sizeof(HalfID)));
-    return buffers;
-  }
-
-  void GetMutableBuffers(MutableBuffers* p_buffers) {
-    p_buffers->push_back(boost::asio::buffer(&local_id_, sizeof(HalfID)));
-    p_buffers->push_back(boost::asio::buffer(&remote_id_, sizeof(HalfID)));
+  /// Read the wire format (size bytes, network byte order) from p_wire
+  void Decode(const uint8_t* p_wire) {
+    local_id_ = DecodeBigEndian<HalfID>(p_wire);
+    remote_id_ = DecodeBigEndian<HalfID>(p_wire + sizeof(HalfID));
   }
 
   HalfID& left_id() { return local_id_; }
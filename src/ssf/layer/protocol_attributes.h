@@ -80,6 +80,7 @@ void AsyncReceiveDatagram(
   auto header_received_lambda = [&socket, p_datagram, payload_received_lambda](
     const boost::system::error_code& ec, std::size_t length) {
     if (!ec) {
+      p_datagram->header().Decode();
       p_datagram->payload().SetSize(p_datagram->header().payload_length());
       boost::asio::async_read(
         socket, p_datagram->payload().GetMutableBuffers(),
@@ -125,6 +126,7 @@ void AsyncReceiveDatagram(
       p_datagram->payload().SetSize(length - Datagram::size);
       boost::asio::buffer_copy(p_datagram->GetMutableBuffers(),
         boost::asio::buffer(*p_buffer));
+      p_datagram->header().Decode();
       handler(ec, length);
     } else {
       handler(ec, 0);
@@ -149,6 +151,7 @@ void AsyncReceiveDatagram(
       p_datagram->payload().SetSize(length - Datagram::size);
       boost::asio::buffer_copy(p_datagram->GetMutableBuffers(),
         boost::asio::buffer(*p_buffer));
+      p_datagram->header().Decode();
       handler(ec, length);
     } else {
       handler(ec, 0);
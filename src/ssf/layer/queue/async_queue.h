@@ -4,6 +4,7 @@
 #include <cstdint>
 
 #include <queue>
+#include <vector>
 
 #include <boost/asio/basic_io_object.hpp>
 #include <boost/asio/io_service.hpp>
@@ -12,6 +13,7 @@
 #include <boost/integer_traits.hpp>
 
 #include "ssf/layer/queue/async_queue_service.h"
+#include "ssf/layer/queue/lockfree_async_queue_service.h"
 
 namespace ssf {
 namespace layer {
@@ -29,6 +31,7 @@ class basic_async_queue : public boost::asio::basic_io_object<Service> {
  public:
   typedef typename Service::value_type value_type;
   typedef typename Service::container_type container_type;
+  typedef typename Service::elements_type elements_type;
   enum {
     kQueueMaxSize = Service::kQueueMaxSize,
     kOPQueueMaxSize = Service::kOPQueueMaxSize
@@ -64,6 +67,17 @@ class basic_async_queue : public boost::asio::basic_io_object<Service> {
                                           std::forward<Handler>(handler));
   }
 
+  /// Push all elements in one op
+  ///   Handler signature: void(boost::system::error_code, std::size_t pushed)
+  template <class Handler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(Handler,
+                                void(boost::system::error_code, std::size_t))
+      async_push_some(elements_type elements, Handler&& handler) {
+    return this->get_service().async_push_some(this->implementation,
+                                               std::move(elements),
+                                               std::forward<Handler>(handler));
+  }
+
   T get(boost::system::error_code& ec) {
     return this->get_service().get(this->implementation, ec);
   }
@@ -75,6 +89,16 @@ class basic_async_queue : public boost::asio::basic_io_object<Service> {
                                          std::forward<Handler>(handler));
   }
 
+  /// Get from 1 to max_count elements (0 for no limit) in one op
+  ///   Handler signature: void(boost::system::error_code, elements_type)
+  template <class Handler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(Handler,
+                                void(boost::system::error_code, elements_type))
+      async_get_some(std::size_t max_count, Handler&& handler) {
+    return this->get_service().async_get_some(this->implementation, max_count,
+                                              std::forward<Handler>(handler));
+  }
+
   bool empty() const { return this->get_service().empty(this->implementation); }
 
   std::size_t size() const {
@@ -88,6 +112,15 @@ class basic_async_queue : public boost::asio::basic_io_object<Service> {
   }
 };
 
+/// Async queue backed by a bounded lock-free ring of QueueMaxSize elements
+template <class Ttype, uint32_t QueueMaxSize = 1024,
+          uint32_t OPQueueMaxSize = boost::integer_traits<uint32_t>::const_max>
+using lockfree_async_queue = basic_async_queue<
+    Ttype, typename basic_lockfree_async_queue_service<
+               Ttype, QueueMaxSize, OPQueueMaxSize>::container_type,
+    QueueMaxSize, OPQueueMaxSize,
+    basic_lockfree_async_queue_service<Ttype, QueueMaxSize, OPQueueMaxSize>>;
+
 }  // queue
 }  // layer
 }  // ssf
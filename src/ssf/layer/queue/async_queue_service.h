@@ -4,8 +4,10 @@
 #include <cstdint>
 
 #include <atomic>
+#include <limits>
 #include <memory>
 #include <type_traits>
+#include <vector>
 
 #include <boost/asio/detail/op_queue.hpp>
 #include <boost/asio/io_service.hpp>
@@ -16,7 +18,9 @@
 #include "ssf/error/error.h"
 
 #include "ssf/io/get_op.h"
+#include "ssf/io/get_some_op.h"
 #include "ssf/io/push_op.h"
+#include "ssf/io/push_some_op.h"
 #include "ssf/io/handler_helpers.h"
 
 namespace ssf {
@@ -35,6 +39,7 @@ class basic_async_queue_service
  public:
   typedef T value_type;
   typedef Container container_type;
+  typedef std::vector<T> elements_type;
   enum { kQueueMaxSize = QueueMaxSize, kOPQueueMaxSize = OPQueueMaxSize };
 
   struct implementation_type {
@@ -47,12 +52,16 @@ class basic_async_queue_service
     mutable std::unique_ptr<boost::recursive_mutex> p_get_op_queue_mutex;
     std::unique_ptr<boost::asio::detail::op_queue<
         io::basic_pending_get_operation<T>>> p_get_op_queue;
+    std::unique_ptr<boost::asio::detail::op_queue<
+        io::basic_pending_get_some_operation<T>>> p_get_some_op_queue;
     uint32_t get_op_queue_size;
     std::unique_ptr<boost::asio::io_service::work> p_get_work;
 
     mutable std::unique_ptr<boost::recursive_mutex> p_push_op_queue_mutex;
     std::unique_ptr<boost::asio::detail::op_queue<
         io::basic_pending_push_operation<T>>> p_push_op_queue;
+    std::unique_ptr<boost::asio::detail::op_queue<
+        io::basic_pending_push_some_operation<T>>> p_push_some_op_queue;
     uint32_t push_op_queue_size;
     std::unique_ptr<boost::asio::io_service::work> p_push_work;
   };
@@ -81,6 +90,16 @@ class basic_async_queue_service
         boost::asio::detail::op_queue<io::basic_pending_push_operation<T>>>(
         new boost::asio::detail::op_queue<
             io::basic_pending_push_operation<T>>());
+    impl.p_get_some_op_queue =
+        std::unique_ptr<boost::asio::detail::op_queue<
+            io::basic_pending_get_some_operation<T>>>(
+            new boost::asio::detail::op_queue<
+                io::basic_pending_get_some_operation<T>>());
+    impl.p_push_some_op_queue =
+        std::unique_ptr<boost::asio::detail::op_queue<
+            io::basic_pending_push_some_operation<T>>>(
+            new boost::asio::detail::op_queue<
+                io::basic_pending_push_some_operation<T>>());
     impl.push_op_queue_size = 0;
     impl.get_op_queue_size = 0;
   }
@@ -100,7 +119,11 @@ class basic_async_queue_service
       while (!impl.p_push_op_queue->empty()) {
         impl.p_push_op_queue->pop();
       }
+      while (!impl.p_push_some_op_queue->empty()) {
+        impl.p_push_some_op_queue->pop();
+      }
       impl.p_push_op_queue.reset();
+      impl.p_push_some_op_queue.reset();
       impl.push_op_queue_size = 0;
       impl.p_push_work.reset();
     }
@@ -109,7 +132,11 @@ class basic_async_queue_service
       while (!impl.p_get_op_queue->empty()) {
         impl.p_get_op_queue->pop();
       }
+      while (!impl.p_get_some_op_queue->empty()) {
+        impl.p_get_some_op_queue->pop();
+      }
       impl.p_get_op_queue.reset();
+      impl.p_get_some_op_queue.reset();
       impl.get_op_queue_size = 0;
       impl.p_get_work.reset();
     }
@@ -209,6 +236,67 @@ class basic_async_queue_service
     return init.result.get();
   }
 
+  /// Push all elements, in order, as room is made in the queue
+  ///   Handler signature: void(boost::system::error_code, std::size_t pushed)
+  template <class Handler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(Handler,
+                                void(boost::system::error_code, std::size_t))
+      async_push_some(implementation_type& impl, elements_type elements,
+                      Handler&& handler) {
+    boost::asio::detail::async_result_init<
+        Handler, void(boost::system::error_code, std::size_t)>
+        init(std::forward<Handler>(handler));
+
+    if (!*impl.p_open) {
+      io::PostHandler(
+          this->get_io_service(), init.handler,
+          boost::system::error_code(ssf::error::broken_pipe,
+                                    ssf::error::get_ssf_category()),
+          0);
+
+      return init.result.get();
+    }
+
+    if (impl.push_op_queue_size >= OPQueueMaxSize) {
+      io::PostHandler(
+          this->get_io_service(), init.handler,
+          boost::system::error_code(ssf::error::buffer_is_full_error,
+                                    ssf::error::get_ssf_category()),
+          0);
+
+      return init.result.get();
+    }
+
+    typedef io::pending_push_some_operation<
+        typename ::boost::asio::handler_type<
+            Handler, void(boost::system::error_code, std::size_t)>::type,
+        T> op;
+    typename op::ptr p = {
+        boost::asio::detail::addressof(init.handler),
+        boost_asio_handler_alloc_helpers::allocate(sizeof(op), init.handler),
+        0};
+    p.p = new (p.v) op(init.handler, std::move(elements), 0);
+
+    {
+      boost::recursive_mutex::scoped_lock lock(*impl.p_push_op_queue_mutex);
+
+      impl.p_push_some_op_queue->push(p.p);
+      ++(impl.push_op_queue_size);
+      if (!impl.p_push_work) {
+        impl.p_push_work = std::unique_ptr<boost::asio::io_service::work>(
+            new boost::asio::io_service::work(this->get_io_service()));
+      }
+    }
+
+    p.v = p.p = 0;
+
+    this->get_io_service().post(
+        boost::bind(&basic_async_queue_service::HandlePushQueues, this, &impl,
+                    impl.p_valid));
+
+    return init.result.get();
+  }
+
   T get(implementation_type& impl, boost::system::error_code& ec) {
     boost::recursive_mutex::scoped_lock lock(*impl.p_container_mutex);
 
@@ -289,6 +377,70 @@ class basic_async_queue_service
     return init.result.get();
   }
 
+  /// Get at least one and at most max_count elements (0 for no limit)
+  ///   Handler signature: void(boost::system::error_code, elements_type)
+  template <class Handler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(Handler,
+                                void(boost::system::error_code, elements_type))
+      async_get_some(implementation_type& impl, std::size_t max_count,
+                     Handler&& handler) {
+    boost::asio::detail::async_result_init<
+        Handler, void(boost::system::error_code, elements_type)>
+        init(std::forward<Handler>(handler));
+
+    if (!*impl.p_open) {
+      io::PostHandler(this->get_io_service(), init.handler,
+                      boost::system::error_code(ssf::error::broken_pipe,
+                                                ssf::error::get_ssf_category()),
+                      elements_type());
+
+      return init.result.get();
+    }
+
+    if ((impl.get_op_queue_size) >= OPQueueMaxSize) {
+      io::PostHandler(
+          this->get_io_service(), init.handler,
+          boost::system::error_code(ssf::error::buffer_is_full_error,
+                                    ssf::error::get_ssf_category()),
+          elements_type());
+
+      return init.result.get();
+    }
+
+    if (max_count == 0) {
+      max_count = (std::numeric_limits<std::size_t>::max)();
+    }
+
+    typedef io::pending_get_some_operation<
+        typename ::boost::asio::handler_type<
+            Handler, void(boost::system::error_code, elements_type)>::type,
+        T> op;
+    typename op::ptr p = {
+        boost::asio::detail::addressof(init.handler),
+        boost_asio_handler_alloc_helpers::allocate(sizeof(op), init.handler),
+        0};
+    p.p = new (p.v) op(init.handler, max_count);
+
+    {
+      boost::recursive_mutex::scoped_lock lock(*impl.p_get_op_queue_mutex);
+
+      impl.p_get_some_op_queue->push(p.p);
+      ++(impl.get_op_queue_size);
+      if (!impl.p_get_work) {
+        impl.p_get_work = std::unique_ptr<boost::asio::io_service::work>(
+            new boost::asio::io_service::work(this->get_io_service()));
+      }
+    }
+
+    p.v = p.p = 0;
+
+    this->get_io_service().post(
+        boost::bind(&basic_async_queue_service::HandleGetQueues, this, &impl,
+                    impl.p_valid));
+
+    return init.result.get();
+  }
+
   bool empty(const implementation_type& impl) const {
     boost::recursive_mutex::scoped_lock lock(*impl.p_container_mutex);
     return impl.container.empty();
@@ -323,6 +475,15 @@ class basic_async_queue_service
                                                ssf::error::get_ssf_category()),
                      T());
       }
+      while (!impl.p_get_some_op_queue->empty()) {
+        auto op = impl.p_get_some_op_queue->front();
+        impl.p_get_some_op_queue->pop();
+        --(impl.get_op_queue_size);
+
+        op->complete(boost::system::error_code(ssf::error::operation_canceled,
+                                               ssf::error::get_ssf_category()),
+                     elements_type());
+      }
 
       impl.p_get_work.reset();
     }
@@ -337,6 +498,14 @@ class basic_async_queue_service
         op->complete(boost::system::error_code(ssf::error::operation_canceled,
                                                ssf::error::get_ssf_category()));
       }
+      while (!impl.p_push_some_op_queue->empty()) {
+        auto op = impl.p_push_some_op_queue->front();
+        impl.p_push_some_op_queue->pop();
+        --(impl.push_op_queue_size);
+
+        op->complete(boost::system::error_code(ssf::error::operation_canceled,
+                                               ssf::error::get_ssf_category()));
+      }
 
       impl.p_push_work.reset();
     }
@@ -361,8 +530,12 @@ class basic_async_queue_service
       return;
     }
 
-    if ((p_impl->container.size() >= QueueMaxSize) ||
-        p_impl->p_push_op_queue->empty()) {
+    if (p_impl->container.size() >= QueueMaxSize) {
+      return;
+    }
+
+    if (p_impl->p_push_op_queue->empty()) {
+      HandlePushSomeQueue(p_impl, p_valid);
       return;
     }
 
@@ -370,20 +543,50 @@ class basic_async_queue_service
     p_impl->p_push_op_queue->pop();
     --(p_impl->push_op_queue_size);
 
-    auto element = op->element();
+    auto element = std::move(op->element());
     p_impl->container.push(std::move(element));
 
     auto do_complete =
         [op]() mutable { op->complete(boost::system::error_code()); };
     this->get_io_service().post(do_complete);
 
-    if (p_impl->p_push_op_queue->empty()) {
+    if (p_impl->p_push_op_queue->empty() &&
+        p_impl->p_push_some_op_queue->empty()) {
       p_impl->p_push_work.reset();
     }
 
     HandleGetQueues(p_impl, p_valid);
   }
 
+  /// Push as many elements of the first batch as the queue can hold
+  void HandlePushSomeQueue(implementation_type* p_impl,
+                           std::shared_ptr<std::atomic<bool>> p_valid) {
+    if (p_impl->p_push_some_op_queue->empty()) {
+      return;
+    }
+
+    auto op = p_impl->p_push_some_op_queue->front();
+    while (!op->done() && p_impl->container.size() < QueueMaxSize) {
+      p_impl->container.push(std::move(op->next_element()));
+      op->element_pushed();
+    }
+
+    if (op->done()) {
+      p_impl->p_push_some_op_queue->pop();
+      --(p_impl->push_op_queue_size);
+
+      auto do_complete =
+          [op]() mutable { op->complete(boost::system::error_code()); };
+      this->get_io_service().post(do_complete);
+
+      if (p_impl->p_push_some_op_queue->empty()) {
+        p_impl->p_push_work.reset();
+      }
+    }
+
+    HandleGetQueues(p_impl, p_valid);
+  }
+
   void HandleGetQueues(implementation_type* p_impl,
                        std::shared_ptr<std::atomic<bool>> p_valid) {
     if (!*p_valid) {
@@ -397,11 +600,16 @@ class basic_async_queue_service
       return;
     }
 
-    if (p_impl->container.empty() || p_impl->p_get_op_queue->empty()) {
+    if (p_impl->container.empty()) {
       HandlePushQueues(p_impl, p_valid);
       return;
     }
 
+    if (p_impl->p_get_op_queue->empty()) {
+      HandleGetSomeQueue(p_impl, p_valid);
+      return;
+    }
+
     auto element = std::move(p_impl->container.front());
     p_impl->container.pop();
 
@@ -414,7 +622,43 @@ class basic_async_queue_service
     };
     this->get_io_service().post(do_complete);
 
-    if (p_impl->p_get_op_queue->empty()) {
+    if (p_impl->p_get_op_queue->empty() &&
+        p_impl->p_get_some_op_queue->empty()) {
+      p_impl->p_get_work.reset();
+    }
+
+    HandlePushQueues(p_impl, p_valid);
+  }
+
+  /// Complete the first batch get with the available elements
+  void HandleGetSomeQueue(implementation_type* p_impl,
+                          std::shared_ptr<std::atomic<bool>> p_valid) {
+    if (p_impl->p_get_some_op_queue->empty()) {
+      HandlePushQueues(p_impl, p_valid);
+      return;
+    }
+
+    auto op = p_impl->p_get_some_op_queue->front();
+    p_impl->p_get_some_op_queue->pop();
+    --(p_impl->get_op_queue_size);
+
+    auto count = p_impl->container.size();
+    if (count > op->max_count()) {
+      count = op->max_count();
+    }
+    auto p_elements = std::make_shared<elements_type>();
+    p_elements->reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      p_elements->push_back(std::move(p_impl->container.front()));
+      p_impl->container.pop();
+    }
+
+    auto do_complete = [p_elements, op]() mutable {
+      op->complete(boost::system::error_code(), std::move(*p_elements));
+    };
+    this->get_io_service().post(do_complete);
+
+    if (p_impl->p_get_some_op_queue->empty()) {
       p_impl->p_get_work.reset();
     }
 
@@ -4,8 +4,12 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <vector>
 
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/bind.hpp>
+#include <boost/log/trivial.hpp>
 #include <boost/system/error_code.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 
@@ -18,6 +22,11 @@ namespace ssf {
 namespace layer {
 namespace queue {
 
+/// Forward elements from registered inputs to registered outputs
+///   Each input loop runs on its own strand and selects the output of its
+///   elements inline. Each output callback runs on the output strand.
+///   Outputs are read from an immutable snapshot, replaced on
+///   Register/UnregisterOutput, so forwarding takes no global lock
 template <class TIdentifier, class TElement, class TSelector>
 class Commutator : public std::enable_shared_from_this<
                        Commutator<TIdentifier, TElement, TSelector>> {
@@ -28,17 +37,40 @@ class Commutator : public std::enable_shared_from_this<
 
   typedef TaggedItem<Identifier, Element> TaggedElement;
 
+  typedef std::vector<Element> Elements;
+
   typedef std::function<void(const boost::system::error_code&, Element)>
       InputHandler;
   typedef std::function<void(InputHandler)> InputCallback;
-  typedef TaggedItemPtr<Identifier, ActiveItem<InputCallback>>
+
+  /// Batch input : one handler call for several elements
+  typedef std::function<void(const boost::system::error_code&, Elements)>
+      BatchInputHandler;
+  typedef std::function<void(BatchInputHandler)> BatchInputCallback;
+
+  typedef std::shared_ptr<boost::asio::io_service::strand> StrandPtr;
+
+  /// Either input_callback or batch_input_callback is set
+  ///   p_strand serializes the input loop and the selection of its elements
+  struct InputCallbacks {
+    InputCallback input_callback;
+    BatchInputCallback batch_input_callback;
+    StrandPtr p_strand;
+  };
+  typedef TaggedItemPtr<Identifier, ActiveItem<InputCallbacks>>
       TaggedActiveInputCallbackPtr;
 
   typedef std::function<void(const boost::system::error_code&)> OutputHandler;
   typedef std::function<void(Element, OutputHandler)> OutputCallback;
 
+  struct Output {
+    OutputCallback output_callback;
+    StrandPtr p_strand;
+  };
+
   typedef std::map<Identifier, TaggedActiveInputCallbackPtr> InputCallbackMap;
-  typedef std::map<Identifier, OutputCallback> OutputCallbackMap;
+  typedef std::map<Identifier, Output> OutputCallbackMap;
+  typedef std::shared_ptr<const OutputCallbackMap> OutputCallbackMapPtr;
 
  public:
   template <class... Args>
@@ -50,17 +82,18 @@ class Commutator : public std::enable_shared_from_this<
   ~Commutator() {}
 
   bool RegisterInput(Identifier id, InputCallback input_callback) {
-    boost::recursive_mutex::scoped_lock lock(input_callbacks_mutex_);
+    InputCallbacks input_callbacks;
+    input_callbacks.input_callback = std::move(input_callback);
 
-    auto active_item = make_active(std::move(input_callback));
-    auto p_tagged_active_item = make_shared_tagged(id, std::move(active_item));
-
-    auto inserted = input_callbacks_.insert(
-        std::make_pair(std::move(id), p_tagged_active_item));
+    return RegisterInputCallbacks(std::move(id), std::move(input_callbacks));
+  }
 
-    StartInputLoop(std::move(p_tagged_active_item));
+  bool RegisterBatchInput(Identifier id,
+                          BatchInputCallback batch_input_callback) {
+    InputCallbacks input_callbacks;
+    input_callbacks.batch_input_callback = std::move(batch_input_callback);
 
-    return inserted.second;
+    return RegisterInputCallbacks(std::move(id), std::move(input_callbacks));
   }
 
   bool UnregisterInput(const Identifier& id) {
@@ -81,8 +114,19 @@ class Commutator : public std::enable_shared_from_this<
   bool RegisterOutput(Identifier id, OutputCallback output_callback) {
     boost::recursive_mutex::scoped_lock lock(output_callbacks_mutex_);
 
-    auto inserted = output_callbacks_.insert(
-        std::make_pair(std::move(id), std::move(output_callback)));
+    Output output;
+    output.output_callback = std::move(output_callback);
+    output.p_strand = std::make_shared<boost::asio::io_service::strand>(
+        io_service_);
+
+    auto p_output_callbacks =
+        std::make_shared<OutputCallbackMap>(*LoadOutputCallbacks());
+    auto inserted = p_output_callbacks->insert(
+        std::make_pair(std::move(id), std::move(output)));
+
+    if (inserted.second) {
+      PublishOutputCallbacks(std::move(p_output_callbacks));
+    }
 
     return inserted.second;
   }
@@ -90,13 +134,16 @@ class Commutator : public std::enable_shared_from_this<
   bool UnregisterOutput(const Identifier& id) {
     boost::recursive_mutex::scoped_lock lock(output_callbacks_mutex_);
 
-    auto p_output_it = output_callbacks_.find(id);
+    auto p_output_callbacks = LoadOutputCallbacks();
 
-    if (p_output_it == std::end(output_callbacks_)) {
+    if (p_output_callbacks->find(id) == std::end(*p_output_callbacks)) {
       return false;
     }
 
-    output_callbacks_.erase(p_output_it);
+    auto p_new_output_callbacks =
+        std::make_shared<OutputCallbackMap>(*p_output_callbacks);
+    p_new_output_callbacks->erase(id);
+    PublishOutputCallbacks(std::move(p_new_output_callbacks));
 
     return true;
   }
@@ -114,7 +161,7 @@ class Commutator : public std::enable_shared_from_this<
 
     {
       boost::recursive_mutex::scoped_lock lock(output_callbacks_mutex_);
-      output_callbacks_.clear();
+      PublishOutputCallbacks(std::make_shared<OutputCallbackMap>());
     }
 
     return ec;
@@ -127,13 +174,41 @@ class Commutator : public std::enable_shared_from_this<
         input_callbacks_mutex_(),
         input_callbacks_(),
         output_callbacks_mutex_(),
-        output_callbacks_() {}
+        p_output_callbacks_(std::make_shared<OutputCallbackMap>()) {}
 
  private:
+  bool RegisterInputCallbacks(Identifier id, InputCallbacks input_callbacks) {
+    boost::recursive_mutex::scoped_lock lock(input_callbacks_mutex_);
+
+    input_callbacks.p_strand =
+        std::make_shared<boost::asio::io_service::strand>(io_service_);
+
+    auto active_item = make_active(std::move(input_callbacks));
+    auto p_tagged_active_item = make_shared_tagged(id, std::move(active_item));
+
+    auto inserted = input_callbacks_.insert(
+        std::make_pair(std::move(id), p_tagged_active_item));
+
+    StartInputLoop(std::move(p_tagged_active_item));
+
+    return inserted.second;
+  }
+
   void StartInputLoop(TaggedActiveInputCallbackPtr p_input_callback) {
-    p_input_callback->item.item()(boost::bind(&Commutator::InputReceived,
-                                              this->shared_from_this(),
-                                              p_input_callback, _1, _2));
+    auto& input_callbacks = p_input_callback->item.item();
+
+    auto& strand = *input_callbacks.p_strand;
+
+    if (input_callbacks.batch_input_callback) {
+      input_callbacks.batch_input_callback(strand.wrap(
+          boost::bind(&Commutator::BatchInputReceived, this->shared_from_this(),
+                      p_input_callback, _1, _2)));
+      return;
+    }
+
+    input_callbacks.input_callback(strand.wrap(
+        boost::bind(&Commutator::InputReceived, this->shared_from_this(),
+                    p_input_callback, _1, _2)));
   }
 
   void InputReceived(TaggedActiveInputCallbackPtr p_input_callback,
@@ -147,19 +222,32 @@ class Commutator : public std::enable_shared_from_this<
       return;
     }
 
-    AsyncCommute(
-        p_input_callback->tag, std::move(element),
-        boost::bind(&Commutator::OutputSent, this->shared_from_this(), _1));
+    Select(TaggedElement(p_input_callback->tag, std::move(element)),
+           boost::bind(&Commutator::OutputSent, this->shared_from_this(), _1));
 
     StartInputLoop(std::move(p_input_callback));
   }
 
-  void AsyncCommute(Identifier id, Element element, OutputHandler handler) {
-    auto tagged_element = make_tagged(std::move(id), std::move(element));
+  void BatchInputReceived(TaggedActiveInputCallbackPtr p_input_callback,
+                          const boost::system::error_code& ec,
+                          Elements elements) {
+    if (ec) {
+      p_input_callback->item.Disactivate();
+      BOOST_LOG_TRIVIAL(trace)
+          << " * Deactivate batch input received callback";
+
+      return;
+    }
 
-    io_service_.post(boost::bind(&Commutator::Select, this->shared_from_this(),
-                                 std::move(tagged_element),
-                                 std::move(handler)));
+    OutputHandler handler(
+        boost::bind(&Commutator::OutputSent, this->shared_from_this(), _1));
+
+    for (auto& element : elements) {
+      Select(TaggedElement(p_input_callback->tag, std::move(element)),
+             handler);
+    }
+
+    StartInputLoop(std::move(p_input_callback));
   }
 
   void Select(TaggedElement tagged_element, OutputHandler handler) {
@@ -174,21 +262,51 @@ class Commutator : public std::enable_shared_from_this<
   }
 
   void DoOutput(TaggedElement tagged_element, OutputHandler handler) {
-    boost::recursive_mutex::scoped_lock lock(output_callbacks_mutex_);
+    auto p_output_callbacks = LoadOutputCallbacks();
 
-    auto output_it = output_callbacks_.find(tagged_element.tag);
+    auto output_it = p_output_callbacks->find(tagged_element.tag);
 
-    if (output_it == std::end(output_callbacks_)) {
+    if (output_it == std::end(*p_output_callbacks)) {
       handler(boost::system::error_code(ssf::error::not_connected,
                                         ssf::error::get_ssf_category()));
       return;
     }
 
-    output_it->second(std::move(tagged_element.item), std::move(handler));
+    const auto& output = output_it->second;
+    output.p_strand->dispatch(OutputOperation(
+        std::move(p_output_callbacks), &output.output_callback,
+        std::move(tagged_element.item), std::move(handler)));
   }
 
   void OutputSent(const boost::system::error_code& ec) {}
 
+  OutputCallbackMapPtr LoadOutputCallbacks() const {
+    return std::atomic_load(&p_output_callbacks_);
+  }
+
+  void PublishOutputCallbacks(OutputCallbackMapPtr p_output_callbacks) {
+    std::atomic_store(&p_output_callbacks_, std::move(p_output_callbacks));
+  }
+
+ private:
+  /// Output callback call, keeps the snapshot holding the callback alive
+  struct OutputOperation {
+    OutputOperation(OutputCallbackMapPtr p_snapshot,
+                    const OutputCallback* p_callback, Element element,
+                    OutputHandler handler)
+        : p_snapshot(std::move(p_snapshot)),
+          p_callback(p_callback),
+          element(std::move(element)),
+          handler(std::move(handler)) {}
+
+    void operator()() { (*p_callback)(std::move(element), std::move(handler)); }
+
+    OutputCallbackMapPtr p_snapshot;
+    const OutputCallback* p_callback;
+    Element element;
+    OutputHandler handler;
+  };
+
  private:
   boost::asio::io_service& io_service_;
 
@@ -198,7 +316,7 @@ class Commutator : public std::enable_shared_from_this<
   InputCallbackMap input_callbacks_;
 
   boost::recursive_mutex output_callbacks_mutex_;
-  OutputCallbackMap output_callbacks_;
+  OutputCallbackMapPtr p_output_callbacks_;
 };
 
 template <class Identifier, class Element, class Selector>
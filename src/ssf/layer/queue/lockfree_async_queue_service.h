@@ -0,0 +1,788 @@
+#ifndef SSF_LAYER_QUEUE_LOCKFREE_ASYNC_QUEUE_SERVICE_H_
+#define SSF_LAYER_QUEUE_LOCKFREE_ASYNC_QUEUE_SERVICE_H_
+
+#include <cstdint>
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <boost/asio/detail/op_queue.hpp>
+#include <boost/asio/io_service.hpp>
+
+#include <boost/thread/mutex.hpp>
+
+#include "ssf/error/error.h"
+
+#include "ssf/io/get_op.h"
+#include "ssf/io/get_some_op.h"
+#include "ssf/io/push_op.h"
+#include "ssf/io/push_some_op.h"
+#include "ssf/io/handler_helpers.h"
+
+#include "ssf/layer/queue/lockfree_ring.h"
+
+namespace ssf {
+namespace layer {
+namespace queue {
+
+/// Async queue service backed by a bounded lock-free ring
+///   Elements are stored in a ring of at least QueueMaxSize slots. Pending
+///   async ops are pushed on intrusive lock-free stacks and moved in FIFO
+///   order by a single dispatcher. Wakeups are coalesced: while a dispatch is
+///   scheduled or running, pushes only flag it dirty instead of posting.
+///   Completions are posted, as with basic_async_queue_service.
+template <class Ttype, uint32_t QueueMaxSize, uint32_t OPQueueMaxSize>
+class basic_lockfree_async_queue_service
+    : public boost::asio::detail::service_base<
+          basic_lockfree_async_queue_service<Ttype, QueueMaxSize,
+                                             OPQueueMaxSize>> {
+ private:
+  typedef Ttype T;
+  typedef basic_lockfree_ring<T, QueueMaxSize> Ring;
+  typedef io::basic_pending_get_operation<T> GetOp;
+  typedef io::basic_pending_push_operation<T> PushOp;
+  typedef io::basic_pending_get_some_operation<T> GetSomeOp;
+  typedef io::basic_pending_push_some_operation<T> PushSomeOp;
+  typedef std::vector<T> Elements;
+
+  static_assert(QueueMaxSize <= (1U << 24),
+                "Lock-free queue size should be bounded");
+
+  enum DispatchState {
+    kIdle = 0,
+    kScheduled = 1,
+    kRunning = 2,
+    kRunningDirty = 3
+  };
+
+  struct State {
+    State(boost::asio::io_service& io_service)
+        : io_service(io_service),
+          valid(true),
+          open(true),
+          dispatch_state(kIdle),
+          p_incoming_get_ops(nullptr),
+          p_incoming_push_ops(nullptr),
+          p_incoming_get_some_ops(nullptr),
+          p_incoming_push_some_ops(nullptr),
+          get_op_count(0),
+          push_op_count(0),
+          pending_op_count(0) {}
+
+    ~State() {
+      DestroyStack(p_incoming_get_ops.exchange(nullptr));
+      DestroyStack(p_incoming_push_ops.exchange(nullptr));
+      DestroyStack(p_incoming_get_some_ops.exchange(nullptr));
+      DestroyStack(p_incoming_push_some_ops.exchange(nullptr));
+    }
+
+    template <class Op>
+    static void DestroyStack(Op* p_op) {
+      while (p_op) {
+        auto p_next = boost::asio::detail::op_queue_access::next(p_op);
+        p_op->destroy();
+        p_op = p_next;
+      }
+    }
+
+    boost::asio::io_service& io_service;
+    std::atomic<bool> valid;
+    std::atomic<bool> open;
+    std::atomic<int> dispatch_state;
+
+    Ring ring;
+
+    // Ops not seen by the dispatcher yet (LIFO)
+    std::atomic<GetOp*> p_incoming_get_ops;
+    std::atomic<PushOp*> p_incoming_push_ops;
+    std::atomic<GetSomeOp*> p_incoming_get_some_ops;
+    std::atomic<PushSomeOp*> p_incoming_push_some_ops;
+
+    // Ops owned by the dispatcher (FIFO)
+    boost::asio::detail::op_queue<GetOp> get_ops;
+    boost::asio::detail::op_queue<PushOp> push_ops;
+    boost::asio::detail::op_queue<GetSomeOp> get_some_ops;
+    boost::asio::detail::op_queue<PushSomeOp> push_some_ops;
+
+    // Pending single and batch ops
+
+    std::atomic<uint32_t> get_op_count;
+    std::atomic<uint32_t> push_op_count;
+
+    std::atomic<uint32_t> pending_op_count;
+    boost::mutex work_mutex;
+    std::unique_ptr<boost::asio::io_service::work> p_work;
+  };
+
+  typedef std::shared_ptr<State> StatePtr;
+
+ public:
+  typedef T value_type;
+  typedef Ring container_type;
+  typedef Elements elements_type;
+  enum { kQueueMaxSize = QueueMaxSize, kOPQueueMaxSize = OPQueueMaxSize };
+
+  struct implementation_type {
+    StatePtr p_state;
+  };
+
+ public:
+  explicit basic_lockfree_async_queue_service(
+      boost::asio::io_service& io_service)
+      : boost::asio::detail::service_base<basic_lockfree_async_queue_service>(
+            io_service) {}
+
+  virtual ~basic_lockfree_async_queue_service() {}
+
+  void construct(implementation_type& impl) {
+    impl.p_state = std::make_shared<State>(this->get_io_service());
+  }
+
+  void destroy(implementation_type& impl) {
+    if (!impl.p_state) {
+      return;
+    }
+
+    impl.p_state->valid = false;
+    impl.p_state->open = false;
+    ScheduleDispatch(impl.p_state);
+
+    {
+      boost::mutex::scoped_lock lock(impl.p_state->work_mutex);
+      impl.p_state->p_work.reset();
+    }
+
+    impl.p_state.reset();
+  }
+
+  void move_construct(implementation_type& impl, implementation_type& other) {
+    impl = std::move(other);
+  }
+
+  void move_assign(implementation_type& impl,
+                   basic_lockfree_async_queue_service& other_service,
+                   implementation_type& other) {
+    impl = std::move(other);
+  }
+
+  boost::system::error_code push(implementation_type& impl, T element,
+                                 boost::system::error_code& ec) {
+    PushElement(impl.p_state, element, ec);
+    return ec;
+  }
+
+  template <class Handler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(Handler, void(boost::system::error_code))
+      async_push(implementation_type& impl, T element, Handler&& handler) {
+    boost::asio::detail::async_result_init<Handler,
+                                           void(boost::system::error_code)>
+        init(std::forward<Handler>(handler));
+
+    auto& state = *impl.p_state;
+
+    if (!state.open) {
+      io::PostHandler(
+          this->get_io_service(), init.handler,
+          boost::system::error_code(ssf::error::broken_pipe,
+                                    ssf::error::get_ssf_category()));
+
+      return init.result.get();
+    }
+
+    // Room in the ring and no older push waiting: no op to queue
+    if (state.push_op_count.load() == 0) {
+      boost::system::error_code ec;
+      PushElement(impl.p_state, element, ec);
+      if (ec.value() != ssf::error::buffer_is_full_error) {
+        io::PostHandler(this->get_io_service(), init.handler, ec);
+
+        return init.result.get();
+      }
+    }
+
+    if (!AcquireOpSlot(state.push_op_count)) {
+      io::PostHandler(
+          this->get_io_service(), init.handler,
+          boost::system::error_code(ssf::error::buffer_is_full_error,
+                                    ssf::error::get_ssf_category()));
+
+      return init.result.get();
+    }
+
+    typedef io::pending_push_operation<
+        typename ::boost::asio::handler_type<
+            Handler, void(boost::system::error_code)>::type,
+        T> op;
+    typename op::ptr p = {
+        boost::asio::detail::addressof(init.handler),
+        boost_asio_handler_alloc_helpers::allocate(sizeof(op), init.handler),
+        0};
+    p.p = new (p.v) op(init.handler, std::move(element));
+
+    EnqueueOp(impl.p_state, state.p_incoming_push_ops,
+              static_cast<PushOp*>(p.p));
+
+    p.v = p.p = 0;
+
+    return init.result.get();
+  }
+
+  /// Push all elements, in order, as room is made in the queue
+  ///   Handler signature: void(boost::system::error_code, std::size_t pushed)
+  template <class Handler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(Handler,
+                                void(boost::system::error_code, std::size_t))
+      async_push_some(implementation_type& impl, Elements elements,
+                      Handler&& handler) {
+    boost::asio::detail::async_result_init<
+        Handler, void(boost::system::error_code, std::size_t)>
+        init(std::forward<Handler>(handler));
+
+    auto& state = *impl.p_state;
+
+    if (!state.open) {
+      io::PostHandler(
+          this->get_io_service(), init.handler,
+          boost::system::error_code(ssf::error::broken_pipe,
+                                    ssf::error::get_ssf_category()),
+          0);
+
+      return init.result.get();
+    }
+
+    // Push what fits if no older push is waiting
+    std::size_t pushed = 0;
+    if (state.push_op_count.load() == 0) {
+      boost::system::error_code ec;
+      while (pushed < elements.size()) {
+        PushElement(impl.p_state, elements[pushed], ec);
+        if (ec) {
+          break;
+        }
+        ++pushed;
+      }
+
+      if (pushed == elements.size() ||
+          ec.value() != ssf::error::buffer_is_full_error) {
+        io::PostHandler(this->get_io_service(), init.handler, ec, pushed);
+
+        return init.result.get();
+      }
+    }
+
+    if (!AcquireOpSlot(state.push_op_count)) {
+      io::PostHandler(
+          this->get_io_service(), init.handler,
+          boost::system::error_code(ssf::error::buffer_is_full_error,
+                                    ssf::error::get_ssf_category()),
+          pushed);
+
+      return init.result.get();
+    }
+
+    typedef io::pending_push_some_operation<
+        typename ::boost::asio::handler_type<
+            Handler, void(boost::system::error_code, std::size_t)>::type,
+        T> op;
+    typename op::ptr p = {
+        boost::asio::detail::addressof(init.handler),
+        boost_asio_handler_alloc_helpers::allocate(sizeof(op), init.handler),
+        0};
+    p.p = new (p.v) op(init.handler, std::move(elements), pushed);
+
+    EnqueueOp(impl.p_state, state.p_incoming_push_some_ops,
+              static_cast<PushSomeOp*>(p.p));
+
+    p.v = p.p = 0;
+
+    return init.result.get();
+  }
+
+  T get(implementation_type& impl, boost::system::error_code& ec) {
+    auto& state = *impl.p_state;
+
+    if (!state.open) {
+      ec.assign(ssf::error::broken_pipe, ssf::error::get_ssf_category());
+      return T();
+    }
+
+    T element;
+    if (!state.ring.TryPop(&element)) {
+      ec.assign(ssf::error::io_error, ssf::error::get_ssf_category());
+      return T();
+    }
+
+    NotifyPushOps(impl.p_state);
+
+    ec.assign(ssf::error::success, ssf::error::get_ssf_category());
+    return element;
+  }
+
+  template <class Handler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(Handler, void(boost::system::error_code, T))
+      async_get(implementation_type& impl, Handler&& handler) {
+    boost::asio::detail::async_result_init<Handler,
+                                           void(boost::system::error_code, T)>
+        init(std::forward<Handler>(handler));
+
+    auto& state = *impl.p_state;
+
+    if (!state.open) {
+      io::PostHandler(this->get_io_service(), init.handler,
+                      boost::system::error_code(ssf::error::broken_pipe,
+                                                ssf::error::get_ssf_category()),
+                      T());
+
+      return init.result.get();
+    }
+
+    // Element available and no older get waiting: no op to queue
+    if (state.get_op_count.load() == 0) {
+      T element;
+      if (state.ring.TryPop(&element)) {
+        io::PostHandler(this->get_io_service(), init.handler,
+                        boost::system::error_code(), std::move(element));
+        NotifyPushOps(impl.p_state);
+
+        return init.result.get();
+      }
+    }
+
+    if (!AcquireOpSlot(state.get_op_count)) {
+      io::PostHandler(
+          this->get_io_service(), init.handler,
+          boost::system::error_code(ssf::error::buffer_is_full_error,
+                                    ssf::error::get_ssf_category()),
+          T());
+
+      return init.result.get();
+    }
+
+    typedef io::pending_get_operation<
+        typename ::boost::asio::handler_type<
+            Handler, void(boost::system::error_code, T)>::type,
+        T> op;
+    typename op::ptr p = {
+        boost::asio::detail::addressof(init.handler),
+        boost_asio_handler_alloc_helpers::allocate(sizeof(op), init.handler),
+        0};
+    p.p = new (p.v) op(init.handler);
+
+    EnqueueOp(impl.p_state, state.p_incoming_get_ops,
+              static_cast<GetOp*>(p.p));
+
+    p.v = p.p = 0;
+
+    return init.result.get();
+  }
+
+  /// Get at least one and at most max_count elements (0 for no limit)
+  ///   Handler signature: void(boost::system::error_code, elements_type)
+  template <class Handler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(Handler,
+                                void(boost::system::error_code, Elements))
+      async_get_some(implementation_type& impl, std::size_t max_count,
+                     Handler&& handler) {
+    boost::asio::detail::async_result_init<
+        Handler, void(boost::system::error_code, Elements)>
+        init(std::forward<Handler>(handler));
+
+    auto& state = *impl.p_state;
+
+    if (!state.open) {
+      io::PostHandler(this->get_io_service(), init.handler,
+                      boost::system::error_code(ssf::error::broken_pipe,
+                                                ssf::error::get_ssf_category()),
+                      Elements());
+
+      return init.result.get();
+    }
+
+    if (max_count == 0) {
+      max_count = (std::numeric_limits<std::size_t>::max)();
+    }
+
+    // Elements available and no older get waiting: no op to queue
+    if (state.get_op_count.load() == 0) {
+      Elements elements;
+      PopElements(state, max_count, &elements);
+      if (!elements.empty()) {
+        io::PostHandler(this->get_io_service(), init.handler,
+                        boost::system::error_code(), std::move(elements));
+        NotifyPushOps(impl.p_state);
+
+        return init.result.get();
+      }
+    }
+
+    if (!AcquireOpSlot(state.get_op_count)) {
+      io::PostHandler(
+          this->get_io_service(), init.handler,
+          boost::system::error_code(ssf::error::buffer_is_full_error,
+                                    ssf::error::get_ssf_category()),
+          Elements());
+
+      return init.result.get();
+    }
+
+    typedef io::pending_get_some_operation<
+        typename ::boost::asio::handler_type<
+            Handler, void(boost::system::error_code, Elements)>::type,
+        T> op;
+    typename op::ptr p = {
+        boost::asio::detail::addressof(init.handler),
+        boost_asio_handler_alloc_helpers::allocate(sizeof(op), init.handler),
+        0};
+    p.p = new (p.v) op(init.handler, max_count);
+
+    EnqueueOp(impl.p_state, state.p_incoming_get_some_ops,
+              static_cast<GetSomeOp*>(p.p));
+
+    p.v = p.p = 0;
+
+    return init.result.get();
+  }
+
+  bool empty(const implementation_type& impl) const {
+    return impl.p_state->ring.empty();
+  }
+
+  /// Approximate when producers or consumers are running concurrently
+  std::size_t size(const implementation_type& impl) const {
+    return impl.p_state->ring.size();
+  }
+
+  void clear(implementation_type& impl) {
+    T element;
+    while (impl.p_state->ring.TryPop(&element)) {
+    }
+
+    NotifyPushOps(impl.p_state);
+  }
+
+  boost::system::error_code close(implementation_type& impl,
+                                  boost::system::error_code& ec) {
+    impl.p_state->open = false;
+
+    // Pending ops are canceled by the dispatcher
+    ScheduleDispatch(impl.p_state);
+    clear(impl);
+
+    ec.assign(ssf::error::success, ssf::error::get_ssf_category());
+    return ec;
+  }
+
+ private:
+  /// Element is left untouched if it could not be pushed
+  void PushElement(const StatePtr& p_state, T& element,
+                   boost::system::error_code& ec) {
+    auto& state = *p_state;
+
+    if (!state.open) {
+      ec.assign(ssf::error::broken_pipe, ssf::error::get_ssf_category());
+      return;
+    }
+
+    if (state.ring.size() >= QueueMaxSize || !state.ring.TryPush(element)) {
+      ec.assign(ssf::error::buffer_is_full_error,
+                ssf::error::get_ssf_category());
+      return;
+    }
+
+    // Pairs with the fence in EnqueueOp: either the pending get op sees the
+    // element or this push sees the pending get op
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (state.get_op_count.load(std::memory_order_relaxed) > 0) {
+      ScheduleDispatch(p_state);
+    }
+
+    ec.assign(ssf::error::success, ssf::error::get_ssf_category());
+  }
+
+  static void PopElements(State& state, std::size_t max_count,
+                          Elements* p_elements) {
+    auto available = state.ring.size();
+    p_elements->reserve(available < max_count ? available : max_count);
+
+    T element;
+    while (p_elements->size() < max_count && state.ring.TryPop(&element)) {
+      p_elements->push_back(std::move(element));
+    }
+  }
+
+  static bool AcquireOpSlot(std::atomic<uint32_t>& op_count) {
+    if (op_count.fetch_add(1) >= OPQueueMaxSize) {
+      --op_count;
+      return false;
+    }
+
+    return true;
+  }
+
+  template <class Op>
+  void EnqueueOp(const StatePtr& p_state, std::atomic<Op*>& incoming,
+                 Op* p_op) {
+    AddPendingOp(*p_state);
+
+    auto p_head = incoming.load(std::memory_order_relaxed);
+    do {
+      boost::asio::detail::op_queue_access::next(p_op, p_head);
+    } while (!incoming.compare_exchange_weak(p_head, p_op,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    ScheduleDispatch(p_state);
+  }
+
+  void NotifyPushOps(const StatePtr& p_state) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (p_state->push_op_count.load(std::memory_order_relaxed) > 0) {
+      ScheduleDispatch(p_state);
+    }
+  }
+
+  void AddPendingOp(State& state) {
+    if (state.pending_op_count.fetch_add(1) == 0) {
+      boost::mutex::scoped_lock lock(state.work_mutex);
+      if (!state.p_work && state.valid) {
+        state.p_work.reset(new boost::asio::io_service::work(state.io_service));
+      }
+    }
+  }
+
+  void RemovePendingOp(State& state) {
+    if (state.pending_op_count.fetch_sub(1) == 1) {
+      boost::mutex::scoped_lock lock(state.work_mutex);
+      if (state.pending_op_count.load() == 0) {
+        state.p_work.reset();
+      }
+    }
+  }
+
+  /// Post a dispatch unless one is already scheduled or running
+  void ScheduleDispatch(const StatePtr& p_state) {
+    auto current = p_state->dispatch_state.load();
+    for (;;) {
+      switch (current) {
+        case kIdle:
+          if (p_state->dispatch_state.compare_exchange_weak(current,
+                                                            kScheduled)) {
+            StatePtr p_dispatched_state(p_state);
+            this->get_io_service().post(
+                [this, p_dispatched_state]() { Dispatch(p_dispatched_state); });
+            return;
+          }
+          break;
+        case kRunning:
+          if (p_state->dispatch_state.compare_exchange_weak(current,
+                                                            kRunningDirty)) {
+            return;
+          }
+          break;
+        default:
+          return;
+      }
+    }
+  }
+
+  void Dispatch(StatePtr p_state) {
+    auto& state = *p_state;
+    state.dispatch_state = kRunning;
+
+    for (;;) {
+      TakeIncomingOps(state.p_incoming_get_ops, state.get_ops);
+      TakeIncomingOps(state.p_incoming_push_ops, state.push_ops);
+      TakeIncomingOps(state.p_incoming_get_some_ops, state.get_some_ops);
+      TakeIncomingOps(state.p_incoming_push_some_ops, state.push_some_ops);
+
+      if (state.open) {
+        ServeOps(state);
+      } else {
+        CancelOps(state);
+      }
+
+      auto running = static_cast<int>(kRunning);
+      if (state.dispatch_state.compare_exchange_strong(running, kIdle)) {
+        return;
+      }
+      // Flagged dirty while running
+      state.dispatch_state = kRunning;
+    }
+  }
+
+  /// Move the incoming ops to the dispatcher queue, oldest first
+  template <class Op>
+  static void TakeIncomingOps(std::atomic<Op*>& incoming,
+                              boost::asio::detail::op_queue<Op>& ops) {
+    auto p_op = incoming.exchange(nullptr, std::memory_order_acquire);
+
+    Op* p_reversed = nullptr;
+    while (p_op) {
+      auto p_next = boost::asio::detail::op_queue_access::next(p_op);
+      boost::asio::detail::op_queue_access::next(p_op, p_reversed);
+      p_reversed = p_op;
+      p_op = p_next;
+    }
+
+    while (p_reversed) {
+      auto p_next = boost::asio::detail::op_queue_access::next(p_reversed);
+      ops.push(p_reversed);
+      p_reversed = p_next;
+    }
+  }
+
+  void ServeOps(State& state) {
+    auto progress = true;
+    while (progress) {
+      progress = false;
+
+      while (!state.push_ops.empty()) {
+        auto op = state.push_ops.front();
+        if (state.ring.size() >= QueueMaxSize ||
+            !state.ring.TryPush(op->element())) {
+          break;
+        }
+        state.push_ops.pop();
+        --state.push_op_count;
+        RemovePendingOp(state);
+        this->get_io_service().post(
+            [op]() { op->complete(boost::system::error_code()); });
+        progress = true;
+      }
+
+      while (!state.get_ops.empty()) {
+        T element;
+        if (!state.ring.TryPop(&element)) {
+          break;
+        }
+        auto op = state.get_ops.front();
+        state.get_ops.pop();
+        --state.get_op_count;
+        RemovePendingOp(state);
+        auto do_complete = [element, op]() mutable {
+          op->complete(boost::system::error_code(), std::move(element));
+        };
+        this->get_io_service().post(do_complete);
+        progress = true;
+      }
+
+      while (!state.push_some_ops.empty()) {
+        auto op = state.push_some_ops.front();
+        while (!op->done() && state.ring.size() < QueueMaxSize &&
+               state.ring.TryPush(op->next_element())) {
+          op->element_pushed();
+          progress = true;
+        }
+        if (!op->done()) {
+          break;
+        }
+        state.push_some_ops.pop();
+        --state.push_op_count;
+        RemovePendingOp(state);
+        this->get_io_service().post(
+            [op]() { op->complete(boost::system::error_code()); });
+      }
+
+      while (state.get_ops.empty() && !state.get_some_ops.empty() &&
+             !state.ring.empty()) {
+        auto op = state.get_some_ops.front();
+        auto p_elements = std::make_shared<Elements>();
+        PopElements(state, op->max_count(), p_elements.get());
+        if (p_elements->empty()) {
+          break;
+        }
+        state.get_some_ops.pop();
+        --state.get_op_count;
+        RemovePendingOp(state);
+        auto do_complete = [p_elements, op]() {
+          op->complete(boost::system::error_code(), std::move(*p_elements));
+        };
+        this->get_io_service().post(do_complete);
+        progress = true;
+      }
+    }
+  }
+
+  /// Canceled handlers are posted like the served ones, none runs inside the
+  /// dispatcher
+  void CancelOps(State& state) {
+    auto valid = state.valid.load();
+
+    while (!state.get_some_ops.empty()) {
+      auto op = state.get_some_ops.front();
+      state.get_some_ops.pop();
+      --state.get_op_count;
+      RemovePendingOp(state);
+      if (valid) {
+        this->get_io_service().post([op]() {
+          op->complete(
+              boost::system::error_code(ssf::error::operation_canceled,
+                                        ssf::error::get_ssf_category()),
+              Elements());
+        });
+      } else {
+        op->destroy();
+      }
+    }
+
+    while (!state.push_some_ops.empty()) {
+      auto op = state.push_some_ops.front();
+      state.push_some_ops.pop();
+      --state.push_op_count;
+      RemovePendingOp(state);
+      if (valid) {
+        this->get_io_service().post([op]() {
+          op->complete(
+              boost::system::error_code(ssf::error::operation_canceled,
+                                        ssf::error::get_ssf_category()));
+        });
+      } else {
+        op->destroy();
+      }
+    }
+
+    while (!state.get_ops.empty()) {
+      auto op = state.get_ops.front();
+      state.get_ops.pop();
+      --state.get_op_count;
+      RemovePendingOp(state);
+      if (valid) {
+        this->get_io_service().post([op]() {
+          op->complete(
+              boost::system::error_code(ssf::error::operation_canceled,
+                                        ssf::error::get_ssf_category()),
+              T());
+        });
+      } else {
+        op->destroy();
+      }
+    }
+
+    while (!state.push_ops.empty()) {
+      auto op = state.push_ops.front();
+      state.push_ops.pop();
+      --state.push_op_count;
+      RemovePendingOp(state);
+      if (valid) {
+        this->get_io_service().post([op]() {
+          op->complete(
+              boost::system::error_code(ssf::error::operation_canceled,
+                                        ssf::error::get_ssf_category()));
+        });
+      } else {
+        op->destroy();
+      }
+    }
+  }
+
+  void shutdown_service() {}
+};
+
+}  // queue
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_QUEUE_LOCKFREE_ASYNC_QUEUE_SERVICE_H_
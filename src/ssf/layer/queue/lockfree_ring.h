@@ -0,0 +1,139 @@
+#ifndef SSF_LAYER_QUEUE_LOCKFREE_RING_H_
+#define SSF_LAYER_QUEUE_LOCKFREE_RING_H_
+
+#include <cstdint>
+
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ssf {
+namespace layer {
+namespace queue {
+
+template <uint32_t N, uint32_t Power = 1, bool Done = (Power >= N)>
+struct NextPowerOfTwo {
+  enum { value = NextPowerOfTwo<N, Power * 2>::value };
+};
+
+template <uint32_t N, uint32_t Power>
+struct NextPowerOfTwo<N, Power, true> {
+  enum { value = Power };
+};
+
+/// Bounded lock-free ring (multiple producers, multiple consumers)
+///   Each cell carries a sequence number telling whether it is ready to be
+///   written or read at a given position (Vyukov bounded queue). Elements
+///   are constructed in place on push and destroyed on pop, so empty cells
+///   own no resource.
+template <class T, uint32_t MinCapacity>
+class basic_lockfree_ring {
+ public:
+  enum { capacity = NextPowerOfTwo<MinCapacity>::value };
+
+ private:
+  enum { mask = capacity - 1 };
+
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    typename std::aligned_storage<sizeof(T),
+                                  std::alignment_of<T>::value>::type storage;
+  };
+
+ public:
+  basic_lockfree_ring()
+      : p_cells_(new Cell[capacity]), enqueue_pos_(0), dequeue_pos_(0) {
+    for (std::size_t i = 0; i < capacity; ++i) {
+      p_cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~basic_lockfree_ring() {
+    T element;
+    while (TryPop(&element)) {
+    }
+    delete[] p_cells_;
+  }
+
+  basic_lockfree_ring(const basic_lockfree_ring&) = delete;
+  basic_lockfree_ring& operator=(const basic_lockfree_ring&) = delete;
+
+  /// Move element into the ring. Element is left untouched if the ring is full
+  bool TryPush(T& element) {
+    Cell* p_cell;
+    auto position = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      p_cell = &p_cells_[position & mask];
+      auto sequence = p_cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(sequence) -
+                  static_cast<intptr_t>(position);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(position, position + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        position = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    new (&p_cell->storage) T(std::move(element));
+    p_cell->sequence.store(position + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  bool TryPop(T* p_element) {
+    Cell* p_cell;
+    auto position = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      p_cell = &p_cells_[position & mask];
+      auto sequence = p_cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(sequence) -
+                  static_cast<intptr_t>(position + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(position, position + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        position = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    auto p_stored = reinterpret_cast<T*>(&p_cell->storage);
+    *p_element = std::move(*p_stored);
+    p_stored->~T();
+    p_cell->sequence.store(position + mask + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  /// Approximate number of elements when producers or consumers are active
+  std::size_t size() const {
+    auto enqueued = enqueue_pos_.load(std::memory_order_acquire);
+    auto dequeued = dequeue_pos_.load(std::memory_order_acquire);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+  }
+
+  bool empty() const { return size() == 0; }
+
+ private:
+  Cell* p_cells_;
+  char pad0_[64];
+  std::atomic<std::size_t> enqueue_pos_;
+  char pad1_[64];
+  std::atomic<std::size_t> dequeue_pos_;
+  char pad2_[64];
+};
+
+}  // queue
+}  // layer
+}  // ssf
+
+#endif  // SSF_LAYER_QUEUE_LOCKFREE_RING_H_
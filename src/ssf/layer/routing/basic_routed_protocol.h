@@ -160,6 +160,28 @@ class basic_RoutedProtocol {
                         typename SendDatagram::Footer());
   }
 
+  /// Copy buffers once in a pooled datagram, handed over to the router
+  template <typename ConstBufferSequence>
+  static ReceiveDatagram make_pooled_datagram(
+      const ConstBufferSequence& buffers, const endpoint& source,
+      const endpoint& destination) {
+    ReceiveDatagram datagram;
+    auto& id = datagram.header().id();
+    id = typename ReceiveDatagram::Header::ID(
+        source.endpoint_context().network_addr,
+        destination.endpoint_context().network_addr);
+    auto& payload_length = datagram.header().payload_length();
+    payload_length =
+        static_cast<typename ReceiveDatagram::Header::PayloadLength>(
+            boost::asio::buffer_size(buffers));
+    datagram.header().Encode();
+
+    datagram.payload().SetSize(payload_length);
+    boost::asio::buffer_copy(datagram.payload().GetMutableBuffers(), buffers);
+
+    return datagram;
+  }
+
   static void StartRouter(const std::string& router_name,
                           boost::asio::io_service& io_service) {
     boost::mutex::scoped_lock lock_router(router_mutex_);
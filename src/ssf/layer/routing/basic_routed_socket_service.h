@@ -276,8 +276,8 @@ class basic_RoutedSocket_service : public boost::asio::detail::service_base<
 
     register_async_op();
     impl.p_socket_context->p_router->async_send(
-        protocol_type::make_datagram(buffers, *impl.p_local_endpoint,
-                                     destination),
+        protocol_type::make_pooled_datagram(buffers, *impl.p_local_endpoint,
+                                            destination),
         [this, init](const boost::system::error_code& ec, std::size_t length) {
           init.handler(ec, length);
           this->unregister_async_op();
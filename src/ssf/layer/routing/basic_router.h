@@ -28,6 +28,7 @@ class basic_Router : public boost::asio::basic_io_object<RouterService> {
   typedef typename RouterService::next_endpoint_type next_endpoint_type;
 
   using SendDatagram = typename RouterService::SendDatagram;
+  using Datagram = typename RouterService::Datagram;
   using SendQueue = typename RouterService::SendQueue;
   using ReceiveQueue = typename RouterService::ReceiveQueue;
 
@@ -79,11 +80,27 @@ class basic_Router : public boost::asio::basic_io_object<RouterService> {
                                          std::move(next_endpoint_context), ec);
   }
 
+  boost::system::error_code add_route(
+      prefix_type prefix, uint8_t prefix_length,
+      network_address_type next_endpoint_context,
+      boost::system::error_code& ec) {
+    return this->get_service().add_route(
+        this->implementation, std::move(prefix), prefix_length,
+        std::move(next_endpoint_context), ec);
+  }
+
   boost::system::error_code remove_route(prefix_type prefix,
                                          boost::system::error_code& ec) {
     return this->get_service().remove_route(this->implementation, prefix, ec);
   }
 
+  boost::system::error_code remove_route(prefix_type prefix,
+                                         uint8_t prefix_length,
+                                         boost::system::error_code& ec) {
+    return this->get_service().remove_route(this->implementation, prefix,
+                                            prefix_length, ec);
+  }
+
   network_address_type resolve(const prefix_type& prefix,
                                boost::system::error_code& ec) const {
     return this->get_service().resolve(this->implementation, prefix, ec);
@@ -105,6 +122,16 @@ class basic_Router : public boost::asio::basic_io_object<RouterService> {
                                           std::forward<Handler>(handler));
   }
 
+  /// Zero-copy send : the router takes ownership of the pooled datagram
+  template <class Handler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(Handler, void(const boost::system::error_code&,
+                                              std::size_t))
+      async_send(Datagram&& datagram, Handler handler) {
+    return this->get_service().async_send(this->implementation,
+                                          std::move(datagram),
+                                          std::forward<Handler>(handler));
+  }
+
   boost::system::error_code flush(boost::system::error_code& ec) {
     return this->get_service().flush(this->implementation, ec);
   }
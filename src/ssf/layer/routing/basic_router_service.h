@@ -6,6 +6,7 @@
 #include <queue>
 
 #include <boost/asio/async_result.hpp>
+#include <boost/asio/buffer.hpp>
 #include <boost/asio/handler_type.hpp>
 #include <boost/asio/io_service.hpp>
 
@@ -63,6 +64,12 @@ class basic_Router_service
   using ReceiveQueue = queue::basic_async_queue<Datagram>;
   using SendQueue = queue::basic_async_queue<Datagram>;
 
+  /// Maximum number of datagrams commuted from the send queue per handler
+  enum { send_batch_size = 64 };
+
+  static_assert(Datagram::Footer::size == 0,
+                "Datagrams are framed in their payload block");
+
  public:
   struct implementation_type {
     std::shared_ptr<bool> p_valid;
@@ -114,14 +121,14 @@ class basic_Router_service
     impl.local_send_buffer.resize(next_layer_protocol::mtu);
 
     auto send_callback =
-        [this, &impl](typename Commutator::InputHandler handler) {
+        [this, &impl](typename Commutator::BatchInputHandler handler) {
           this->AsyncSend(impl, std::move(handler));
         };
 
     /// Register local input : local send
-    /// Get from send local queue
-    /// Push element to destination output
-    impl.p_commutator->RegisterInput(0, std::move(send_callback));
+    /// Get batches from send local queue
+    /// Push elements to destination output
+    impl.p_commutator->RegisterBatchInput(0, std::move(send_callback));
   }
 
   void destroy(implementation_type& impl) {
@@ -219,12 +226,15 @@ class basic_Router_service
       auto output_callback = [p_queued_send_socket](
           typename Commutator::Element datagram,
           typename Commutator::OutputHandler handler) {
-        auto p_datagram = std::make_shared<Datagram>(std::move(datagram));
+        // Header encoded in the headroom of the pooled block, the handler
+        // keeps the block alive until the frame is written
+        auto frame = datagram.payload().Frame(datagram.header());
+        auto payload = std::move(datagram.payload());
 
-        auto complete_handler = [p_datagram, handler, p_queued_send_socket](
+        auto complete_handler = [payload, handler, p_queued_send_socket](
             const boost::system::error_code& ec, std::size_t) { handler(ec); };
 
-        AsyncSendDatagram(*p_queued_send_socket, *p_datagram,
+        AsyncSendDatagram(*p_queued_send_socket, FramedDatagram(frame),
                           std::move(complete_handler));
       };
 
@@ -344,12 +354,28 @@ class basic_Router_service
                                        std::move(next_endpoint_context), ec);
   }
 
+  /// Route every address sharing the prefix_length first bits of prefix
+  boost::system::error_code add_route(
+      implementation_type& impl, prefix_type prefix, uint8_t prefix_length,
+      network_address_type next_endpoint_context,
+      boost::system::error_code& ec) {
+    return impl.routing_table.AddRoute(std::move(prefix), prefix_length,
+                                       std::move(next_endpoint_context), ec);
+  }
+
   boost::system::error_code remove_route(implementation_type& impl,
                                          prefix_type prefix,
                                          boost::system::error_code& ec) {
     return impl.routing_table.RemoveRoute(prefix, ec);
   }
 
+  boost::system::error_code remove_route(implementation_type& impl,
+                                         prefix_type prefix,
+                                         uint8_t prefix_length,
+                                         boost::system::error_code& ec) {
+    return impl.routing_table.RemoveRoute(prefix, prefix_length, ec);
+  }
+
   network_address_type resolve(const implementation_type& impl,
                                const prefix_type& prefix,
                                boost::system::error_code& ec) const {
@@ -380,35 +406,48 @@ class basic_Router_service
   }
 
   /// Async send packet
-  /// Push packet in the local snd queue
+  /// Copy the packet in a pooled datagram and push it in the local snd queue
   template <class Handler>
   BOOST_ASIO_INITFN_RESULT_TYPE(Handler, void(const boost::system::error_code&,
                                               std::size_t))
       async_send(implementation_type& impl, const SendDatagram& datagram,
                  Handler&& handler) {
+    Datagram copied_datagram;
+
+    copied_datagram.header() = datagram.header();
+    copied_datagram.payload().SetSize(datagram.header().payload_length());
+    boost::asio::buffer_copy(copied_datagram.payload().GetMutableBuffers(),
+                             datagram.payload().GetConstBuffers());
+
+    return async_send(impl, std::move(copied_datagram),
+                      std::forward<Handler>(handler));
+  }
+
+  /// Async send packet without copy
+  /// The pooled datagram is moved in the local snd queue then written
+  /// by the selected network socket from its own block
+  template <class Handler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(Handler, void(const boost::system::error_code&,
+                                              std::size_t))
+      async_send(implementation_type& impl, Datagram&& datagram,
+                 Handler&& handler) {
     boost::asio::detail::async_result_init<
         Handler, void(const boost::system::error_code&, std::size_t)>
         init(std::forward<Handler>(handler));
 
-    Datagram copied_datagram;
-
-    auto& payload_length = copied_datagram.header().payload_length();
-    payload_length = datagram.header().payload_length();
-
-    copied_datagram.payload().SetSize(payload_length);
-    auto copied = boost::asio::buffer_copy(copied_datagram.GetMutableBuffers(),
-                                           datagram.GetConstBuffers());
+    std::size_t length = Datagram::Header::size +
+                         datagram.payload().GetSize() + Datagram::Footer::size;
 
     auto push_handler =
-        [this, copied, init](const boost::system::error_code ec) {
+        [this, length, init](const boost::system::error_code ec) {
           if (ec) {
             io::PostHandler(this->get_io_service(), init.handler, ec, 0);
           } else {
-            io::PostHandler(this->get_io_service(), init.handler, ec, copied);
+            io::PostHandler(this->get_io_service(), init.handler, ec, length);
           }
         };
 
-    impl.p_send_queue->async_push(std::move(copied_datagram), push_handler);
+    impl.p_send_queue->async_push(std::move(datagram), push_handler);
 
     return init.result.get();
   }
@@ -441,12 +480,24 @@ class basic_Router_service
     return ec;
   }
 
+ private:
+  /// Header and payload sent as one contiguous buffer
+  struct FramedDatagram {
+    explicit FramedDatagram(boost::asio::const_buffer frame) : frame(frame) {}
+
+    boost::asio::const_buffers_1 GetConstBuffers() const {
+      return boost::asio::const_buffers_1(frame);
+    }
+
+    boost::asio::const_buffer frame;
+  };
+
  private:
   void shutdown_service() {}
 
   void AsyncSend(implementation_type& impl,
-                 typename Commutator::InputHandler handler) {
-    impl.p_send_queue->async_get(std::move(handler));
+                 typename Commutator::BatchInputHandler handler) {
+    impl.p_send_queue->async_get_some(send_batch_size, std::move(handler));
   }
 
   /// A packet is received locally
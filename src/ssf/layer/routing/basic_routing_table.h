@@ -4,6 +4,10 @@
 #include <cstdint>
 
 #include <map>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <boost/log/trivial.hpp>
 #include <boost/system/error_code.hpp>
@@ -15,6 +19,11 @@ namespace ssf {
 namespace layer {
 namespace routing {
 
+/// Longest prefix match routing table over the network address space
+///   Routes are (prefix, prefix length) pairs, a prefix length of 0 being the
+///   default route. Lookups read an immutable direct index snapshot (one
+///   entry per address) loaded atomically, writers build and publish a new
+///   snapshot under the table mutex
 template <class NetworkProtocol>
 class basic_RoutingTable {
  private:
@@ -22,73 +31,187 @@ class basic_RoutingTable {
   typedef network_address_type prefix_type;
 
  public:
+  enum { address_bits = sizeof(network_address_type) * 8 };
+  enum { table_size = 1 << address_bits };
+
+  static_assert(std::is_unsigned<network_address_type>::value &&
+                    address_bits <= 16,
+                "Direct index table needs a small unsigned address type");
+
+ private:
+  enum { no_route = 0xFF };
+
+  struct Entry {
+    network_address_type next_hop;
+    uint8_t prefix_length;
+  };
+
+  typedef std::vector<Entry> Snapshot;
+  typedef std::shared_ptr<const Snapshot> SnapshotPtr;
+
+  /// Routes ordered by prefix length then prefix
+  typedef std::map<std::pair<uint8_t, prefix_type>, network_address_type>
+      RouteMap;
+
+ public:
+  basic_RoutingTable()
+      : mutex_(), routes_(), p_snapshot_(MakeEmptySnapshot()) {}
+
+  /// Add a host route (full length prefix)
   boost::system::error_code AddRoute(
       prefix_type prefix, network_address_type network_endpoint_context,
       boost::system::error_code& ec) {
+    return AddRoute(std::move(prefix), address_bits,
+                    std::move(network_endpoint_context), ec);
+  }
+
+  boost::system::error_code AddRoute(
+      prefix_type prefix, uint8_t prefix_length,
+      network_address_type network_endpoint_context,
+      boost::system::error_code& ec) {
+    if (prefix_length > address_bits) {
+      ec.assign(ssf::error::invalid_argument, ssf::error::get_ssf_category());
+      return ec;
+    }
+
     boost::recursive_mutex::scoped_lock lock(mutex_);
 
     BOOST_LOG_TRIVIAL(trace) << " * Routing table : add route from " << prefix
+                             << "/" << static_cast<uint32_t>(prefix_length)
                              << " to " << network_endpoint_context;
 
-    auto inserted = table_.insert(
-        std::make_pair(std::move(prefix), std::move(network_endpoint_context)));
+    prefix = Mask(prefix, prefix_length);
 
-    if (!inserted.second) {
-      ec.assign(ssf::error::address_in_use, ssf::error::get_ssf_category());
+    auto inserted = routes_.insert(std::make_pair(
+        std::make_pair(prefix_length, prefix), network_endpoint_context));
+
+    if (inserted.second) {
+      // Longer prefixes already in the range keep their entries
+      auto p_snapshot = std::make_shared<Snapshot>(*LoadSnapshot());
+      Fill(p_snapshot.get(), prefix, prefix_length, network_endpoint_context);
+      Publish(std::move(p_snapshot));
     }
 
     ec.assign(ssf::error::success, ssf::error::get_ssf_category());
     return ec;
   }
 
+  /// Remove a host route (full length prefix)
   boost::system::error_code RemoveRoute(const prefix_type& prefix,
                                         boost::system::error_code& ec) {
+    return RemoveRoute(prefix, address_bits, ec);
+  }
+
+  boost::system::error_code RemoveRoute(const prefix_type& prefix,
+                                        uint8_t prefix_length,
+                                        boost::system::error_code& ec) {
+    if (prefix_length > address_bits) {
+      ec.assign(ssf::error::invalid_argument, ssf::error::get_ssf_category());
+      return ec;
+    }
+
     boost::recursive_mutex::scoped_lock lock(mutex_);
 
-    auto erased = table_.erase(prefix);
+    auto erased = routes_.erase(
+        std::make_pair(prefix_length, Mask(prefix, prefix_length)));
 
     if (!erased) {
       ec.assign(ssf::error::not_connected, ssf::error::get_ssf_category());
-    } else {
-      ec.assign(ssf::error::success, ssf::error::get_ssf_category());
+      return ec;
     }
 
+    Publish(BuildSnapshot());
+
+    ec.assign(ssf::error::success, ssf::error::get_ssf_category());
     return ec;
   }
 
-  /// Resolve a network id and return the associated endpoint
+  /// Resolve a network id and return the endpoint of its longest prefix route
   network_address_type Resolve(const prefix_type& prefix,
                                boost::system::error_code& ec) const {
-    boost::recursive_mutex::scoped_lock lock(mutex_);
-
-    auto network_endpoint_context_it = table_.find(prefix);
+    auto p_snapshot = LoadSnapshot();
+    const auto& entry = (*p_snapshot)[prefix];
 
-    if (network_endpoint_context_it == std::end(table_)) {
+    if (entry.prefix_length == no_route) {
       ec.assign(ssf::error::not_connected, ssf::error::get_ssf_category());
       return network_address_type();
     }
 
     ec.assign(ssf::error::success, ssf::error::get_ssf_category());
-    return network_endpoint_context_it->second;
+    return entry.next_hop;
   }
 
   /// Clear the routing table
   boost::system::error_code Flush(boost::system::error_code& ec) {
     boost::recursive_mutex::scoped_lock lock(mutex_);
 
-    table_.clear();
+    routes_.clear();
+    Publish(MakeEmptySnapshot());
 
     ec.assign(ssf::error::success, ssf::error::get_ssf_category());
     return ec;
   }
 
+ private:
+  static prefix_type Mask(prefix_type prefix, uint8_t prefix_length) {
+    if (prefix_length == 0) {
+      return prefix_type();
+    }
+
+    uint32_t mask = ((table_size - 1) << (address_bits - prefix_length)) &
+                    (table_size - 1);
+
+    return static_cast<prefix_type>(prefix & mask);
+  }
+
+  static std::shared_ptr<Snapshot> MakeEmptySnapshot() {
+    Entry empty_entry = {network_address_type(), no_route};
+
+    return std::make_shared<Snapshot>(table_size, empty_entry);
+  }
+
+  /// Set the entries covered by prefix unless a longer prefix owns them
+  static void Fill(Snapshot* p_snapshot, prefix_type prefix,
+                   uint8_t prefix_length, network_address_type next_hop) {
+    uint32_t first = prefix;
+    uint32_t last = first + (1 << (address_bits - prefix_length));
+
+    for (auto i = first; i < last; ++i) {
+      auto& entry = (*p_snapshot)[i];
+      if (entry.prefix_length == no_route ||
+          entry.prefix_length <= prefix_length) {
+        entry.next_hop = next_hop;
+        entry.prefix_length = prefix_length;
+      }
+    }
+  }
+
+  /// Rebuild the whole snapshot, shortest prefixes first
+  std::shared_ptr<Snapshot> BuildSnapshot() const {
+    auto p_snapshot = MakeEmptySnapshot();
+
+    for (const auto& route : routes_) {
+      Fill(p_snapshot.get(), route.first.second, route.first.first,
+           route.second);
+    }
+
+    return p_snapshot;
+  }
+
+  SnapshotPtr LoadSnapshot() const { return std::atomic_load(&p_snapshot_); }
+
+  void Publish(SnapshotPtr p_snapshot) {
+    std::atomic_store(&p_snapshot_, std::move(p_snapshot));
+  }
+
  private:
   mutable boost::recursive_mutex mutex_;
-  std::map<prefix_type, network_address_type> table_;
+  RouteMap routes_;
+  SnapshotPtr p_snapshot_;
 };
 
 }  // routing
 }  // layer
 }  // ssf
 
-#endif  // SSF_LAYER_ROUTING_BASIC_ROUTING_TABLE_H_
\ No newline at end of file
+#endif  // SSF_LAYER_ROUTING_BASIC_ROUTING_TABLE_H_
@@ -1,5 +1,6 @@
 #include "ssf/system/system_routers.h"
 
+#include <cctype>
 #include <cstdint>
 
 #include <map>
@@ -196,8 +197,13 @@ void SystemRouters::AddRoutesFromPropertyTree(SystemRouters::Router* p_router,
                                               const PropertyTree& routes_pt,
                                               boost::system::error_code& ec) {
   for (auto& route_pt : routes_pt) {
+    // Route key is either a network id or a prefix ("id/prefix_length")
+    const auto& from = route_pt.first;
+    auto prefix_separator = from.find('/');
+
     network_address_type from_network_id =
-        RoutedProtocol::ResolveToNetworkAddress(route_pt.first.c_str(), ec);
+        RoutedProtocol::ResolveToNetworkAddress(
+            from.substr(0, prefix_separator), ec);
 
     network_address_type to_network_id =
         RoutedProtocol::ResolveToNetworkAddress(route_pt.second.data().c_str(),
@@ -205,7 +211,29 @@ void SystemRouters::AddRoutesFromPropertyTree(SystemRouters::Router* p_router,
     if (ec) {
       return;
     }
-    p_router->add_route(from_network_id, to_network_id, ec);
+
+    if (prefix_separator == std::string::npos) {
+      p_router->add_route(from_network_id, to_network_id, ec);
+    } else {
+      // Prefix length is a decimal integer no longer than the address
+      auto prefix_length_str = from.substr(prefix_separator + 1);
+      std::size_t parsed_length = 0;
+      unsigned long prefix_length = 0;
+      try {
+        prefix_length = std::stoul(prefix_length_str, &parsed_length);
+      } catch (...) {
+        parsed_length = 0;
+      }
+      if (parsed_length == 0 || parsed_length != prefix_length_str.size() ||
+          !std::isdigit(static_cast<unsigned char>(prefix_length_str[0])) ||
+          prefix_length > sizeof(network_address_type) * 8) {
+        ec.assign(ssf::error::invalid_argument, ssf::error::get_ssf_category());
+        return;
+      }
+      p_router->add_route(from_network_id,
+                          static_cast<uint8_t>(prefix_length), to_network_id,
+                          ec);
+    }
     if (ec) {
       return;
     }
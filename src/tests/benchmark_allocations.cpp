@@ -0,0 +1,17 @@
+#include <cstdlib>
+
+#include <new>
+
+#include "tests/benchmark_allocations.h"
+
+/// Count allocations of the benchmark executables
+void* operator new(std::size_t size) {
+  ++tests::benchmark_helpers::AllocationCount();
+  void* p = std::malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) throw() { std::free(p); }
@@ -0,0 +1,21 @@
+#ifndef SSF_TESTS_BENCHMARK_ALLOCATIONS_H_
+#define SSF_TESTS_BENCHMARK_ALLOCATIONS_H_
+
+#include <cstdint>
+
+#include <atomic>
+
+namespace tests {
+namespace benchmark_helpers {
+
+/// Number of operator new calls, counted by the benchmark executables
+///   (benchmark_allocations.cpp)
+inline std::atomic<uint64_t>& AllocationCount() {
+  static std::atomic<uint64_t> allocation_count(0);
+  return allocation_count;
+}
+
+}  // benchmark_helpers
+}  // tests
+
+#endif  // SSF_TESTS_BENCHMARK_ALLOCATIONS_H_
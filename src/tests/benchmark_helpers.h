@@ -0,0 +1,746 @@
+#ifndef SSF_TESTS_BENCHMARK_HELPERS_H_
+#define SSF_TESTS_BENCHMARK_HELPERS_H_
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/socket_base.hpp>
+#include <boost/asio/write.hpp>
+
+#include <boost/chrono/process_cpu_clocks.hpp>
+
+#include <boost/system/error_code.hpp>
+#include <boost/thread.hpp>
+
+#include "ssf/layer/parameters.h"
+
+#include "tests/benchmark_allocations.h"
+#include "tests/virtual_network_helpers.h"
+
+namespace tests {
+namespace benchmark_helpers {
+
+inline uint64_t Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::high_resolution_clock::now().time_since_epoch())
+      .count();
+}
+
+/// Packets (or other units of work), bytes and latencies of one benchmark run
+class BenchmarkResult {
+ public:
+  BenchmarkResult(std::string name, uint64_t packets,
+                  std::string unit = "packet")
+      : name_(std::move(name)),
+        unit_(std::move(unit)),
+        mutex_(),
+        latencies_(),
+        bytes_(0),
+        start_time_(0),
+        stop_time_(0),
+        start_allocations_(0),
+        stop_allocations_(0) {
+    latencies_.reserve(static_cast<std::size_t>(packets));
+  }
+
+  void Start() {
+    start_allocations_ = AllocationCount().load();
+    start_time_ = Now();
+  }
+
+  void Stop() {
+    stop_time_ = Now();
+    stop_allocations_ = AllocationCount().load();
+  }
+
+  /// Record a packet of length bytes sent at send_time
+  void AddPacket(uint64_t send_time, std::size_t length) {
+    auto latency = Now() - send_time;
+
+    boost::mutex::scoped_lock lock(mutex_);
+    latencies_.push_back(latency);
+    bytes_ += length;
+  }
+
+  uint64_t packets() const {
+    boost::mutex::scoped_lock lock(mutex_);
+    return latencies_.size();
+  }
+
+  void Print() const {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    auto packets = latencies_.size();
+    auto seconds = (stop_time_ - start_time_) / 1e9;
+    auto allocations = stop_allocations_ - start_allocations_;
+
+    std::cout << "[ BENCHMARK] " << name_ << std::fixed
+              << std::setprecision(2) << ": " << packets << " " << unit_
+              << "s, " << packets / seconds << " " << unit_ << "s/s, "
+              << bytes_ / seconds / 1024 / 1024 << " MB/s, p50 "
+              << Percentile(50) / 1e3 << " us, p99 " << Percentile(99) / 1e3
+              << " us, "
+              << (packets ? static_cast<double>(allocations) / packets : 0)
+              << " allocations/" << unit_ << std::endl;
+  }
+
+ private:
+  uint64_t Percentile(uint32_t percent) const {
+    if (latencies_.empty()) {
+      return 0;
+    }
+
+    auto sorted = latencies_;
+    auto rank = (sorted.size() - 1) * percent / 100;
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+
+    return sorted[rank];
+  }
+
+ private:
+  std::string name_;
+  std::string unit_;
+  mutable boost::mutex mutex_;
+  std::vector<uint64_t> latencies_;
+  uint64_t bytes_;
+  uint64_t start_time_;
+  uint64_t stop_time_;
+  uint64_t start_allocations_;
+  uint64_t stop_allocations_;
+};
+
+/// CPU time used by the process (user and system), in nanoseconds
+inline uint64_t CpuNow() {
+  auto user = boost::chrono::process_user_cpu_clock::now().time_since_epoch();
+  auto system =
+      boost::chrono::process_system_cpu_clock::now().time_since_epoch();
+
+  return boost::chrono::duration_cast<boost::chrono::nanoseconds>(user)
+             .count() +
+         boost::chrono::duration_cast<boost::chrono::nanoseconds>(system)
+             .count();
+}
+
+inline void RunThreads(boost::asio::io_service& io_service) {
+  boost::thread_group threads;
+  for (uint16_t i = 1; i <= boost::thread::hardware_concurrency(); ++i) {
+    threads.create_thread([&io_service]() { io_service.run(); });
+  }
+  threads.join_all();
+}
+
+/// Push timestamps in a queue while getting them from the other end
+template <class Queue>
+void BenchmarkQueue(const std::string& name, uint64_t packets) {
+  boost::asio::io_service io_service;
+  Queue queue(io_service);
+  BenchmarkResult result(name, packets);
+
+  uint64_t pushed = 0;
+  uint64_t got = 0;
+
+  std::function<void(const boost::system::error_code&)> pushed_handler;
+  std::function<void(const boost::system::error_code&, uint64_t)> got_handler;
+
+  pushed_handler = [&](const boost::system::error_code& ec) {
+    ASSERT_EQ(0, ec.value()) << "Push should not be in error: " << ec.message();
+    if (++pushed < packets) {
+      queue.async_push(Now(), pushed_handler);
+    }
+  };
+
+  got_handler = [&](const boost::system::error_code& ec, uint64_t send_time) {
+    ASSERT_EQ(0, ec.value()) << "Get should not be in error: " << ec.message();
+    result.AddPacket(send_time, sizeof(send_time));
+    if (++got < packets) {
+      queue.async_get(got_handler);
+    } else {
+      result.Stop();
+    }
+  };
+
+  result.Start();
+  queue.async_get(got_handler);
+  queue.async_push(Now(), pushed_handler);
+
+  RunThreads(io_service);
+
+  boost::system::error_code ec;
+  queue.close(ec);
+
+  ASSERT_EQ(packets, result.packets());
+  result.Print();
+}
+
+/// Push elements from several threads and get them on several io_service
+/// threads, one by one (batch_size 0) or by batches of batch_size. Print
+/// elements per second
+template <class Queue>
+void BenchmarkQueueThroughput(const std::string& name, uint32_t nb_of_pushers,
+                              uint64_t nb_of_pushes, std::size_t batch_size) {
+  boost::asio::io_service io_service;
+  Queue queue(io_service);
+
+  uint64_t total = nb_of_pushers * nb_of_pushes;
+  std::atomic<uint64_t> received(0);
+  std::atomic<uint64_t> sum(0);
+
+  std::function<void(const boost::system::error_code&, uint64_t)> got;
+  std::function<void(const boost::system::error_code&,
+                     typename Queue::elements_type)> got_some;
+  got = [&](const boost::system::error_code& ec, uint64_t element) {
+    if (ec) {
+      return;
+    }
+    sum += element;
+    if (++received < total) {
+      queue.async_get(got);
+    }
+  };
+  got_some = [&](const boost::system::error_code& ec,
+                 typename Queue::elements_type elements) {
+    if (ec) {
+      return;
+    }
+    for (auto element : elements) {
+      sum += element;
+    }
+    received += elements.size();
+    if (received < total) {
+      queue.async_get_some(batch_size, got_some);
+    }
+  };
+
+  auto start = Now();
+  if (batch_size) {
+    queue.async_get_some(batch_size, got_some);
+  } else {
+    queue.async_get(got);
+  }
+
+  boost::thread_group pushers;
+  for (uint32_t i = 0; i < nb_of_pushers; ++i) {
+    pushers.create_thread([&]() {
+      boost::system::error_code ec;
+      for (uint64_t element = 1; element <= nb_of_pushes;) {
+        queue.push(element, ec);
+        if (!ec) {
+          ++element;
+        } else {
+          boost::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  RunThreads(io_service);
+  pushers.join_all();
+  auto duration = static_cast<double>(Now() - start) / 1e9;
+
+  ASSERT_EQ(total, received.load());
+  ASSERT_EQ(nb_of_pushers * nb_of_pushes * (nb_of_pushes + 1) / 2,
+            sum.load());
+
+  std::cout << "    " << name << ": " << total / duration << " elements/s"
+            << std::endl;
+}
+
+/// Send mtu sized datagrams from socket1 to socket2, one datagram in flight
+///   Datagram layers may drop, waiting for each datagram keeps the run
+///   lossless and reproducible
+template <class DatagramProtocol>
+void BenchmarkDatagramProtocol(const std::string& name,
+                               ssf::layer::ParameterStack socket1_parameters,
+                               ssf::layer::ParameterStack socket2_parameters,
+                               uint64_t packets) {
+  using Buffer = std::vector<uint8_t>;
+
+  boost::asio::io_service io_service;
+  boost::system::error_code ec;
+  BenchmarkResult result(name, packets);
+
+  Buffer buffer1(DatagramProtocol::mtu);
+  Buffer r_buffer2(DatagramProtocol::mtu);
+  tests::virtual_network_helpers::ResetBuffer(&buffer1, 1);
+
+  typename DatagramProtocol::socket socket1(io_service);
+  typename DatagramProtocol::socket socket2(io_service);
+  typename DatagramProtocol::resolver resolver(io_service);
+
+  auto socket1_endpoint_it = resolver.resolve(socket1_parameters, ec);
+  ASSERT_EQ(0, ec.value()) << "Resolving should not be in error: "
+                           << ec.message();
+  typename DatagramProtocol::endpoint socket1_endpoint(*socket1_endpoint_it);
+
+  auto socket2_endpoint_it = resolver.resolve(socket2_parameters, ec);
+  ASSERT_EQ(0, ec.value()) << "Resolving should not be in error: "
+                           << ec.message();
+  typename DatagramProtocol::endpoint socket2_endpoint(*socket2_endpoint_it);
+  typename DatagramProtocol::endpoint socket2_r_endpoint;
+
+  std::promise<bool> finished;
+  std::atomic<bool> done(false);
+  auto finish = [&](bool success) {
+    if (!done.exchange(true)) {
+      result.Stop();
+      finished.set_value(success);
+    }
+  };
+
+  uint64_t send_time = 0;
+
+  tests::virtual_network_helpers::SendHandler sent_handler1;
+  tests::virtual_network_helpers::ReceiveHandler received_handler2;
+
+  sent_handler1 = [&](const boost::system::error_code& ec, std::size_t) {
+    if (ec && !done.load()) {
+      ADD_FAILURE() << "Send should not be in error: " << ec.message();
+      finish(false);
+    }
+  };
+
+  received_handler2 = [&](const boost::system::error_code& ec,
+                          std::size_t length) {
+    EXPECT_EQ(0, ec.value()) << "Receive should not be in error: "
+                             << ec.message();
+    if (ec) {
+      finish(false);
+      return;
+    }
+
+    result.AddPacket(send_time, length);
+
+    if (result.packets() == packets) {
+      finish(true);
+      return;
+    }
+
+    socket2.async_receive_from(boost::asio::buffer(r_buffer2),
+                               socket2_r_endpoint, received_handler2);
+    send_time = Now();
+    socket1.async_send_to(boost::asio::buffer(buffer1), socket2_endpoint,
+                          sent_handler1);
+  };
+
+  socket1.open();
+  socket1.bind(socket1_endpoint, ec);
+  ASSERT_EQ(0, ec.value()) << "Bind socket1 should not be in error: "
+                           << ec.message();
+  socket2.open();
+  socket2.bind(socket2_endpoint, ec);
+  ASSERT_EQ(0, ec.value()) << "Bind socket2 should not be in error: "
+                           << ec.message();
+
+  socket2.async_receive_from(boost::asio::buffer(r_buffer2), socket2_r_endpoint,
+                             received_handler2);
+  result.Start();
+  send_time = Now();
+  socket1.async_send_to(boost::asio::buffer(buffer1), socket2_endpoint,
+                        sent_handler1);
+
+  boost::thread_group threads;
+  for (uint16_t i = 1; i <= boost::thread::hardware_concurrency(); ++i) {
+    threads.create_thread([&io_service]() { io_service.run(); });
+  }
+
+  auto success = finished.get_future().get();
+
+  socket1.close(ec);
+  socket2.close(ec);
+
+  threads.join_all();
+
+  ASSERT_TRUE(success);
+  result.Print();
+}
+
+/// Write packet_size frames on a connected stream and read them on the
+/// accepted side, several frames in flight
+///   The first bytes of each frame carry its index, latency runs from the
+///   write call to the complete read of the frame
+template <class StreamProtocol>
+void BenchmarkStreamProtocol(
+    const std::string& name,
+    typename StreamProtocol::resolver::query client_parameters,
+    typename StreamProtocol::resolver::query acceptor_parameters,
+    uint64_t packets, std::size_t packet_size) {
+  using Buffer = std::vector<uint8_t>;
+
+  ASSERT_LE(sizeof(uint64_t), packet_size);
+
+  boost::asio::io_service io_service;
+  boost::system::error_code ec;
+  BenchmarkResult result(name, packets);
+
+  Buffer buffer1(packet_size);
+  Buffer r_buffer2(packet_size);
+  tests::virtual_network_helpers::ResetBuffer(&buffer1, 1);
+  std::vector<std::atomic<uint64_t>> send_times(
+      static_cast<std::size_t>(packets));
+
+  typename StreamProtocol::socket socket1(io_service);
+  typename StreamProtocol::socket socket2(io_service);
+  typename StreamProtocol::acceptor acceptor(io_service);
+  typename StreamProtocol::resolver resolver(io_service);
+
+  auto acceptor_endpoint_it = resolver.resolve(acceptor_parameters, ec);
+  ASSERT_EQ(0, ec.value())
+      << "Resolving acceptor endpoint should not be in error: "
+      << ec.message();
+  typename StreamProtocol::endpoint acceptor_endpoint(*acceptor_endpoint_it);
+
+  auto remote_endpoint_it = resolver.resolve(client_parameters, ec);
+  ASSERT_EQ(0, ec.value())
+      << "Resolving remote endpoint should not be in error: " << ec.message();
+  typename StreamProtocol::endpoint remote_endpoint(*remote_endpoint_it);
+
+  uint64_t sent = 0;
+
+  tests::virtual_network_helpers::AcceptHandler accepted;
+  tests::virtual_network_helpers::ConnectHandler connected;
+  tests::virtual_network_helpers::SendHandler sent_handler1;
+  tests::virtual_network_helpers::ReceiveHandler received_handler2;
+
+  auto send_next = [&]() {
+    std::memcpy(buffer1.data(), &sent, sizeof(sent));
+    send_times[static_cast<std::size_t>(sent)] = Now();
+    boost::asio::async_write(socket1, boost::asio::buffer(buffer1),
+                             sent_handler1);
+  };
+
+  auto close = [&]() {
+    boost::system::error_code close_ec;
+    socket1.close(close_ec);
+    socket2.close(close_ec);
+    acceptor.close(close_ec);
+  };
+
+  connected = [&](const boost::system::error_code& ec) {
+    EXPECT_EQ(0, ec.value()) << "Connect should not be in error: "
+                             << ec.message();
+    if (ec) {
+      close();
+      return;
+    }
+
+    result.Start();
+    send_next();
+  };
+
+  sent_handler1 = [&](const boost::system::error_code& ec, std::size_t) {
+    if (ec) {
+      return;
+    }
+
+    if (++sent < packets) {
+      send_next();
+    }
+  };
+
+  accepted = [&](const boost::system::error_code& ec) {
+    EXPECT_EQ(0, ec.value()) << "Accept should not be in error: "
+                             << ec.message();
+    if (ec) {
+      close();
+      return;
+    }
+
+    boost::asio::async_read(socket2, boost::asio::buffer(r_buffer2),
+                            received_handler2);
+  };
+
+  received_handler2 = [&](const boost::system::error_code& ec,
+                          std::size_t length) {
+    EXPECT_EQ(0, ec.value()) << "Receive should not be in error: "
+                             << ec.message();
+    if (ec) {
+      close();
+      return;
+    }
+
+    uint64_t index = 0;
+    std::memcpy(&index, r_buffer2.data(), sizeof(index));
+    result.AddPacket(send_times[static_cast<std::size_t>(index)], length);
+
+    if (result.packets() < packets) {
+      boost::asio::async_read(socket2, boost::asio::buffer(r_buffer2),
+                              received_handler2);
+    } else {
+      result.Stop();
+      close();
+    }
+  };
+
+  acceptor.open();
+  acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+  acceptor.bind(acceptor_endpoint, ec);
+  ASSERT_EQ(0, ec.value()) << "Bind acceptor should not be in error: "
+                           << ec.message();
+  acceptor.listen(100, ec);
+  ASSERT_EQ(0, ec.value()) << "Listen acceptor should not be in error: "
+                           << ec.message();
+
+  acceptor.async_accept(socket2, accepted);
+  socket1.async_connect(remote_endpoint, connected);
+
+  RunThreads(io_service);
+
+  ASSERT_EQ(packets, result.packets());
+  result.Print();
+}
+
+/// Write bytes in write_size chunks on a connected stream and read them on
+/// the accepted side
+///   Both ends run in this process, the rate per core is the transferred
+///   bits over the process CPU time (sending, receiving and transport)
+template <class StreamProtocol>
+void BenchmarkBulkTransfer(
+    const std::string& name,
+    typename StreamProtocol::resolver::query client_parameters,
+    typename StreamProtocol::resolver::query acceptor_parameters,
+    uint64_t bytes, std::size_t write_size) {
+  using Buffer = std::vector<uint8_t>;
+
+  boost::asio::io_service io_service;
+  boost::system::error_code ec;
+
+  Buffer buffer1(write_size);
+  Buffer r_buffer2(write_size);
+  tests::virtual_network_helpers::ResetBuffer(&buffer1, 1);
+
+  typename StreamProtocol::socket socket1(io_service);
+  typename StreamProtocol::socket socket2(io_service);
+  typename StreamProtocol::acceptor acceptor(io_service);
+  typename StreamProtocol::resolver resolver(io_service);
+
+  auto acceptor_endpoint_it = resolver.resolve(acceptor_parameters, ec);
+  ASSERT_EQ(0, ec.value())
+      << "Resolving acceptor endpoint should not be in error: "
+      << ec.message();
+  typename StreamProtocol::endpoint acceptor_endpoint(*acceptor_endpoint_it);
+
+  auto remote_endpoint_it = resolver.resolve(client_parameters, ec);
+  ASSERT_EQ(0, ec.value())
+      << "Resolving remote endpoint should not be in error: " << ec.message();
+  typename StreamProtocol::endpoint remote_endpoint(*remote_endpoint_it);
+
+  uint64_t sent = 0;
+  uint64_t received = 0;
+  uint64_t start_time = 0;
+  uint64_t stop_time = 0;
+  uint64_t start_cpu = 0;
+  uint64_t stop_cpu = 0;
+
+  tests::virtual_network_helpers::AcceptHandler accepted;
+  tests::virtual_network_helpers::ConnectHandler connected;
+  tests::virtual_network_helpers::SendHandler sent_handler1;
+  tests::virtual_network_helpers::ReceiveHandler received_handler2;
+
+  auto send_next = [&]() {
+    auto length = static_cast<std::size_t>(
+        std::min<uint64_t>(write_size, bytes - sent));
+    boost::asio::async_write(socket1, boost::asio::buffer(buffer1, length),
+                             sent_handler1);
+  };
+
+  auto close = [&]() {
+    boost::system::error_code close_ec;
+    socket1.close(close_ec);
+    socket2.close(close_ec);
+    acceptor.close(close_ec);
+  };
+
+  connected = [&](const boost::system::error_code& ec) {
+    EXPECT_EQ(0, ec.value()) << "Connect should not be in error: "
+                             << ec.message();
+    if (ec) {
+      close();
+      return;
+    }
+
+    start_time = Now();
+    start_cpu = CpuNow();
+    send_next();
+  };
+
+  sent_handler1 = [&](const boost::system::error_code& ec,
+                      std::size_t length) {
+    if (ec) {
+      return;
+    }
+
+    sent += length;
+    if (sent < bytes) {
+      send_next();
+    }
+  };
+
+  accepted = [&](const boost::system::error_code& ec) {
+    EXPECT_EQ(0, ec.value()) << "Accept should not be in error: "
+                             << ec.message();
+    if (ec) {
+      close();
+      return;
+    }
+
+    socket2.async_read_some(boost::asio::buffer(r_buffer2),
+                            received_handler2);
+  };
+
+  received_handler2 = [&](const boost::system::error_code& ec,
+                          std::size_t length) {
+    EXPECT_EQ(0, ec.value()) << "Receive should not be in error: "
+                             << ec.message();
+    if (ec) {
+      close();
+      return;
+    }
+
+    received += length;
+
+    if (received < bytes) {
+      socket2.async_read_some(boost::asio::buffer(r_buffer2),
+                              received_handler2);
+    } else {
+      stop_cpu = CpuNow();
+      stop_time = Now();
+      close();
+    }
+  };
+
+  acceptor.open();
+  acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+  acceptor.bind(acceptor_endpoint, ec);
+  ASSERT_EQ(0, ec.value()) << "Bind acceptor should not be in error: "
+                           << ec.message();
+  acceptor.listen(100, ec);
+  ASSERT_EQ(0, ec.value()) << "Listen acceptor should not be in error: "
+                           << ec.message();
+
+  acceptor.async_accept(socket2, accepted);
+  socket1.async_connect(remote_endpoint, connected);
+
+  RunThreads(io_service);
+
+  ASSERT_EQ(bytes, received);
+
+  auto bits = received * 8.0;
+  auto seconds = (stop_time - start_time) / 1e9;
+  auto cpu_seconds = (stop_cpu - start_cpu) / 1e9;
+
+  std::cout << "[ BENCHMARK] " << name << std::fixed << std::setprecision(2)
+            << ": " << received / 1024 / 1024 << " MB, "
+            << bits / seconds / 1e9 << " Gbps, "
+            << (cpu_seconds > 0 ? bits / cpu_seconds / 1e9 : 0)
+            << " Gbps/core (" << cpu_seconds << " s cpu)" << std::endl;
+}
+
+/// Connect and accept one socket pair after the other
+///   Each pair is closed once both sides completed their handshake, latency
+///   runs from the connect call to the later of the two completions
+template <class StreamProtocol>
+void BenchmarkHandshakes(
+    const std::string& name,
+    typename StreamProtocol::resolver::query client_parameters,
+    typename StreamProtocol::resolver::query acceptor_parameters,
+    uint64_t handshakes) {
+  boost::asio::io_service io_service;
+  boost::system::error_code ec;
+  BenchmarkResult result(name, handshakes, "handshake");
+
+  typename StreamProtocol::acceptor acceptor(io_service);
+  typename StreamProtocol::resolver resolver(io_service);
+
+  auto acceptor_endpoint_it = resolver.resolve(acceptor_parameters, ec);
+  ASSERT_EQ(0, ec.value())
+      << "Resolving acceptor endpoint should not be in error: "
+      << ec.message();
+  typename StreamProtocol::endpoint acceptor_endpoint(*acceptor_endpoint_it);
+
+  auto remote_endpoint_it = resolver.resolve(client_parameters, ec);
+  ASSERT_EQ(0, ec.value())
+      << "Resolving remote endpoint should not be in error: " << ec.message();
+  typename StreamProtocol::endpoint remote_endpoint(*remote_endpoint_it);
+
+  std::function<void()> start_next;
+
+  start_next = [&]() {
+    auto p_socket1 = std::make_shared<typename StreamProtocol::socket>(
+        io_service);
+    auto p_socket2 = std::make_shared<typename StreamProtocol::socket>(
+        io_service);
+    auto p_pending = std::make_shared<std::atomic<uint32_t>>(2);
+    auto connect_time = Now();
+
+    auto completed = [&, p_socket1, p_socket2, p_pending, connect_time](
+        const boost::system::error_code& ec) {
+      EXPECT_EQ(0, ec.value()) << "Handshake should not be in error: "
+                               << ec.message();
+      if (ec) {
+        boost::system::error_code close_ec;
+        p_socket1->close(close_ec);
+        p_socket2->close(close_ec);
+        acceptor.close(close_ec);
+        return;
+      }
+
+      if (--(*p_pending)) {
+        return;
+      }
+
+      result.AddPacket(connect_time, 0);
+
+      boost::system::error_code close_ec;
+      p_socket1->close(close_ec);
+      p_socket2->close(close_ec);
+
+      if (result.packets() < handshakes) {
+        start_next();
+      } else {
+        result.Stop();
+        acceptor.close(close_ec);
+      }
+    };
+
+    acceptor.async_accept(*p_socket2, completed);
+    p_socket1->async_connect(remote_endpoint, completed);
+  };
+
+  acceptor.open();
+  acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+  acceptor.bind(acceptor_endpoint, ec);
+  ASSERT_EQ(0, ec.value()) << "Bind acceptor should not be in error: "
+                           << ec.message();
+  acceptor.listen(100, ec);
+  ASSERT_EQ(0, ec.value()) << "Listen acceptor should not be in error: "
+                           << ec.message();
+
+  result.Start();
+  start_next();
+
+  RunThreads(io_service);
+
+  ASSERT_EQ(handshakes, result.packets());
+  result.Print();
+}
+
+}  // benchmark_helpers
+}  // tests
+
+#endif  // SSF_TESTS_BENCHMARK_HELPERS_H_
@@ -0,0 +1,291 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ssf/layer/parameters.h"
+
+#include "ssf/layer/congestion/drop_tail_policy.h"
+#include "ssf/layer/data_link/circuit_helpers.h"
+#include "ssf/layer/multiplexing/basic_multiplexer_protocol.h"
+#include "ssf/layer/multiplexing/port_multiplex_id.h"
+#include "ssf/layer/physical/tlsotcp.h"
+#include "ssf/layer/queue/async_queue.h"
+#include "ssf/layer/queue/commutator.h"
+
+#include "tests/benchmark_helpers.h"
+#include "tests/circuit_test_fixture.h"
+#include "tests/framed_datagram_helpers.h"
+#include "tests/routing_test_fixture.h"
+
+using tests::benchmark_helpers::BenchmarkResult;
+using tests::benchmark_helpers::Now;
+
+namespace {
+
+ssf::layer::LayerParameters tcp_server_parameters = {{"port", "9000"}};
+
+ssf::layer::LayerParameters tcp_client_parameters = {{"addr", "127.0.0.1"},
+                                                     {"port", "9000"}};
+
+const uint64_t queue_packets = 1000000;
+const uint64_t datagram_packets = 20000;
+const uint64_t stream_packets = 50000;
+const std::size_t stream_packet_size = 1400;
+const uint64_t framed_datagram_packets = 100000;
+const std::size_t framed_datagram_size = 64;
+
+ssf::layer::ParameterStack RoutedParameters(const std::string& address,
+                                            const std::string& router) {
+  ssf::layer::LayerParameters routed_parameters;
+  routed_parameters["network_address"] = address;
+  routed_parameters["router"] = router;
+
+  ssf::layer::ParameterStack parameters;
+  parameters.push_back(routed_parameters);
+
+  return parameters;
+}
+
+/// Select output (input id % 2) + 1
+struct InputParitySelector {
+  bool operator()(uint32_t* p_id, uint64_t* p_element) const {
+    *p_id = (*p_id % 2) + 1;
+    return true;
+  }
+};
+
+}  // namespace
+
+TEST(QueueBenchmark, AsyncQueueTest) {
+  tests::benchmark_helpers::BenchmarkQueue<
+      ssf::layer::queue::basic_async_queue<uint64_t>>("basic_async_queue",
+                                                      queue_packets);
+  tests::benchmark_helpers::BenchmarkQueue<
+      ssf::layer::queue::lockfree_async_queue<uint64_t>>(
+      "lockfree_async_queue", queue_packets);
+}
+
+TEST(QueueBenchmark, AsyncQueueThroughputTest) {
+  static const uint32_t nb_of_pushers = 4;
+  static const uint64_t nb_of_pushes = queue_packets / nb_of_pushers;
+
+  typedef ssf::layer::queue::basic_async_queue<uint64_t, std::queue<uint64_t>,
+                                               1024> MutexQueue;
+  typedef ssf::layer::queue::lockfree_async_queue<uint64_t, 1024>
+      LockFreeQueue;
+
+  tests::benchmark_helpers::BenchmarkQueueThroughput<MutexQueue>(
+      "mutex queue", nb_of_pushers, nb_of_pushes, 0);
+  tests::benchmark_helpers::BenchmarkQueueThroughput<LockFreeQueue>(
+      "lock-free queue", nb_of_pushers, nb_of_pushes, 0);
+  tests::benchmark_helpers::BenchmarkQueueThroughput<MutexQueue>(
+      "mutex queue, batches of 64", nb_of_pushers, nb_of_pushes, 64);
+  tests::benchmark_helpers::BenchmarkQueueThroughput<LockFreeQueue>(
+      "lock-free queue, batches of 64", nb_of_pushers, nb_of_pushes, 64);
+}
+
+TEST(QueueBenchmark, CommutatorTest) {
+  typedef ssf::layer::queue::Commutator<uint32_t, uint64_t,
+                                        InputParitySelector> Commutator;
+  typedef ssf::layer::queue::basic_async_queue<uint64_t> Queue;
+  typedef std::function<void(const boost::system::error_code&)> PushHandler;
+
+  static const uint32_t nb_of_inputs = 4;
+  static const uint64_t packets_per_input = queue_packets / nb_of_inputs;
+  static const uint64_t total = nb_of_inputs * packets_per_input;
+
+  boost::asio::io_service io_service;
+  InputParitySelector selector;
+  auto p_commutator = Commutator::Create(io_service, selector);
+  BenchmarkResult result("commutator", total);
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<PushHandler> pushed_handlers(nb_of_inputs);
+  std::vector<uint64_t> pushed(nb_of_inputs, 0);
+
+  auto output = [&](uint64_t send_time, Commutator::OutputHandler handler) {
+    result.AddPacket(send_time, sizeof(send_time));
+    handler(boost::system::error_code());
+
+    if (result.packets() == total) {
+      result.Stop();
+      boost::system::error_code ec;
+      for (auto& p_queue : queues) {
+        p_queue->close(ec);
+      }
+    }
+  };
+
+  p_commutator->RegisterOutput(1, output);
+  p_commutator->RegisterOutput(2, output);
+
+  for (uint32_t i = 0; i < nb_of_inputs; ++i) {
+    queues.emplace_back(new Queue(io_service));
+    auto p_queue = queues[i].get();
+
+    pushed_handlers[i] = [&, i, p_queue](const boost::system::error_code& ec) {
+      if (!ec && ++pushed[i] < packets_per_input) {
+        p_queue->async_push(Now(), pushed_handlers[i]);
+      }
+    };
+
+    p_commutator->RegisterInput(i, [p_queue](Commutator::InputHandler handler) {
+      p_queue->async_get(std::move(handler));
+    });
+  }
+
+  result.Start();
+  for (uint32_t i = 0; i < nb_of_inputs; ++i) {
+    queues[i]->async_push(Now(), pushed_handlers[i]);
+  }
+
+  tests::benchmark_helpers::RunThreads(io_service);
+
+  boost::system::error_code ec;
+  p_commutator->close(ec);
+
+  ASSERT_EQ(total, result.packets());
+  result.Print();
+}
+
+TEST_F(RoutingTestFixture, LocalRoutingBenchmarkTest) {
+  tests::benchmark_helpers::BenchmarkDatagramProtocol<RoutedProtocol>(
+      "router local", RoutedParameters("7", "router1"),
+      RoutedParameters("5", "router1"), datagram_packets);
+}
+
+TEST_F(RoutingTestFixture, RemoteRoutingBenchmarkTest) {
+  tests::benchmark_helpers::BenchmarkDatagramProtocol<RoutedProtocol>(
+      "router remote", RoutedParameters("7", "router1"),
+      RoutedParameters("2", "router2"), datagram_packets);
+}
+
+class MultiplexingBenchmarkFixture : public RoutingTestFixture {
+ protected:
+  using MultiplexedProtocol =
+      ssf::layer::multiplexing::basic_MultiplexedProtocol<
+          RoutedProtocol, ssf::layer::multiplexing::PortID,
+          ssf::layer::congestion::DropTailPolicy<100>>;
+
+  static ssf::layer::ParameterStack MultiplexedParameters(
+      const std::string& port, const std::string& address,
+      const std::string& router) {
+    auto parameters = RoutedParameters(address, router);
+    parameters.push_front({{"port", port}});
+
+    return parameters;
+  }
+};
+
+TEST_F(MultiplexingBenchmarkFixture, MultiplexedRoutingBenchmarkTest) {
+  tests::benchmark_helpers::BenchmarkDatagramProtocol<MultiplexedProtocol>(
+      "multiplexer local", MultiplexedParameters("1", "7", "router1"),
+      MultiplexedParameters("2", "5", "router1"), datagram_packets);
+
+  tests::benchmark_helpers::BenchmarkDatagramProtocol<MultiplexedProtocol>(
+      "multiplexer remote", MultiplexedParameters("3", "7", "router1"),
+      MultiplexedParameters("4", "2", "router2"), datagram_packets);
+}
+
+TEST(StreamBenchmark, TLSStreamTest) {
+  ssf::layer::ParameterStack acceptor_parameters;
+  acceptor_parameters.push_back(
+      tests::virtual_network_helpers::tls_server_parameters);
+  acceptor_parameters.push_back(tcp_server_parameters);
+
+  ssf::layer::ParameterStack client_parameters;
+  client_parameters.push_back(
+      tests::virtual_network_helpers::tls_client_parameters);
+  client_parameters.push_back(tcp_client_parameters);
+
+  tests::benchmark_helpers::BenchmarkStreamProtocol<
+      ssf::layer::physical::TLSoTCPPhysicalLayer>(
+      "tls", client_parameters, acceptor_parameters, stream_packets,
+      stream_packet_size);
+
+  tests::benchmark_helpers::BenchmarkStreamProtocol<
+      ssf::layer::physical::TLSboTCPPhysicalLayer>(
+      "buffered tls", client_parameters, acceptor_parameters, stream_packets,
+      stream_packet_size);
+}
+
+TEST(StreamBenchmark, FramedDatagramReceiveTest) {
+  ssf::layer::ParameterStack tcp_acceptor_parameters;
+  tcp_acceptor_parameters.push_back(tcp_server_parameters);
+
+  ssf::layer::ParameterStack tcp_client_parameters_stack;
+  tcp_client_parameters_stack.push_back(tcp_client_parameters);
+
+  tests::framed_datagram_helpers::BenchmarkFramedDatagramReceive<
+      ssf::layer::physical::TCPPhysicalLayer>(
+      tcp_client_parameters_stack, tcp_acceptor_parameters,
+      framed_datagram_packets, framed_datagram_size);
+
+  ssf::layer::ParameterStack tls_acceptor_parameters;
+  tls_acceptor_parameters.push_back(
+      tests::virtual_network_helpers::tls_server_parameters);
+  tls_acceptor_parameters.push_back(tcp_server_parameters);
+
+  ssf::layer::ParameterStack tls_client_parameters;
+  tls_client_parameters.push_back(
+      tests::virtual_network_helpers::tls_client_parameters);
+  tls_client_parameters.push_back(tcp_client_parameters);
+
+  tests::framed_datagram_helpers::BenchmarkFramedDatagramReceive<
+      ssf::layer::physical::TLSboTCPPhysicalLayer>(
+      tls_client_parameters, tls_acceptor_parameters, framed_datagram_packets,
+      framed_datagram_size);
+}
+
+TEST_F(CircuitTestFixture, CircuitBenchmarkTest) {
+  ssf::layer::ParameterStack acceptor_default_parameters = {{}, {}};
+  ssf::layer::ParameterStack acceptor_next_layers_parameters;
+  acceptor_next_layers_parameters.push_back(tcp_server_parameters);
+  ssf::layer::ParameterStack acceptor_parameters(
+      ssf::layer::data_link::make_acceptor_parameter_stack(
+          "server", acceptor_default_parameters,
+          acceptor_next_layers_parameters));
+
+  ssf::layer::data_link::NodeParameterList nodes(this->GetClientNodes());
+  nodes.PushBackNode();
+  nodes.AddTopLayerToBackNode(tcp_client_parameters);
+
+  ssf::layer::ParameterStack client_parameters(
+      ssf::layer::data_link::make_client_full_circuit_parameter_stack(
+          "server", nodes));
+
+  tests::benchmark_helpers::BenchmarkStreamProtocol<CircuitProtocol>(
+      "circuit", client_parameters, acceptor_parameters, stream_packets,
+      stream_packet_size);
+}
+
+TEST_F(CircuitTestFixture, TLSCircuitBenchmarkTest) {
+  ssf::layer::ParameterStack acceptor_default_parameters = {{}, {}, {}};
+  ssf::layer::ParameterStack acceptor_next_layers_parameters;
+  acceptor_next_layers_parameters.push_front(tcp_server_parameters);
+  acceptor_next_layers_parameters.push_front(
+      tests::virtual_network_helpers::tls_server_parameters);
+  ssf::layer::ParameterStack acceptor_parameters(
+      ssf::layer::data_link::make_acceptor_parameter_stack(
+          "server", acceptor_default_parameters,
+          acceptor_next_layers_parameters));
+
+  ssf::layer::data_link::NodeParameterList nodes(this->GetClientTLSNodes());
+  nodes.PushBackNode();
+  nodes.AddTopLayerToBackNode(tcp_client_parameters);
+  nodes.AddTopLayerToBackNode(
+      tests::virtual_network_helpers::tls_server_parameters);
+
+  ssf::layer::ParameterStack client_parameters(
+      ssf::layer::data_link::make_client_full_circuit_parameter_stack(
+          "server", nodes));
+
+  tests::benchmark_helpers::BenchmarkStreamProtocol<TLSCircuitProtocol>(
+      "tls circuit", client_parameters, acceptor_parameters, stream_packets,
+      stream_packet_size);
+}
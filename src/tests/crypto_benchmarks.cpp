@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+
+#include "ssf/layer/parameters.h"
+
+#include "ssf/layer/physical/tlsotcp.h"
+
+#include "tests/benchmark_helpers.h"
+
+namespace {
+
+ssf::layer::LayerParameters tcp_server_parameters = {{"port", "9000"}};
+
+ssf::layer::LayerParameters tcp_client_parameters = {{"addr", "127.0.0.1"},
+                                                     {"port", "9000"}};
+
+const uint64_t bulk_bytes = 1024 * 1024 * 1024;
+const std::size_t bulk_write_size = 64 * 1024;
+
+/// Transfer bulk_bytes over TLS 1.2 with both sides restricted to cipher
+void BenchmarkCipher(const std::string& cipher) {
+  typedef ssf::layer::physical::TLSoTCPPhysicalLayer TLSStackProtocol;
+
+  auto server_tls_parameters =
+      tests::virtual_network_helpers::tls_server_parameters;
+  auto client_tls_parameters =
+      tests::virtual_network_helpers::tls_client_parameters;
+  server_tls_parameters["cipher_profile"] = "fast-ecdhe";
+  client_tls_parameters["cipher_profile"] = "fast-ecdhe";
+  server_tls_parameters["set_cipher_suit"] = cipher;
+  client_tls_parameters["set_cipher_suit"] = cipher;
+
+  ssf::layer::ParameterStack acceptor_parameters;
+  acceptor_parameters.push_back(server_tls_parameters);
+  acceptor_parameters.push_back(tcp_server_parameters);
+
+  ssf::layer::ParameterStack client_parameters;
+  client_parameters.push_back(client_tls_parameters);
+  client_parameters.push_back(tcp_client_parameters);
+
+  tests::benchmark_helpers::BenchmarkBulkTransfer<TLSStackProtocol>(
+      "tls bulk " + cipher, client_parameters, acceptor_parameters,
+      bulk_bytes, bulk_write_size);
+}
+
+}  // namespace
+
+TEST(CryptoBenchmark, CapabilitiesTest) {
+  typedef ssf::layer::physical::TLSoTCPPhysicalLayer::CryptoProtocol
+      CryptoProtocol;
+
+  std::cout << "[ BENCHMARK] crypto: "
+            << ssf::layer::cryptography::detail::ToString(
+                   CryptoProtocol::crypto_capabilities())
+            << std::endl;
+}
+
+TEST(CryptoBenchmark, AES128GCMTest) {
+  BenchmarkCipher("ECDHE-RSA-AES128-GCM-SHA256");
+}
+
+TEST(CryptoBenchmark, AES256GCMTest) {
+  BenchmarkCipher("ECDHE-RSA-AES256-GCM-SHA384");
+}
+
+TEST(CryptoBenchmark, ChaCha20Poly1305Test) {
+  BenchmarkCipher("ECDHE-RSA-CHACHA20-POLY1305");
+}
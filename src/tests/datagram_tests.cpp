@@ -0,0 +1,280 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <atomic>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+
+#include "ssf/layer/datagram/basic_datagram.h"
+#include "ssf/layer/datagram/basic_header.h"
+#include "ssf/layer/datagram/basic_payload.h"
+#include "ssf/layer/datagram/empty_component.h"
+
+#include "ssf/layer/multiplexing/port_multiplex_id.h"
+#include "ssf/layer/network/network_id.h"
+
+namespace {
+
+std::atomic<uint64_t> g_allocation_count(0);
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  ++g_allocation_count;
+  void* p = std::malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) throw() { std::free(p); }
+
+void operator delete(void* p, std::size_t) throw() { std::free(p); }
+
+template <class Datagram>
+uint64_t CountGetBuffersAllocations(Datagram& datagram, uint32_t count) {
+  std::size_t total_size = 0;
+  auto before = g_allocation_count.load();
+  for (uint32_t i = 0; i < count; ++i) {
+    total_size += boost::asio::buffer_size(datagram.header().GetConstBuffers());
+    total_size += boost::asio::buffer_size(datagram.GetConstBuffers());
+    total_size += boost::asio::buffer_size(datagram.GetMutableBuffers());
+  }
+  auto allocations = g_allocation_count.load() - before;
+  EXPECT_NE(0, total_size);
+
+  return allocations;
+}
+
+TEST(DatagramTest, buffer_payload_pool_reuse_test) {
+  typedef ssf::layer::BufferPayload<1500> Payload;
+
+  const uint8_t* p_first_data = nullptr;
+  {
+    Payload payload;
+    auto buffers = payload.GetMutableBuffers();
+    p_first_data =
+        boost::asio::buffer_cast<const uint8_t*>(*buffers.begin());
+    ASSERT_EQ(1500, payload.GetSize());
+  }
+
+  ASSERT_LE(1U, Payload::Pool::CachedBlocks());
+
+  Payload payload;
+  auto buffers = payload.GetMutableBuffers();
+  ASSERT_EQ(p_first_data,
+            boost::asio::buffer_cast<const uint8_t*>(*buffers.begin()))
+      << "Released block not reused";
+}
+
+TEST(DatagramTest, buffer_payload_copy_on_write_test) {
+  typedef ssf::layer::BufferPayload<128> Payload;
+
+  Payload payload;
+  payload.SetSize(4);
+  std::vector<uint8_t> data = {1, 2, 3, 4};
+  boost::asio::buffer_copy(payload.GetMutableBuffers(),
+                           boost::asio::buffer(data));
+
+  Payload copy(payload);
+  ASSERT_EQ(4, copy.GetSize());
+  ASSERT_EQ(
+      boost::asio::buffer_cast<const uint8_t*>(*payload.GetConstBuffers().begin()),
+      boost::asio::buffer_cast<const uint8_t*>(*copy.GetConstBuffers().begin()))
+      << "Copy should share the block";
+
+  std::vector<uint8_t> other_data = {5, 6, 7, 8};
+  boost::asio::buffer_copy(copy.GetMutableBuffers(),
+                           boost::asio::buffer(other_data));
+
+  std::vector<uint8_t> result(4);
+  boost::asio::buffer_copy(boost::asio::buffer(result),
+                           payload.GetConstBuffers());
+  ASSERT_EQ(data, result) << "Original payload modified through its copy";
+
+  boost::asio::buffer_copy(boost::asio::buffer(result),
+                           copy.GetConstBuffers());
+  ASSERT_EQ(other_data, result);
+}
+
+TEST(DatagramTest, buffer_payload_moved_from_test) {
+  typedef ssf::layer::BufferPayload<64> Payload;
+
+  Payload payload;
+  Payload moved(std::move(payload));
+  ASSERT_EQ(64, moved.GetSize());
+  ASSERT_EQ(0, payload.GetSize());
+
+  payload.ResetSize();
+  ASSERT_EQ(64, payload.GetSize());
+  ASSERT_EQ(64, boost::asio::buffer_size(payload.GetMutableBuffers()));
+
+  payload.SetSize(65);
+  ASSERT_EQ(64, payload.GetSize());
+}
+
+TEST(DatagramTest, buffer_payload_frame_test) {
+  typedef ssf::layer::basic_Header<ssf::layer::EmptyComponent,
+                                   ssf::layer::network::NetworkID,
+                                   ssf::layer::EmptyComponent, uint16_t>
+      Header;
+  typedef ssf::layer::BufferPayload<1400, Header::size> Payload;
+
+  Payload payload;
+  payload.SetSize(4);
+  std::vector<uint8_t> data = {7, 8, 9, 10};
+  boost::asio::buffer_copy(payload.GetMutableBuffers(),
+                           boost::asio::buffer(data));
+
+  Header header(ssf::layer::EmptyComponent(),
+                ssf::layer::network::NetworkID(0x0102, 0x0304),
+                ssf::layer::EmptyComponent(), 4);
+
+  auto before = g_allocation_count.load();
+  auto frame = payload.Frame(header);
+  Payload sent_payload(std::move(payload));
+  ASSERT_EQ(0, g_allocation_count.load() - before)
+      << "Framing should not allocate";
+
+  ASSERT_EQ(Header::size + 4, boost::asio::buffer_size(frame));
+  ASSERT_EQ(boost::asio::buffer_cast<const uint8_t*>(frame) + Header::size,
+            boost::asio::buffer_cast<const uint8_t*>(
+                *sent_payload.GetConstBuffers().begin()))
+      << "Header not encoded in front of the payload";
+
+  std::vector<uint8_t> wire(Header::size + 4);
+  boost::asio::buffer_copy(boost::asio::buffer(wire), frame);
+  std::vector<uint8_t> expected_wire = {1, 2, 3, 4, 0, 4, 7, 8, 9, 10};
+  ASSERT_EQ(expected_wire, wire);
+}
+
+TEST(DatagramTest, network_header_buffers_no_allocation_test) {
+  typedef ssf::layer::basic_Header<ssf::layer::EmptyComponent,
+                                   ssf::layer::network::NetworkID,
+                                   ssf::layer::EmptyComponent, uint16_t>
+      Header;
+  typedef ssf::layer::basic_Datagram<Header, ssf::layer::BufferPayload<1400>,
+                                     ssf::layer::EmptyComponent> Datagram;
+
+  ASSERT_EQ(1, Header::buffer_count);
+  ASSERT_EQ(2, Datagram::buffer_count);
+
+  Datagram datagram;
+  ASSERT_EQ(0, CountGetBuffersAllocations(datagram, 10000))
+      << "GetConstBuffers/GetMutableBuffers should not allocate";
+}
+
+TEST(DatagramTest, multiplexing_header_buffers_no_allocation_test) {
+  typedef ssf::layer::basic_Header<ssf::layer::EmptyComponent,
+                                   ssf::layer::multiplexing::PortPairID,
+                                   ssf::layer::EmptyComponent,
+                                   ssf::layer::uint0_t> Header;
+  typedef ssf::layer::basic_Datagram<Header, ssf::layer::BufferPayload<1400>,
+                                     ssf::layer::EmptyComponent> Datagram;
+
+  ASSERT_EQ(1, Header::buffer_count);
+  ASSERT_EQ(2, Datagram::buffer_count);
+
+  Datagram datagram;
+  ASSERT_EQ(0, CountGetBuffersAllocations(datagram, 10000))
+      << "GetConstBuffers/GetMutableBuffers should not allocate";
+}
+
+TEST(DatagramTest, network_header_wire_format_test) {
+  typedef ssf::layer::basic_Header<ssf::layer::EmptyComponent,
+                                   ssf::layer::network::NetworkID,
+                                   ssf::layer::EmptyComponent, uint16_t>
+      Header;
+
+  ASSERT_EQ(6, Header::size);
+
+  Header header(ssf::layer::EmptyComponent(),
+                ssf::layer::network::NetworkID(0x0102, 0x0304),
+                ssf::layer::EmptyComponent(), 0x0506);
+
+  auto buffers = header.GetConstBuffers();
+  ASSERT_EQ(1, buffers.size()) << "Header should be one contiguous buffer";
+
+  std::vector<uint8_t> wire(Header::size);
+  boost::asio::buffer_copy(boost::asio::buffer(wire), buffers);
+  std::vector<uint8_t> expected_wire = {1, 2, 3, 4, 5, 6};
+  ASSERT_EQ(expected_wire, wire) << "Header not in network byte order";
+
+  Header received_header;
+  boost::asio::buffer_copy(received_header.GetMutableBuffers(),
+                           boost::asio::buffer(wire));
+  received_header.Decode();
+  ASSERT_EQ(0x0102, received_header.id().left_id());
+  ASSERT_EQ(0x0304, received_header.id().right_id());
+  ASSERT_EQ(0x0506, received_header.payload_length());
+}
+
+TEST(DatagramTest, multiplexing_header_wire_format_test) {
+  typedef ssf::layer::basic_Header<ssf::layer::EmptyComponent,
+                                   ssf::layer::multiplexing::PortPairID,
+                                   ssf::layer::EmptyComponent,
+                                   ssf::layer::uint0_t> Header;
+  typedef ssf::layer::multiplexing::PortID PortID;
+
+  ASSERT_EQ(4, Header::size);
+
+  Header header(ssf::layer::EmptyComponent(),
+                ssf::layer::multiplexing::PortPairID(PortID(0x0A0B),
+                                                     PortID(0x0C0D)),
+                ssf::layer::EmptyComponent(), 0);
+
+  std::vector<uint8_t> wire(Header::size);
+  boost::asio::buffer_copy(boost::asio::buffer(wire),
+                           header.GetConstBuffers());
+  std::vector<uint8_t> expected_wire = {0x0A, 0x0B, 0x0C, 0x0D};
+  ASSERT_EQ(expected_wire, wire);
+
+  Header received_header;
+  boost::asio::buffer_copy(received_header.GetMutableBuffers(),
+                           boost::asio::buffer(wire));
+  received_header.Decode();
+  ASSERT_EQ(header.id(), received_header.id());
+}
+
+TEST(DatagramTest, header_encoded_when_fields_set_test) {
+  typedef ssf::layer::basic_Header<ssf::layer::EmptyComponent,
+                                   ssf::layer::multiplexing::PortPairID,
+                                   ssf::layer::EmptyComponent,
+                                   ssf::layer::uint0_t> Header;
+  typedef ssf::layer::basic_Datagram<Header, ssf::layer::ConstPayload,
+                                     ssf::layer::EmptyComponent> Datagram;
+  typedef ssf::layer::multiplexing::PortID PortID;
+
+  Header header;
+  header.id() = ssf::layer::multiplexing::PortPairID(PortID(0x0102),
+                                                      PortID(0x0304));
+  std::vector<uint8_t> expected_wire = {1, 2, 3, 4};
+
+  // Fields set through the accessors are encoded by the datagram
+  std::vector<uint8_t> data = {5, 6};
+  Datagram datagram(header, ssf::layer::ConstPayload(boost::asio::buffer(data)),
+                    ssf::layer::EmptyComponent());
+  std::vector<uint8_t> wire(Header::size + 2);
+  boost::asio::buffer_copy(boost::asio::buffer(wire),
+                           datagram.GetConstBuffers());
+  std::vector<uint8_t> expected_datagram = {1, 2, 3, 4, 5, 6};
+  ASSERT_EQ(expected_datagram, wire);
+
+  // Serializing a const header leaves its wire buffer unchanged
+  const Header& const_header = header;
+  wire.resize(Header::size);
+  boost::asio::buffer_copy(boost::asio::buffer(wire),
+                           const_header.GetConstBuffers());
+  ASSERT_NE(expected_wire, wire) << "Const serialization encoded the fields";
+
+  header.Encode();
+  boost::asio::buffer_copy(boost::asio::buffer(wire),
+                           const_header.GetConstBuffers());
+  ASSERT_EQ(expected_wire, wire);
+}
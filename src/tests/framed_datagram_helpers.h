@@ -0,0 +1,375 @@
+#ifndef SSF_TESTS_FRAMED_DATAGRAM_HELPERS_H_
+#define SSF_TESTS_FRAMED_DATAGRAM_HELPERS_H_
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/write.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include "ssf/error/error.h"
+
+#include "ssf/layer/datagram/basic_datagram.h"
+#include "ssf/layer/datagram/basic_header.h"
+#include "ssf/layer/datagram/basic_payload.h"
+#include "ssf/layer/datagram/empty_component.h"
+
+#include "ssf/layer/framed_datagram_reader.h"
+#include "ssf/layer/protocol_attributes.h"
+
+#include "tests/tools.h"
+#include "tests/virtual_network_helpers.h"
+
+namespace tests {
+namespace framed_datagram_helpers {
+
+typedef ssf::layer::basic_Header<
+    ssf::layer::EmptyComponent, ssf::layer::EmptyComponent,
+    ssf::layer::EmptyComponent, uint16_t> FramedHeader;
+typedef ssf::layer::basic_Datagram<FramedHeader,
+                                   ssf::layer::BufferPayload<1500>,
+                                   ssf::layer::EmptyComponent> FramedDatagram;
+
+/// Serialize a datagram of payload_size bytes set to value
+inline std::vector<uint8_t> MakeFramedDatagram(std::size_t payload_size,
+                                               uint8_t value) {
+  FramedHeader header(ssf::layer::EmptyComponent(),
+                      ssf::layer::EmptyComponent(),
+                      ssf::layer::EmptyComponent(),
+                      static_cast<uint16_t>(payload_size));
+
+  std::vector<uint8_t> wire(FramedHeader::size);
+  boost::asio::buffer_copy(boost::asio::buffer(wire), header.GetConstBuffers());
+  wire.resize(FramedHeader::size + payload_size, value);
+
+  return wire;
+}
+
+/// Serialize count datagrams of payload_size bytes in a contiguous buffer
+inline std::vector<uint8_t> MakeFramedDatagrams(uint64_t count,
+                                                std::size_t payload_size) {
+  std::vector<uint8_t> payload(payload_size);
+  tests::virtual_network_helpers::ResetBuffer(&payload, 1, false);
+
+  std::vector<uint8_t> wire;
+  wire.reserve(static_cast<std::size_t>(count) *
+               (FramedHeader::size + payload_size));
+  for (uint64_t i = 0; i < count; ++i) {
+    auto datagram = MakeFramedDatagram(payload_size, 0);
+    wire.insert(wire.end(), datagram.begin(),
+                datagram.begin() + FramedHeader::size);
+    wire.insert(wire.end(), payload.begin(), payload.end());
+  }
+
+  return wire;
+}
+
+/// Receive datagrams split across writes with basic_FramedDatagramReader
+///   Datagram i (1 to 6) holds i * 10 bytes set to i. The first write ends
+///   in the payload of datagram 4, the second one in the header of datagram
+///   5. The third write ends with an oversize frame after datagram 6: the
+///   datagrams before it are received without error, then the reader
+///   reports message_size
+template <class StreamProtocol>
+void TestFramedDatagramReceive(
+    typename StreamProtocol::resolver::query client_parameters,
+    typename StreamProtocol::resolver::query acceptor_parameters) {
+  typedef typename StreamProtocol::socket Socket;
+  typedef ssf::layer::basic_FramedDatagramReader<Socket, FramedDatagram>
+      FramedReader;
+  typedef std::function<void(const boost::system::error_code&,
+                             typename FramedReader::Datagrams&)>
+      BatchHandler;
+
+  boost::asio::io_service io_service;
+  boost::system::error_code resolve_ec;
+
+  Socket socket1(io_service);
+  Socket socket2(io_service);
+  typename StreamProtocol::acceptor acceptor(io_service);
+  typename StreamProtocol::resolver resolver(io_service);
+
+  auto acceptor_endpoint_it = resolver.resolve(acceptor_parameters, resolve_ec);
+  ASSERT_EQ(0, resolve_ec.value())
+      << "Resolving acceptor endpoint should not be in error: "
+      << resolve_ec.message();
+  typename StreamProtocol::endpoint acceptor_endpoint(*acceptor_endpoint_it);
+
+  auto remote_endpoint_it = resolver.resolve(client_parameters, resolve_ec);
+  ASSERT_EQ(0, resolve_ec.value())
+      << "Resolving remote endpoint should not be in error: "
+      << resolve_ec.message();
+  typename StreamProtocol::endpoint remote_endpoint(*remote_endpoint_it);
+
+  std::vector<uint8_t> wire;
+  for (uint8_t i = 1; i <= 6; ++i) {
+    auto datagram = MakeFramedDatagram(i * 10, i);
+    wire.insert(wire.end(), datagram.begin(), datagram.end());
+  }
+  auto oversize = MakeFramedDatagram(0, 0);
+  oversize[0] = 0xFF;
+  oversize[1] = 0xFF;
+  wire.insert(wire.end(), oversize.begin(), oversize.end());
+
+  // Datagrams 1 to 3 and part of 4, rest of 4 and part of the 5 header,
+  // rest of 5, 6 and the oversize frame
+  auto header_size = static_cast<std::size_t>(FramedHeader::size);
+  auto first_end = 3 * header_size + 60 + header_size + 15;
+  auto second_end = 4 * header_size + 100 + 1;
+  std::vector<std::vector<uint8_t>> writes = {
+      std::vector<uint8_t>(wire.begin(), wire.begin() + first_end),
+      std::vector<uint8_t>(wire.begin() + first_end,
+                           wire.begin() + second_end),
+      std::vector<uint8_t>(wire.begin() + second_end, wire.end())};
+
+  uint8_t received_count = 0;
+  bool message_size_error = false;
+  FramedReader reader(socket2);
+
+  tests::virtual_network_helpers::AcceptHandler accepted;
+  tests::virtual_network_helpers::ConnectHandler connected;
+  BatchHandler received;
+
+  auto close_all = [&]() {
+    boost::system::error_code close_ec;
+    acceptor.close(close_ec);
+    socket1.close(close_ec);
+    socket2.close(close_ec);
+  };
+
+  auto write = [&](std::size_t index) {
+    boost::asio::async_write(
+        socket1, boost::asio::buffer(writes[index]),
+        [](const boost::system::error_code&, std::size_t) {});
+  };
+
+  received = [&](const boost::system::error_code& ec,
+                 typename FramedReader::Datagrams& datagrams) {
+    if (ec) {
+      EXPECT_EQ(ssf::error::message_size, ec.value())
+          << "Oversize frame should be in error: " << ec.message();
+      EXPECT_TRUE(datagrams.empty());
+      message_size_error = true;
+      close_all();
+      return;
+    }
+
+    for (const auto& datagram : datagrams) {
+      ++received_count;
+      std::vector<uint8_t> expected_payload(received_count * 10,
+                                            received_count);
+      std::vector<uint8_t> payload(datagram.payload().GetSize());
+      boost::asio::buffer_copy(boost::asio::buffer(payload),
+                               datagram.payload().GetConstBuffers());
+      EXPECT_EQ(expected_payload, payload)
+          << "Wrong payload of datagram " << int(received_count);
+    }
+
+    if (received_count == 3 || received_count == 4) {
+      // Complete the frame split by the previous write
+      write(received_count - 2);
+    }
+
+    if (received_count > 6) {
+      close_all();
+      return;
+    }
+
+    reader.AsyncReadDatagrams(received);
+  };
+
+  accepted = [&](const boost::system::error_code& ec) {
+    ASSERT_EQ(0, ec.value())
+        << "Accept handler should not be in error: " << ec.message();
+    reader.AsyncReadDatagrams(received);
+  };
+
+  connected = [&](const boost::system::error_code& ec) {
+    ASSERT_EQ(0, ec.value())
+        << "Connect handler should not be in error: " << ec.message();
+    write(0);
+  };
+
+  boost::system::error_code ec;
+  acceptor.open();
+  acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+  ec.clear();
+  acceptor.bind(acceptor_endpoint, ec);
+  ASSERT_EQ(0, ec.value()) << "Bind acceptor should not be in error: "
+                           << ec.message();
+  acceptor.listen(100, ec);
+  ASSERT_EQ(0, ec.value()) << "Listen acceptor should not be in error: "
+                           << ec.message();
+  acceptor.async_accept(socket2, accepted);
+  socket1.async_connect(remote_endpoint, connected);
+
+  io_service.run();
+
+  ASSERT_EQ(6, received_count) << "Datagrams before the oversize frame lost";
+  ASSERT_TRUE(message_size_error) << "Oversize frame not reported";
+}
+
+/// Receive datagram_count small datagrams over a stream protocol, first with
+/// the chained header/payload/footer reads (AsyncReceiveDatagram), then with
+/// basic_FramedDatagramReader. Print packet rate and handlers run per
+/// datagram by the receiving io_service (the sender runs on its own)
+template <class StreamProtocol>
+void BenchmarkFramedDatagramReceive(
+    typename StreamProtocol::resolver::query client_parameters,
+    typename StreamProtocol::resolver::query acceptor_parameters,
+    uint64_t datagram_count, std::size_t payload_size) {
+  std::cout << "  * BenchmarkFramedDatagramReceive (" << datagram_count
+            << " datagrams of " << payload_size << " bytes)" << std::endl;
+  typedef typename StreamProtocol::socket Socket;
+  typedef ssf::layer::basic_FramedDatagramReader<Socket, FramedDatagram>
+      FramedReader;
+  typedef std::function<void(const boost::system::error_code&,
+                             typename FramedReader::Datagrams&)>
+      BatchHandler;
+
+  boost::asio::io_service io_service;
+  boost::asio::io_service sender_io_service;
+  boost::system::error_code resolve_ec;
+
+  Socket socket1(sender_io_service);
+  Socket socket2(io_service);
+  typename StreamProtocol::acceptor acceptor(io_service);
+  typename StreamProtocol::resolver resolver(io_service);
+
+  auto acceptor_endpoint_it = resolver.resolve(acceptor_parameters, resolve_ec);
+  ASSERT_EQ(0, resolve_ec.value())
+      << "Resolving acceptor endpoint should not be in error: "
+      << resolve_ec.message();
+  typename StreamProtocol::endpoint acceptor_endpoint(*acceptor_endpoint_it);
+
+  auto remote_endpoint_it = resolver.resolve(client_parameters, resolve_ec);
+  ASSERT_EQ(0, resolve_ec.value())
+      << "Resolving remote endpoint should not be in error: "
+      << resolve_ec.message();
+  typename StreamProtocol::endpoint remote_endpoint(*remote_endpoint_it);
+
+  // Both phases read from the same connection
+  auto wire = MakeFramedDatagrams(2 * datagram_count, payload_size);
+
+  uint64_t chained_count = 0;
+  uint64_t framed_count = 0;
+  bool payload_error = false;
+  TimedScope chained_timer;
+  TimedScope framed_timer;
+  double chained_duration = 0;
+  double framed_duration = 0;
+
+  FramedDatagram datagram;
+  FramedReader reader(socket2);
+
+  tests::virtual_network_helpers::AcceptHandler accepted;
+  tests::virtual_network_helpers::ConnectHandler connected;
+  tests::virtual_network_helpers::ReceiveHandler chained_received;
+  BatchHandler framed_received;
+
+  framed_received = [&](const boost::system::error_code& ec,
+                        typename FramedReader::Datagrams& datagrams) {
+    ASSERT_EQ(0, ec.value()) << "Framed read should not be in error: "
+                             << ec.message();
+    for (const auto& received : datagrams) {
+      payload_error |= (received.payload().GetSize() != payload_size);
+    }
+    framed_count += datagrams.size();
+
+    if (framed_count < datagram_count) {
+      reader.AsyncReadDatagrams(framed_received);
+    } else {
+      framed_duration = framed_timer.FloatSecondDuration();
+    }
+  };
+
+  chained_received = [&](const boost::system::error_code& ec,
+                         std::size_t length) {
+    ASSERT_EQ(0, ec.value()) << "Chained read should not be in error: "
+                             << ec.message();
+    payload_error |= (datagram.payload().GetSize() != payload_size);
+    ++chained_count;
+
+    if (chained_count < datagram_count) {
+      datagram.payload().ResetSize();
+      ssf::layer::AsyncReceiveDatagram(socket2, &datagram, chained_received);
+    } else {
+      chained_duration = chained_timer.FloatSecondDuration();
+    }
+  };
+
+  accepted = [&](const boost::system::error_code& ec) {
+    ASSERT_EQ(0, ec.value())
+        << "Accept handler should not be in error: " << ec.message();
+  };
+
+  connected = [&](const boost::system::error_code& ec) {
+    ASSERT_EQ(0, ec.value())
+        << "Connect handler should not be in error: " << ec.message();
+    boost::asio::async_write(
+        socket1, boost::asio::buffer(wire),
+        [](const boost::system::error_code&, std::size_t) {});
+  };
+
+  boost::system::error_code ec;
+  acceptor.open();
+  acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+  ec.clear();
+  acceptor.bind(acceptor_endpoint, ec);
+  ASSERT_EQ(0, ec.value()) << "Bind acceptor should not be in error: "
+                           << ec.message();
+  acceptor.listen(100, ec);
+  ASSERT_EQ(0, ec.value()) << "Listen acceptor should not be in error: "
+                           << ec.message();
+  acceptor.async_accept(socket2, accepted);
+  socket1.async_connect(remote_endpoint, connected);
+
+  std::thread sender([&sender_io_service]() { sender_io_service.run(); });
+
+  // Each phase runs alone so that its handlers can be counted
+  io_service.run();
+  io_service.reset();
+
+  chained_timer.ResetTime();
+  ssf::layer::AsyncReceiveDatagram(socket2, &datagram, chained_received);
+  auto chained_handlers = io_service.run();
+  io_service.reset();
+
+  framed_timer.ResetTime();
+  reader.AsyncReadDatagrams(framed_received);
+  auto framed_handlers = io_service.run();
+
+  sender.join();
+
+  boost::system::error_code close_ec;
+  acceptor.close(close_ec);
+  socket1.close(close_ec);
+  socket2.close(close_ec);
+
+  ASSERT_FALSE(payload_error) << "Wrong payload size received";
+  ASSERT_EQ(datagram_count, chained_count);
+  ASSERT_EQ(datagram_count, framed_count);
+
+  std::cout << "    chained reads: " << chained_count / chained_duration
+            << " pkt/s, "
+            << static_cast<double>(chained_handlers) / chained_count
+            << " handlers/pkt" << std::endl;
+  std::cout << "    framed reader: " << framed_count / framed_duration
+            << " pkt/s, "
+            << static_cast<double>(framed_handlers) / framed_count
+            << " handlers/pkt" << std::endl;
+}
+
+}  // framed_datagram_helpers
+}  // tests
+
+#endif  // SSF_TESTS_FRAMED_DATAGRAM_HELPERS_H_
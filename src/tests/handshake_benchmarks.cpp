@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include <string>
+
+#include "ssf/layer/parameters.h"
+
+#include "ssf/layer/physical/tlsotcp.h"
+
+#include "tests/benchmark_helpers.h"
+
+namespace {
+
+ssf::layer::LayerParameters tcp_server_parameters = {{"port", "9000"}};
+
+ssf::layer::LayerParameters tcp_client_parameters = {{"addr", "127.0.0.1"},
+                                                     {"port", "9000"}};
+
+const uint64_t handshakes = 500;
+
+/// Run the TLS handshake benchmark with both sides on the same profile
+void BenchmarkProfile(const std::string& name,
+                      const std::string& cipher_profile,
+                      ssf::layer::LayerParameters extra_parameters) {
+  auto server_tls_parameters =
+      tests::virtual_network_helpers::tls_server_parameters;
+  auto client_tls_parameters =
+      tests::virtual_network_helpers::tls_client_parameters;
+  server_tls_parameters["cipher_profile"] = cipher_profile;
+  client_tls_parameters["cipher_profile"] = cipher_profile;
+
+  for (const auto& parameter : extra_parameters) {
+    server_tls_parameters[parameter.first] = parameter.second;
+    client_tls_parameters[parameter.first] = parameter.second;
+  }
+
+  ssf::layer::ParameterStack acceptor_parameters;
+  acceptor_parameters.push_back(server_tls_parameters);
+  acceptor_parameters.push_back(tcp_server_parameters);
+
+  ssf::layer::ParameterStack client_parameters;
+  client_parameters.push_back(client_tls_parameters);
+  client_parameters.push_back(tcp_client_parameters);
+
+  tests::benchmark_helpers::BenchmarkHandshakes<
+      ssf::layer::physical::TLSoTCPPhysicalLayer>(
+      name, client_parameters, acceptor_parameters, handshakes);
+}
+
+}  // namespace
+
+TEST(HandshakeBenchmark, CompatProfileTest) {
+  BenchmarkProfile("tls handshake compat", "compat", {});
+}
+
+TEST(HandshakeBenchmark, FastECDHEProfileTest) {
+  BenchmarkProfile("tls handshake fast-ecdhe", "fast-ecdhe", {});
+}
+
+TEST(HandshakeBenchmark, TLS13ProfileTest) {
+  BenchmarkProfile("tls handshake tls13", "tls13", {});
+}
+
+TEST(HandshakeBenchmark, ResumedSessionTest) {
+  BenchmarkProfile("tls handshake fast-ecdhe resumed", "fast-ecdhe",
+                   {{"session_cache", "true"}, {"session_resumption", "true"}});
+}
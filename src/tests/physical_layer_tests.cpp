@@ -1,11 +1,39 @@
 #include <gtest/gtest.h>
 
+#include <cstdint>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+#include <openssl/evp.h>
+#include <openssl/opensslv.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/provider.h>
+#endif
+
 #include "tests/datagram_protocol_helpers.h"
+#include "tests/framed_datagram_helpers.h"
 #include "tests/stream_protocol_helpers.h"
 #include "tests/virtual_network_helpers.h"
 
 #include "ssf/layer/parameters.h"
 
+#include "ssf/layer/cryptography/tls/OpenSSL/buffering.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/crypto_engine.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/handshake_executor.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/helpers.h"
+#include "ssf/layer/cryptography/tls/OpenSSL/kernel_tls.h"
 #include "ssf/layer/physical/tcp.h"
 #include "ssf/layer/physical/tlsotcp.h"
 #include "ssf/layer/physical/udp.h"
@@ -118,6 +146,996 @@ TEST(PhysicalLayerTest, TLSLayerProtocolStackOverTCPTest) {
                                                      acceptor_parameters, 200);
 }
 
+#if defined(SSF_TLS_KERNEL_OFFLOAD)
+/// The kernel takes the TLS upper layer on connected TCP sockets
+bool IsKernelTLSAvailable() {
+#if defined(TCP_ULP)
+  boost::asio::io_service io_service;
+  boost::asio::ip::tcp::acceptor acceptor(
+      io_service, boost::asio::ip::tcp::endpoint(
+                      boost::asio::ip::address_v4::loopback(), 0));
+  boost::asio::ip::tcp::socket client(io_service);
+  boost::asio::ip::tcp::socket server(io_service);
+  boost::system::error_code ec;
+
+  client.connect(acceptor.local_endpoint(), ec);
+  if (ec) {
+    return false;
+  }
+  acceptor.accept(server, ec);
+  if (ec) {
+    return false;
+  }
+
+  return !setsockopt(client.native_handle(), SOL_TCP, TCP_ULP, "tls",
+                     sizeof("tls"));
+#else
+  return false;
+#endif
+}
+#endif
+
+// Kernel TLS or its user space fallback when unavailable
+TEST(PhysicalLayerTest, KernelTLSLayerProtocolStackOverTCPTest) {
+  typedef ssf::layer::physical::TLSoTCPPhysicalLayer TLSStackProtocol;
+
+  auto tls_server_parameters =
+      tests::virtual_network_helpers::tls_server_parameters;
+  tls_server_parameters["kernel_tls"] = "true";
+  auto tls_client_parameters =
+      tests::virtual_network_helpers::tls_client_parameters;
+  tls_client_parameters["kernel_tls"] = "true";
+
+  ssf::layer::ParameterStack acceptor_parameters;
+  acceptor_parameters.push_back(tls_server_parameters);
+  acceptor_parameters.push_back(tcp_server_parameters);
+
+  ssf::layer::ParameterStack client_parameters;
+  client_parameters.push_back(tls_client_parameters);
+  client_parameters.push_back(tcp_client_parameters);
+
+  TestStreamProtocol<TLSStackProtocol>(client_parameters, acceptor_parameters,
+                                       1024);
+
+  TestStreamProtocolSynchronous<TLSStackProtocol>(client_parameters,
+                                                  acceptor_parameters);
+
+  PerfTestStreamProtocolFullDuplex<TLSStackProtocol>(client_parameters,
+                                                     acceptor_parameters, 200);
+
+#if defined(SSF_TLS_KERNEL_OFFLOAD)
+  // Records must go through the kernel once it takes the TLS upper layer
+  if (!IsKernelTLSAvailable()) {
+    return;
+  }
+
+  boost::asio::io_service io_service;
+  std::unique_ptr<boost::asio::io_service::work> p_worker(
+      new boost::asio::io_service::work(io_service));
+  boost::thread_group threads;
+  for (uint16_t i = 1; i <= boost::thread::hardware_concurrency(); ++i) {
+    threads.create_thread([&io_service]() { io_service.run(); });
+  }
+
+  TLSStackProtocol::resolver resolver(io_service);
+  TLSStackProtocol::acceptor acceptor(io_service);
+  TLSStackProtocol::socket client(io_service);
+  TLSStackProtocol::socket server(io_service);
+  boost::system::error_code ec;
+
+  TLSStackProtocol::endpoint acceptor_endpoint(
+      *resolver.resolve(acceptor_parameters, ec));
+  EXPECT_EQ(0, ec.value()) << ec.message();
+  TLSStackProtocol::endpoint remote_endpoint(
+      *resolver.resolve(client_parameters, ec));
+  EXPECT_EQ(0, ec.value()) << ec.message();
+
+  acceptor.open();
+  acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+  acceptor.bind(acceptor_endpoint, ec);
+  EXPECT_EQ(0, ec.value()) << "Bind acceptor should not be in error: "
+                           << ec.message();
+  acceptor.listen(100, ec);
+  EXPECT_EQ(0, ec.value()) << "Listen acceptor should not be in error: "
+                           << ec.message();
+
+  boost::system::error_code accept_ec;
+  boost::system::error_code connect_ec;
+  boost::thread accepting([&acceptor, &server, &accept_ec]() {
+    acceptor.accept(server, accept_ec);
+  });
+  client.connect(remote_endpoint, connect_ec);
+  accepting.join();
+
+  EXPECT_EQ(0, accept_ec.value()) << accept_ec.message();
+  EXPECT_EQ(0, connect_ec.value()) << connect_ec.message();
+
+  if (!accept_ec && !connect_ec) {
+    auto p_client_ssl =
+        client.native_handle().p_next_layer_socket->native_handle();
+    auto p_server_ssl =
+        server.native_handle().p_next_layer_socket->native_handle();
+    EXPECT_TRUE(BIO_get_ktls_send(SSL_get_wbio(p_client_ssl)) != 0)
+        << "Client records sent in user space";
+    EXPECT_TRUE(BIO_get_ktls_recv(SSL_get_rbio(p_client_ssl)) != 0)
+        << "Client records received in user space";
+    EXPECT_TRUE(BIO_get_ktls_send(SSL_get_wbio(p_server_ssl)) != 0)
+        << "Server records sent in user space";
+    EXPECT_TRUE(BIO_get_ktls_recv(SSL_get_rbio(p_server_ssl)) != 0)
+        << "Server records received in user space";
+  }
+
+  boost::system::error_code close_ec;
+  client.close(close_ec);
+  server.close(close_ec);
+  acceptor.close(close_ec);
+  p_worker.reset();
+  threads.join_all();
+#endif
+}
+
+TEST(PhysicalLayerTest, TLSHandshakeExecutorOverTCPTest) {
+  typedef ssf::layer::physical::TLSoTCPPhysicalLayer TLSStackProtocol;
+  typedef TLSStackProtocol::CryptoProtocol CryptoProtocol;
+
+  ssf::layer::ParameterStack acceptor_parameters;
+  acceptor_parameters.push_back(
+      tests::virtual_network_helpers::tls_server_parameters);
+  acceptor_parameters.push_back(tcp_server_parameters);
+
+  ssf::layer::ParameterStack client_parameters;
+  client_parameters.push_back(
+      tests::virtual_network_helpers::tls_client_parameters);
+  client_parameters.push_back(tcp_client_parameters);
+
+  CryptoProtocol::set_handshake_executor(2, 0, 16);
+
+  TestStreamProtocol<TLSStackProtocol>(client_parameters, acceptor_parameters,
+                                       1024);
+
+  TestStreamProtocolFuture<TLSStackProtocol>(client_parameters,
+                                             acceptor_parameters);
+
+  CryptoProtocol::set_handshake_executor(0, 0, 0);
+}
+
+/// Stream whose handshakes are completed by the test
+class ManualHandshakeStream {
+ public:
+  template <typename Handler>
+  void async_handshake(boost::asio::ssl::stream_base::handshake_type type,
+                       Handler handler) {
+    handler_ = handler;
+    started_.set_value(boost::this_thread::get_id());
+  }
+
+  /// Thread which started the handshake
+  boost::thread::id WaitStarted() { return started_.get_future().get(); }
+
+  void Complete() { handler_(boost::system::error_code()); }
+
+ private:
+  std::promise<boost::thread::id> started_;
+  std::function<void(const boost::system::error_code&)> handler_;
+};
+
+TEST(PhysicalLayerTest, TLSHandshakeExecutorTest) {
+  using ssf::layer::cryptography::detail::AsyncHandshake;
+  using ssf::layer::cryptography::detail::TLSHandshakeExecutor;
+  typedef boost::asio::io_service::strand strand_type;
+  typedef std::shared_ptr<ManualHandshakeStream> StreamPtr;
+  typedef std::promise<boost::system::error_code> Done;
+
+  boost::asio::io_service io_service;
+  std::unique_ptr<boost::asio::io_service::work> p_worker(
+      new boost::asio::io_service::work(io_service));
+  boost::thread worker([&io_service]() { io_service.run(); });
+  auto p_strand = std::make_shared<strand_type>(io_service);
+
+  auto handshake = [&p_strand](StreamPtr p_stream, Done& done) {
+    AsyncHandshake(
+        p_stream, boost::asio::ssl::stream_base::client, p_strand,
+        [&done](const boost::system::error_code& ec) { done.set_value(ec); });
+  };
+
+  // One handshake in flight, one queued, the next refused
+  TLSHandshakeExecutor::Start(1, 1, 1);
+
+  auto p_first = std::make_shared<ManualHandshakeStream>();
+  auto p_second = std::make_shared<ManualHandshakeStream>();
+  auto p_third = std::make_shared<ManualHandshakeStream>();
+  Done first_done;
+  Done second_done;
+  Done third_done;
+  handshake(p_first, first_done);
+  handshake(p_second, second_done);
+  handshake(p_third, third_done);
+
+  EXPECT_EQ(1, TLSHandshakeExecutor::InFlight());
+  EXPECT_EQ(1, TLSHandshakeExecutor::Queued());
+  auto third_ec = third_done.get_future().get();
+  EXPECT_EQ(ssf::error::device_or_resource_busy, third_ec.value())
+      << third_ec.message();
+
+  auto first_thread = p_first->WaitStarted();
+  EXPECT_NE(boost::this_thread::get_id(), first_thread);
+  EXPECT_NE(worker.get_id(), first_thread)
+      << "Handshake run by the socket io_service";
+
+  // The slot released by the first handshake goes to the queued one
+  p_first->Complete();
+  EXPECT_EQ(0, first_done.get_future().get().value());
+  EXPECT_EQ(first_thread, p_second->WaitStarted())
+      << "Handshakes run by the single pool thread";
+  p_second->Complete();
+  EXPECT_EQ(0, second_done.get_future().get().value());
+  EXPECT_EQ(0, TLSHandshakeExecutor::InFlight());
+
+  // Stopping aborts the queued handshake and waits for the one in flight
+  auto p_running = std::make_shared<ManualHandshakeStream>();
+  auto p_waiting = std::make_shared<ManualHandshakeStream>();
+  Done running_done;
+  Done waiting_done;
+  handshake(p_running, running_done);
+  handshake(p_waiting, waiting_done);
+  p_running->WaitStarted();
+
+  auto stopped = std::async(std::launch::async,
+                            []() { TLSHandshakeExecutor::Stop(); });
+  EXPECT_EQ(boost::asio::error::operation_aborted,
+            waiting_done.get_future().get());
+  EXPECT_EQ(std::future_status::timeout,
+            stopped.wait_for(std::chrono::milliseconds(100)))
+      << "Stopped with a handshake in flight";
+  EXPECT_FALSE(TLSHandshakeExecutor::Enabled());
+
+  p_running->Complete();
+  stopped.get();
+  EXPECT_EQ(0, running_done.get_future().get().value());
+  EXPECT_EQ(0, TLSHandshakeExecutor::InFlight());
+  EXPECT_EQ(0, TLSHandshakeExecutor::Queued());
+
+  p_worker.reset();
+  worker.join();
+}
+
+/// Connect twice to the same peer with the given cipher profile, the second
+/// connection resumes the session of the first one
+void TestTLSSessionResumptionOverTCP(const std::string& cipher_profile) {
+  typedef ssf::layer::physical::TLSoTCPPhysicalLayer TLSStackProtocol;
+  typedef TLSStackProtocol::CryptoProtocol CryptoProtocol;
+
+  auto tls_server_parameters =
+      tests::virtual_network_helpers::tls_server_parameters;
+  tls_server_parameters["session_cache"] = "true";
+  tls_server_parameters["cipher_profile"] = cipher_profile;
+  auto tls_client_parameters =
+      tests::virtual_network_helpers::tls_client_parameters;
+  tls_client_parameters["session_resumption"] = "true";
+  tls_client_parameters["cipher_profile"] = cipher_profile;
+
+  ssf::layer::ParameterStack acceptor_parameters;
+  acceptor_parameters.push_back(tls_server_parameters);
+  acceptor_parameters.push_back(tcp_server_parameters);
+
+  ssf::layer::ParameterStack client_parameters;
+  client_parameters.push_back(tls_client_parameters);
+  client_parameters.push_back(tcp_client_parameters);
+
+  boost::asio::io_service io_service;
+  std::unique_ptr<boost::asio::io_service::work> p_worker(
+      new boost::asio::io_service::work(io_service));
+  boost::thread_group threads;
+  for (uint16_t i = 1; i <= boost::thread::hardware_concurrency(); ++i) {
+    threads.create_thread([&io_service]() { io_service.run(); });
+  }
+
+  TLSStackProtocol::resolver resolver(io_service);
+  TLSStackProtocol::acceptor acceptor(io_service);
+  boost::system::error_code ec;
+
+  TLSStackProtocol::endpoint acceptor_endpoint(
+      *resolver.resolve(acceptor_parameters, ec));
+  EXPECT_EQ(0, ec.value()) << ec.message();
+  TLSStackProtocol::endpoint remote_endpoint(
+      *resolver.resolve(client_parameters, ec));
+  EXPECT_EQ(0, ec.value()) << ec.message();
+
+  acceptor.open();
+  acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+  acceptor.bind(acceptor_endpoint, ec);
+  EXPECT_EQ(0, ec.value()) << "Bind acceptor should not be in error: "
+                           << ec.message();
+  acceptor.listen(100, ec);
+  EXPECT_EQ(0, ec.value()) << "Listen acceptor should not be in error: "
+                           << ec.message();
+
+  // The second connection to the same peer resumes the first session
+  for (int connection = 0; connection < 2; ++connection) {
+    TLSStackProtocol::socket client(io_service);
+    TLSStackProtocol::socket server(io_service);
+    boost::system::error_code accept_ec;
+    boost::system::error_code connect_ec;
+
+    boost::thread accepting([&acceptor, &server, &accept_ec]() {
+      acceptor.accept(server, accept_ec);
+    });
+    client.connect(remote_endpoint, connect_ec);
+    accepting.join();
+
+    EXPECT_EQ(0, accept_ec.value()) << accept_ec.message();
+    EXPECT_EQ(0, connect_ec.value()) << connect_ec.message();
+
+    if (!accept_ec && !connect_ec) {
+      // A TLS 1.3 session is issued after the handshake, ahead of the data
+      uint8_t sent = 1;
+      uint8_t received = 0;
+      boost::system::error_code write_ec;
+      boost::system::error_code read_ec;
+      boost::asio::write(server, boost::asio::buffer(&sent, 1), write_ec);
+      boost::asio::read(client, boost::asio::buffer(&received, 1), read_ec);
+      EXPECT_EQ(0, write_ec.value()) << write_ec.message();
+      EXPECT_EQ(0, read_ec.value()) << read_ec.message();
+
+      auto p_client_ssl =
+          client.native_handle().p_next_layer_socket->native_handle();
+      auto p_server_ssl =
+          server.native_handle().p_next_layer_socket->native_handle();
+      EXPECT_EQ(connection, SSL_session_reused(p_client_ssl))
+          << "Client session of connection " << connection;
+      EXPECT_EQ(connection, SSL_session_reused(p_server_ssl))
+          << "Server session of connection " << connection;
+#ifdef TLS1_3_VERSION
+      if (cipher_profile == "tls13") {
+        EXPECT_EQ(TLS1_3_VERSION, SSL_version(p_client_ssl));
+      }
+#endif
+    }
+
+    boost::system::error_code close_ec;
+    client.close(close_ec);
+    server.close(close_ec);
+  }
+
+  boost::system::error_code close_ec;
+  acceptor.close(close_ec);
+  p_worker.reset();
+  threads.join_all();
+
+  CryptoProtocol::invalidate_endpoint_contexts();
+}
+
+TEST(PhysicalLayerTest, TLSSessionResumptionOverTCPTest) {
+  TestTLSSessionResumptionOverTCP("");
+  TestTLSSessionResumptionOverTCP("tls13");
+}
+
+TEST(PhysicalLayerTest, TLSWriteCoalescingOverTCPTest) {
+  typedef ssf::layer::physical::TLSoTCPPhysicalLayer TLSStackProtocol;
+  typedef TLSStackProtocol::CryptoProtocol CryptoProtocol;
+
+  auto tls_client_parameters =
+      tests::virtual_network_helpers::tls_client_parameters;
+  tls_client_parameters["write_coalescing"] = "true";
+  tls_client_parameters["write_record_size"] = "4096";
+
+  ssf::layer::ParameterStack acceptor_parameters;
+  acceptor_parameters.push_back(
+      tests::virtual_network_helpers::tls_server_parameters);
+  acceptor_parameters.push_back(tcp_server_parameters);
+
+  ssf::layer::ParameterStack client_parameters;
+  client_parameters.push_back(tls_client_parameters);
+  client_parameters.push_back(tcp_client_parameters);
+
+  // Each writer chains messages starting with its id and their sequence,
+  // some of them overflowing a record
+  enum { writers = 4, messages = 64 };
+  std::vector<std::vector<std::vector<uint8_t>>> payloads(writers);
+  std::size_t total_size = 0;
+  for (uint8_t writer = 0; writer < writers; ++writer) {
+    for (uint8_t sequence = 0; sequence < messages; ++sequence) {
+      std::vector<uint8_t> message(
+          2 + (writer * 1000 + sequence * 397) % 6000,
+          static_cast<uint8_t>(writer + sequence));
+      message[0] = writer;
+      message[1] = sequence;
+      total_size += message.size();
+      payloads[writer].push_back(std::move(message));
+    }
+  }
+
+  boost::asio::io_service io_service;
+  std::unique_ptr<boost::asio::io_service::work> p_worker(
+      new boost::asio::io_service::work(io_service));
+  boost::thread_group threads;
+  for (uint16_t i = 1; i <= boost::thread::hardware_concurrency(); ++i) {
+    threads.create_thread([&io_service]() { io_service.run(); });
+  }
+
+  TLSStackProtocol::resolver resolver(io_service);
+  TLSStackProtocol::acceptor acceptor(io_service);
+  TLSStackProtocol::socket client(io_service);
+  TLSStackProtocol::socket server(io_service);
+  boost::system::error_code ec;
+
+  TLSStackProtocol::endpoint acceptor_endpoint(
+      *resolver.resolve(acceptor_parameters, ec));
+  EXPECT_EQ(0, ec.value()) << ec.message();
+  TLSStackProtocol::endpoint remote_endpoint(
+      *resolver.resolve(client_parameters, ec));
+  EXPECT_EQ(0, ec.value()) << ec.message();
+
+  acceptor.open();
+  acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+  acceptor.bind(acceptor_endpoint, ec);
+  EXPECT_EQ(0, ec.value()) << "Bind acceptor should not be in error: "
+                           << ec.message();
+  acceptor.listen(100, ec);
+  EXPECT_EQ(0, ec.value()) << "Listen acceptor should not be in error: "
+                           << ec.message();
+
+  boost::system::error_code accept_ec;
+  boost::system::error_code connect_ec;
+  boost::thread accepting([&acceptor, &server, &accept_ec]() {
+    acceptor.accept(server, accept_ec);
+  });
+  client.connect(remote_endpoint, connect_ec);
+  accepting.join();
+
+  EXPECT_EQ(0, accept_ec.value()) << accept_ec.message();
+  EXPECT_EQ(0, connect_ec.value()) << connect_ec.message();
+
+  // Every write must complete whole, gathered or not
+  std::vector<std::function<void(uint8_t)>> write_messages(writers);
+  for (uint8_t writer = 0; writer < writers; ++writer) {
+    write_messages[writer] = [&, writer](uint8_t sequence) {
+      if (sequence == messages) {
+        return;
+      }
+
+      auto& message = payloads[writer][sequence];
+      client.async_write_some(
+          boost::asio::buffer(message),
+          [&, writer, sequence](const boost::system::error_code& write_ec,
+                                std::size_t length) {
+            EXPECT_EQ(0, write_ec.value()) << write_ec.message();
+            EXPECT_EQ(message.size(), length)
+                << "Partial write " << static_cast<int>(sequence)
+                << " of writer " << static_cast<int>(writer);
+            if (write_ec || length != message.size()) {
+              // Fail the read instead of waiting for the missing bytes
+              boost::system::error_code close_ec;
+              client.close(close_ec);
+              return;
+            }
+
+            write_messages[writer](sequence + 1);
+          });
+    };
+  }
+
+  std::vector<uint8_t> received(total_size);
+  boost::system::error_code read_ec;
+  if (!accept_ec && !connect_ec) {
+    for (uint8_t writer = 0; writer < writers; ++writer) {
+      io_service.post(
+          [&write_messages, writer]() { write_messages[writer](0); });
+    }
+
+    boost::asio::read(server, boost::asio::buffer(received), read_ec);
+    EXPECT_EQ(0, read_ec.value()) << read_ec.message();
+  } else {
+    read_ec = boost::asio::error::not_connected;
+  }
+
+  // Messages of each writer arrive whole and in order
+  std::vector<uint8_t> next_sequences(writers, 0);
+  std::size_t offset = 0;
+  while (!read_ec && offset < received.size()) {
+    uint8_t writer = received[offset];
+    if (writer >= writers || next_sequences[writer] == messages) {
+      ADD_FAILURE() << "Write interleaved at " << offset;
+      break;
+    }
+
+    auto& message = payloads[writer][next_sequences[writer]];
+    if (offset + message.size() > received.size() ||
+        !std::equal(message.begin(), message.end(),
+                    received.begin() + offset)) {
+      ADD_FAILURE() << "Write " << static_cast<int>(next_sequences[writer])
+                    << " of writer " << static_cast<int>(writer)
+                    << " interleaved or reordered";
+      break;
+    }
+
+    offset += message.size();
+    ++next_sequences[writer];
+  }
+
+  boost::system::error_code close_ec;
+  client.close(close_ec);
+  server.close(close_ec);
+  acceptor.close(close_ec);
+  p_worker.reset();
+  threads.join_all();
+
+  CryptoProtocol::invalidate_endpoint_contexts();
+}
+
+TEST(PhysicalLayerTest, TLSDirectReadOverTCPTest) {
+  typedef ssf::layer::physical::TLSboTCPPhysicalLayer TLSStackProtocol;
+  typedef TLSStackProtocol::CryptoProtocol CryptoProtocol;
+
+  ssf::layer::ParameterStack acceptor_parameters;
+  acceptor_parameters.push_back(
+      tests::virtual_network_helpers::tls_server_parameters);
+  acceptor_parameters.push_back(tcp_server_parameters);
+
+  ssf::layer::ParameterStack client_parameters;
+  client_parameters.push_back(
+      tests::virtual_network_helpers::tls_client_parameters);
+  client_parameters.push_back(tcp_client_parameters);
+
+  boost::asio::io_service io_service;
+  std::unique_ptr<boost::asio::io_service::work> p_worker(
+      new boost::asio::io_service::work(io_service));
+  boost::thread_group threads;
+  for (uint16_t i = 1; i <= boost::thread::hardware_concurrency(); ++i) {
+    threads.create_thread([&io_service]() { io_service.run(); });
+  }
+
+  TLSStackProtocol::resolver resolver(io_service);
+  TLSStackProtocol::acceptor acceptor(io_service);
+  TLSStackProtocol::socket client(io_service);
+  TLSStackProtocol::socket server(io_service);
+  boost::system::error_code ec;
+
+  TLSStackProtocol::endpoint acceptor_endpoint(
+      *resolver.resolve(acceptor_parameters, ec));
+  EXPECT_EQ(0, ec.value()) << ec.message();
+  TLSStackProtocol::endpoint remote_endpoint(
+      *resolver.resolve(client_parameters, ec));
+  EXPECT_EQ(0, ec.value()) << ec.message();
+
+  acceptor.open();
+  acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+  acceptor.bind(acceptor_endpoint, ec);
+  EXPECT_EQ(0, ec.value()) << "Bind acceptor should not be in error: "
+                           << ec.message();
+  acceptor.listen(100, ec);
+  EXPECT_EQ(0, ec.value()) << "Listen acceptor should not be in error: "
+                           << ec.message();
+
+  boost::system::error_code accept_ec;
+  boost::system::error_code connect_ec;
+  boost::thread accepting([&acceptor, &server, &accept_ec]() {
+    acceptor.accept(server, accept_ec);
+  });
+  client.connect(remote_endpoint, connect_ec);
+  accepting.join();
+
+  EXPECT_EQ(0, accept_ec.value()) << accept_ec.message();
+  EXPECT_EQ(0, connect_ec.value()) << connect_ec.message();
+
+  if (!accept_ec && !connect_ec) {
+    // Reads shorter than a record are served from the queue, the others
+    // may receive directly : the bytes stay in order across both paths
+    std::vector<uint8_t> sent(3 * 16384 + 777);
+    for (std::size_t i = 0; i < sent.size(); ++i) {
+      sent[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+    }
+
+    boost::system::error_code write_ec;
+    boost::thread writing([&client, &sent, &write_ec]() {
+      boost::asio::write(client, boost::asio::buffer(sent), write_ec);
+    });
+
+    const std::size_t read_sizes[] = {1, 100, 20000};
+    std::vector<uint8_t> received(sent.size());
+    std::size_t offset = 0;
+    boost::system::error_code read_ec;
+    for (std::size_t i = 0; !read_ec && offset < received.size(); ++i) {
+      auto size = std::min(read_sizes[i % 3], received.size() - offset);
+      offset += server.read_some(
+          boost::asio::buffer(&received[offset], size), read_ec);
+    }
+    writing.join();
+
+    EXPECT_EQ(0, write_ec.value()) << write_ec.message();
+    EXPECT_EQ(0, read_ec.value()) << read_ec.message();
+    EXPECT_TRUE(sent == received) << "Short and direct reads reordered data";
+
+    // A read queued when data arrives receives the next record directly,
+    // the cancel runs on the strand once that direct read is started
+    std::vector<uint8_t> first(1);
+    std::vector<uint8_t> direct(20000);
+    std::promise<boost::system::error_code> direct_done;
+    server.async_read_some(
+        boost::asio::buffer(first),
+        [&server, &direct, &direct_done](const boost::system::error_code& ec,
+                                         std::size_t) {
+          EXPECT_EQ(0, ec.value()) << ec.message();
+          server.async_read_some(
+              boost::asio::buffer(direct),
+              [&direct_done](const boost::system::error_code& ec,
+                             std::size_t) { direct_done.set_value(ec); });
+          server.native_handle().p_next_layer_socket->strand().post(
+              [&server]() {
+                boost::system::error_code cancel_ec;
+                server.cancel(cancel_ec);
+              });
+        });
+    boost::asio::write(client, boost::asio::buffer(first), write_ec);
+
+    EXPECT_EQ(boost::asio::error::operation_aborted,
+              direct_done.get_future().get())
+        << "Direct read not cancelled";
+
+    // The stream still works after the cancel
+    boost::asio::write(client, boost::asio::buffer(sent, 5), write_ec);
+    EXPECT_EQ(0, write_ec.value()) << write_ec.message();
+    std::vector<uint8_t> next(5);
+    boost::asio::read(server, boost::asio::buffer(next), read_ec);
+    EXPECT_EQ(0, read_ec.value()) << read_ec.message();
+    EXPECT_TRUE(std::equal(next.begin(), next.end(), sent.begin()));
+  }
+
+  boost::system::error_code close_ec;
+  client.close(close_ec);
+  server.close(close_ec);
+  acceptor.close(close_ec);
+  p_worker.reset();
+  threads.join_all();
+
+  CryptoProtocol::invalidate_endpoint_contexts();
+}
+
+TEST(PhysicalLayerTest, TLSContextCacheTest) {
+  typedef ssf::layer::physical::TLSboTCPPhysicalLayer TLSStackProtocol;
+  typedef TLSStackProtocol::CryptoProtocol CryptoProtocol;
+
+  boost::asio::io_service io_service;
+  TLSStackProtocol::resolver resolver(io_service);
+  boost::system::error_code ec;
+
+  ssf::layer::ParameterStack server_parameters;
+  server_parameters.push_back(
+      tests::virtual_network_helpers::tls_server_parameters);
+  server_parameters.push_back(tcp_server_parameters);
+
+  ssf::layer::ParameterStack client_parameters;
+  client_parameters.push_back(
+      tests::virtual_network_helpers::tls_client_parameters);
+  client_parameters.push_back(tcp_client_parameters);
+
+  CryptoProtocol::invalidate_endpoint_contexts();
+
+  TLSStackProtocol::endpoint server1(*resolver.resolve(server_parameters, ec));
+  ASSERT_EQ(0, ec.value()) << ec.message();
+  TLSStackProtocol::endpoint server2(*resolver.resolve(server_parameters, ec));
+  ASSERT_EQ(0, ec.value()) << ec.message();
+  TLSStackProtocol::endpoint client(*resolver.resolve(client_parameters, ec));
+  ASSERT_EQ(0, ec.value()) << ec.message();
+
+  ASSERT_TRUE(server1.endpoint_context() == server2.endpoint_context())
+      << "Same parameters should share their context";
+  ASSERT_TRUE(server1 == server2);
+  ASSERT_TRUE(server1.endpoint_context() != client.endpoint_context())
+      << "Different parameters should not share their context";
+
+  ASSERT_TRUE(CryptoProtocol::invalidate_endpoint_context(
+      tests::virtual_network_helpers::tls_server_parameters));
+  ASSERT_FALSE(CryptoProtocol::invalidate_endpoint_context(
+      tests::virtual_network_helpers::tls_server_parameters));
+
+  TLSStackProtocol::endpoint server3(*resolver.resolve(server_parameters, ec));
+  ASSERT_EQ(0, ec.value()) << ec.message();
+  ASSERT_TRUE(server1.endpoint_context() != server3.endpoint_context())
+      << "Invalidated context should be rebuilt";
+  ASSERT_FALSE(!server1.endpoint_context())
+      << "Invalidated context should stay valid for its users";
+
+  CryptoProtocol::invalidate_endpoint_contexts();
+}
+
+TEST(PhysicalLayerTest, TLSUInt32FieldTest) {
+  using ssf::layer::cryptography::detail::GetUInt32Field;
+
+  ssf::layer::LayerParameters parameters = {{"value", "42"},
+                                            {"max", "4294967295"},
+                                            {"overflow", "4294967296"},
+                                            {"negative", "-1"},
+                                            {"signed", "+1"},
+                                            {"space", " 1"},
+                                            {"trailing", "12abc"},
+                                            {"text", "abc"}};
+  uint32_t value = 0;
+
+  ASSERT_TRUE(GetUInt32Field(parameters, "unset", 7, &value));
+  ASSERT_EQ(7, value) << "Unset field is the default value";
+  ASSERT_TRUE(GetUInt32Field(parameters, "value", 7, &value));
+  ASSERT_EQ(42, value);
+  ASSERT_TRUE(GetUInt32Field(parameters, "max", 7, &value));
+  ASSERT_EQ(4294967295u, value);
+
+  for (const auto& key : {"overflow", "negative", "signed", "space",
+                          "trailing", "text"}) {
+    ASSERT_FALSE(GetUInt32Field(parameters, key, 7, &value)) << key;
+  }
+}
+
+TEST(PhysicalLayerTest, TLSBufferingOptionsTest) {
+  using ssf::layer::cryptography::detail::GetCtxBuffering;
+  using ssf::layer::cryptography::detail::SetCtxBuffering;
+  using ssf::layer::cryptography::detail::TLSBufferingOptions;
+
+  auto set_buffering = [](const ssf::layer::LayerParameters& parameters,
+                          TLSBufferingOptions* p_options) {
+    boost::asio::ssl::context ctx(boost::asio::ssl::context::sslv23);
+    auto set = SetCtxBuffering(ctx, parameters);
+    *p_options = GetCtxBuffering(ctx.native_handle());
+    return set;
+  };
+
+  TLSBufferingOptions options;
+  ASSERT_TRUE(set_buffering({}, &options));
+  ASSERT_EQ(TLSBufferingOptions::default_receive_buffer_size,
+            options.receive_buffer_size);
+  ASSERT_EQ(TLSBufferingOptions::default_low_watermark, options.low_watermark);
+  ASSERT_EQ(TLSBufferingOptions::default_high_watermark,
+            options.high_watermark);
+  ASSERT_FALSE(options.adaptive);
+  ASSERT_TRUE(options.direct_read);
+  ASSERT_FALSE(options.coalesce_writes);
+
+  ASSERT_TRUE(set_buffering({{"receive_buffer_size", "4096"},
+                             {"low_watermark", "1000"},
+                             {"high_watermark", "8000"},
+                             {"adaptive_buffering", "true"},
+                             {"direct_read", "false"},
+                             {"write_coalescing", "true"},
+                             {"write_record_size", "4096"},
+                             {"write_flush_latency", "50"}},
+                            &options));
+  ASSERT_EQ(4096, options.receive_buffer_size);
+  ASSERT_EQ(1000, options.low_watermark);
+  ASSERT_EQ(8000, options.high_watermark);
+  ASSERT_TRUE(options.adaptive);
+  ASSERT_FALSE(options.direct_read);
+  ASSERT_TRUE(options.coalesce_writes);
+  ASSERT_EQ(4096, options.write_record_size);
+  ASSERT_EQ(50, options.write_flush_latency);
+
+  ASSERT_FALSE(set_buffering({{"receive_buffer_size", "0"}}, &options));
+  ASSERT_FALSE(set_buffering({{"high_watermark", "0"}}, &options));
+  ASSERT_FALSE(set_buffering(
+      {{"low_watermark", "2000"}, {"high_watermark", "1000"}}, &options))
+      << "Low watermark above the high watermark";
+  ASSERT_FALSE(set_buffering({{"write_record_size", "0"}}, &options));
+  ASSERT_FALSE(set_buffering({{"write_record_size", "16385"}}, &options))
+      << "Write records above the TLS record size";
+  ASSERT_FALSE(set_buffering({{"low_watermark", "-1"}}, &options));
+  ASSERT_FALSE(set_buffering({{"write_flush_latency", "1ms"}}, &options));
+}
+
+TEST(PhysicalLayerTest, TLSBufferingBudgetTest) {
+  using ssf::layer::cryptography::detail::TLSBufferingBudget;
+
+  auto used = TLSBufferingBudget::Used();
+
+  TLSBufferingBudget::SetLimit(0);
+  ASSERT_TRUE(TLSBufferingBudget::Reserve(1 << 30, false)) << "No limit";
+  TLSBufferingBudget::Release(1 << 30);
+  ASSERT_EQ(used, TLSBufferingBudget::Used());
+
+  TLSBufferingBudget::SetLimit(used + 100);
+  ASSERT_EQ(used + 100, TLSBufferingBudget::Limit());
+  ASSERT_TRUE(TLSBufferingBudget::Reserve(60, false));
+  ASSERT_EQ(used + 60, TLSBufferingBudget::Used());
+  ASSERT_FALSE(TLSBufferingBudget::Reserve(50, false))
+      << "Reservation above the budget";
+  ASSERT_EQ(used + 60, TLSBufferingBudget::Used())
+      << "Failed reservation should not be accounted";
+  ASSERT_TRUE(TLSBufferingBudget::Reserve(40, false));
+  ASSERT_TRUE(TLSBufferingBudget::Reserve(50, true)) << "Forced reservation";
+  ASSERT_EQ(used + 150, TLSBufferingBudget::Used());
+
+  TLSBufferingBudget::Release(150);
+  ASSERT_EQ(used, TLSBufferingBudget::Used());
+  TLSBufferingBudget::SetLimit(0);
+}
+
+TEST(PhysicalLayerTest, TLSReceiveWindowTest) {
+  using ssf::layer::cryptography::detail::TLSBufferingOptions;
+  using ssf::layer::cryptography::detail::TLSReceiveWindow;
+
+  TLSBufferingOptions options;
+  options.receive_buffer_size = 40000;
+  options.low_watermark = 20000;
+  options.high_watermark = 1000000;
+
+  TLSReceiveWindow fixed_window(options);
+  fixed_window.ReadCompleted(40000, 40000);
+  fixed_window.Consumed(10000000);
+  boost::this_thread::sleep_for(boost::chrono::milliseconds(110));
+  fixed_window.Update();
+  ASSERT_EQ(40000, fixed_window.read_size()) << "Window not adaptive";
+  ASSERT_EQ(20000, fixed_window.low_watermark());
+  ASSERT_EQ(1000000, fixed_window.high_watermark());
+
+  // Adaptive windows read one record and buffer twice the configured read
+  // size (at least the low watermark), keeping the low/high ratio
+  options.adaptive = true;
+  TLSReceiveWindow window(options);
+  ASSERT_EQ(TLSBufferingOptions::max_record_size, window.read_size());
+  ASSERT_EQ(80000, window.high_watermark());
+  ASSERT_EQ(1600, window.low_watermark());
+
+  // Updates wait for the adaptation interval
+  window.ReadCompleted(window.read_size(), window.read_size());
+  window.Consumed(10000000);
+  window.Update();
+  ASSERT_EQ(TLSBufferingOptions::max_record_size, window.read_size());
+
+  // Full reads double the read size, the high watermark follows the
+  // consumer, both up to the configured ones
+  boost::this_thread::sleep_for(boost::chrono::milliseconds(110));
+  window.Update();
+  ASSERT_EQ(2 * TLSBufferingOptions::max_record_size, window.read_size());
+  ASSERT_EQ(1000000, window.high_watermark());
+  ASSERT_EQ(20000, window.low_watermark());
+
+  window.ReadCompleted(window.read_size(), window.read_size());
+  window.Consumed(10000000);
+  boost::this_thread::sleep_for(boost::chrono::milliseconds(110));
+  window.Update();
+  ASSERT_EQ(40000, window.read_size()) << "Read size above the configured one";
+
+  // Idle consumer : both shrink
+  boost::this_thread::sleep_for(boost::chrono::milliseconds(110));
+  window.Update();
+  ASSERT_EQ(20000, window.read_size());
+  ASSERT_EQ(500000, window.high_watermark());
+  ASSERT_EQ(10000, window.low_watermark());
+}
+
+TEST(PhysicalLayerTest, TLSCryptoAccelerationTest) {
+  typedef ssf::layer::physical::TLSoTCPPhysicalLayer TLSStackProtocol;
+  typedef TLSStackProtocol::CryptoProtocol CryptoProtocol;
+  using ssf::layer::cryptography::detail::GetPreferAESGCM;
+  using ssf::layer::cryptography::detail::HasHardwareAESGCM;
+
+  bool prefer_aes = false;
+  ASSERT_TRUE(GetPreferAESGCM({}, &prefer_aes));
+  ASSERT_EQ(HasHardwareAESGCM(), prefer_aes);
+  ASSERT_TRUE(GetPreferAESGCM({{"crypto_acceleration", "on"}}, &prefer_aes));
+  ASSERT_TRUE(prefer_aes);
+  ASSERT_TRUE(GetPreferAESGCM({{"crypto_acceleration", "off"}}, &prefer_aes));
+  ASSERT_FALSE(prefer_aes);
+  ASSERT_FALSE(GetPreferAESGCM({{"crypto_acceleration", "fast"}}, &prefer_aes));
+  ASSERT_FALSE(GetPreferAESGCM({{"crypto_acceleration", "ON"}}, &prefer_aes));
+
+  // An unknown value fails the endpoint resolution
+  boost::asio::io_service io_service;
+  TLSStackProtocol::resolver resolver(io_service);
+  boost::system::error_code ec;
+
+  auto tls_parameters = tests::virtual_network_helpers::tls_client_parameters;
+  tls_parameters["crypto_acceleration"] = "fast";
+  ssf::layer::ParameterStack parameters;
+  parameters.push_back(tls_parameters);
+  parameters.push_back(tcp_client_parameters);
+  resolver.resolve(parameters, ec);
+  ASSERT_NE(0, ec.value()) << "Invalid crypto acceleration accepted";
+
+  CryptoProtocol::invalidate_endpoint_contexts();
+}
+
+TEST(PhysicalLayerTest, TLSCryptoEngineTest) {
+  using ssf::layer::cryptography::detail::GetCryptoCapabilities;
+  using ssf::layer::cryptography::detail::make_tls_context;
+
+  boost::asio::io_service io_service;
+
+  auto missing_parameters =
+      tests::virtual_network_helpers::tls_client_parameters;
+  missing_parameters["crypto_engine"] = "missing-engine";
+  ASSERT_TRUE(!make_tls_context(io_service, missing_parameters))
+      << "Unknown crypto engine accepted";
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  auto tls_parameters = tests::virtual_network_helpers::tls_client_parameters;
+  tls_parameters["crypto_engine"] = "default";
+  auto context = make_tls_context(io_service, tls_parameters);
+  ASSERT_FALSE(!context);
+
+  // Fetches with the default properties, as the context does
+  auto p_cipher = EVP_CIPHER_fetch(nullptr, "AES-256-GCM", nullptr);
+  ASSERT_NE(nullptr, p_cipher);
+  EXPECT_STREQ("default",
+               OSSL_PROVIDER_get0_name(EVP_CIPHER_get0_provider(p_cipher)));
+  EVP_CIPHER_free(p_cipher);
+  EXPECT_NE(std::string::npos, GetCryptoCapabilities().engines.find("default"));
+
+  // Back to the builtin selection for the other tests
+  EVP_set_default_properties(nullptr, "");
+#endif
+}
+
+TEST(PhysicalLayerTest, TLSDhparamTest) {
+  typedef ssf::layer::physical::TLSoTCPPhysicalLayer TLSStackProtocol;
+  typedef TLSStackProtocol::CryptoProtocol CryptoProtocol;
+
+  boost::asio::io_service io_service;
+  TLSStackProtocol::resolver resolver(io_service);
+  boost::system::error_code ec;
+
+  CryptoProtocol::invalidate_endpoint_contexts();
+
+  // A configured DH parameter source must load
+  auto missing_file_parameters =
+      tests::virtual_network_helpers::tls_server_parameters;
+  missing_file_parameters["dhparam_file"] = "./certs/missing_dh.pem";
+  ssf::layer::ParameterStack missing_file_stack;
+  missing_file_stack.push_back(missing_file_parameters);
+  missing_file_stack.push_back(tcp_server_parameters);
+  resolver.resolve(missing_file_stack, ec);
+  ASSERT_NE(0, ec.value()) << "Missing DH parameter file";
+
+  // The compat profile (finite field DHE) cannot accept without them
+  auto no_dhparam_parameters =
+      tests::virtual_network_helpers::tls_server_parameters;
+  no_dhparam_parameters.erase("dhparam_src");
+  no_dhparam_parameters.erase("dhparam_file");
+  ssf::layer::ParameterStack compat_stack;
+  compat_stack.push_back(no_dhparam_parameters);
+  compat_stack.push_back(tcp_server_parameters);
+  TLSStackProtocol::endpoint compat_endpoint(
+      *resolver.resolve(compat_stack, ec));
+  ASSERT_EQ(0, ec.value()) << "Clients do not need DH parameters: "
+                           << ec.message();
+
+  TLSStackProtocol::acceptor compat_acceptor(io_service);
+  compat_acceptor.open();
+  compat_acceptor.bind(compat_endpoint, ec);
+  ASSERT_EQ(ssf::error::no_dh_param_error, ec.value())
+      << "Compat acceptor without DH parameters";
+
+  // ECDHE profiles do not use them
+  no_dhparam_parameters["cipher_profile"] = "fast-ecdhe";
+  ssf::layer::ParameterStack ecdhe_stack;
+  ecdhe_stack.push_back(no_dhparam_parameters);
+  ecdhe_stack.push_back(tcp_server_parameters);
+  TLSStackProtocol::endpoint ecdhe_endpoint(*resolver.resolve(ecdhe_stack, ec));
+  ASSERT_EQ(0, ec.value()) << ec.message();
+
+  TLSStackProtocol::acceptor ecdhe_acceptor(io_service);
+  ecdhe_acceptor.open();
+  ecdhe_acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+  ecdhe_acceptor.bind(ecdhe_endpoint, ec);
+  ASSERT_EQ(0, ec.value()) << "ECDHE acceptor without DH parameters: "
+                           << ec.message();
+
+  boost::system::error_code close_ec;
+  ecdhe_acceptor.close(close_ec);
+
+  CryptoProtocol::invalidate_endpoint_contexts();
+}
+
+TEST(PhysicalLayerTest, FramedDatagramReceiveOverTCPTest) {
+  typedef ssf::layer::physical::TCPPhysicalLayer StreamStackProtocol;
+
+  ssf::layer::ParameterStack acceptor_parameters;
+  acceptor_parameters.push_back(tcp_server_parameters);
+
+  ssf::layer::ParameterStack client_parameters;
+  client_parameters.push_back(tcp_client_parameters);
+
+  tests::framed_datagram_helpers::TestFramedDatagramReceive<
+      StreamStackProtocol>(client_parameters, acceptor_parameters);
+}
+
 TEST(PhysicalLayerTest, EmptyDatagramProtocolStackOverUDPTest) {
   typedef ssf::layer::physical::UDPPhysicalLayer
       DatagramStackProtocol;
@@ -4,8 +4,12 @@
 
 #include <atomic>
 #include <chrono>
+#include <functional>
 #include <future>
+#include <iostream>
 #include <set>
+#include <string>
+#include <vector>
 
 #include <boost/asio/ip/udp.hpp>
 #include <boost/asio/use_future.hpp>
@@ -17,8 +21,11 @@
 #include <boost/thread.hpp>
 
 #include "ssf/layer/queue/async_queue.h"
+#include "ssf/layer/queue/commutator.h"
 #include "ssf/layer/queue/send_queued_datagram_socket.h"
 
+#include "tests/tools.h"
+
 TEST(QueueTest, async_queue_limit_test) {
   boost::asio::io_service io_service;
 
@@ -287,6 +294,260 @@ TEST(QueueTest, async_queue_spawn_test) {
   queue.clear();
 }
 
+TEST(QueueTest, lockfree_async_queue_test) {
+  boost::asio::io_service io_service;
+
+  typedef ssf::layer::queue::lockfree_async_queue<uint32_t, 2, 2>
+      LimitQueueTest;
+
+  LimitQueueTest queue(io_service);
+
+  boost::system::error_code main_ec;
+  std::vector<uint32_t> got_elements;
+
+  auto pushed = [&](const boost::system::error_code& ec) {
+    EXPECT_EQ(0, ec.value());
+  };
+  auto canceled_pushed = [&](const boost::system::error_code& ec) {
+    EXPECT_EQ(ssf::error::operation_canceled, ec.value());
+  };
+  auto got = [&](const boost::system::error_code& ec, uint32_t element) {
+    EXPECT_EQ(0, ec.value());
+    got_elements.push_back(element);
+  };
+  auto canceled_got = [&](const boost::system::error_code& ec,
+                          uint32_t element) {
+    EXPECT_EQ(ssf::error::operation_canceled, ec.value());
+  };
+
+  queue.push(1, main_ec);
+  EXPECT_EQ(0, main_ec.value());
+  queue.push(2, main_ec);
+  EXPECT_EQ(0, main_ec.value());
+  queue.push(3, main_ec);  // fails because the queue limit was reached
+  EXPECT_NE(0, main_ec.value());
+  EXPECT_EQ(2, queue.size());
+
+  queue.async_push(3, pushed);  // op queued until an element is got
+  queue.async_get(got);
+  queue.async_get(got);
+  queue.async_get(got);
+  io_service.run();
+  io_service.reset();
+
+  ASSERT_EQ(3, got_elements.size());
+  EXPECT_EQ(1, got_elements[0]);
+  EXPECT_EQ(2, got_elements[1]);
+  EXPECT_EQ(3, got_elements[2]);
+  EXPECT_EQ(0, queue.size());
+
+  queue.push(4, main_ec);
+  queue.push(5, main_ec);
+  queue.async_push(6, canceled_pushed);
+  queue.close(main_ec);
+  EXPECT_EQ(0, main_ec.value());
+  queue.async_get([&](const boost::system::error_code& ec, uint32_t element) {
+    EXPECT_EQ(ssf::error::broken_pipe, ec.value());
+  });
+  io_service.run();
+  io_service.reset();
+
+  EXPECT_EQ(0, queue.size());
+
+  LimitQueueTest closed_queue(io_service);
+  closed_queue.async_get(canceled_got);
+  closed_queue.close(main_ec);
+  io_service.run();
+}
+
+TEST(QueueTest, lockfree_async_queue_push_limit_test) {
+  boost::asio::io_service io_service;
+
+  // Ring of 4 slots for a queue limited to 3 elements
+  typedef ssf::layer::queue::lockfree_async_queue<uint32_t, 3, 2>
+      LimitQueueTest;
+
+  LimitQueueTest queue(io_service);
+
+  boost::system::error_code main_ec;
+  std::vector<uint32_t> got_elements;
+  bool pushed = false;
+
+  for (uint32_t i = 1; i <= 3; ++i) {
+    queue.push(i, main_ec);
+    EXPECT_EQ(0, main_ec.value());
+  }
+
+  queue.async_push(4, [&](const boost::system::error_code& ec) {
+    EXPECT_EQ(0, ec.value());
+    pushed = true;
+  });
+  io_service.poll();
+  io_service.reset();
+
+  EXPECT_FALSE(pushed) << "Push op served beyond the queue limit";
+  EXPECT_EQ(3, queue.size());
+
+  queue.async_get([&](const boost::system::error_code& ec, uint32_t element) {
+    EXPECT_EQ(0, ec.value());
+    got_elements.push_back(element);
+  });
+  io_service.poll();
+  io_service.reset();
+
+  EXPECT_TRUE(pushed);
+  ASSERT_EQ(1, got_elements.size());
+  EXPECT_EQ(1, got_elements[0]);
+  EXPECT_EQ(3, queue.size());
+
+  queue.close(main_ec);
+  io_service.run();
+}
+
+template <class Queue>
+void TestAsyncQueueBatch() {
+  boost::asio::io_service io_service;
+
+  // Queue limited to 4 elements
+  Queue queue(io_service);
+
+  typename Queue::elements_type elements = {1, 2, 3, 4, 5, 6};
+  typename Queue::elements_type got_elements;
+  std::size_t pushed_count = 0;
+
+  auto pushed = [&](const boost::system::error_code& ec, std::size_t pushed) {
+    EXPECT_EQ(0, ec.value());
+    pushed_count = pushed;
+  };
+  auto got_all = [&](const boost::system::error_code& ec,
+                     typename Queue::elements_type elements) {
+    EXPECT_EQ(0, ec.value());
+    EXPECT_EQ(3, elements.size());
+    got_elements.insert(got_elements.end(), elements.begin(), elements.end());
+  };
+  auto got_some = [&](const boost::system::error_code& ec,
+                      typename Queue::elements_type elements) {
+    EXPECT_EQ(0, ec.value());
+    EXPECT_EQ(3, elements.size());
+    got_elements.insert(got_elements.end(), elements.begin(), elements.end());
+    queue.async_get_some(0, got_all);
+  };
+
+  // Elements 5 and 6 are pushed once room is made
+  queue.async_push_some(elements, pushed);
+  queue.async_get_some(3, got_some);
+
+  io_service.run();
+
+  EXPECT_EQ(6, pushed_count);
+  EXPECT_EQ(elements, got_elements);
+  EXPECT_EQ(0, queue.size());
+
+  io_service.reset();
+  boost::system::error_code ec;
+  queue.async_get_some(
+      2, [&](const boost::system::error_code& ec,
+             typename Queue::elements_type elements) {
+        EXPECT_EQ(ssf::error::operation_canceled, ec.value());
+        EXPECT_TRUE(elements.empty());
+      });
+  io_service.poll();
+  queue.close(ec);
+  io_service.run();
+}
+
+TEST(QueueTest, async_queue_batch_test) {
+  TestAsyncQueueBatch<ssf::layer::queue::basic_async_queue<
+      uint32_t, std::queue<uint32_t>, 4, 4>>();
+  TestAsyncQueueBatch<
+      ssf::layer::queue::lockfree_async_queue<uint32_t, 4, 4>>();
+}
+
+/// Select output 1 for odd elements and 2 for even ones
+struct ParitySelector {
+  bool operator()(uint32_t* p_id, uint32_t* p_element) const {
+    *p_id = (*p_element % 2) ? 1 : 2;
+    return true;
+  }
+};
+
+TEST(QueueTest, commutator_forwarding_test) {
+  typedef ssf::layer::queue::Commutator<uint32_t, uint32_t, ParitySelector>
+      Commutator;
+  typedef ssf::layer::queue::basic_async_queue<uint32_t> Queue;
+
+  static const uint32_t nb_of_inputs = 4;
+  static const uint32_t nb_of_elements = 10000;
+  static const uint64_t total = nb_of_inputs * nb_of_elements;
+
+  boost::asio::io_service io_service;
+  ParitySelector selector;
+  auto p_commutator = Commutator::Create(io_service, selector);
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  for (uint32_t i = 0; i < nb_of_inputs; ++i) {
+    queues.emplace_back(new Queue(io_service));
+  }
+
+  std::atomic<uint64_t> received(0);
+  std::atomic<uint64_t> odd_received(0);
+  std::atomic<uint64_t> sum(0);
+  std::atomic<bool> in_output[2] = {{false}, {false}};
+
+  auto output = [&](uint32_t output_id, uint32_t element,
+                    Commutator::OutputHandler handler) {
+    // Output callbacks are serialized by their strand
+    EXPECT_FALSE(in_output[output_id - 1].exchange(true));
+    EXPECT_EQ(output_id == 1, element % 2 == 1);
+    if (output_id == 1) {
+      ++odd_received;
+    }
+    sum += element;
+    in_output[output_id - 1] = false;
+
+    handler(boost::system::error_code());
+
+    if (++received == total) {
+      boost::system::error_code ec;
+      for (auto& p_queue : queues) {
+        p_queue->close(ec);
+      }
+    }
+  };
+
+  p_commutator->RegisterOutput(1, boost::bind<void>(output, 1, _1, _2));
+  p_commutator->RegisterOutput(2, boost::bind<void>(output, 2, _1, _2));
+
+  for (uint32_t i = 0; i < nb_of_inputs; ++i) {
+    auto p_queue = queues[i].get();
+    p_commutator->RegisterInput(
+        10 + i, [p_queue](Commutator::InputHandler handler) {
+          p_queue->async_get(std::move(handler));
+        });
+  }
+
+  boost::system::error_code ec;
+  for (uint32_t element = 1; element <= nb_of_elements; ++element) {
+    for (auto& p_queue : queues) {
+      p_queue->push(element, ec);
+      ASSERT_EQ(0, ec.value());
+    }
+  }
+
+  boost::thread_group threads;
+  for (uint16_t i = 1; i <= boost::thread::hardware_concurrency(); ++i) {
+    threads.create_thread([&io_service]() { io_service.run(); });
+  }
+  threads.join_all();
+
+  p_commutator->close(ec);
+
+  ASSERT_EQ(total, received.load());
+  ASSERT_EQ(total / 2, odd_received.load());
+  ASSERT_EQ(nb_of_inputs * nb_of_elements * (nb_of_elements + 1) / 2,
+            sum.load());
+}
+
  TEST(QueueTest, send_queued_datagram_socket) {
   static const uint32_t number_of_senders = 100;
   static const uint32_t number_of_sends = 1000;
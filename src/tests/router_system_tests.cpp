@@ -11,6 +11,8 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include "ssf/error/error.h"
+
 #include "ssf/system/system_interfaces.h"
 #include "ssf/system/system_routers.h"
 
@@ -21,7 +23,9 @@ class RouterSystemTestFixture : public ::testing::Test {
             "./system/system_multiple_config.json"),
         system_router_config_filename_("./system/router_config.json"),
         fail_system_router_config_filename_(
-            "./system/fail_router_config.json") {}
+            "./system/fail_router_config.json"),
+        fail_prefix_system_router_config_filename_(
+            "./system/fail_prefix_router_config.json") {}
 
   virtual ~RouterSystemTestFixture() {}
 
@@ -33,6 +37,7 @@ class RouterSystemTestFixture : public ::testing::Test {
   std::string system_multiple_interfaces_config_filename_;
   std::string system_router_config_filename_;
   std::string fail_system_router_config_filename_;
+  std::string fail_prefix_system_router_config_filename_;
 };
 
 TEST_F(RouterSystemTestFixture, FailImportRouters) {
@@ -66,6 +71,39 @@ TEST_F(RouterSystemTestFixture, FailImportRouters) {
   threads.join_all();
 }
 
+TEST_F(RouterSystemTestFixture, FailImportRoutersPrefixLength) {
+  boost::asio::io_service io_service;
+  boost::system::error_code ec;
+
+  ssf::system::SystemRouters system_routers(io_service);
+
+  system_routers.Start();
+
+  std::promise<bool> all_up;
+  auto all_routers_up =
+      [&all_up](const boost::system::error_code& ec) { all_up.set_value(!ec); };
+
+  // Prefix length 264 is longer than the address, it must not wrap to 8
+  ASSERT_EQ(0, system_routers.AsyncConfig(
+                   system_multiple_interfaces_config_filename_,
+                   fail_prefix_system_router_config_filename_, ec,
+                   all_routers_up));
+
+  ASSERT_EQ(ssf::error::invalid_argument, ec.value())
+      << "Error when configuring routers : " << ec.message();
+
+  boost::thread_group threads;
+  for (uint16_t i = 1; i <= boost::thread::hardware_concurrency(); ++i) {
+    threads.create_thread([&io_service]() { io_service.run(); });
+  }
+
+  ASSERT_FALSE(all_up.get_future().get()) << "All routers up";
+
+  system_routers.Stop();
+
+  threads.join_all();
+}
+
 TEST_F(RouterSystemTestFixture, ImportRouters) {
   boost::asio::io_service io_service;
 
@@ -1,10 +1,64 @@
 #include <gtest/gtest.h>
 
+#include <cstdint>
+
 #include "ssf/layer/parameters.h"
+#include "ssf/layer/routing/basic_routing_table.h"
 
 #include "tests/datagram_protocol_helpers.h"
 #include "tests/routing_test_fixture.h"
 
+struct RoutingTableTestProtocol {
+  typedef uint16_t endpoint_context_type;
+};
+
+TEST(RoutingTableTest, LongestPrefixMatchTest) {
+  ssf::layer::routing::basic_RoutingTable<RoutingTableTestProtocol> table;
+  boost::system::error_code ec;
+
+  table.Resolve(0x1234, ec);
+  ASSERT_NE(0, ec.value()) << "Empty table should not resolve";
+
+  table.AddRoute(0, 0, 1, ec);
+  ASSERT_EQ(0, ec.value());
+  table.AddRoute(0x1200, 8, 2, ec);
+  ASSERT_EQ(0, ec.value());
+  table.AddRoute(0x1234, 3, ec);
+  ASSERT_EQ(0, ec.value());
+
+  ASSERT_EQ(1, table.Resolve(0xFFFF, ec)) << "Default route";
+  ASSERT_EQ(0, ec.value());
+  ASSERT_EQ(2, table.Resolve(0x1235, ec)) << "Aggregated route";
+  ASSERT_EQ(3, table.Resolve(0x1234, ec)) << "Host route";
+
+  // Shorter prefix added last must not override longer ones
+  table.AddRoute(0x1000, 4, 4, ec);
+  ASSERT_EQ(4, table.Resolve(0x1F00, ec));
+  ASSERT_EQ(2, table.Resolve(0x12FF, ec));
+  ASSERT_EQ(3, table.Resolve(0x1234, ec));
+
+  table.RemoveRoute(0x1234, ec);
+  ASSERT_EQ(0, ec.value());
+  ASSERT_EQ(2, table.Resolve(0x1234, ec));
+
+  table.RemoveRoute(0x12AB, 8, ec);
+  ASSERT_EQ(0, ec.value()) << "Prefix bits beyond the length are ignored";
+  ASSERT_EQ(4, table.Resolve(0x1234, ec));
+
+  table.RemoveRoute(0x1200, 8, ec);
+  ASSERT_NE(0, ec.value()) << "Route already removed";
+
+  table.AddRoute(0, 17, 5, ec);
+  ASSERT_NE(0, ec.value()) << "Prefix longer than the address";
+  table.RemoveRoute(0, 17, ec);
+  ASSERT_EQ(ssf::error::invalid_argument, ec.value())
+      << "Prefix longer than the address";
+
+  table.Flush(ec);
+  table.Resolve(0xFFFF, ec);
+  ASSERT_NE(0, ec.value()) << "Flushed table should not resolve";
+}
+
 TEST_F(RoutingTestFixture, NetworkResolvingTest) {
   boost::asio::io_service io_service;
   boost::system::error_code ec;
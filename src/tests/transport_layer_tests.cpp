@@ -1,10 +1,803 @@
 #include <gtest/gtest.h>
 
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <limits>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_service.hpp>
+
 #include "tests/datagram_protocol_helpers.h"
 #include "tests/stream_protocol_helpers.h"
 #include "tests/transport_test_fixture.h"
 
+#include "ssf/error/error.h"
+
+#include "ssf/layer/congestion/byte_limit_policy.h"
+#include "ssf/layer/congestion/codel_policy.h"
+#include "ssf/layer/congestion/deficit_round_robin_scheduler.h"
+#include "ssf/layer/congestion/drop_tail_policy.h"
+#include "ssf/layer/congestion/fifo_scheduler.h"
+#include "ssf/layer/congestion/red_policy.h"
+#include "ssf/layer/multiplexing/basic_multiplexer.h"
+#include "ssf/layer/multiplexing/dispatch_table.h"
+#include "ssf/layer/multiplexing/port_multiplex_id.h"
+#include "ssf/layer/multiplexing/receive_ring.h"
 #include "ssf/layer/parameters.h"
+#include "ssf/layer/protocol_attributes.h"
+
+TEST(DispatchTableTest, PortPairLookupTest) {
+  typedef ssf::layer::multiplexing::PortID PortID;
+  typedef ssf::layer::multiplexing::DispatchTable<uint32_t> Table;
+
+  Table empty;
+  ASSERT_EQ(nullptr, empty.Find(0)) << "Empty table should not find";
+
+  std::vector<Table::Item> items;
+  for (uint32_t local = 1; local <= 200; ++local) {
+    for (uint32_t remote = 1; remote <= 100; ++remote) {
+      items.emplace_back(
+          ssf::layer::multiplexing::PackDispatchKey(
+              PortID(static_cast<uint16_t>(local)),
+              PortID(static_cast<uint16_t>(remote))),
+          local * 1000 + remote);
+    }
+  }
+
+  Table table(std::move(items));
+  ASSERT_EQ(20000U, table.size());
+
+  for (uint32_t local = 1; local <= 200; ++local) {
+    for (uint32_t remote = 1; remote <= 100; ++remote) {
+      auto p_value = table.Find(ssf::layer::multiplexing::PackDispatchKey(
+          PortID(static_cast<uint16_t>(local)),
+          PortID(static_cast<uint16_t>(remote))));
+      ASSERT_NE(nullptr, p_value);
+      ASSERT_EQ(local * 1000 + remote, *p_value);
+    }
+  }
+
+  ASSERT_EQ(nullptr,
+            table.Find(ssf::layer::multiplexing::PackDispatchKey(
+                PortID(1), PortID(101)))) << "Unbound remote id";
+  ASSERT_EQ(nullptr,
+            table.Find(ssf::layer::multiplexing::PackDispatchKey(
+                PortID(201), PortID(1)))) << "Unbound local id";
+  ASSERT_EQ(0x12340000ULL << 32,
+            ssf::layer::multiplexing::PackDispatchKey(PortID(0x1234),
+                                                      PortID(0)));
+}
+
+namespace {
+
+struct SchedulerTestDatagram {
+  struct Header {
+    typedef uint32_t ID;
+
+    uint32_t id_;
+    const uint32_t& id() const { return id_; }
+  };
+
+  std::vector<boost::asio::const_buffer> GetConstBuffers() const {
+    return std::vector<boost::asio::const_buffer>(
+        1, boost::asio::buffer(payload));
+  }
+
+  void GetConstBuffers(
+      std::vector<boost::asio::const_buffer>* p_buffers) const {
+    p_buffers->push_back(boost::asio::buffer(payload));
+  }
+
+  const Header& header() const { return header_; }
+
+  Header header_;
+  std::vector<uint8_t> payload;
+};
+
+struct SchedulerTestElement {
+  SchedulerTestDatagram datagram;
+};
+
+SchedulerTestElement MakeSchedulerTestElement(uint32_t flow, std::size_t size) {
+  SchedulerTestElement element;
+  element.datagram.header_.id_ = flow;
+  element.datagram.payload.resize(size);
+  return element;
+}
+
+struct PolicyTestQueue {
+  std::size_t size() const { return size_; }
+
+  std::size_t size_;
+};
+
+/// Flow 3 has the highest priority, flow 1 twice the weight of flow 2
+struct SchedulerTestClassifier {
+  static ssf::layer::congestion::FlowClass Classify(const uint32_t& flow) {
+    return ssf::layer::congestion::FlowClass(flow == 3 ? 0 : 1,
+                                             flow == 1 ? 2 : 1);
+  }
+};
+
+}  // namespace
+
+TEST(SchedulerTest, DeficitRoundRobinTest) {
+  typedef ssf::layer::congestion::DeficitRoundRobinScheduler<1500>::Queue<
+      SchedulerTestElement, uint32_t> Queue;
+  typedef ssf::layer::congestion::DeficitRoundRobinScheduler<
+      1500, SchedulerTestClassifier>::Queue<SchedulerTestElement, uint32_t>
+      ClassQueue;
+
+  // Interactive datagrams are not delayed by the backlog of a bulk flow
+  Queue queue;
+  for (int i = 0; i < 50; ++i) {
+    queue.push(MakeSchedulerTestElement(1, 1000));
+  }
+  queue.push(MakeSchedulerTestElement(2, 10));
+  queue.push(MakeSchedulerTestElement(2, 10));
+  ASSERT_EQ(52U, queue.size());
+
+  std::vector<uint32_t> flows;
+  while (!queue.empty()) {
+    flows.push_back(queue.front().datagram.header().id());
+    queue.pop();
+  }
+  ASSERT_EQ(52U, flows.size());
+  ASSERT_EQ(1U, flows[0]);
+  ASSERT_EQ(2U, flows[1]) << "Interactive flow waits for the bulk backlog";
+  ASSERT_EQ(2U, flows[2]) << "Interactive flow waits for the bulk backlog";
+
+  // Weights share the link, priorities preempt it
+  ClassQueue class_queue;
+  for (int i = 0; i < 30; ++i) {
+    class_queue.push(MakeSchedulerTestElement(1, 500));
+    class_queue.push(MakeSchedulerTestElement(2, 500));
+  }
+
+  // Rounds of 6 datagrams of flow 1 and 3 datagrams of flow 2
+  uint32_t served[3] = {0, 0, 0};
+  for (int i = 0; i < 27; ++i) {
+    ++served[class_queue.front().datagram.header().id()];
+    class_queue.pop();
+  }
+  ASSERT_EQ(18U, served[1]) << "Weighted share of flow 1";
+  ASSERT_EQ(9U, served[2]) << "Weighted share of flow 2";
+
+  class_queue.push(MakeSchedulerTestElement(3, 500));
+  ASSERT_EQ(3U, class_queue.front().datagram.header().id())
+      << "Priority flow not served first";
+  class_queue.pop();
+  ASSERT_EQ(33U, class_queue.size());
+
+  // A flow always gets credit, whatever its configured weight
+  ASSERT_EQ(1U, ssf::layer::congestion::FlowClass(0, 0).weight);
+}
+
+TEST(CongestionPolicyTest, SizeLimitsTest) {
+  auto packet = MakeSchedulerTestElement(1, 400).datagram;
+  PolicyTestQueue queue = {0};
+
+  ssf::layer::congestion::DropTailPolicy<3> drop_tail;
+  for (int i = 0; i < 5; ++i) {
+    if (drop_tail.IsAddable(queue, packet)) {
+      ++queue.size_;
+    }
+  }
+  ASSERT_EQ(3U, queue.size_);
+  ASSERT_EQ(2U, drop_tail.dropped_packets());
+  ASSERT_EQ(800U, drop_tail.dropped_bytes());
+
+  typedef ssf::layer::congestion::FifoScheduler::Queue<SchedulerTestElement,
+                                                       uint32_t> FifoQueue;
+  typedef ssf::layer::congestion::DeficitRoundRobinScheduler<1500>::Queue<
+      SchedulerTestElement, uint32_t> DRRQueue;
+
+  // The policy reads the queued bytes from the queue
+  FifoQueue fifo_queue;
+  ssf::layer::congestion::ByteLimitPolicy<1000> byte_limit;
+  for (int i = 0; i < 3; ++i) {
+    if (byte_limit.IsAddable(fifo_queue, packet)) {
+      fifo_queue.push(MakeSchedulerTestElement(1, 400));
+    }
+  }
+  ASSERT_EQ(2U, fifo_queue.size()) << "Byte limit exceeded";
+  ASSERT_EQ(800U, fifo_queue.bytes());
+
+  fifo_queue.pop();
+  ASSERT_EQ(400U, fifo_queue.bytes());
+  ASSERT_TRUE(byte_limit.IsAddable(fifo_queue, packet))
+      << "Dequeued bytes kept";
+  ASSERT_EQ(1U, byte_limit.dropped_packets());
+
+  // The second datagram of flow 1 leaves before the older one of flow 2
+  DRRQueue drr_queue;
+  drr_queue.push(MakeSchedulerTestElement(1, 100));
+  drr_queue.push(MakeSchedulerTestElement(2, 800));
+  drr_queue.push(MakeSchedulerTestElement(1, 100));
+  ASSERT_EQ(1000U, drr_queue.bytes());
+
+  drr_queue.pop();
+  drr_queue.pop();
+  ASSERT_EQ(2U, drr_queue.front().datagram.header().id());
+  ASSERT_EQ(800U, drr_queue.bytes());
+
+  auto small_packet = MakeSchedulerTestElement(1, 300).datagram;
+  ASSERT_FALSE(byte_limit.IsAddable(drr_queue, small_packet))
+      << "Bytes of the scheduled queue not counted";
+  ASSERT_EQ(2U, byte_limit.dropped_packets());
+  ASSERT_EQ(700U, byte_limit.dropped_bytes());
+}
+
+TEST(CongestionPolicyTest, REDTest) {
+  auto packet = MakeSchedulerTestElement(1, 100).datagram;
+  PolicyTestQueue queue = {5};
+
+  ssf::layer::congestion::REDPolicy<10, 30> red;
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(red.IsAddable(queue, packet)) << "Drop under min size";
+  }
+
+  // Without dequeue, the queue is bounded by the drops
+  for (int i = 0; i < 1000; ++i) {
+    if (red.IsAddable(queue, packet)) {
+      ++queue.size_;
+    }
+  }
+  ASSERT_LT(queue.size_, 60U);
+  ASSERT_EQ(1000U - (queue.size_ - 5), red.dropped_packets());
+  ASSERT_EQ(100U * red.dropped_packets(), red.dropped_bytes());
+}
+
+TEST(CongestionPolicyTest, CoDelTest) {
+  auto packet = MakeSchedulerTestElement(1, 100).datagram;
+  PolicyTestQueue queue = {0};
+
+  // Target 2 ms, interval 20 ms
+  ssf::layer::congestion::CoDelPolicy<2, 20> codel;
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(codel.IsAddable(queue, packet));
+    ++queue.size_;
+  }
+
+  // Sojourn over target for less than an interval
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  ASSERT_TRUE(codel.IsAddable(queue, packet));
+  ++queue.size_;
+
+  // Standing queue for more than an interval
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  ASSERT_FALSE(codel.IsAddable(queue, packet)) << "Standing queue not dropped";
+  ASSERT_EQ(1U, codel.dropped_packets());
+
+  // Queue drained
+  queue.size_ = 0;
+  ASSERT_TRUE(codel.IsAddable(queue, packet));
+  ASSERT_EQ(1U, codel.dropped_packets());
+}
+
+namespace {
+
+/// Stream next layer recording the written bytes and the completed writes
+///   Writes fail with broken_pipe once fail_after bytes are written. The
+///   handlers only run with the io_service
+class MultiplexerTestStream {
+ public:
+  struct protocol_type {
+    enum { facilities = ssf::layer::facilities::stream };
+  };
+
+ public:
+  explicit MultiplexerTestStream(boost::asio::io_service& io_service)
+      : data(),
+        completed_writes(0),
+        fail_after(std::numeric_limits<std::size_t>::max()),
+        io_service_(io_service) {}
+
+  boost::asio::io_service& get_io_service() { return io_service_; }
+
+  template <class ConstBufferSequence, class Handler>
+  void async_write_some(const ConstBufferSequence& buffers, Handler&& handler) {
+    auto length = std::min(boost::asio::buffer_size(buffers),
+                           fail_after - data.size());
+    auto ec = length ? boost::system::error_code()
+                     : boost::asio::error::make_error_code(
+                           boost::asio::error::broken_pipe);
+
+    auto offset = data.size();
+    data.resize(offset + length);
+    boost::asio::buffer_copy(boost::asio::buffer(data.data() + offset, length),
+                             buffers);
+
+    io_service_.post([this, handler, ec, length]() mutable {
+      ++completed_writes;
+      handler(ec, length);
+    });
+  }
+
+ public:
+  std::vector<uint8_t> data;
+  std::size_t completed_writes;
+  std::size_t fail_after;
+
+ private:
+  boost::asio::io_service& io_service_;
+};
+
+typedef ssf::layer::multiplexing::basic_Multiplexer<
+    std::shared_ptr<MultiplexerTestStream>, SchedulerTestDatagram, uint32_t,
+    ssf::layer::congestion::DropTailPolicy<1000>,
+    ssf::layer::congestion::FifoScheduler> TestMultiplexer;
+
+struct SentResult {
+  boost::system::error_code ec;
+  std::size_t length;
+  /// Completed writes when the handler ran
+  std::size_t completed_writes;
+};
+
+/// Number of datagrams in each gathered write
+///   The handlers of a batch run before the writes of the next batch
+///   complete, they all see the same count of completed writes
+std::vector<std::size_t> BatchSizes(const std::vector<SentResult>& results) {
+  std::vector<std::size_t> batches;
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    if (!i ||
+        results[i].completed_writes != results[i - 1].completed_writes) {
+      batches.push_back(0);
+    }
+    ++batches.back();
+  }
+
+  return batches;
+}
+
+/// Send datagrams of the given sizes filled with their index on the stream
+///   The first one is written alone, the next ones are queued behind it
+///   and gathered when the io_service runs
+std::vector<SentResult> SendDatagrams(
+    std::shared_ptr<MultiplexerTestStream> p_stream,
+    const std::vector<std::size_t>& sizes) {
+  auto p_multiplexer = TestMultiplexer::Create(p_stream);
+
+  std::vector<SentResult> results(sizes.size(), SentResult{{}, 0, 0});
+  std::vector<uint32_t> order;
+  for (uint32_t i = 0; i < sizes.size(); ++i) {
+    auto datagram = MakeSchedulerTestElement(i, sizes[i]).datagram;
+    std::fill(datagram.payload.begin(), datagram.payload.end(),
+              static_cast<uint8_t>(i));
+    p_multiplexer->Send(
+        std::move(datagram), 0,
+        [i, p_stream, &results, &order](const boost::system::error_code& ec,
+                                        std::size_t length) {
+          results[i].ec = ec;
+          results[i].length = length;
+          results[i].completed_writes = p_stream->completed_writes;
+          order.push_back(i);
+        });
+  }
+
+  p_stream->get_io_service().reset();
+  p_stream->get_io_service().run();
+
+  EXPECT_EQ(sizes.size(), order.size()) << "Handlers not all called";
+  for (uint32_t i = 0; i < order.size(); ++i) {
+    EXPECT_EQ(i, order[i]) << "Handlers not called in order";
+  }
+
+  return results;
+}
+
+}  // namespace
+
+TEST(MultiplexerTest, StreamFramingTest) {
+  std::vector<std::size_t> sizes;
+  for (std::size_t i = 0; i < 40; ++i) {
+    sizes.push_back(1 + (i * 397) % 1500);
+  }
+
+  boost::asio::io_service io_service;
+  auto p_stream = std::make_shared<MultiplexerTestStream>(io_service);
+  auto results = SendDatagrams(p_stream, sizes);
+
+  std::vector<uint8_t> expected;
+  for (std::size_t i = 0; i < sizes.size(); ++i) {
+    ASSERT_EQ(0, results[i].ec.value()) << "Datagram " << i;
+    ASSERT_EQ(sizes[i], results[i].length) << "Datagram " << i;
+    expected.insert(expected.end(), sizes[i], static_cast<uint8_t>(i));
+  }
+
+  // The first datagram is written alone, the others are gathered
+  ASSERT_EQ(expected, p_stream->data) << "Datagrams not framed in order";
+  ASSERT_EQ(std::vector<std::size_t>({1, sizes.size() - 1}),
+            BatchSizes(results));
+}
+
+TEST(MultiplexerTest, PartialWriteErrorTest) {
+  std::vector<std::size_t> sizes(8, 100);
+
+  // The link fails in the middle of datagram 4
+  boost::asio::io_service io_service;
+  auto p_stream = std::make_shared<MultiplexerTestStream>(io_service);
+  p_stream->fail_after = 450;
+  auto results = SendDatagrams(p_stream, sizes);
+
+  for (std::size_t i = 0; i < 4; ++i) {
+    ASSERT_EQ(0, results[i].ec.value()) << "Datagram " << i << " was written";
+    ASSERT_EQ(100U, results[i].length);
+  }
+
+  ASSERT_EQ(boost::asio::error::broken_pipe, results[4].ec.value());
+  ASSERT_EQ(50U, results[4].length);
+
+  for (std::size_t i = 5; i < sizes.size(); ++i) {
+    ASSERT_EQ(boost::asio::error::broken_pipe, results[i].ec.value())
+        << "Datagram " << i << " was not written";
+    ASSERT_EQ(0U, results[i].length);
+  }
+  ASSERT_EQ(450U, p_stream->data.size());
+  ASSERT_EQ(std::vector<std::size_t>({1, 7}), BatchSizes(results));
+}
+
+TEST(MultiplexerTest, BatchLimitsTest) {
+  // 13 datagrams of 5000 bytes fit in max_batch_bytes, not 14
+  std::vector<std::size_t> sizes(20, 5000);
+
+  boost::asio::io_service io_service;
+  auto p_stream = std::make_shared<MultiplexerTestStream>(io_service);
+  auto results = SendDatagrams(p_stream, sizes);
+
+  ASSERT_EQ(std::vector<std::size_t>({1, 13, 6}), BatchSizes(results))
+      << "max_batch_bytes not respected";
+
+  // A datagram over max_batch_bytes is sent alone
+  sizes.assign(1, 10);
+  sizes.push_back(TestMultiplexer::max_batch_bytes + 1);
+  sizes.push_back(10);
+  p_stream = std::make_shared<MultiplexerTestStream>(io_service);
+  results = SendDatagrams(p_stream, sizes);
+
+  ASSERT_EQ(std::vector<std::size_t>({1, 1, 1}), BatchSizes(results));
+  ASSERT_EQ(sizes[1], results[1].length);
+
+  // At most max_batch_datagrams datagrams per write
+  sizes.assign(TestMultiplexer::max_batch_datagrams + 6, 10);
+  p_stream = std::make_shared<MultiplexerTestStream>(io_service);
+  results = SendDatagrams(p_stream, sizes);
+
+  ASSERT_EQ(std::vector<std::size_t>(
+                {1, TestMultiplexer::max_batch_datagrams, 5}),
+            BatchSizes(results)) << "max_batch_datagrams not respected";
+}
+
+TEST(MultiplexerTest, DropStatsTest) {
+  typedef ssf::layer::multiplexing::basic_Multiplexer<
+      std::shared_ptr<MultiplexerTestStream>, SchedulerTestDatagram, uint32_t,
+      ssf::layer::congestion::DropTailPolicy<2>,
+      ssf::layer::congestion::FifoScheduler> Multiplexer;
+
+  boost::asio::io_service io_service;
+  auto p_stream = std::make_shared<MultiplexerTestStream>(io_service);
+  auto p_multiplexer = Multiplexer::Create(p_stream);
+
+  // The first datagram is being written, two are queued, two are dropped
+  uint32_t no_buffer_space = 0;
+  for (int i = 0; i < 5; ++i) {
+    p_multiplexer->Send(
+        MakeSchedulerTestElement(1, 100).datagram, 0,
+        [&no_buffer_space](const boost::system::error_code& ec, std::size_t) {
+          if (ec.value() == ssf::error::no_buffer_space) {
+            ++no_buffer_space;
+          }
+        });
+  }
+
+  auto stats = p_multiplexer->GetDropStats();
+  ASSERT_EQ(2U, stats.packets);
+  ASSERT_EQ(200U, stats.bytes);
+
+  io_service.run();
+  ASSERT_EQ(2U, no_buffer_space);
+}
+
+class MultiplexedReceiveTest : public RoutingTestFixture {
+ protected:
+  using MultiplexedProtocol =
+      ssf::layer::multiplexing::basic_MultiplexedProtocol<
+          RoutedProtocol, ssf::layer::multiplexing::PortID,
+          ssf::layer::congestion::DropTailPolicy<100>>;
+  using Buffer = std::vector<uint8_t>;
+
+ protected:
+  MultiplexedReceiveTest()
+      : RoutingTestFixture(),
+        socket1_(this->io_service_),
+        socket2_(this->io_service_) {}
+
+  virtual void SetUp() {
+    RoutingTestFixture::SetUp();
+
+    boost::system::error_code ec;
+    MultiplexedProtocol::resolver resolver(this->io_service_);
+
+    auto socket1_endpoint_it =
+        resolver.resolve(MultiplexedParameters("1", "7"), ec);
+    ASSERT_EQ(0, ec.value()) << ec.message();
+    auto socket2_endpoint_it =
+        resolver.resolve(MultiplexedParameters("2", "5"), ec);
+    ASSERT_EQ(0, ec.value()) << ec.message();
+    socket2_endpoint_ = *socket2_endpoint_it;
+
+    socket1_.open();
+    socket1_.bind(*socket1_endpoint_it, ec);
+    ASSERT_EQ(0, ec.value()) << "Bind socket1: " << ec.message();
+    socket2_.open();
+    socket2_.bind(socket2_endpoint_, ec);
+    ASSERT_EQ(0, ec.value()) << "Bind socket2: " << ec.message();
+  }
+
+  virtual void TearDown() {
+    boost::system::error_code ec;
+    socket1_.close(ec);
+    socket2_.close(ec);
+
+    RoutingTestFixture::TearDown();
+  }
+
+  static ssf::layer::ParameterStack MultiplexedParameters(
+      const std::string& port, const std::string& address) {
+    ssf::layer::LayerParameters multiplexed_parameters;
+    multiplexed_parameters["port"] = port;
+    ssf::layer::LayerParameters routed_parameters;
+    routed_parameters["network_address"] = address;
+    routed_parameters["router"] = "router1";
+
+    ssf::layer::ParameterStack parameters;
+    parameters.push_back(multiplexed_parameters);
+    parameters.push_back(routed_parameters);
+
+    return parameters;
+  }
+
+  /// Send size bytes datagrams headed by their index, one after the other
+  bool Send(uint32_t first, uint32_t count, std::size_t size) {
+    for (uint32_t i = first; i < first + count; ++i) {
+      Buffer buffer(size, static_cast<uint8_t>(i));
+      std::memcpy(buffer.data(), &i, sizeof(i));
+
+      std::promise<boost::system::error_code> sent;
+      socket1_.async_send_to(
+          boost::asio::buffer(buffer), socket2_endpoint_,
+          [&sent](const boost::system::error_code& ec, std::size_t) {
+            sent.set_value(ec);
+          });
+
+      auto ec = sent.get_future().get();
+      if (ec) {
+        ADD_FAILURE() << "Send should not be in error: " << ec.message();
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /// Wait until a first_size bytes datagram is queued for socket2
+  bool WaitQueued(std::size_t first_size) {
+    boost::system::error_code ec;
+    for (int i = 0; i < 500; ++i) {
+      if (socket2_.available(ec) == first_size) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return false;
+  }
+
+ protected:
+  MultiplexedProtocol::socket socket1_;
+  MultiplexedProtocol::socket socket2_;
+  MultiplexedProtocol::endpoint socket2_endpoint_;
+};
+
+TEST_F(MultiplexedReceiveTest, QueuedThenWaitingOrderTest) {
+  const uint32_t queued = 40;
+  const uint32_t delivered = 40;
+  const std::size_t size = 100;
+
+  // Datagrams queued before any read
+  ASSERT_TRUE(Send(0, queued, size));
+  ASSERT_TRUE(WaitQueued(size));
+
+  Buffer r_buffer(MultiplexedProtocol::mtu);
+  MultiplexedProtocol::endpoint r_endpoint;
+  std::promise<bool> finished;
+  std::atomic<uint32_t> received(0);
+  std::function<void(const boost::system::error_code&, std::size_t)>
+      received_handler;
+
+  received_handler = [&](const boost::system::error_code& ec,
+                         std::size_t length) {
+    uint32_t index = 0;
+    if (!ec && length >= sizeof(index)) {
+      std::memcpy(&index, r_buffer.data(), sizeof(index));
+    }
+
+    if (ec || length != size || index != received) {
+      ADD_FAILURE() << "Datagram " << received << " : " << ec.message()
+                    << ", length " << length << ", index " << index;
+      finished.set_value(false);
+      return;
+    }
+
+    if (++received == queued + delivered) {
+      finished.set_value(true);
+      return;
+    }
+
+    socket2_.async_receive_from(boost::asio::buffer(r_buffer), r_endpoint,
+                                received_handler);
+  };
+
+  // Drain the ring then keep a read waiting for the next datagrams
+  socket2_.async_receive_from(boost::asio::buffer(r_buffer), r_endpoint,
+                              received_handler);
+  ASSERT_TRUE(Send(queued, delivered, size));
+
+  auto future = finished.get_future();
+  ASSERT_EQ(std::future_status::ready,
+            future.wait_for(std::chrono::seconds(10)))
+      << "Datagrams not all received";
+  ASSERT_TRUE(future.get());
+}
+
+TEST_F(MultiplexedReceiveTest, MessageSizeTest) {
+  const std::size_t size = 100;
+
+  ASSERT_TRUE(Send(0, 1, size));
+  ASSERT_TRUE(WaitQueued(size));
+
+  Buffer short_buffer(size - 1);
+  Buffer r_buffer(MultiplexedProtocol::mtu);
+  MultiplexedProtocol::endpoint r_endpoint;
+
+  std::promise<std::pair<boost::system::error_code, std::size_t>> short_read;
+  socket2_.async_receive_from(
+      boost::asio::buffer(short_buffer), r_endpoint,
+      [&short_read](const boost::system::error_code& ec, std::size_t length) {
+        short_read.set_value(std::make_pair(ec, length));
+      });
+  auto short_result = short_read.get_future().get();
+  ASSERT_EQ(ssf::error::message_size, short_result.first.value())
+      << "Short buffer should not truncate the datagram";
+  ASSERT_EQ(0U, short_result.second);
+
+  // The datagram stays for the next read
+  boost::system::error_code ec;
+  ASSERT_EQ(size, socket2_.available(ec));
+
+  std::promise<std::pair<boost::system::error_code, std::size_t>> read;
+  socket2_.async_receive_from(
+      boost::asio::buffer(r_buffer), r_endpoint,
+      [&read](const boost::system::error_code& ec, std::size_t length) {
+        read.set_value(std::make_pair(ec, length));
+      });
+  auto result = read.get_future().get();
+  ASSERT_EQ(0, result.first.value()) << result.first.message();
+  ASSERT_EQ(size, result.second);
+
+  uint32_t index = 1;
+  std::memcpy(&index, r_buffer.data(), sizeof(index));
+  ASSERT_EQ(0U, index);
+}
+
+TEST_F(MultiplexedReceiveTest, CancelWaitingReadTest) {
+  Buffer r_buffer(MultiplexedProtocol::mtu);
+  MultiplexedProtocol::endpoint r_endpoint;
+
+  std::promise<boost::system::error_code> cancelled;
+  socket2_.async_receive_from(
+      boost::asio::buffer(r_buffer), r_endpoint,
+      [&cancelled](const boost::system::error_code& ec, std::size_t) {
+        cancelled.set_value(ec);
+      });
+
+  boost::system::error_code ec;
+  socket2_.cancel(ec);
+  ASSERT_EQ(0, ec.value()) << ec.message();
+
+  auto future = cancelled.get_future();
+  ASSERT_EQ(std::future_status::ready,
+            future.wait_for(std::chrono::seconds(10)))
+      << "Cancelled read not completed";
+  ASSERT_EQ(boost::asio::error::operation_aborted, future.get().value());
+
+  // The socket still receives after the cancel
+  const std::size_t size = 50;
+  std::promise<std::pair<boost::system::error_code, std::size_t>> read;
+  socket2_.async_receive_from(
+      boost::asio::buffer(r_buffer), r_endpoint,
+      [&read](const boost::system::error_code& ec, std::size_t length) {
+        read.set_value(std::make_pair(ec, length));
+      });
+  ASSERT_TRUE(Send(0, 1, size));
+
+  auto result = read.get_future().get();
+  ASSERT_EQ(0, result.first.value()) << result.first.message();
+  ASSERT_EQ(size, result.second);
+}
+
+/// Receive ring over the datagram type of the multiplexed socket contexts
+class ReceiveRingTest : public MultiplexedReceiveTest {
+ protected:
+  using Datagram = MultiplexedProtocol::ReceiveDatagram;
+  using Pool = MultiplexedProtocol::ReceivePayload::Pool;
+  using Ring = ssf::layer::multiplexing::ReceiveRing<Datagram, uint32_t>;
+};
+
+TEST_F(ReceiveRingTest, SpareBuffersTest) {
+  const std::size_t used = Pool::UsedBlocks();
+  const uint32_t burst = 4 * Ring::max_spares;
+
+  {
+    Ring ring;
+    ASSERT_EQ(used, Pool::UsedBlocks()) << "Empty ring should hold no buffer";
+
+    for (uint32_t i = 0; i < burst; ++i) {
+      Datagram datagram;
+      datagram.payload().SetSize(sizeof(i));
+      auto buffers = datagram.payload().GetMutableBuffers();
+      boost::asio::buffer_copy(buffers, boost::asio::buffer(&i, sizeof(i)));
+      uint32_t endpoint = i;
+      ring.push(datagram, endpoint, datagram.payload().GetSize());
+    }
+    ASSERT_EQ(burst, ring.size());
+    ASSERT_EQ(sizeof(uint32_t) * burst, ring.bytes());
+    ASSERT_EQ(used + burst, Pool::UsedBlocks())
+        << "Growing ring should not allocate buffers";
+
+    for (uint32_t i = 0; i < burst; ++i) {
+      uint32_t index = 0;
+      boost::asio::buffer_copy(
+          boost::asio::buffer(&index, sizeof(index)),
+          ring.front().datagram->payload().GetConstBuffers());
+      ASSERT_EQ(i, index) << "Ring not in order";
+      ASSERT_EQ(i, ring.front().next_endpoint);
+      ring.pop();
+    }
+    ASSERT_TRUE(ring.empty());
+    ASSERT_EQ(0U, ring.bytes());
+    ASSERT_EQ(used + Ring::max_spares, Pool::UsedBlocks())
+        << "Drained ring should keep max_spares buffers";
+
+    // Each push hands back the datagram kept by the slot, if any, the others
+    // leave a moved from datagram without buffer
+    uint32_t spares = 0;
+    for (uint32_t i = 0; i < burst; ++i) {
+      Datagram datagram;
+      uint32_t endpoint = 0;
+      ring.push(datagram, endpoint, 0);
+      if (datagram.payload().GetSize() == sizeof(uint32_t)) {
+        ++spares;
+      }
+    }
+    ASSERT_EQ(static_cast<uint32_t>(Ring::max_spares), spares);
+    ASSERT_EQ(used + burst, Pool::UsedBlocks());
+  }
+
+  ASSERT_EQ(used, Pool::UsedBlocks()) << "Ring buffers not released";
+}
 
 TEST_F(TransportTestFixture, DatagramTransportTest) {}
 